@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// AllocationCounter.cpp
+// ============
+// counts the heap allocations made through operator new on a thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// plain thread locals, so counting needs no locking and
+	// cannot allocate itself
+	thread_local bool t_bCounting = false;
+	thread_local uint64_t t_Count = 0;
+	thread_local uint64_t t_Bytes = 0;
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for turning the counting on or off
+ *  for the calling thread.
+ ***********************************************************/
+void AllocationCounter::Enable(bool bEnable)
+{
+	t_bCounting = bEnable;
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of counted
+ *  allocations.
+ ***********************************************************/
+uint64_t AllocationCounter::GetCount()
+{
+	return(t_Count);
+}
+
+/***********************************************************
+ *  GetBytes()
+ *
+ *  This method is used for getting the total size of the
+ *  counted allocations.
+ ***********************************************************/
+uint64_t AllocationCounter::GetBytes()
+{
+	return(t_Bytes);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for clearing the totals, usually at
+ *  the start of a frame.
+ ***********************************************************/
+void AllocationCounter::Reset()
+{
+	t_Count = 0;
+	t_Bytes = 0;
+}
+
+/***********************************************************
+ *  Count()
+ *
+ *  This method is used for adding one allocation to the
+ *  totals when counting is turned on.
+ ***********************************************************/
+void AllocationCounter::Count(size_t size)
+{
+	if (t_bCounting == true)
+	{
+		t_Count++;
+		t_Bytes += size;
+	}
+}
+
+/***********************************************************
+ *  Replaced allocation functions
+ *
+ *  The array and nothrow forms of the standard library
+ *  call these, so replacing the plain forms counts every
+ *  allocation made with new apart from over-aligned ones.
+ ***********************************************************/
+void* operator new(size_t size)
+{
+	AllocationCounter::Count(size);
+
+	void* pMemory = malloc((size > 0) ? size : 1);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// counts the heap allocations made through operator new on a thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  This class contains the allocation counts.  The global
+ *  operator new is replaced in AllocationCounter.cpp, and
+ *  while counting is turned on for a thread every
+ *  allocation that thread makes adds to its totals.  Other
+ *  threads, and allocations made with malloc(), are not
+ *  counted.
+ ***********************************************************/
+class AllocationCounter
+{
+public:
+	// turn the counting on or off for the calling thread
+	static void Enable(bool bEnable);
+
+	// get the allocations and their bytes counted on the
+	// calling thread since the last Reset()
+	static uint64_t GetCount();
+	static uint64_t GetBytes();
+	static void Reset();
+
+	// called by the replaced operator new
+	static void Count(size_t size);
+};
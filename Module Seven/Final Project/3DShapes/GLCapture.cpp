@@ -0,0 +1,1953 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLCapture.cpp
+// ============
+// records every GL call of one frame, with the objects and state it starts
+// from, into a file the GLReplay tool can re-issue offline
+///////////////////////////////////////////////////////////////////////////////
+
+#define GL_CAPTURE_NO_REDIRECT
+#include "GLCapture.h"
+#include "GLCaptureFormat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+// the entry points GLEW loads through pointers that are hooked
+#define GL_CAPTURE_HOOKS(HOOK) \
+	HOOK(PFNGLACTIVETEXTUREPROC, ActiveTexture) \
+	HOOK(PFNGLGENERATEMIPMAPPROC, GenerateMipmap) \
+	HOOK(PFNGLTEXBUFFERPROC, TexBuffer) \
+	HOOK(PFNGLGENBUFFERSPROC, GenBuffers) \
+	HOOK(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+	HOOK(PFNGLBINDBUFFERPROC, BindBuffer) \
+	HOOK(PFNGLBUFFERDATAPROC, BufferData) \
+	HOOK(PFNGLBUFFERSUBDATAPROC, BufferSubData) \
+	HOOK(PFNGLCOPYBUFFERSUBDATAPROC, CopyBufferSubData) \
+	HOOK(PFNGLMAPBUFFERRANGEPROC, MapBufferRange) \
+	HOOK(PFNGLUNMAPBUFFERPROC, UnmapBuffer) \
+	HOOK(PFNGLBINDBUFFERRANGEPROC, BindBufferRange) \
+	HOOK(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays) \
+	HOOK(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays) \
+	HOOK(PFNGLBINDVERTEXARRAYPROC, BindVertexArray) \
+	HOOK(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer) \
+	HOOK(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray) \
+	HOOK(PFNGLDISABLEVERTEXATTRIBARRAYPROC, DisableVertexAttribArray) \
+	HOOK(PFNGLVERTEXATTRIB4FPROC, VertexAttrib4f) \
+	HOOK(PFNGLMULTIDRAWARRAYSPROC, MultiDrawArrays) \
+	HOOK(PFNGLMULTIDRAWELEMENTSPROC, MultiDrawElements) \
+	HOOK(PFNGLDRAWELEMENTSBASEVERTEXPROC, DrawElementsBaseVertex) \
+	HOOK(PFNGLDRAWBUFFERSPROC, DrawBuffers) \
+	HOOK(PFNGLGENFRAMEBUFFERSPROC, GenFramebuffers) \
+	HOOK(PFNGLDELETEFRAMEBUFFERSPROC, DeleteFramebuffers) \
+	HOOK(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer) \
+	HOOK(PFNGLFRAMEBUFFERTEXTURE2DPROC, FramebufferTexture2D) \
+	HOOK(PFNGLFRAMEBUFFERRENDERBUFFERPROC, FramebufferRenderbuffer) \
+	HOOK(PFNGLGENRENDERBUFFERSPROC, GenRenderbuffers) \
+	HOOK(PFNGLDELETERENDERBUFFERSPROC, DeleteRenderbuffers) \
+	HOOK(PFNGLBINDRENDERBUFFERPROC, BindRenderbuffer) \
+	HOOK(PFNGLRENDERBUFFERSTORAGEPROC, RenderbufferStorage) \
+	HOOK(PFNGLPRIMITIVERESTARTINDEXPROC, PrimitiveRestartIndex) \
+	HOOK(PFNGLCREATESHADERPROC, CreateShader) \
+	HOOK(PFNGLSHADERSOURCEPROC, ShaderSource) \
+	HOOK(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+	HOOK(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+	HOOK(PFNGLATTACHSHADERPROC, AttachShader) \
+	HOOK(PFNGLUSEPROGRAMPROC, UseProgram) \
+	HOOK(PFNGLUNIFORMBLOCKBINDINGPROC, UniformBlockBinding) \
+	HOOK(PFNGLUNIFORM1IPROC, Uniform1i) \
+	HOOK(PFNGLUNIFORM1IVPROC, Uniform1iv) \
+	HOOK(PFNGLUNIFORM1FPROC, Uniform1f) \
+	HOOK(PFNGLUNIFORM1FVPROC, Uniform1fv) \
+	HOOK(PFNGLUNIFORM2FPROC, Uniform2f) \
+	HOOK(PFNGLUNIFORM2FVPROC, Uniform2fv) \
+	HOOK(PFNGLUNIFORM3FPROC, Uniform3f) \
+	HOOK(PFNGLUNIFORM3FVPROC, Uniform3fv) \
+	HOOK(PFNGLUNIFORM4FPROC, Uniform4f) \
+	HOOK(PFNGLUNIFORM4FVPROC, Uniform4fv) \
+	HOOK(PFNGLUNIFORMMATRIX3FVPROC, UniformMatrix3fv) \
+	HOOK(PFNGLUNIFORMMATRIX4FVPROC, UniformMatrix4fv)
+
+// entry points newer than the GL the engine needs, hooked
+// when the GL has them
+#define GL_CAPTURE_OPTIONAL_HOOKS(HOOK) \
+	HOOK(PFNGLBUFFERSTORAGEPROC, BufferStorage) \
+	HOOK(PFNGLMEMORYBARRIERPROC, MemoryBarrier)
+
+namespace
+{
+	// the texture units and vertex attributes saved in the
+	// snapshot, the engine uses far fewer
+	const GLint g_SnapshotTextureUnits = 16;
+	const GLint g_SnapshotAttributes = 16;
+	const GLint g_SnapshotUniformBindings = 8;
+	const GLint g_SnapshotDrawBuffers = 4;
+
+	// the GLEW entry points the hooks call through
+	struct GL_ENTRY_POINTS
+	{
+#define GL_CAPTURE_DECLARE(type, name) type name;
+		GL_CAPTURE_HOOKS(GL_CAPTURE_DECLARE)
+		GL_CAPTURE_OPTIONAL_HOOKS(GL_CAPTURE_DECLARE)
+#undef GL_CAPTURE_DECLARE
+	};
+
+	// a shader as it was created, for rebuilding programs
+	struct SHADER_SOURCE
+	{
+		GLenum type;
+		std::string source;
+	};
+
+	// a buffer range mapped for writing, with its contents
+	// as the capture last saved them
+	struct MAPPED_RANGE
+	{
+		GLintptr offset;
+		GLsizeiptr length;
+		GLbitfield access;
+		std::vector<unsigned char> contents;
+	};
+
+	// the drawing state saved at the start of a capture
+	struct DRAW_STATE
+	{
+		GLint program;
+		GLint vertexArray;
+		GLint arrayBuffer;
+		GLint activeTexture;
+		GLint textures[g_SnapshotTextureUnits];
+		GLint bufferTextures[g_SnapshotTextureUnits];
+		GLint framebuffer;
+		GLint renderbuffer;
+		GLboolean depthTest;
+		GLboolean blend;
+		GLboolean cullFace;
+		GLboolean primitiveRestart;
+		GLboolean scissorTest;
+		GLint blendSrcRGB;
+		GLint blendDstRGB;
+		GLint blendSrcAlpha;
+		GLint blendDstAlpha;
+		GLint depthFunc;
+		GLint cullFaceMode;
+		GLint polygonMode[2];
+		GLint viewport[4];
+		GLint scissorBox[4];
+		GLfloat clearColor[4];
+		GLint primitiveRestartIndex;
+		GLint packAlignment;
+		GLint unpackAlignment;
+		GLfloat attributes[g_SnapshotAttributes][4];
+		GLint uniformBuffers[g_SnapshotUniformBindings];
+		GLint64 uniformStarts[g_SnapshotUniformBindings];
+		GLint64 uniformSizes[g_SnapshotUniformBindings];
+	};
+
+	bool g_bInstalled = false;
+	bool g_bCapturePending = false;
+	bool g_bRecording = false;
+	std::string g_CaptureFile;
+	GL_ENTRY_POINTS g_Real;
+
+	// the objects created since Install()
+	std::set<GLuint> g_Objects[MAX_GLC_OBJECTS];
+	std::map<GLuint, GLenum> g_TextureTargets;
+	std::map<GLuint, SHADER_SOURCE> g_Shaders;
+	std::map<GLuint, std::vector<GLuint>> g_ProgramShaders;
+	std::map<GLuint, MAPPED_RANGE> g_MappedBuffers;
+
+	GLCaptureWriter g_Snapshot;
+	GLCaptureWriter g_Frame;
+	GLuint g_CaptureWidth = 0;
+	GLuint g_CaptureHeight = 0;
+
+	GLCapture::CALL_STATS g_CallStats = { 0, 0, 0, 0 };
+
+	/***********************************************************
+	 *  CountCall()
+	 *
+	 *  Adds a call to the state change count when it sets
+	 *  drawing state.  Draws and uniforms are counted by
+	 *  their own hooks.
+	 ***********************************************************/
+	void CountCall(GLCAPTURE_COMMAND command)
+	{
+		switch (command)
+		{
+		case GLC_ENABLE:
+		case GLC_DISABLE:
+		case GLC_BLEND_FUNC:
+		case GLC_DEPTH_FUNC:
+		case GLC_CULL_FACE:
+		case GLC_POLYGON_MODE:
+		case GLC_CLEAR_COLOR:
+		case GLC_VIEWPORT:
+		case GLC_BIND_TEXTURE:
+		case GLC_ACTIVE_TEXTURE:
+		case GLC_TEX_PARAMETER_I:
+		case GLC_PIXEL_STORE_I:
+		case GLC_READ_BUFFER:
+		case GLC_BIND_BUFFER:
+		case GLC_BIND_BUFFER_RANGE:
+		case GLC_UNIFORM_BLOCK_BINDING:
+		case GLC_DRAW_BUFFER:
+		case GLC_DRAW_BUFFERS:
+		case GLC_SCISSOR:
+		case GLC_BIND_VERTEX_ARRAY:
+		case GLC_VERTEX_ATTRIB_POINTER:
+		case GLC_ENABLE_VERTEX_ATTRIB_ARRAY:
+		case GLC_DISABLE_VERTEX_ATTRIB_ARRAY:
+		case GLC_VERTEX_ATTRIB_4F:
+		case GLC_BIND_FRAMEBUFFER:
+		case GLC_BIND_RENDERBUFFER:
+		case GLC_PRIMITIVE_RESTART_INDEX:
+		case GLC_USE_PROGRAM:
+			g_CallStats.stateChanges++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// count the triangles of a draw - strips joined with
+	// restart indices also count the joins
+	void CountTriangles(GLenum mode, GLsizei count)
+	{
+		if (mode == GL_TRIANGLES)
+		{
+			g_CallStats.triangles += count / 3;
+		}
+		else if (((mode == GL_TRIANGLE_STRIP) || (mode == GL_TRIANGLE_FAN)) && (count > 2))
+		{
+			g_CallStats.triangles += count - 2;
+		}
+	}
+
+	void CountDraw(GLenum mode, const GLsizei* count, GLsizei drawcount)
+	{
+		g_CallStats.drawCalls++;
+		for (GLsizei i = 0; i < drawcount; i++)
+		{
+			CountTriangles(mode, count[i]);
+		}
+	}
+
+	/***********************************************************
+	 *  RecordCall()
+	 *
+	 *  Records a call whose arguments are all 32 bit values.
+	 ***********************************************************/
+	void PutValue(float value) { g_Frame.PutFloat(value); }
+	template <typename T>
+	void PutValue(T value) { g_Frame.Put32((uint32_t)value); }
+
+	template <typename... ARGS>
+	void RecordCall(GLCAPTURE_COMMAND command, ARGS... args)
+	{
+		CountCall(command);
+		if (g_bRecording == false)
+		{
+			return;
+		}
+		g_Frame.Begin(command);
+		(PutValue(args), ...);
+		g_Frame.End();
+	}
+
+	// record the names passed to a glGen* or glDelete* call
+	void RecordNames(GLCAPTURE_COMMAND command, GLsizei n, const GLuint* pNames)
+	{
+		if (g_bRecording == false)
+		{
+			return;
+		}
+		g_Frame.Begin(command);
+		g_Frame.Put32((uint32_t)n);
+		for (GLsizei i = 0; i < n; i++)
+		{
+			g_Frame.Put32(pNames[i]);
+		}
+		g_Frame.End();
+	}
+
+	void TrackNames(GLCAPTURE_OBJECT type, GLsizei n, const GLuint* pNames, bool bCreated)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (bCreated == true)
+			{
+				g_Objects[type].insert(pNames[i]);
+			}
+			else
+			{
+				g_Objects[type].erase(pNames[i]);
+			}
+		}
+	}
+
+	void RecordUniform(
+		GLCAPTURE_UNIFORM kind,
+		GLint location,
+		GLsizei count,
+		GLboolean transpose,
+		const void* pValues,
+		size_t nValues)
+	{
+		g_CallStats.uniformUploads++;
+		if (g_bRecording == false)
+		{
+			return;
+		}
+		g_Frame.Begin(GLC_UNIFORM);
+		g_Frame.Put32(kind);
+		g_Frame.Put32((uint32_t)location);
+		g_Frame.Put32((uint32_t)count);
+		g_Frame.Put32(transpose);
+		g_Frame.PutBlock(pValues, nValues * sizeof(GLfloat));
+		g_Frame.End();
+	}
+
+	// bytes of a client image with the current unpack alignment
+	size_t GetImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+	{
+		size_t components = 4;
+		switch (format)
+		{
+		case GL_RED:
+		case GL_RED_INTEGER:
+		case GL_DEPTH_COMPONENT:
+			components = 1;
+			break;
+		case GL_RG:
+		case GL_RG_INTEGER:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+		case GL_RGB_INTEGER:
+			components = 3;
+			break;
+		}
+
+		size_t typeSize = 4;
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			typeSize = 1;
+			break;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			typeSize = 2;
+			break;
+		}
+
+		GLint alignment = 4;
+		::glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+
+		size_t rowSize = (size_t)width * components * typeSize;
+		size_t rowPitch = (rowSize + alignment - 1) / alignment * alignment;
+		return((height > 0) ? rowPitch * (height - 1) + rowSize : 0);
+	}
+
+	// indices from client memory are copied, otherwise the
+	// pointer is an offset into the element buffer
+	void PutElementIndices(GLsizei count, GLenum type, const void* indices)
+	{
+		GLint elementBuffer = 0;
+		::glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+		size_t indexSize = (type == GL_UNSIGNED_BYTE) ? 1 : (type == GL_UNSIGNED_SHORT) ? 2 : 4;
+
+		if (elementBuffer != 0)
+		{
+			g_Frame.Put64((uint64_t)(size_t)indices);
+			g_Frame.PutBlock(NULL, 0);
+		}
+		else
+		{
+			g_Frame.Put64(0);
+			g_Frame.PutBlock(indices, count * indexSize);
+		}
+	}
+
+	// the buffer bound to a target
+	GLuint GetBoundBuffer(GLenum target)
+	{
+		GLenum binding = GL_ARRAY_BUFFER_BINDING;
+		switch (target)
+		{
+		case GL_ELEMENT_ARRAY_BUFFER: binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
+		case GL_COPY_READ_BUFFER: binding = GL_COPY_READ_BUFFER_BINDING; break;
+		case GL_COPY_WRITE_BUFFER: binding = GL_COPY_WRITE_BUFFER_BINDING; break;
+		case GL_UNIFORM_BUFFER: binding = GL_UNIFORM_BUFFER_BINDING; break;
+		case GL_TEXTURE_BUFFER: binding = GL_TEXTURE_BUFFER_BINDING; break;
+		case GL_PIXEL_PACK_BUFFER: binding = GL_PIXEL_PACK_BUFFER_BINDING; break;
+		case GL_PIXEL_UNPACK_BUFFER: binding = GL_PIXEL_UNPACK_BUFFER_BINDING; break;
+		case GL_DRAW_INDIRECT_BUFFER: binding = GL_DRAW_INDIRECT_BUFFER_BINDING; break;
+		case GL_SHADER_STORAGE_BUFFER: binding = GL_SHADER_STORAGE_BUFFER_BINDING; break;
+		}
+
+		GLint buffer = 0;
+		::glGetIntegerv(binding, &buffer);
+		return((GLuint)buffer);
+	}
+
+	// read back part of a buffer through the copy read
+	// binding, which is put back afterwards
+	void ReadBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, std::vector<unsigned char>& data)
+	{
+		GLint readBuffer = 0;
+		::glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &readBuffer);
+
+		data.resize((size_t)length);
+		g_Real.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+		if (length > 0)
+		{
+			glGetBufferSubData(GL_COPY_READ_BUFFER, offset, length, data.data());
+		}
+		g_Real.BindBuffer(GL_COPY_READ_BUFFER, readBuffer);
+	}
+
+	// record the bytes of a mapped range that differ from
+	// the ones last saved
+	void RecordBufferWrite(GLuint buffer, MAPPED_RANGE& range, const std::vector<unsigned char>& contents)
+	{
+		size_t first = 0;
+		size_t last = contents.size();
+		if (range.contents.size() == contents.size())
+		{
+			while ((first < last) && (contents[first] == range.contents[first]))
+			{
+				first++;
+			}
+			while ((last > first) && (contents[last - 1] == range.contents[last - 1]))
+			{
+				last--;
+			}
+		}
+
+		if (first < last)
+		{
+			g_Frame.Begin(GLC_BUFFER_WRITE);
+			g_Frame.Put32(buffer);
+			g_Frame.Put64((uint64_t)range.offset + first);
+			g_Frame.PutBlock(&contents[first], last - first);
+			g_Frame.End();
+		}
+		range.contents = contents;
+	}
+
+	/***********************************************************
+	 *  RecordMappedWrites()
+	 *
+	 *  Records what was written through the persistent
+	 *  mappings since the last check, called before every
+	 *  draw and copy.  The GL lets a buffer be read while it
+	 *  is mapped persistent, other mappings are saved when
+	 *  they are unmapped.
+	 ***********************************************************/
+	void RecordMappedWrites()
+	{
+		if ((g_bRecording == false) || (g_MappedBuffers.empty() == true))
+		{
+			return;
+		}
+
+		std::vector<unsigned char> contents;
+		for (std::map<GLuint, MAPPED_RANGE>::iterator mapped = g_MappedBuffers.begin(); mapped != g_MappedBuffers.end(); ++mapped)
+		{
+			if ((mapped->second.access & GL_MAP_PERSISTENT_BIT) == 0)
+			{
+				continue;
+			}
+			ReadBufferRange(mapped->first, mapped->second.offset, mapped->second.length, contents);
+			RecordBufferWrite(mapped->first, mapped->second, contents);
+		}
+	}
+
+	// block indices can differ between drivers, so blocks
+	// are saved by name
+	std::string GetUniformBlockName(GLuint program, GLuint blockIndex)
+	{
+		GLchar name[256];
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program, blockIndex, sizeof(name), &length, name);
+		return(std::string(name, length));
+	}
+
+	/***********************************************************
+	 *  Hook functions
+	 *
+	 *  Each one calls the real entry point and records the
+	 *  call when a capture is running.
+	 ***********************************************************/
+	void GLAPIENTRY HookActiveTexture(GLenum texture)
+	{
+		g_Real.ActiveTexture(texture);
+		RecordCall(GLC_ACTIVE_TEXTURE, texture);
+	}
+
+	void GLAPIENTRY HookGenerateMipmap(GLenum target)
+	{
+		g_Real.GenerateMipmap(target);
+		RecordCall(GLC_GENERATE_MIPMAP, target);
+	}
+
+	void GLAPIENTRY HookTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+	{
+		g_Real.TexBuffer(target, internalformat, buffer);
+		RecordCall(GLC_TEX_BUFFER, target, internalformat, buffer);
+	}
+
+	void GLAPIENTRY HookGenBuffers(GLsizei n, GLuint* buffers)
+	{
+		g_Real.GenBuffers(n, buffers);
+		TrackNames(GLC_OBJECT_BUFFER, n, buffers, true);
+		RecordNames(GLC_GEN_BUFFERS, n, buffers);
+	}
+
+	void GLAPIENTRY HookDeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		RecordNames(GLC_DELETE_BUFFERS, n, buffers);
+		TrackNames(GLC_OBJECT_BUFFER, n, buffers, false);
+		for (GLsizei i = 0; i < n; i++)
+		{
+			g_MappedBuffers.erase(buffers[i]);
+		}
+		g_Real.DeleteBuffers(n, buffers);
+	}
+
+	void GLAPIENTRY HookBindBuffer(GLenum target, GLuint buffer)
+	{
+		g_Real.BindBuffer(target, buffer);
+		RecordCall(GLC_BIND_BUFFER, target, buffer);
+	}
+
+	void GLAPIENTRY HookBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		g_Real.BufferData(target, size, data, usage);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_BUFFER_DATA);
+			g_Frame.Put32(target);
+			g_Frame.Put64((uint64_t)size);
+			g_Frame.Put32(usage);
+			g_Frame.PutBlock(data, (NULL != data) ? (size_t)size : 0);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		g_Real.BufferSubData(target, offset, size, data);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_BUFFER_SUB_DATA);
+			g_Frame.Put32(target);
+			g_Frame.Put64((uint64_t)offset);
+			g_Frame.PutBlock(data, (size_t)size);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+	{
+		g_Real.BufferStorage(target, size, data, flags);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_BUFFER_STORAGE);
+			g_Frame.Put32(target);
+			g_Frame.Put64((uint64_t)size);
+			g_Frame.Put32(flags);
+			g_Frame.PutBlock(data, (NULL != data) ? (size_t)size : 0);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+	{
+		g_Real.CopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+		RecordMappedWrites();
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_COPY_BUFFER_SUB_DATA);
+			g_Frame.Put32(readTarget);
+			g_Frame.Put32(writeTarget);
+			g_Frame.Put64((uint64_t)readOffset);
+			g_Frame.Put64((uint64_t)writeOffset);
+			g_Frame.Put64((uint64_t)size);
+			g_Frame.End();
+		}
+	}
+
+	// mappings are not recorded, their writes are found by
+	// RecordMappedWrites() and when they are unmapped
+	void* GLAPIENTRY HookMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+	{
+		void* pMapped = g_Real.MapBufferRange(target, offset, length, access);
+		if ((NULL != pMapped) && ((access & GL_MAP_WRITE_BIT) != 0))
+		{
+			MAPPED_RANGE& range = g_MappedBuffers[GetBoundBuffer(target)];
+			range.offset = offset;
+			range.length = length;
+			range.access = access;
+			range.contents.clear();
+		}
+		return(pMapped);
+	}
+
+	GLboolean GLAPIENTRY HookUnmapBuffer(GLenum target)
+	{
+		GLuint buffer = GetBoundBuffer(target);
+		GLboolean bUnmapped = g_Real.UnmapBuffer(target);
+
+		std::map<GLuint, MAPPED_RANGE>::iterator mapped = g_MappedBuffers.find(buffer);
+		if (mapped != g_MappedBuffers.end())
+		{
+			if (g_bRecording == true)
+			{
+				std::vector<unsigned char> contents;
+				ReadBufferRange(buffer, mapped->second.offset, mapped->second.length, contents);
+				RecordBufferWrite(buffer, mapped->second, contents);
+			}
+			g_MappedBuffers.erase(mapped);
+		}
+		return(bUnmapped);
+	}
+
+	void GLAPIENTRY HookBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		g_Real.BindBufferRange(target, index, buffer, offset, size);
+		CountCall(GLC_BIND_BUFFER_RANGE);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_BIND_BUFFER_RANGE);
+			g_Frame.Put32(target);
+			g_Frame.Put32(index);
+			g_Frame.Put32(buffer);
+			g_Frame.Put64((uint64_t)offset);
+			g_Frame.Put64((uint64_t)size);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookGenVertexArrays(GLsizei n, GLuint* arrays)
+	{
+		g_Real.GenVertexArrays(n, arrays);
+		TrackNames(GLC_OBJECT_VERTEX_ARRAY, n, arrays, true);
+		RecordNames(GLC_GEN_VERTEX_ARRAYS, n, arrays);
+	}
+
+	void GLAPIENTRY HookDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+	{
+		RecordNames(GLC_DELETE_VERTEX_ARRAYS, n, arrays);
+		TrackNames(GLC_OBJECT_VERTEX_ARRAY, n, arrays, false);
+		g_Real.DeleteVertexArrays(n, arrays);
+	}
+
+	void GLAPIENTRY HookBindVertexArray(GLuint array)
+	{
+		g_Real.BindVertexArray(array);
+		RecordCall(GLC_BIND_VERTEX_ARRAY, array);
+	}
+
+	void GLAPIENTRY HookVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+	{
+		g_Real.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+		CountCall(GLC_VERTEX_ATTRIB_POINTER);
+		if (g_bRecording == true)
+		{
+			// the engine always sources attributes from buffers,
+			// so the pointer is an offset
+			g_Frame.Begin(GLC_VERTEX_ATTRIB_POINTER);
+			g_Frame.Put32(index);
+			g_Frame.Put32((uint32_t)size);
+			g_Frame.Put32(type);
+			g_Frame.Put32(normalized);
+			g_Frame.Put32((uint32_t)stride);
+			g_Frame.Put64((uint64_t)(size_t)pointer);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookEnableVertexAttribArray(GLuint index)
+	{
+		g_Real.EnableVertexAttribArray(index);
+		RecordCall(GLC_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+	}
+
+	void GLAPIENTRY HookDisableVertexAttribArray(GLuint index)
+	{
+		g_Real.DisableVertexAttribArray(index);
+		RecordCall(GLC_DISABLE_VERTEX_ATTRIB_ARRAY, index);
+	}
+
+	void GLAPIENTRY HookVertexAttrib4f(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+	{
+		g_Real.VertexAttrib4f(index, x, y, z, w);
+		RecordCall(GLC_VERTEX_ATTRIB_4F, index, x, y, z, w);
+	}
+
+	void GLAPIENTRY HookMultiDrawArrays(GLenum mode, const GLint* first, const GLsizei* count, GLsizei drawcount)
+	{
+		g_Real.MultiDrawArrays(mode, first, count, drawcount);
+		CountDraw(mode, count, drawcount);
+		RecordMappedWrites();
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_MULTI_DRAW_ARRAYS);
+			g_Frame.Put32(mode);
+			g_Frame.Put32((uint32_t)drawcount);
+			g_Frame.PutBytes(first, sizeof(GLint) * drawcount);
+			g_Frame.PutBytes(count, sizeof(GLsizei) * drawcount);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookMultiDrawElements(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawcount)
+	{
+		g_Real.MultiDrawElements(mode, count, type, indices, drawcount);
+		CountDraw(mode, count, drawcount);
+		RecordMappedWrites();
+		if (g_bRecording == true)
+		{
+			// the indices always come from the bound element
+			// buffer, so each pointer is an offset
+			g_Frame.Begin(GLC_MULTI_DRAW_ELEMENTS);
+			g_Frame.Put32(mode);
+			g_Frame.Put32(type);
+			g_Frame.Put32((uint32_t)drawcount);
+			g_Frame.PutBytes(count, sizeof(GLsizei) * drawcount);
+			for (GLsizei i = 0; i < drawcount; i++)
+			{
+				g_Frame.Put64((uint64_t)(size_t)indices[i]);
+			}
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+	{
+		g_Real.DrawElementsBaseVertex(mode, count, type, indices, basevertex);
+		CountDraw(mode, &count, 1);
+		RecordMappedWrites();
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_DRAW_ELEMENTS_BASE_VERTEX);
+			g_Frame.Put32(mode);
+			g_Frame.Put32((uint32_t)count);
+			g_Frame.Put32(type);
+			PutElementIndices(count, type, indices);
+			g_Frame.Put32((uint32_t)basevertex);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookDrawBuffers(GLsizei n, const GLenum* bufs)
+	{
+		g_Real.DrawBuffers(n, bufs);
+		CountCall(GLC_DRAW_BUFFERS);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_DRAW_BUFFERS);
+			g_Frame.Put32((uint32_t)n);
+			g_Frame.PutBytes(bufs, sizeof(GLenum) * n);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookMemoryBarrier(GLbitfield barriers)
+	{
+		g_Real.MemoryBarrier(barriers);
+		RecordCall(GLC_MEMORY_BARRIER, barriers);
+	}
+
+	void GLAPIENTRY HookGenFramebuffers(GLsizei n, GLuint* framebuffers)
+	{
+		g_Real.GenFramebuffers(n, framebuffers);
+		TrackNames(GLC_OBJECT_FRAMEBUFFER, n, framebuffers, true);
+		RecordNames(GLC_GEN_FRAMEBUFFERS, n, framebuffers);
+	}
+
+	void GLAPIENTRY HookDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+	{
+		RecordNames(GLC_DELETE_FRAMEBUFFERS, n, framebuffers);
+		TrackNames(GLC_OBJECT_FRAMEBUFFER, n, framebuffers, false);
+		g_Real.DeleteFramebuffers(n, framebuffers);
+	}
+
+	void GLAPIENTRY HookBindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		g_Real.BindFramebuffer(target, framebuffer);
+		RecordCall(GLC_BIND_FRAMEBUFFER, target, framebuffer);
+	}
+
+	void GLAPIENTRY HookFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+	{
+		g_Real.FramebufferTexture2D(target, attachment, textarget, texture, level);
+		RecordCall(GLC_FRAMEBUFFER_TEXTURE_2D, target, attachment, textarget, texture, level);
+	}
+
+	void GLAPIENTRY HookFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+	{
+		g_Real.FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+		RecordCall(GLC_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffertarget, renderbuffer);
+	}
+
+	void GLAPIENTRY HookGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+	{
+		g_Real.GenRenderbuffers(n, renderbuffers);
+		TrackNames(GLC_OBJECT_RENDERBUFFER, n, renderbuffers, true);
+		RecordNames(GLC_GEN_RENDERBUFFERS, n, renderbuffers);
+	}
+
+	void GLAPIENTRY HookDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+	{
+		RecordNames(GLC_DELETE_RENDERBUFFERS, n, renderbuffers);
+		TrackNames(GLC_OBJECT_RENDERBUFFER, n, renderbuffers, false);
+		g_Real.DeleteRenderbuffers(n, renderbuffers);
+	}
+
+	void GLAPIENTRY HookBindRenderbuffer(GLenum target, GLuint renderbuffer)
+	{
+		g_Real.BindRenderbuffer(target, renderbuffer);
+		RecordCall(GLC_BIND_RENDERBUFFER, target, renderbuffer);
+	}
+
+	void GLAPIENTRY HookRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+	{
+		g_Real.RenderbufferStorage(target, internalformat, width, height);
+		RecordCall(GLC_RENDERBUFFER_STORAGE, target, internalformat, width, height);
+	}
+
+	void GLAPIENTRY HookPrimitiveRestartIndex(GLuint index)
+	{
+		g_Real.PrimitiveRestartIndex(index);
+		RecordCall(GLC_PRIMITIVE_RESTART_INDEX, index);
+	}
+
+	// shaders and programs are only tracked - they are created
+	// at load time and saved in the snapshot
+	GLuint GLAPIENTRY HookCreateShader(GLenum type)
+	{
+		GLuint shader = g_Real.CreateShader(type);
+		g_Shaders[shader].type = type;
+		return(shader);
+	}
+
+	void GLAPIENTRY HookShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+	{
+		g_Real.ShaderSource(shader, count, string, length);
+
+		std::string source;
+		for (GLsizei i = 0; i < count; i++)
+		{
+			if ((NULL != length) && (length[i] >= 0))
+			{
+				source.append(string[i], length[i]);
+			}
+			else
+			{
+				source.append(string[i]);
+			}
+		}
+		g_Shaders[shader].source = source;
+	}
+
+	GLuint GLAPIENTRY HookCreateProgram()
+	{
+		GLuint program = g_Real.CreateProgram();
+		g_Objects[GLC_OBJECT_PROGRAM].insert(program);
+		return(program);
+	}
+
+	void GLAPIENTRY HookDeleteProgram(GLuint program)
+	{
+		g_Objects[GLC_OBJECT_PROGRAM].erase(program);
+		g_ProgramShaders.erase(program);
+		g_Real.DeleteProgram(program);
+	}
+
+	void GLAPIENTRY HookAttachShader(GLuint program, GLuint shader)
+	{
+		g_Real.AttachShader(program, shader);
+		g_ProgramShaders[program].push_back(shader);
+	}
+
+	void GLAPIENTRY HookUseProgram(GLuint program)
+	{
+		g_Real.UseProgram(program);
+		RecordCall(GLC_USE_PROGRAM, program);
+	}
+
+	void GLAPIENTRY HookUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+	{
+		g_Real.UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+		CountCall(GLC_UNIFORM_BLOCK_BINDING);
+		if (g_bRecording == true)
+		{
+			g_Frame.Begin(GLC_UNIFORM_BLOCK_BINDING);
+			g_Frame.Put32(program);
+			g_Frame.PutString(GetUniformBlockName(program, uniformBlockIndex));
+			g_Frame.Put32(uniformBlockBinding);
+			g_Frame.End();
+		}
+	}
+
+	void GLAPIENTRY HookUniform1i(GLint location, GLint v0)
+	{
+		g_Real.Uniform1i(location, v0);
+		RecordUniform(GLC_UNIFORM_1I, location, 1, GL_FALSE, &v0, 1);
+	}
+
+	void GLAPIENTRY HookUniform1iv(GLint location, GLsizei count, const GLint* value)
+	{
+		g_Real.Uniform1iv(location, count, value);
+		RecordUniform(GLC_UNIFORM_1IV, location, count, GL_FALSE, value, count);
+	}
+
+	void GLAPIENTRY HookUniform1f(GLint location, GLfloat v0)
+	{
+		g_Real.Uniform1f(location, v0);
+		RecordUniform(GLC_UNIFORM_1F, location, 1, GL_FALSE, &v0, 1);
+	}
+
+	void GLAPIENTRY HookUniform1fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_Real.Uniform1fv(location, count, value);
+		RecordUniform(GLC_UNIFORM_1FV, location, count, GL_FALSE, value, count);
+	}
+
+	void GLAPIENTRY HookUniform2f(GLint location, GLfloat v0, GLfloat v1)
+	{
+		GLfloat values[2] = { v0, v1 };
+		g_Real.Uniform2f(location, v0, v1);
+		RecordUniform(GLC_UNIFORM_2FV, location, 1, GL_FALSE, values, 2);
+	}
+
+	void GLAPIENTRY HookUniform2fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_Real.Uniform2fv(location, count, value);
+		RecordUniform(GLC_UNIFORM_2FV, location, count, GL_FALSE, value, count * 2);
+	}
+
+	void GLAPIENTRY HookUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+	{
+		GLfloat values[3] = { v0, v1, v2 };
+		g_Real.Uniform3f(location, v0, v1, v2);
+		RecordUniform(GLC_UNIFORM_3FV, location, 1, GL_FALSE, values, 3);
+	}
+
+	void GLAPIENTRY HookUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_Real.Uniform3fv(location, count, value);
+		RecordUniform(GLC_UNIFORM_3FV, location, count, GL_FALSE, value, count * 3);
+	}
+
+	void GLAPIENTRY HookUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+	{
+		GLfloat values[4] = { v0, v1, v2, v3 };
+		g_Real.Uniform4f(location, v0, v1, v2, v3);
+		RecordUniform(GLC_UNIFORM_4FV, location, 1, GL_FALSE, values, 4);
+	}
+
+	void GLAPIENTRY HookUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_Real.Uniform4fv(location, count, value);
+		RecordUniform(GLC_UNIFORM_4FV, location, count, GL_FALSE, value, count * 4);
+	}
+
+	void GLAPIENTRY HookUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		g_Real.UniformMatrix3fv(location, count, transpose, value);
+		RecordUniform(GLC_UNIFORM_MATRIX3FV, location, count, transpose, value, count * 9);
+	}
+
+	void GLAPIENTRY HookUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		g_Real.UniformMatrix4fv(location, count, transpose, value);
+		RecordUniform(GLC_UNIFORM_MATRIX4FV, location, count, transpose, value, count * 16);
+	}
+
+	/***********************************************************
+	 *  Snapshot functions
+	 *
+	 *  Each one saves the contents of one kind of object into
+	 *  the snapshot.  They bind objects through the real
+	 *  entry points, the bindings are put back afterwards
+	 *  from the saved drawing state.
+	 ***********************************************************/
+	void GetDrawState(DRAW_STATE& state)
+	{
+		::glGetIntegerv(GL_CURRENT_PROGRAM, &state.program);
+		::glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &state.vertexArray);
+		::glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &state.arrayBuffer);
+		::glGetIntegerv(GL_ACTIVE_TEXTURE, &state.activeTexture);
+		for (GLint i = 0; i < g_SnapshotTextureUnits; i++)
+		{
+			g_Real.ActiveTexture(GL_TEXTURE0 + i);
+			::glGetIntegerv(GL_TEXTURE_BINDING_2D, &state.textures[i]);
+			::glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &state.bufferTextures[i]);
+		}
+		g_Real.ActiveTexture(state.activeTexture);
+		::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &state.framebuffer);
+		::glGetIntegerv(GL_RENDERBUFFER_BINDING, &state.renderbuffer);
+
+		state.depthTest = ::glIsEnabled(GL_DEPTH_TEST);
+		state.blend = ::glIsEnabled(GL_BLEND);
+		state.cullFace = ::glIsEnabled(GL_CULL_FACE);
+		state.primitiveRestart = ::glIsEnabled(GL_PRIMITIVE_RESTART);
+		state.scissorTest = ::glIsEnabled(GL_SCISSOR_TEST);
+		::glGetIntegerv(GL_BLEND_SRC_RGB, &state.blendSrcRGB);
+		::glGetIntegerv(GL_BLEND_DST_RGB, &state.blendDstRGB);
+		::glGetIntegerv(GL_BLEND_SRC_ALPHA, &state.blendSrcAlpha);
+		::glGetIntegerv(GL_BLEND_DST_ALPHA, &state.blendDstAlpha);
+		::glGetIntegerv(GL_DEPTH_FUNC, &state.depthFunc);
+		::glGetIntegerv(GL_CULL_FACE_MODE, &state.cullFaceMode);
+		::glGetIntegerv(GL_POLYGON_MODE, state.polygonMode);
+		::glGetIntegerv(GL_VIEWPORT, state.viewport);
+		::glGetIntegerv(GL_SCISSOR_BOX, state.scissorBox);
+		::glGetFloatv(GL_COLOR_CLEAR_VALUE, state.clearColor);
+		::glGetIntegerv(GL_PRIMITIVE_RESTART_INDEX, &state.primitiveRestartIndex);
+		::glGetIntegerv(GL_PACK_ALIGNMENT, &state.packAlignment);
+		::glGetIntegerv(GL_UNPACK_ALIGNMENT, &state.unpackAlignment);
+
+		for (GLint i = 0; i < g_SnapshotUniformBindings; i++)
+		{
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, i, &state.uniformBuffers[i]);
+			glGetInteger64i_v(GL_UNIFORM_BUFFER_START, i, &state.uniformStarts[i]);
+			glGetInteger64i_v(GL_UNIFORM_BUFFER_SIZE, i, &state.uniformSizes[i]);
+		}
+
+		for (GLint i = 0; i < g_SnapshotAttributes; i++)
+		{
+			glGetVertexAttribfv(i, GL_CURRENT_VERTEX_ATTRIB, state.attributes[i]);
+		}
+		// attribute 0 cannot be queried on some contexts
+		while (::glGetError() != GL_NO_ERROR)
+		{
+		}
+	}
+
+	void RestoreBindings(const DRAW_STATE& state)
+	{
+		for (GLint i = 0; i < g_SnapshotTextureUnits; i++)
+		{
+			g_Real.ActiveTexture(GL_TEXTURE0 + i);
+			::glBindTexture(GL_TEXTURE_2D, state.textures[i]);
+			::glBindTexture(GL_TEXTURE_BUFFER, state.bufferTextures[i]);
+		}
+		g_Real.ActiveTexture(state.activeTexture);
+		g_Real.BindVertexArray(state.vertexArray);
+		g_Real.BindBuffer(GL_ARRAY_BUFFER, state.arrayBuffer);
+		g_Real.BindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+		g_Real.BindRenderbuffer(GL_RENDERBUFFER, state.renderbuffer);
+	}
+
+	void PutDrawState(const DRAW_STATE& state)
+	{
+		g_Snapshot.Begin(GLC_SNAPSHOT_STATE);
+		g_Snapshot.Put32(state.program);
+		g_Snapshot.Put32(state.vertexArray);
+		g_Snapshot.Put32(state.arrayBuffer);
+		g_Snapshot.Put32(state.activeTexture);
+		g_Snapshot.Put32(g_SnapshotTextureUnits);
+		for (GLint i = 0; i < g_SnapshotTextureUnits; i++)
+		{
+			g_Snapshot.Put32(state.textures[i]);
+			g_Snapshot.Put32(state.bufferTextures[i]);
+		}
+		g_Snapshot.Put32(state.framebuffer);
+		g_Snapshot.Put32(state.renderbuffer);
+		g_Snapshot.Put32(state.depthTest);
+		g_Snapshot.Put32(state.blend);
+		g_Snapshot.Put32(state.cullFace);
+		g_Snapshot.Put32(state.primitiveRestart);
+		g_Snapshot.Put32(state.blendSrcRGB);
+		g_Snapshot.Put32(state.blendDstRGB);
+		g_Snapshot.Put32(state.blendSrcAlpha);
+		g_Snapshot.Put32(state.blendDstAlpha);
+		g_Snapshot.Put32(state.depthFunc);
+		g_Snapshot.Put32(state.cullFaceMode);
+		g_Snapshot.Put32(state.polygonMode[0]);
+		for (int i = 0; i < 4; i++)
+		{
+			g_Snapshot.Put32(state.viewport[i]);
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			g_Snapshot.PutFloat(state.clearColor[i]);
+		}
+		g_Snapshot.Put32(state.primitiveRestartIndex);
+		g_Snapshot.Put32(state.packAlignment);
+		g_Snapshot.Put32(state.unpackAlignment);
+		g_Snapshot.Put32(g_SnapshotAttributes);
+		for (GLint i = 0; i < g_SnapshotAttributes; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				g_Snapshot.PutFloat(state.attributes[i][c]);
+			}
+		}
+		g_Snapshot.Put32(state.scissorTest);
+		for (int i = 0; i < 4; i++)
+		{
+			g_Snapshot.Put32(state.scissorBox[i]);
+		}
+		g_Snapshot.Put32(g_SnapshotUniformBindings);
+		for (GLint i = 0; i < g_SnapshotUniformBindings; i++)
+		{
+			g_Snapshot.Put32(state.uniformBuffers[i]);
+			g_Snapshot.Put64((uint64_t)state.uniformStarts[i]);
+			g_Snapshot.Put64((uint64_t)state.uniformSizes[i]);
+		}
+		g_Snapshot.End();
+	}
+
+	void SnapshotBuffers()
+	{
+		std::vector<unsigned char> data;
+
+		for (GLuint buffer : g_Objects[GLC_OBJECT_BUFFER])
+		{
+			// names that were never bound have no storage yet
+			if (glIsBuffer(buffer) == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLint size = 0;
+			GLint usage = GL_STATIC_DRAW;
+			g_Real.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+			glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+
+			// immutable buffers are remade with the same flags
+			GLint immutable = GL_FALSE;
+			GLint flags = 0;
+			if ((GLEW_VERSION_4_4 == GL_TRUE) || (GLEW_ARB_buffer_storage == GL_TRUE))
+			{
+				glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_IMMUTABLE_STORAGE, &immutable);
+				glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_STORAGE_FLAGS, &flags);
+			}
+			data.resize(size);
+			if (size > 0)
+			{
+				glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, data.data());
+			}
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_BUFFER);
+			g_Snapshot.Put32(buffer);
+			g_Snapshot.Put32(usage);
+			g_Snapshot.Put32(immutable);
+			g_Snapshot.Put32(flags);
+			g_Snapshot.PutBlock(data.data(), data.size());
+			g_Snapshot.End();
+		}
+		g_Real.BindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	void SnapshotTextures()
+	{
+		std::vector<unsigned char> data;
+
+		for (GLuint texture : g_Objects[GLC_OBJECT_TEXTURE])
+		{
+			// BeginFrame() cancels captures that use other kinds
+			std::map<GLuint, GLenum>::const_iterator target = g_TextureTargets.find(texture);
+			if ((target == g_TextureTargets.end()) || (target->second != GL_TEXTURE_2D))
+			{
+				continue;
+			}
+
+			GLint width = 0;
+			GLint height = 0;
+			GLint internalFormat = GL_RGBA8;
+			GLint minFilter = GL_LINEAR;
+			GLint magFilter = GL_LINEAR;
+			GLint wrapS = GL_REPEAT;
+			GLint wrapT = GL_REPEAT;
+			::glBindTexture(GL_TEXTURE_2D, texture);
+			::glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+			::glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+			::glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+			::glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+			::glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &magFilter);
+			::glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrapS);
+			::glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrapT);
+
+			// read every format as whole 4 byte texels, so the
+			// rows need no padding
+			GLenum readFormat = GL_RGBA;
+			GLenum readType = GL_UNSIGNED_BYTE;
+			size_t texelSize = 4;
+			switch (internalFormat)
+			{
+			case GL_DEPTH_COMPONENT16:
+			case GL_DEPTH_COMPONENT24:
+			case GL_DEPTH_COMPONENT32:
+			case GL_DEPTH_COMPONENT32F:
+				readFormat = GL_DEPTH_COMPONENT;
+				readType = GL_FLOAT;
+				break;
+			case GL_R16F:
+			case GL_R32F:
+			case GL_RG16F:
+			case GL_RG32F:
+			case GL_RGB16F:
+			case GL_RGB32F:
+			case GL_RGBA16F:
+			case GL_RGBA32F:
+			case GL_R11F_G11F_B10F:
+				readType = GL_FLOAT;
+				texelSize = 16;
+				break;
+			case GL_R32UI:
+			case GL_RG32UI:
+			case GL_RGBA32UI:
+			case GL_RGBA8UI:
+				readFormat = GL_RGBA_INTEGER;
+				readType = GL_UNSIGNED_INT;
+				texelSize = 16;
+				break;
+			}
+
+			data.resize((size_t)width * height * texelSize);
+			if (data.empty() == false)
+			{
+				::glGetTexImage(GL_TEXTURE_2D, 0, readFormat, readType, data.data());
+			}
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_TEXTURE);
+			g_Snapshot.Put32(texture);
+			g_Snapshot.Put32(width);
+			g_Snapshot.Put32(height);
+			g_Snapshot.Put32(internalFormat);
+			g_Snapshot.Put32(readFormat);
+			g_Snapshot.Put32(readType);
+			g_Snapshot.Put32(minFilter);
+			g_Snapshot.Put32(magFilter);
+			g_Snapshot.Put32(wrapS);
+			g_Snapshot.Put32(wrapT);
+			g_Snapshot.PutBlock(data.data(), data.size());
+			g_Snapshot.End();
+		}
+	}
+
+	// the buffer each texture buffer reads, the buffer's
+	// contents are saved with the other buffers
+	void SnapshotTextureBuffers()
+	{
+		for (GLuint texture : g_Objects[GLC_OBJECT_TEXTURE])
+		{
+			std::map<GLuint, GLenum>::const_iterator target = g_TextureTargets.find(texture);
+			if ((target == g_TextureTargets.end()) || (target->second != GL_TEXTURE_BUFFER))
+			{
+				continue;
+			}
+
+			GLint internalFormat = GL_RGBA32F;
+			GLint buffer = 0;
+			::glBindTexture(GL_TEXTURE_BUFFER, texture);
+			::glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+			::glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_BUFFER_DATA_STORE_BINDING, &buffer);
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_TEXTURE_BUFFER);
+			g_Snapshot.Put32(texture);
+			g_Snapshot.Put32(internalFormat);
+			g_Snapshot.Put32(buffer);
+			g_Snapshot.End();
+		}
+	}
+
+	void SnapshotRenderbuffers()
+	{
+		for (GLuint renderbuffer : g_Objects[GLC_OBJECT_RENDERBUFFER])
+		{
+			if (glIsRenderbuffer(renderbuffer) == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLint internalFormat = 0;
+			GLint width = 0;
+			GLint height = 0;
+			g_Real.BindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+			glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &internalFormat);
+			glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+			glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_RENDERBUFFER);
+			g_Snapshot.Put32(renderbuffer);
+			g_Snapshot.Put32(internalFormat);
+			g_Snapshot.Put32(width);
+			g_Snapshot.Put32(height);
+			g_Snapshot.End();
+		}
+	}
+
+	void SnapshotFramebuffers()
+	{
+		const GLenum attachments[] = {
+			GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
+			GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+		const int nAttachments = sizeof(attachments) / sizeof(attachments[0]);
+
+		for (GLuint framebuffer : g_Objects[GLC_OBJECT_FRAMEBUFFER])
+		{
+			if (glIsFramebuffer(framebuffer) == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLint types[nAttachments];
+			GLint names[nAttachments];
+			uint32_t nUsed = 0;
+			g_Real.BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			for (int i = 0; i < nAttachments; i++)
+			{
+				types[i] = GL_NONE;
+				names[i] = 0;
+				glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachments[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &types[i]);
+				if (types[i] != GL_NONE)
+				{
+					glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachments[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &names[i]);
+					nUsed++;
+				}
+			}
+
+			GLint drawBuffers[g_SnapshotDrawBuffers];
+			GLint readBuffer = GL_NONE;
+			for (GLint i = 0; i < g_SnapshotDrawBuffers; i++)
+			{
+				::glGetIntegerv(GL_DRAW_BUFFER0 + i, &drawBuffers[i]);
+			}
+			::glGetIntegerv(GL_READ_BUFFER, &readBuffer);
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_FRAMEBUFFER);
+			g_Snapshot.Put32(framebuffer);
+			g_Snapshot.Put32(nUsed);
+			for (int i = 0; i < nAttachments; i++)
+			{
+				if (types[i] != GL_NONE)
+				{
+					g_Snapshot.Put32(attachments[i]);
+					g_Snapshot.Put32(types[i]);
+					g_Snapshot.Put32(names[i]);
+				}
+			}
+			g_Snapshot.Put32(g_SnapshotDrawBuffers);
+			for (GLint i = 0; i < g_SnapshotDrawBuffers; i++)
+			{
+				g_Snapshot.Put32(drawBuffers[i]);
+			}
+			g_Snapshot.Put32(readBuffer);
+			g_Snapshot.End();
+		}
+	}
+
+	void SnapshotVertexArrays()
+	{
+		GLint maxAttributes = 0;
+		::glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+		maxAttributes = std::min(maxAttributes, g_SnapshotAttributes);
+
+		for (GLuint vertexArray : g_Objects[GLC_OBJECT_VERTEX_ARRAY])
+		{
+			if (glIsVertexArray(vertexArray) == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLint elementBuffer = 0;
+			g_Real.BindVertexArray(vertexArray);
+			::glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+
+			GLCaptureWriter attributes;
+			uint32_t nAttributes = 0;
+			for (GLint i = 0; i < maxAttributes; i++)
+			{
+				GLint enabled = 0;
+				GLint buffer = 0;
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+				if ((enabled == 0) && (buffer == 0))
+				{
+					continue;
+				}
+
+				GLint size = 4;
+				GLint type = GL_FLOAT;
+				GLint normalized = 0;
+				GLint integer = 0;
+				GLint stride = 0;
+				GLint divisor = 0;
+				void* pointer = NULL;
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+				glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+				glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+
+				attributes.Put32(i);
+				attributes.Put32(enabled);
+				attributes.Put32(size);
+				attributes.Put32(type);
+				attributes.Put32(normalized);
+				attributes.Put32(integer);
+				attributes.Put32(stride);
+				attributes.Put32(divisor);
+				attributes.Put32(buffer);
+				attributes.Put64((uint64_t)(size_t)pointer);
+				nAttributes++;
+			}
+
+			g_Snapshot.Begin(GLC_SNAPSHOT_VERTEX_ARRAY);
+			g_Snapshot.Put32(vertexArray);
+			g_Snapshot.Put32(elementBuffer);
+			g_Snapshot.Put32(nAttributes);
+			g_Snapshot.PutBytes(attributes.GetData().data(), attributes.GetData().size());
+			g_Snapshot.End();
+		}
+	}
+
+	// components of a uniform type, and whether they are ints
+	GLuint GetUniformComponents(GLenum type, bool& bInteger)
+	{
+		bInteger = false;
+		switch (type)
+		{
+		case GL_FLOAT: return(1);
+		case GL_FLOAT_VEC2: return(2);
+		case GL_FLOAT_VEC3: return(3);
+		case GL_FLOAT_VEC4: return(4);
+		case GL_FLOAT_MAT2: return(4);
+		case GL_FLOAT_MAT3: return(9);
+		case GL_FLOAT_MAT4: return(16);
+		}
+
+		bInteger = true;
+		switch (type)
+		{
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2:
+			return(2);
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3:
+			return(3);
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4:
+			return(4);
+		}
+		// ints, bools and samplers
+		return(1);
+	}
+
+	void SnapshotPrograms()
+	{
+		for (GLuint program : g_Objects[GLC_OBJECT_PROGRAM])
+		{
+			if (glIsProgram(program) == GL_FALSE)
+			{
+				continue;
+			}
+
+			// the shaders as they were created, the program is
+			// relinked from their source on replay
+			std::vector<GLuint>& shaders = g_ProgramShaders[program];
+			g_Snapshot.Begin(GLC_SNAPSHOT_PROGRAM);
+			g_Snapshot.Put32(program);
+			g_Snapshot.Put32((uint32_t)shaders.size());
+			for (size_t i = 0; i < shaders.size(); i++)
+			{
+				const SHADER_SOURCE& shader = g_Shaders[shaders[i]];
+				g_Snapshot.Put32(shader.type);
+				g_Snapshot.PutString(shader.source);
+			}
+
+			// the uniform values, one entry per array element
+			GLCaptureWriter uniforms;
+			uint32_t nUniforms = 0;
+			GLint nActive = 0;
+			glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &nActive);
+			for (GLint i = 0; i < nActive; i++)
+			{
+				GLchar nameBuffer[256];
+				GLsizei nameLength = 0;
+				GLint arraySize = 0;
+				GLenum type = GL_FLOAT;
+				glGetActiveUniform(program, i, sizeof(nameBuffer), &nameLength, &arraySize, &type, nameBuffer);
+
+				std::string name(nameBuffer, nameLength);
+				if ((arraySize > 1) && (name.size() > 3) && (name.compare(name.size() - 3, 3, "[0]") == 0))
+				{
+					name.resize(name.size() - 3);
+				}
+
+				bool bInteger = false;
+				GLuint nComponents = GetUniformComponents(type, bInteger);
+				for (GLint element = 0; element < arraySize; element++)
+				{
+					std::string elementName = (arraySize > 1) ? name + "[" + std::to_string(element) + "]" : name;
+					GLint location = glGetUniformLocation(program, elementName.c_str());
+					if (location < 0)
+					{
+						// members of uniform blocks have no location
+						continue;
+					}
+
+					union
+					{
+						GLfloat floats[16];
+						GLint ints[16];
+					} values;
+					if (bInteger == true)
+					{
+						glGetUniformiv(program, location, values.ints);
+					}
+					else
+					{
+						glGetUniformfv(program, location, values.floats);
+					}
+
+					uniforms.Put32(location);
+					uniforms.Put32(type);
+					uniforms.PutString(elementName);
+					uniforms.PutBlock(&values, nComponents * sizeof(GLfloat));
+					nUniforms++;
+				}
+			}
+
+			g_Snapshot.Put32(nUniforms);
+			g_Snapshot.PutBytes(uniforms.GetData().data(), uniforms.GetData().size());
+
+			// the binding point of each uniform block
+			GLint nBlocks = 0;
+			glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &nBlocks);
+			g_Snapshot.Put32((uint32_t)nBlocks);
+			for (GLint i = 0; i < nBlocks; i++)
+			{
+				GLint binding = 0;
+				glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+				g_Snapshot.PutString(GetUniformBlockName(program, i));
+				g_Snapshot.Put32(binding);
+			}
+			g_Snapshot.End();
+		}
+	}
+}
+
+/***********************************************************
+ *  Install()
+ *
+ *  This method is used for swapping the GLEW entry points
+ *  for the hooks.  GLEW must be initialized first.
+ ***********************************************************/
+bool GLCapture::Install()
+{
+	if (g_bInstalled == true)
+	{
+		return(true);
+	}
+
+#define GL_CAPTURE_CHECK(type, name) \
+	if (NULL == __glew##name) \
+	{ \
+		std::cout << "GLCapture: gl" #name " is not available" << std::endl; \
+		return(false); \
+	}
+	GL_CAPTURE_HOOKS(GL_CAPTURE_CHECK)
+#undef GL_CAPTURE_CHECK
+
+#define GL_CAPTURE_INSTALL(type, name) \
+	g_Real.name = __glew##name; \
+	if (NULL != g_Real.name) \
+	{ \
+		__glew##name = Hook##name; \
+	}
+	GL_CAPTURE_HOOKS(GL_CAPTURE_INSTALL)
+	GL_CAPTURE_OPTIONAL_HOOKS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+
+	g_bInstalled = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Uninstall()
+ *
+ *  This method is used for putting back the GLEW entry
+ *  points.
+ ***********************************************************/
+void GLCapture::Uninstall()
+{
+	if (g_bInstalled == false)
+	{
+		return;
+	}
+
+#define GL_CAPTURE_UNINSTALL(type, name) \
+	if (NULL != g_Real.name) \
+	{ \
+		__glew##name = g_Real.name; \
+	}
+	GL_CAPTURE_HOOKS(GL_CAPTURE_UNINSTALL)
+	GL_CAPTURE_OPTIONAL_HOOKS(GL_CAPTURE_UNINSTALL)
+#undef GL_CAPTURE_UNINSTALL
+
+	g_bInstalled = false;
+	g_bRecording = false;
+	g_bCapturePending = false;
+}
+
+bool GLCapture::IsInstalled()
+{
+	return(g_bInstalled);
+}
+
+/***********************************************************
+ *  RequestCapture()
+ *
+ *  This method is used for capturing the next frame that
+ *  BeginFrame() starts.
+ ***********************************************************/
+void GLCapture::RequestCapture(const std::string& filename)
+{
+	if (g_bInstalled == false)
+	{
+		std::cout << "GLCapture: not installed, the capture is ignored" << std::endl;
+		return;
+	}
+	g_CaptureFile = filename;
+	g_bCapturePending = true;
+}
+
+bool GLCapture::IsCapturePending()
+{
+	return(g_bCapturePending);
+}
+
+bool GLCapture::IsRecording()
+{
+	return(g_bRecording);
+}
+
+/***********************************************************
+ *  GetCallStats()
+ *
+ *  This method is used for getting the calls counted since
+ *  the last ResetCallStats().
+ ***********************************************************/
+const GLCapture::CALL_STATS& GLCapture::GetCallStats()
+{
+	return(g_CallStats);
+}
+
+/***********************************************************
+ *  ResetCallStats()
+ *
+ *  This method is used for clearing the call counts.
+ ***********************************************************/
+void GLCapture::ResetCallStats()
+{
+	g_CallStats.drawCalls = 0;
+	g_CallStats.stateChanges = 0;
+	g_CallStats.uniformUploads = 0;
+	g_CallStats.triangles = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a requested capture.
+ *  The contents of every object and the drawing state are
+ *  saved first, which stalls on the GPU for the read
+ *  backs, then the calls of the frame are recorded.
+ ***********************************************************/
+void GLCapture::BeginFrame()
+{
+	if ((g_bInstalled == false) || (g_bCapturePending == false))
+	{
+		return;
+	}
+	g_bCapturePending = false;
+
+	// only 2D textures and texture buffers are saved, a frame
+	// that could sample any other kind would replay wrong
+	for (std::map<GLuint, GLenum>::const_iterator target = g_TextureTargets.begin(); target != g_TextureTargets.end(); ++target)
+	{
+		if ((target->second != GL_TEXTURE_2D) && (target->second != GL_TEXTURE_BUFFER))
+		{
+			std::cout << "GLCapture: texture " << target->first << " is neither a 2D texture nor a texture buffer, which captures cannot save - the capture is cancelled" << std::endl;
+			return;
+		}
+	}
+
+	g_Snapshot.Clear();
+	g_Frame.Clear();
+
+	DRAW_STATE state;
+	GetDrawState(state);
+	g_CaptureWidth = state.viewport[2];
+	g_CaptureHeight = state.viewport[3];
+
+	SnapshotBuffers();
+	SnapshotTextures();
+	SnapshotTextureBuffers();
+	SnapshotRenderbuffers();
+	SnapshotFramebuffers();
+	SnapshotVertexArrays();
+	SnapshotPrograms();
+	PutDrawState(state);
+	RestoreBindings(state);
+
+	// the mapped contents the frame starts with, its writes
+	// through the mappings are found against these
+	for (std::map<GLuint, MAPPED_RANGE>::iterator mapped = g_MappedBuffers.begin(); mapped != g_MappedBuffers.end(); ++mapped)
+	{
+		mapped->second.contents.clear();
+		if ((mapped->second.access & GL_MAP_PERSISTENT_BIT) != 0)
+		{
+			ReadBufferRange(mapped->first, mapped->second.offset, mapped->second.length, mapped->second.contents);
+		}
+	}
+
+	g_bRecording = true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing a running capture and
+ *  writing it to its file.
+ ***********************************************************/
+bool GLCapture::EndFrame()
+{
+	if (g_bRecording == false)
+	{
+		return(false);
+	}
+
+	RecordCall(GLC_FRAME_END);
+	g_bRecording = false;
+
+	FILE* file = fopen(g_CaptureFile.c_str(), "wb");
+	if (NULL == file)
+	{
+		std::cout << "GLCapture: could not write " << g_CaptureFile << std::endl;
+		return(false);
+	}
+
+	GLCAPTURE_HEADER header;
+	header.magic = GLCAPTURE_MAGIC;
+	header.version = GLCAPTURE_VERSION;
+	header.width = g_CaptureWidth;
+	header.height = g_CaptureHeight;
+	header.nSnapshotRecords = g_Snapshot.GetRecordCount();
+	header.nFrameRecords = g_Frame.GetRecordCount();
+
+	bool bWritten =
+		(fwrite(&header, sizeof(header), 1, file) == 1) &&
+		(fwrite(g_Snapshot.GetData().data(), 1, g_Snapshot.GetData().size(), file) == g_Snapshot.GetData().size()) &&
+		(fwrite(g_Frame.GetData().data(), 1, g_Frame.GetData().size(), file) == g_Frame.GetData().size());
+	fclose(file);
+
+	if (bWritten == false)
+	{
+		std::cout << "GLCapture: could not write " << g_CaptureFile << std::endl;
+		return(false);
+	}
+
+	std::cout << "GLCapture: saved " << header.nFrameRecords << " calls and "
+		<< header.nSnapshotRecords << " objects to " << g_CaptureFile
+		<< " (" << (g_Snapshot.GetData().size() + g_Frame.GetData().size()) / 1024 << " KB)" << std::endl;
+
+	// the capture can be large, free it
+	g_Snapshot = GLCaptureWriter();
+	g_Frame = GLCaptureWriter();
+
+	return(true);
+}
+
+/***********************************************************
+ *  GL 1.1 hooks
+ *
+ *  GLEW exports these entry points directly, the macros in
+ *  GLCapture.h route the engine's calls here.
+ ***********************************************************/
+void GLCapture::glEnable(GLenum cap)
+{
+	::glEnable(cap);
+	RecordCall(GLC_ENABLE, cap);
+}
+
+void GLCapture::glDisable(GLenum cap)
+{
+	::glDisable(cap);
+	RecordCall(GLC_DISABLE, cap);
+}
+
+void GLCapture::glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	::glBlendFunc(sfactor, dfactor);
+	RecordCall(GLC_BLEND_FUNC, sfactor, dfactor);
+}
+
+void GLCapture::glDepthFunc(GLenum func)
+{
+	::glDepthFunc(func);
+	RecordCall(GLC_DEPTH_FUNC, func);
+}
+
+void GLCapture::glCullFace(GLenum mode)
+{
+	::glCullFace(mode);
+	RecordCall(GLC_CULL_FACE, mode);
+}
+
+void GLCapture::glPolygonMode(GLenum face, GLenum mode)
+{
+	::glPolygonMode(face, mode);
+	RecordCall(GLC_POLYGON_MODE, face, mode);
+}
+
+void GLCapture::glClear(GLbitfield mask)
+{
+	::glClear(mask);
+	RecordCall(GLC_CLEAR, mask);
+}
+
+void GLCapture::glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	::glClearColor(red, green, blue, alpha);
+	RecordCall(GLC_CLEAR_COLOR, red, green, blue, alpha);
+}
+
+void GLCapture::glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	::glViewport(x, y, width, height);
+	RecordCall(GLC_VIEWPORT, x, y, width, height);
+}
+
+void GLCapture::glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	::glScissor(x, y, width, height);
+	RecordCall(GLC_SCISSOR, x, y, width, height);
+}
+
+void GLCapture::glDrawBuffer(GLenum buf)
+{
+	::glDrawBuffer(buf);
+	RecordCall(GLC_DRAW_BUFFER, buf);
+}
+
+void GLCapture::glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	::glDrawArrays(mode, first, count);
+	CountDraw(mode, &count, 1);
+	RecordMappedWrites();
+	RecordCall(GLC_DRAW_ARRAYS, mode, first, count);
+}
+
+void GLCapture::glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	::glDrawElements(mode, count, type, indices);
+	CountDraw(mode, &count, 1);
+	RecordMappedWrites();
+	if (g_bRecording == true)
+	{
+		g_Frame.Begin(GLC_DRAW_ELEMENTS);
+		g_Frame.Put32(mode);
+		g_Frame.Put32((uint32_t)count);
+		g_Frame.Put32(type);
+		PutElementIndices(count, type, indices);
+		g_Frame.End();
+	}
+}
+
+void GLCapture::glGenTextures(GLsizei n, GLuint* textures)
+{
+	::glGenTextures(n, textures);
+	if (g_bInstalled == true)
+	{
+		TrackNames(GLC_OBJECT_TEXTURE, n, textures, true);
+		RecordNames(GLC_GEN_TEXTURES, n, textures);
+	}
+}
+
+void GLCapture::glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+	if (g_bInstalled == true)
+	{
+		RecordNames(GLC_DELETE_TEXTURES, n, textures);
+		TrackNames(GLC_OBJECT_TEXTURE, n, textures, false);
+		for (GLsizei i = 0; i < n; i++)
+		{
+			g_TextureTargets.erase(textures[i]);
+		}
+	}
+	::glDeleteTextures(n, textures);
+}
+
+void GLCapture::glBindTexture(GLenum target, GLuint texture)
+{
+	::glBindTexture(target, texture);
+	if ((g_bInstalled == true) && (texture != 0))
+	{
+		// a texture gets its target from its first binding
+		g_TextureTargets.insert(std::make_pair(texture, target));
+	}
+	RecordCall(GLC_BIND_TEXTURE, target, texture);
+}
+
+void GLCapture::glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	::glTexParameteri(target, pname, param);
+	RecordCall(GLC_TEX_PARAMETER_I, target, pname, param);
+}
+
+void GLCapture::glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	::glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (g_bRecording == true)
+	{
+		g_Frame.Begin(GLC_TEX_IMAGE_2D);
+		g_Frame.Put32(target);
+		g_Frame.Put32(level);
+		g_Frame.Put32(internalformat);
+		g_Frame.Put32(width);
+		g_Frame.Put32(height);
+		g_Frame.Put32(border);
+		g_Frame.Put32(format);
+		g_Frame.Put32(type);
+		g_Frame.PutBlock(pixels, (NULL != pixels) ? GetImageSize(width, height, format, type) : 0);
+		g_Frame.End();
+	}
+}
+
+void GLCapture::glPixelStorei(GLenum pname, GLint param)
+{
+	::glPixelStorei(pname, param);
+	RecordCall(GLC_PIXEL_STORE_I, pname, param);
+}
+
+void GLCapture::glReadBuffer(GLenum mode)
+{
+	::glReadBuffer(mode);
+	RecordCall(GLC_READ_BUFFER, mode);
+}
+
+void GLCapture::glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+	::glReadPixels(x, y, width, height, format, type, pixels);
+	// the pixels are not stored, the replay reads into a
+	// scratch buffer to reproduce the stall
+	RecordCall(GLC_READ_PIXELS, x, y, width, height, format, type);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// glcapture.h
+// ============
+// records every GL call of one frame, with the objects and state it starts
+// from, into a file the GLReplay tool can re-issue offline
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  GLCapture
+ *
+ *  This class contains the frame capture.  Install() hooks
+ *  the GL entry points that GLEW loads through pointers,
+ *  and the macros at the end of this file route the GL 1.1
+ *  calls, which GLEW exports directly, through the same
+ *  hooks.  While nothing is captured the hooks only keep
+ *  track of the objects that are created.
+ *
+ *  A requested capture starts at BeginFrame() by saving
+ *  the contents of every buffer, texture, vertex array,
+ *  framebuffer and program along with the drawing state,
+ *  then records each call until EndFrame() writes the
+ *  file.  Only the calls the engine makes are hooked, a
+ *  new GL call needs its own hook to appear in captures.
+ *  Writes through mapped buffers are found by comparing
+ *  the mapped ranges before each draw.  A frame that uses
+ *  a kind of texture other than 2D textures and texture
+ *  buffers is not captured.
+ *
+ *  The hooks also count the draws, state changes and
+ *  uniform uploads whether or not a capture is running.
+ ***********************************************************/
+class GLCapture
+{
+public:
+	// GL calls counted by the hooks since the last reset
+	struct CALL_STATS
+	{
+		uint64_t drawCalls;       // A multi-draw counts once
+		uint64_t stateChanges;    // Binds, enables and the other state setting calls
+		uint64_t uniformUploads;
+		uint64_t triangles;       // Triangles submitted by the draw calls
+	};
+
+	// hook the GL entry points - call right after glewInit(),
+	// objects created before this are not known to captures
+	static bool Install();
+	// restore the GLEW entry points
+	static void Uninstall();
+	static bool IsInstalled();
+
+	// capture the next frame into the passed in file
+	static void RequestCapture(const std::string& filename);
+	static bool IsCapturePending();
+	// true between BeginFrame() and EndFrame() of a capture
+	static bool IsRecording();
+
+	// get or clear the call counts, usually once per frame
+	static const CALL_STATS& GetCallStats();
+	static void ResetCallStats();
+
+	// bracket the GL calls of one frame
+	static void BeginFrame();
+	// returns true when a capture was written
+	static bool EndFrame();
+
+	// GL 1.1 entry points, reached through the macros below
+	static void glEnable(GLenum cap);
+	static void glDisable(GLenum cap);
+	static void glBlendFunc(GLenum sfactor, GLenum dfactor);
+	static void glDepthFunc(GLenum func);
+	static void glCullFace(GLenum mode);
+	static void glPolygonMode(GLenum face, GLenum mode);
+	static void glClear(GLbitfield mask);
+	static void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	static void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	static void glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+	static void glDrawBuffer(GLenum buf);
+	static void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+	static void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+	static void glGenTextures(GLsizei n, GLuint* textures);
+	static void glDeleteTextures(GLsizei n, const GLuint* textures);
+	static void glBindTexture(GLenum target, GLuint texture);
+	static void glTexParameteri(GLenum target, GLenum pname, GLint param);
+	static void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+	static void glPixelStorei(GLenum pname, GLint param);
+	static void glReadBuffer(GLenum mode);
+	static void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels);
+};
+
+// GLCapture.cpp calls the real entry points, every other
+// file that includes this header is routed through the hooks
+#ifndef GL_CAPTURE_NO_REDIRECT
+#define glEnable GLCapture::glEnable
+#define glDisable GLCapture::glDisable
+#define glBlendFunc GLCapture::glBlendFunc
+#define glDepthFunc GLCapture::glDepthFunc
+#define glCullFace GLCapture::glCullFace
+#define glPolygonMode GLCapture::glPolygonMode
+#define glClear GLCapture::glClear
+#define glClearColor GLCapture::glClearColor
+#define glViewport GLCapture::glViewport
+#define glScissor GLCapture::glScissor
+#define glDrawBuffer GLCapture::glDrawBuffer
+#define glDrawArrays GLCapture::glDrawArrays
+#define glDrawElements GLCapture::glDrawElements
+#define glGenTextures GLCapture::glGenTextures
+#define glDeleteTextures GLCapture::glDeleteTextures
+#define glBindTexture GLCapture::glBindTexture
+#define glTexParameteri GLCapture::glTexParameteri
+#define glTexImage2D GLCapture::glTexImage2D
+#define glPixelStorei GLCapture::glPixelStorei
+#define glReadBuffer GLCapture::glReadBuffer
+#define glReadPixels GLCapture::glReadPixels
+#endif
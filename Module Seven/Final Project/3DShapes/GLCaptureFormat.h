@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+// glcaptureformat.h
+// ============
+// file format shared by the GL frame capture and the offline replay tool
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// "GLCP" at the start of every capture file
+const uint32_t GLCAPTURE_MAGIC = 0x50434C47;
+const uint32_t GLCAPTURE_VERSION = 4;
+
+/***********************************************************
+ *  GLCAPTURE_HEADER
+ *
+ *  Starts the file.  It is followed by records, each one a
+ *  GLCAPTURE_RECORD and its payload.  The snapshot records
+ *  come first and describe the objects and drawing state
+ *  at the start of the frame, then one record follows for
+ *  every GL call the frame made, ending with
+ *  GLC_FRAME_END.
+ ***********************************************************/
+struct GLCAPTURE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;         // Size of the default framebuffer
+	uint32_t height;
+	uint32_t nSnapshotRecords;
+	uint32_t nFrameRecords;
+};
+
+struct GLCAPTURE_RECORD
+{
+	uint32_t command;       // GLCAPTURE_COMMAND
+	uint32_t size;          // Bytes of payload that follow
+};
+
+/***********************************************************
+ *  GLCAPTURE_COMMAND
+ *
+ *  Payloads are packed 32 bit values in the order of the
+ *  GL call's arguments, with offsets and sizes stored as
+ *  64 bit values and data blocks stored as a 32 bit byte
+ *  count followed by the bytes.  Object names are the
+ *  names at capture time, the replay maps them to the
+ *  names it creates.
+ *
+ *  Writes through a mapped buffer make no GL call, so the
+ *  capture compares the mapped ranges before each draw and
+ *  stores the bytes that changed as GLC_BUFFER_WRITE,
+ *  which names the buffer rather than a binding.
+ ***********************************************************/
+enum GLCAPTURE_COMMAND
+{
+	// snapshot of the frame's starting state
+	GLC_SNAPSHOT_BUFFER = 1,
+	GLC_SNAPSHOT_TEXTURE,
+	GLC_SNAPSHOT_RENDERBUFFER,
+	GLC_SNAPSHOT_FRAMEBUFFER,
+	GLC_SNAPSHOT_VERTEX_ARRAY,
+	GLC_SNAPSHOT_PROGRAM,
+	GLC_SNAPSHOT_STATE,
+	GLC_SNAPSHOT_TEXTURE_BUFFER,
+
+	// calls made during the frame
+	GLC_ENABLE = 100,
+	GLC_DISABLE,
+	GLC_BLEND_FUNC,
+	GLC_DEPTH_FUNC,
+	GLC_CULL_FACE,
+	GLC_POLYGON_MODE,
+	GLC_CLEAR,
+	GLC_CLEAR_COLOR,
+	GLC_VIEWPORT,
+	GLC_DRAW_ARRAYS,
+	GLC_DRAW_ELEMENTS,
+	GLC_MULTI_DRAW_ARRAYS,
+	GLC_MULTI_DRAW_ELEMENTS,
+	GLC_GEN_TEXTURES,
+	GLC_DELETE_TEXTURES,
+	GLC_BIND_TEXTURE,
+	GLC_ACTIVE_TEXTURE,
+	GLC_TEX_PARAMETER_I,
+	GLC_TEX_IMAGE_2D,
+	GLC_GENERATE_MIPMAP,
+	GLC_PIXEL_STORE_I,
+	GLC_READ_BUFFER,
+	GLC_READ_PIXELS,
+	GLC_GEN_BUFFERS,
+	GLC_DELETE_BUFFERS,
+	GLC_BIND_BUFFER,
+	GLC_BUFFER_DATA,
+	GLC_BUFFER_SUB_DATA,
+	GLC_COPY_BUFFER_SUB_DATA,
+	GLC_GEN_VERTEX_ARRAYS,
+	GLC_DELETE_VERTEX_ARRAYS,
+	GLC_BIND_VERTEX_ARRAY,
+	GLC_VERTEX_ATTRIB_POINTER,
+	GLC_ENABLE_VERTEX_ATTRIB_ARRAY,
+	GLC_DISABLE_VERTEX_ATTRIB_ARRAY,
+	GLC_VERTEX_ATTRIB_4F,
+	GLC_GEN_FRAMEBUFFERS,
+	GLC_DELETE_FRAMEBUFFERS,
+	GLC_BIND_FRAMEBUFFER,
+	GLC_FRAMEBUFFER_TEXTURE_2D,
+	GLC_FRAMEBUFFER_RENDERBUFFER,
+	GLC_GEN_RENDERBUFFERS,
+	GLC_DELETE_RENDERBUFFERS,
+	GLC_BIND_RENDERBUFFER,
+	GLC_RENDERBUFFER_STORAGE,
+	GLC_PRIMITIVE_RESTART_INDEX,
+	GLC_USE_PROGRAM,
+	GLC_UNIFORM,
+	GLC_BUFFER_STORAGE,
+	GLC_BUFFER_WRITE,
+	GLC_BIND_BUFFER_RANGE,
+	GLC_UNIFORM_BLOCK_BINDING,
+	GLC_DRAW_BUFFER,
+	GLC_DRAW_BUFFERS,
+	GLC_SCISSOR,
+	GLC_DRAW_ELEMENTS_BASE_VERTEX,
+	GLC_MEMORY_BARRIER,
+	GLC_TEX_BUFFER,
+	GLC_FRAME_END
+};
+
+// the glUniform* variant stored in a GLC_UNIFORM record
+enum GLCAPTURE_UNIFORM
+{
+	GLC_UNIFORM_1I = 0,
+	GLC_UNIFORM_1IV,
+	GLC_UNIFORM_1F,
+	GLC_UNIFORM_1FV,
+	GLC_UNIFORM_2FV,
+	GLC_UNIFORM_3FV,
+	GLC_UNIFORM_4FV,
+	GLC_UNIFORM_MATRIX3FV,
+	GLC_UNIFORM_MATRIX4FV
+};
+
+// the object types that snapshot and frame records name
+enum GLCAPTURE_OBJECT
+{
+	GLC_OBJECT_BUFFER = 0,
+	GLC_OBJECT_TEXTURE,
+	GLC_OBJECT_VERTEX_ARRAY,
+	GLC_OBJECT_FRAMEBUFFER,
+	GLC_OBJECT_RENDERBUFFER,
+	GLC_OBJECT_PROGRAM,
+	MAX_GLC_OBJECTS
+};
+
+/***********************************************************
+ *  GLCaptureWriter
+ *
+ *  Appends records to a memory buffer.
+ ***********************************************************/
+class GLCaptureWriter
+{
+public:
+	GLCaptureWriter() { m_recordStart = 0; m_nRecords = 0; }
+
+	// start a record, the payload follows with the Put calls
+	void Begin(GLCAPTURE_COMMAND command)
+	{
+		GLCAPTURE_RECORD record = { (uint32_t)command, 0 };
+		m_recordStart = m_data.size();
+		PutBytes(&record, sizeof(record));
+	}
+	// patch the payload size of the record
+	void End()
+	{
+		uint32_t size = (uint32_t)(m_data.size() - m_recordStart - sizeof(GLCAPTURE_RECORD));
+		memcpy(&m_data[m_recordStart + sizeof(uint32_t)], &size, sizeof(size));
+		m_nRecords++;
+	}
+
+	void Put32(uint32_t value) { PutBytes(&value, sizeof(value)); }
+	void PutFloat(float value) { PutBytes(&value, sizeof(value)); }
+	void Put64(uint64_t value) { PutBytes(&value, sizeof(value)); }
+	// a 32 bit byte count followed by the bytes
+	void PutBlock(const void* pData, size_t size)
+	{
+		Put32((uint32_t)size);
+		if (size > 0)
+		{
+			PutBytes(pData, size);
+		}
+	}
+	void PutString(const std::string& text) { PutBlock(text.data(), text.size()); }
+	void PutBytes(const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		m_data.insert(m_data.end(), pBytes, pBytes + size);
+	}
+
+	const std::vector<unsigned char>& GetData() const { return(m_data); }
+	uint32_t GetRecordCount() const { return(m_nRecords); }
+	void Clear() { m_data.clear(); m_nRecords = 0; }
+
+private:
+	std::vector<unsigned char> m_data;
+	size_t m_recordStart;
+	uint32_t m_nRecords;
+};
+
+/***********************************************************
+ *  GLCaptureReader
+ *
+ *  Reads the payload of one record.  Reading past the end
+ *  returns zeros and marks the reader as failed, so a
+ *  truncated file cannot read outside its buffer.
+ ***********************************************************/
+class GLCaptureReader
+{
+public:
+	GLCaptureReader(const unsigned char* pData, size_t size)
+	{
+		m_pData = pData;
+		m_size = size;
+		m_offset = 0;
+		m_bFailed = false;
+	}
+
+	uint32_t Get32() { uint32_t value = 0; GetBytes(&value, sizeof(value)); return(value); }
+	float GetFloat() { float value = 0.0f; GetBytes(&value, sizeof(value)); return(value); }
+	uint64_t Get64() { uint64_t value = 0; GetBytes(&value, sizeof(value)); return(value); }
+	// returns the block in place, with its size
+	const unsigned char* GetBlock(uint32_t& size)
+	{
+		size = Get32();
+		if ((m_bFailed == true) || (size > m_size - m_offset))
+		{
+			m_bFailed = true;
+			size = 0;
+			return(NULL);
+		}
+		const unsigned char* pBlock = m_pData + m_offset;
+		m_offset += size;
+		return(pBlock);
+	}
+	std::string GetString()
+	{
+		uint32_t size = 0;
+		const unsigned char* pText = GetBlock(size);
+		return((NULL != pText) ? std::string((const char*)pText, size) : std::string());
+	}
+	void GetBytes(void* pData, size_t size)
+	{
+		if ((m_bFailed == true) || (size > m_size - m_offset))
+		{
+			m_bFailed = true;
+			memset(pData, 0, size);
+			return;
+		}
+		memcpy(pData, m_pData + m_offset, size);
+		m_offset += size;
+	}
+
+	bool IsFailed() const { return(m_bFailed); }
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+	size_t m_offset;
+	bool m_bFailed;
+};
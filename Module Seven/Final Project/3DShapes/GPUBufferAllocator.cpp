@@ -0,0 +1,727 @@
+///////////////////////////////////////////////////////////////////////////////
+// GPUBufferAllocator.cpp
+// ============
+// hands out ranges of a few large GL buffers, so meshes share buffers
+// instead of creating one buffer each
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GPUBufferAllocator.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// index of the highest set bit, -1 for zero
+	int FindLastSet(uint64_t value)
+	{
+		int bit = -1;
+		while (value != 0)
+		{
+			value >>= 1;
+			bit++;
+		}
+		return(bit);
+	}
+
+	// index of the lowest set bit, the value must not be zero
+	int FindFirstSet(uint32_t value)
+	{
+		int bit = 0;
+		while ((value & 1) == 0)
+		{
+			value >>= 1;
+			bit++;
+		}
+		return(bit);
+	}
+
+	GLsizeiptr AlignSize(GLsizeiptr size)
+	{
+		GLsizeiptr alignment = GPUBufferAllocator::ALIGNMENT;
+		return(((size + alignment - 1) / alignment) * alignment);
+	}
+}
+
+/***********************************************************
+ *  GPUBufferAllocator()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GPUBufferAllocator::GPUBufferAllocator(GLsizeiptr blockSize)
+{
+	m_blockSize = AlignSize(blockSize);
+	m_flBitmap = 0;
+	m_movedBytes = 0;
+	m_nFrees = 0;
+	m_bPacked = true;
+
+	for (int fl = 0; fl < FL_COUNT; fl++)
+	{
+		m_slBitmaps[fl] = 0;
+		for (int sl = 0; sl < SL_COUNT; sl++)
+		{
+			m_freeLists[fl][sl] = -1;
+		}
+	}
+
+	// handle zero stands for no allocation
+	m_allocations.push_back(-1);
+}
+
+/***********************************************************
+ *  ~GPUBufferAllocator()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GPUBufferAllocator::~GPUBufferAllocator()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking a range of the passed in
+ *  size from the free lists, creating a new block when no
+ *  free range fits, and copying the data into it.
+ ***********************************************************/
+GLuint GPUBufferAllocator::Allocate(GLsizeiptr size, const void* data)
+{
+	GLsizeiptr rangeSize = AlignSize(std::max(size, (GLsizeiptr)1));
+
+	int range = FindFree(rangeSize);
+	if (range < 0)
+	{
+		range = CreateBlock(std::max(m_blockSize, rangeSize));
+		if (range < 0)
+		{
+			return(0);
+		}
+	}
+
+	GLuint allocation = 0;
+	if (m_unusedAllocations.empty() == false)
+	{
+		allocation = m_unusedAllocations.back();
+		m_unusedAllocations.pop_back();
+	}
+	else
+	{
+		allocation = (GLuint)m_allocations.size();
+		m_allocations.push_back(-1);
+	}
+
+	UseRange(range, rangeSize, allocation);
+	m_allocations[allocation] = range;
+	m_bPacked = false;
+
+	// the copy binding points leave the array and element
+	// bindings of the caller alone
+	if ((NULL != data) && (size > 0))
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_blocks[m_ranges[range].block].buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, m_ranges[range].offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	return(allocation);
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for giving the range of an
+ *  allocation back to the free lists.
+ ***********************************************************/
+void GPUBufferAllocator::Free(GLuint allocation)
+{
+	if ((allocation == 0) || (allocation >= m_allocations.size()) || (m_allocations[allocation] < 0))
+	{
+		return;
+	}
+
+	FreeRange(m_allocations[allocation]);
+	m_allocations[allocation] = -1;
+	m_unusedAllocations.push_back(allocation);
+	m_nFrees++;
+	m_bPacked = false;
+}
+
+/***********************************************************
+ *  GetBuffer()
+ *
+ *  This method is used for getting the buffer holding an
+ *  allocation, or zero for an unknown handle.
+ ***********************************************************/
+GLuint GPUBufferAllocator::GetBuffer(GLuint allocation) const
+{
+	if ((allocation == 0) || (allocation >= m_allocations.size()) || (m_allocations[allocation] < 0))
+	{
+		return(0);
+	}
+	return(m_blocks[m_ranges[m_allocations[allocation]].block].buffer);
+}
+
+/***********************************************************
+ *  GetOffset()
+ *
+ *  This method is used for getting the byte offset of an
+ *  allocation in its buffer.
+ ***********************************************************/
+GLintptr GPUBufferAllocator::GetOffset(GLuint allocation) const
+{
+	if ((allocation == 0) || (allocation >= m_allocations.size()) || (m_allocations[allocation] < 0))
+	{
+		return(0);
+	}
+	return(m_ranges[m_allocations[allocation]].offset);
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method is used for getting the bytes taken by an
+ *  allocation, rounded up to the alignment.
+ ***********************************************************/
+GLsizeiptr GPUBufferAllocator::GetSize(GLuint allocation) const
+{
+	if ((allocation == 0) || (allocation >= m_allocations.size()) || (m_allocations[allocation] < 0))
+	{
+		return(0);
+	}
+	return(m_ranges[m_allocations[allocation]].size);
+}
+
+/***********************************************************
+ *  Compact()
+ *
+ *  This method is used for moving the used ranges that lie
+ *  furthest from the start of the first block into the
+ *  lowest free range that fits them.  The GL orders the
+ *  copies after the draws already issued, so the old range
+ *  can be reused at once.  Meant to be called once per
+ *  frame with a small budget, so the copies are spread
+ *  over many frames.
+ ***********************************************************/
+GLsizeiptr GPUBufferAllocator::Compact(GLsizeiptr maxBytes)
+{
+	// nothing changed since the last pass found nothing
+	if (m_bPacked == true)
+	{
+		return(0);
+	}
+
+	m_compactOrder.clear();
+	for (GLuint allocation = 1; allocation < m_allocations.size(); allocation++)
+	{
+		if (m_allocations[allocation] >= 0)
+		{
+			m_compactOrder.push_back(m_allocations[allocation]);
+		}
+	}
+	std::sort(m_compactOrder.begin(), m_compactOrder.end(),
+		[this](int a, int b) { return(IsBefore(b, a)); });
+
+	GLsizeiptr movedBytes = 0;
+	for (size_t i = 0; (i < m_compactOrder.size()) && (movedBytes < maxBytes); i++)
+	{
+		int source = m_compactOrder[i];
+		int target = FindLowerFree(m_ranges[source].size, source);
+		if (target < 0)
+		{
+			continue;
+		}
+
+		GLuint allocation = m_ranges[source].allocation;
+		GLsizeiptr size = m_ranges[source].size;
+		UseRange(target, size, allocation);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, m_blocks[m_ranges[source].block].buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_blocks[m_ranges[target].block].buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, m_ranges[source].offset, m_ranges[target].offset, size);
+
+		m_allocations[allocation] = target;
+		FreeRange(source);
+		movedBytes += size;
+	}
+
+	if (movedBytes > 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		m_movedBytes += movedBytes;
+	}
+
+	ReleaseEmptyBlocks();
+	// the moved ranges may have opened room for others,
+	// so the next pass looks again
+	m_bPacked = (movedBytes == 0);
+
+	return(movedBytes);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the occupancy and the
+ *  fragmentation of the blocks.  Fragmentation is the part
+ *  of the free bytes that lies outside the largest free
+ *  range, zero when all free space is in one piece.
+ ***********************************************************/
+void GPUBufferAllocator::GetStats(ALLOCATOR_STATS& stats) const
+{
+	stats.nBlocks = 0;
+	stats.nAllocations = 0;
+	stats.nFreeRanges = 0;
+	stats.capacity = 0;
+	stats.usedBytes = 0;
+	stats.largestFree = 0;
+	stats.movedBytes = m_movedBytes;
+	stats.nFrees = m_nFrees;
+
+	GLsizeiptr freeBytes = 0;
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		if (m_blocks[b].buffer == 0)
+		{
+			continue;
+		}
+		stats.nBlocks++;
+		stats.capacity += m_blocks[b].size;
+
+		for (int range = m_blocks[b].firstRange; range >= 0; range = m_ranges[range].nextPhysical)
+		{
+			if (m_ranges[range].bFree == true)
+			{
+				stats.nFreeRanges++;
+				freeBytes += m_ranges[range].size;
+				stats.largestFree = std::max(stats.largestFree, m_ranges[range].size);
+			}
+			else
+			{
+				stats.nAllocations++;
+				stats.usedBytes += m_ranges[range].size;
+			}
+		}
+	}
+
+	stats.occupancy = (stats.capacity > 0) ? (float)stats.usedBytes / stats.capacity : 0.0f;
+	stats.fragmentation = (freeBytes > 0) ? 1.0f - (float)stats.largestFree / freeBytes : 0.0f;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the blocks and clearing
+ *  every range and handle.
+ ***********************************************************/
+void GPUBufferAllocator::Destroy()
+{
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		if (m_blocks[b].buffer != 0)
+		{
+			glDeleteBuffers(1, &m_blocks[b].buffer);
+		}
+	}
+
+	m_blocks.clear();
+	m_ranges.clear();
+	m_unusedRanges.clear();
+	m_allocations.assign(1, -1);
+	m_unusedAllocations.clear();
+	m_bPacked = true;
+
+	m_flBitmap = 0;
+	for (int fl = 0; fl < FL_COUNT; fl++)
+	{
+		m_slBitmaps[fl] = 0;
+		for (int sl = 0; sl < SL_COUNT; sl++)
+		{
+			m_freeLists[fl][sl] = -1;
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateBlock()
+ *
+ *  This method is used for creating a block and adding it
+ *  to the free lists as one range, which is returned, or
+ *  -1 on failure.  The storage is made immutable when the
+ *  GL supports it, so the driver can place it once, and
+ *  only the allocator writes to it.
+ ***********************************************************/
+int GPUBufferAllocator::CreateBlock(GLsizeiptr size)
+{
+	BLOCK block;
+	block.size = size;
+	block.buffer = 0;
+
+	glGenBuffers(1, &block.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, block.buffer);
+	if ((GLEW_VERSION_4_4 == GL_TRUE) || (GLEW_ARB_buffer_storage == GL_TRUE))
+	{
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, GL_DYNAMIC_STORAGE_BIT);
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (glGetError() == GL_OUT_OF_MEMORY)
+	{
+		std::cout << "GPUBufferAllocator: out of memory for a " << size << " byte block" << std::endl;
+		glDeleteBuffers(1, &block.buffer);
+		return(-1);
+	}
+
+	// reuse the slot of a freed block
+	GLuint index = (GLuint)m_blocks.size();
+	for (GLuint b = 0; b < m_blocks.size(); b++)
+	{
+		if (m_blocks[b].buffer == 0)
+		{
+			index = b;
+			break;
+		}
+	}
+	if (index == m_blocks.size())
+	{
+		m_blocks.push_back(block);
+	}
+
+	int range = NewRange();
+	m_ranges[range].block = index;
+	m_ranges[range].offset = 0;
+	m_ranges[range].size = size;
+	m_ranges[range].prevPhysical = -1;
+	m_ranges[range].nextPhysical = -1;
+	block.firstRange = range;
+	m_blocks[index] = block;
+
+	InsertFree(range);
+
+	return(range);
+}
+
+/***********************************************************
+ *  ReleaseEmptyBlocks()
+ *
+ *  This method is used for giving the blocks without any
+ *  allocation back to the driver.  The first block is kept
+ *  for the next allocations.
+ ***********************************************************/
+void GPUBufferAllocator::ReleaseEmptyBlocks()
+{
+	for (size_t b = 1; b < m_blocks.size(); b++)
+	{
+		int range = m_blocks[b].firstRange;
+		if ((m_blocks[b].buffer == 0) ||
+			(m_ranges[range].bFree == false) ||
+			(m_ranges[range].nextPhysical >= 0))
+		{
+			continue;
+		}
+
+		RemoveFree(range);
+		ReleaseRange(range);
+		glDeleteBuffers(1, &m_blocks[b].buffer);
+		m_blocks[b].buffer = 0;
+		m_blocks[b].firstRange = -1;
+	}
+}
+
+/***********************************************************
+ *  MapSize()
+ *
+ *  This method is used for finding the size class of the
+ *  passed in size - the first level is the power of two,
+ *  the second level the next SL_LOG2 bits below it.
+ ***********************************************************/
+void GPUBufferAllocator::MapSize(GLsizeiptr size, int& fl, int& sl)
+{
+	if (size < SMALL_SIZE)
+	{
+		fl = 0;
+		sl = (int)(size / (SMALL_SIZE / SL_COUNT));
+	}
+	else
+	{
+		int msb = FindLastSet((uint64_t)size);
+		fl = std::min(msb - FL_SHIFT + 1, FL_COUNT - 1);
+		sl = (int)(((uint64_t)size >> (msb - SL_LOG2)) - SL_COUNT);
+	}
+}
+
+/***********************************************************
+ *  FindFree()
+ *
+ *  This method is used for finding a free range of at
+ *  least the passed in size.  The size is rounded up to
+ *  the next size class first, so any range in that class
+ *  or above fits without walking the list.
+ ***********************************************************/
+int GPUBufferAllocator::FindFree(GLsizeiptr size) const
+{
+	GLsizeiptr classSize = size;
+	if (size >= SMALL_SIZE)
+	{
+		classSize += ((GLsizeiptr)1 << (FindLastSet((uint64_t)size) - SL_LOG2)) - 1;
+	}
+
+	int fl = 0;
+	int sl = 0;
+	MapSize(classSize, fl, sl);
+
+	uint32_t slMap = (sl < SL_COUNT) ? (m_slBitmaps[fl] & (~0u << sl)) : 0;
+	if (slMap == 0)
+	{
+		uint32_t flMap = (fl + 1 < FL_COUNT) ? (m_flBitmap & (~0u << (fl + 1))) : 0;
+		if (flMap == 0)
+		{
+			return(-1);
+		}
+		fl = FindFirstSet(flMap);
+		slMap = m_slBitmaps[fl];
+	}
+
+	int range = m_freeLists[fl][FindFirstSet(slMap)];
+
+	// the last first level class holds every larger size
+	if ((range >= 0) && (m_ranges[range].size < size))
+	{
+		return(-1);
+	}
+	return(range);
+}
+
+/***********************************************************
+ *  FindLowerFree()
+ *
+ *  This method is used for finding the free range closest
+ *  to the start of the blocks that fits the passed in size
+ *  and lies before the passed in range.  The lists of the
+ *  fitting classes are walked, which is slower than
+ *  FindFree() but keeps compaction moving data downwards.
+ ***********************************************************/
+int GPUBufferAllocator::FindLowerFree(GLsizeiptr size, int before) const
+{
+	int fl = 0;
+	int sl = 0;
+	MapSize(size, fl, sl);
+
+	int best = -1;
+	for (; fl < FL_COUNT; fl++, sl = 0)
+	{
+		for (; sl < SL_COUNT; sl++)
+		{
+			for (int range = m_freeLists[fl][sl]; range >= 0; range = m_ranges[range].nextFree)
+			{
+				if ((m_ranges[range].size >= size) &&
+					(IsBefore(range, before) == true) &&
+					((best < 0) || (IsBefore(range, best) == true)))
+				{
+					best = range;
+				}
+			}
+		}
+	}
+
+	return(best);
+}
+
+/***********************************************************
+ *  InsertFree()
+ *
+ *  This method is used for adding a range to the head of
+ *  the free list of its size class.
+ ***********************************************************/
+void GPUBufferAllocator::InsertFree(int range)
+{
+	int fl = 0;
+	int sl = 0;
+	MapSize(m_ranges[range].size, fl, sl);
+
+	RANGE& freeRange = m_ranges[range];
+	freeRange.bFree = true;
+	freeRange.allocation = 0;
+	freeRange.prevFree = -1;
+	freeRange.nextFree = m_freeLists[fl][sl];
+	if (freeRange.nextFree >= 0)
+	{
+		m_ranges[freeRange.nextFree].prevFree = range;
+	}
+	m_freeLists[fl][sl] = range;
+
+	m_flBitmap |= (1u << fl);
+	m_slBitmaps[fl] |= (1u << sl);
+}
+
+/***********************************************************
+ *  RemoveFree()
+ *
+ *  This method is used for taking a range out of the free
+ *  list of its size class.
+ ***********************************************************/
+void GPUBufferAllocator::RemoveFree(int range)
+{
+	int fl = 0;
+	int sl = 0;
+	MapSize(m_ranges[range].size, fl, sl);
+
+	RANGE& freeRange = m_ranges[range];
+	if (freeRange.prevFree >= 0)
+	{
+		m_ranges[freeRange.prevFree].nextFree = freeRange.nextFree;
+	}
+	else
+	{
+		m_freeLists[fl][sl] = freeRange.nextFree;
+	}
+	if (freeRange.nextFree >= 0)
+	{
+		m_ranges[freeRange.nextFree].prevFree = freeRange.prevFree;
+	}
+	freeRange.prevFree = -1;
+	freeRange.nextFree = -1;
+	freeRange.bFree = false;
+
+	if (m_freeLists[fl][sl] < 0)
+	{
+		m_slBitmaps[fl] &= ~(1u << sl);
+		if (m_slBitmaps[fl] == 0)
+		{
+			m_flBitmap &= ~(1u << fl);
+		}
+	}
+}
+
+/***********************************************************
+ *  UseRange()
+ *
+ *  This method is used for taking a free range out of its
+ *  list for an allocation.  What is left past the passed
+ *  in size becomes a free range of its own.
+ ***********************************************************/
+void GPUBufferAllocator::UseRange(int range, GLsizeiptr size, GLuint allocation)
+{
+	RemoveFree(range);
+
+	if (m_ranges[range].size - size >= ALIGNMENT)
+	{
+		// NewRange() may move the ranges, so no references
+		// are held across it
+		int rest = NewRange();
+		m_ranges[rest].block = m_ranges[range].block;
+		m_ranges[rest].offset = m_ranges[range].offset + size;
+		m_ranges[rest].size = m_ranges[range].size - size;
+		m_ranges[rest].prevPhysical = range;
+		m_ranges[rest].nextPhysical = m_ranges[range].nextPhysical;
+		if (m_ranges[rest].nextPhysical >= 0)
+		{
+			m_ranges[m_ranges[rest].nextPhysical].prevPhysical = rest;
+		}
+		m_ranges[range].nextPhysical = rest;
+		m_ranges[range].size = size;
+		InsertFree(rest);
+	}
+
+	m_ranges[range].allocation = allocation;
+}
+
+/***********************************************************
+ *  FreeRange()
+ *
+ *  This method is used for returning a used range to the
+ *  free lists.  Free neighbours in the block are merged
+ *  into it, so two free ranges are never next to each
+ *  other.
+ ***********************************************************/
+void GPUBufferAllocator::FreeRange(int range)
+{
+	int next = m_ranges[range].nextPhysical;
+	if ((next >= 0) && (m_ranges[next].bFree == true))
+	{
+		RemoveFree(next);
+		m_ranges[range].size += m_ranges[next].size;
+		m_ranges[range].nextPhysical = m_ranges[next].nextPhysical;
+		if (m_ranges[range].nextPhysical >= 0)
+		{
+			m_ranges[m_ranges[range].nextPhysical].prevPhysical = range;
+		}
+		ReleaseRange(next);
+	}
+
+	int prev = m_ranges[range].prevPhysical;
+	if ((prev >= 0) && (m_ranges[prev].bFree == true))
+	{
+		RemoveFree(prev);
+		m_ranges[prev].size += m_ranges[range].size;
+		m_ranges[prev].nextPhysical = m_ranges[range].nextPhysical;
+		if (m_ranges[prev].nextPhysical >= 0)
+		{
+			m_ranges[m_ranges[prev].nextPhysical].prevPhysical = prev;
+		}
+		ReleaseRange(range);
+		range = prev;
+	}
+
+	InsertFree(range);
+}
+
+/***********************************************************
+ *  NewRange()
+ *
+ *  This method is used for getting an unused range slot.
+ ***********************************************************/
+int GPUBufferAllocator::NewRange()
+{
+	int range = 0;
+	if (m_unusedRanges.empty() == false)
+	{
+		range = m_unusedRanges.back();
+		m_unusedRanges.pop_back();
+	}
+	else
+	{
+		range = (int)m_ranges.size();
+		m_ranges.push_back(RANGE());
+	}
+
+	RANGE& newRange = m_ranges[range];
+	newRange.block = 0;
+	newRange.offset = 0;
+	newRange.size = 0;
+	newRange.bFree = false;
+	newRange.prevPhysical = -1;
+	newRange.nextPhysical = -1;
+	newRange.prevFree = -1;
+	newRange.nextFree = -1;
+	newRange.allocation = 0;
+
+	return(range);
+}
+
+void GPUBufferAllocator::ReleaseRange(int range)
+{
+	m_unusedRanges.push_back(range);
+}
+
+/***********************************************************
+ *  IsBefore()
+ *
+ *  This method is used for ordering ranges by block and
+ *  then by offset.
+ ***********************************************************/
+bool GPUBufferAllocator::IsBefore(int range, int other) const
+{
+	if (m_ranges[range].block != m_ranges[other].block)
+	{
+		return(m_ranges[range].block < m_ranges[other].block);
+	}
+	return(m_ranges[range].offset < m_ranges[other].offset);
+}
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpubufferallocator.h
+// ============
+// hands out ranges of a few large GL buffers, so meshes share buffers
+// instead of creating one buffer each
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  GPUBufferAllocator
+ *
+ *  This class contains a TLSF (two level segregated fit)
+ *  allocator over large GL buffers, called blocks.  Free
+ *  ranges are kept in lists by size class, found through
+ *  two levels of bitmaps, so allocating and freeing take
+ *  the same short time however many ranges there are.
+ *
+ *  Allocations are known by a handle that stays the same
+ *  when Compact() moves the data, the buffer and offset
+ *  must be read again through the handle before use.
+ *  Blocks are created when the first allocation needs one
+ *  and use immutable storage where the GL supports it.
+ ***********************************************************/
+class GPUBufferAllocator
+{
+public:
+	// occupancy and fragmentation of the blocks
+	struct ALLOCATOR_STATS
+	{
+		GLuint nBlocks;
+		GLuint nAllocations;
+		GLuint nFreeRanges;
+		GLsizeiptr capacity;      // Bytes in all blocks
+		GLsizeiptr usedBytes;
+		GLsizeiptr largestFree;   // Largest range that can be allocated
+		float occupancy;          // Used bytes over the capacity
+		float fragmentation;      // Free bytes outside the largest free range
+		uint64_t movedBytes;      // Bytes moved by compaction so far
+		uint64_t nFrees;          // Allocations freed so far
+	};
+
+	// constructor - no GL calls are made until the first
+	// allocation, blocks hold at least blockSize bytes
+	GPUBufferAllocator(GLsizeiptr blockSize);
+	~GPUBufferAllocator();
+
+	// copy the passed in data, when not NULL, into a new
+	// range and return its handle, or zero on failure
+	GLuint Allocate(GLsizeiptr size, const void* data);
+	void Free(GLuint allocation);
+
+	// the current place of an allocation
+	GLuint GetBuffer(GLuint allocation) const;
+	GLintptr GetOffset(GLuint allocation) const;
+	GLsizeiptr GetSize(GLuint allocation) const;
+
+	// move allocations towards the start of the first
+	// block, up to the passed in number of bytes, and free
+	// the blocks left empty - returns the bytes moved
+	GLsizeiptr Compact(GLsizeiptr maxBytes);
+
+	void GetStats(ALLOCATOR_STATS& stats) const;
+
+	// free every block, the handles become invalid
+	void Destroy();
+
+	// offsets and sizes are multiples of this many bytes
+	static const GLsizeiptr ALIGNMENT = 16;
+
+private:
+	// the size classes - each power of two is split into
+	// SL_COUNT lists, sizes below SMALL_SIZE share the
+	// first level in ALIGNMENT wide steps
+	static const int SL_LOG2 = 4;
+	static const int SL_COUNT = 1 << SL_LOG2;
+	static const int FL_SHIFT = SL_LOG2 + 4;
+	static const int FL_COUNT = 32;
+	static const GLsizeiptr SMALL_SIZE = (GLsizeiptr)1 << FL_SHIFT;
+
+	// one range of a block, free or used
+	struct RANGE
+	{
+		GLuint block;
+		GLintptr offset;
+		GLsizeiptr size;
+		bool bFree;
+		int prevPhysical;         // Neighbours in the block, -1 at the ends
+		int nextPhysical;
+		int prevFree;             // Neighbours in the free list
+		int nextFree;
+		GLuint allocation;        // Handle while used
+	};
+
+	struct BLOCK
+	{
+		GLuint buffer;            // Zero once the block is freed
+		GLsizeiptr size;
+		int firstRange;
+	};
+
+	GLsizeiptr m_blockSize;
+	std::vector<BLOCK> m_blocks;
+	std::vector<RANGE> m_ranges;
+	std::vector<int> m_unusedRanges;
+	// range of each handle, -1 for unused handles
+	std::vector<int> m_allocations;
+	std::vector<GLuint> m_unusedAllocations;
+
+	// free lists by size class, with a bit set for each
+	// list that is not empty
+	int m_freeLists[FL_COUNT][SL_COUNT];
+	uint32_t m_flBitmap;
+	uint32_t m_slBitmaps[FL_COUNT];
+
+	uint64_t m_movedBytes;
+	uint64_t m_nFrees;
+	// set when a compaction found nothing to move, cleared
+	// when the ranges change
+	bool m_bPacked;
+	// reused list of the used ranges, furthest first
+	std::vector<int> m_compactOrder;
+
+	// called to create a new block of at least the size,
+	// returns its free range
+	int CreateBlock(GLsizeiptr size);
+	// called to free the blocks that hold no allocations,
+	// keeping the first one
+	void ReleaseEmptyBlocks();
+
+	// called to find the free list of a size
+	static void MapSize(GLsizeiptr size, int& fl, int& sl);
+	// called to find a free range that fits the size
+	int FindFree(GLsizeiptr size) const;
+	// called to find the free range nearest the start of
+	// the blocks that fits the size and lies before the
+	// passed in range
+	int FindLowerFree(GLsizeiptr size, int before) const;
+	void InsertFree(int range);
+	void RemoveFree(int range);
+
+	// called to mark a free range used, splitting off the
+	// rest of it as a new free range
+	void UseRange(int range, GLsizeiptr size, GLuint allocation);
+	// called to mark a range free, merging it with its
+	// free neighbours
+	void FreeRange(int range);
+
+	int NewRange();
+	void ReleaseRange(int range);
+	bool IsBefore(int range, int other) const;
+};
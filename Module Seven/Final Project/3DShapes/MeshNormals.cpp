@@ -0,0 +1,369 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshNormals.cpp
+// ========
+// generate smooth normals and tangents for indexed triangle meshes, splitting
+// vertices along hard edges
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshNormals.h"
+#include "MeshWeld.h"
+#include "PerfCounters.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+// SSE is available on every x86 target we build for, other
+// targets fall back to the scalar face normal loop
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define MESHNORMALS_USE_SSE
+#endif
+
+namespace
+{
+	// default crease angle in degrees
+	const float g_DefaultCreaseAngle = 60.0f;
+	// generated normals closer than this share a vertex
+	const float g_SameNormalCosine = 0.9999f;
+	// items handed to a worker thread at a time
+	const size_t g_ItemsPerChunk = 1024;
+
+	// angle of the triangle corner at p0
+	float CornerAngle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+	{
+		glm::vec3 e1 = p1 - p0;
+		glm::vec3 e2 = p2 - p0;
+		float lengths = glm::length(e1) * glm::length(e2);
+		if (lengths <= 0.0f)
+		{
+			return(0.0f);
+		}
+		return(std::acos(glm::clamp(glm::dot(e1, e2) / lengths, -1.0f, 1.0f)));
+	}
+}
+
+///////////////////////////////////////////////////
+//	MeshNormals()
+//
+//	The constructor for the class
+///////////////////////////////////////////////////
+MeshNormals::MeshNormals()
+{
+	SetCreaseAngle(g_DefaultCreaseAngle);
+	m_nThreads = 0;
+}
+
+///////////////////////////////////////////////////
+//	SetCreaseAngle()
+//
+//	Set the angle above which an edge is hard.  Use
+//  180 degrees for a fully smooth mesh.
+///////////////////////////////////////////////////
+void MeshNormals::SetCreaseAngle(float degrees)
+{
+	m_creaseCosine = std::cos(glm::radians(glm::clamp(degrees, 0.0f, 180.0f)));
+}
+
+///////////////////////////////////////////////////
+//	SetThreadCount()
+//
+//	Set the number of worker threads used for the
+//  per-face and per-corner passes.
+///////////////////////////////////////////////////
+void MeshNormals::SetThreadCount(unsigned int nThreads)
+{
+	m_nThreads = nThreads;
+}
+
+///////////////////////////////////////////////////
+//	CalculateFaceNormals()
+//
+//	Calculate the unit normal and the area of every
+//  triangle.  Four triangles are gathered into SIMD
+//  registers per iteration; degenerate triangles get a
+//  zero normal and a zero area.
+///////////////////////////////////////////////////
+void MeshNormals::CalculateFaceNormals(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<GLuint>& indices,
+	std::vector<glm::vec3>& faceNormals,
+	std::vector<float>& faceAreas)
+{
+	size_t nFaces = indices.size() / 3;
+	faceNormals.resize(nFaces);
+	faceAreas.resize(nFaces);
+
+	ParallelFor(nFaces, m_nThreads, g_ItemsPerChunk, [&](size_t begin, size_t end)
+	{
+		size_t face = begin;
+
+#ifdef MESHNORMALS_USE_SSE
+		for (; face + 4 <= end; face += 4)
+		{
+			float p[3][3][4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const glm::vec3& v = positions[indices[(face + lane) * 3 + corner]];
+					p[corner][0][lane] = v.x;
+					p[corner][1][lane] = v.y;
+					p[corner][2][lane] = v.z;
+				}
+			}
+
+			__m128 e1x = _mm_sub_ps(_mm_loadu_ps(p[1][0]), _mm_loadu_ps(p[0][0]));
+			__m128 e1y = _mm_sub_ps(_mm_loadu_ps(p[1][1]), _mm_loadu_ps(p[0][1]));
+			__m128 e1z = _mm_sub_ps(_mm_loadu_ps(p[1][2]), _mm_loadu_ps(p[0][2]));
+			__m128 e2x = _mm_sub_ps(_mm_loadu_ps(p[2][0]), _mm_loadu_ps(p[0][0]));
+			__m128 e2y = _mm_sub_ps(_mm_loadu_ps(p[2][1]), _mm_loadu_ps(p[0][1]));
+			__m128 e2z = _mm_sub_ps(_mm_loadu_ps(p[2][2]), _mm_loadu_ps(p[0][2]));
+
+			__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+			__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+			__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+				_mm_mul_ps(nz, nz)));
+			__m128 valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+			__m128 inverse = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), length));
+
+			float out[4][4];
+			_mm_storeu_ps(out[0], _mm_mul_ps(nx, inverse));
+			_mm_storeu_ps(out[1], _mm_mul_ps(ny, inverse));
+			_mm_storeu_ps(out[2], _mm_mul_ps(nz, inverse));
+			_mm_storeu_ps(out[3], _mm_mul_ps(length, _mm_set1_ps(0.5f)));
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				faceNormals[face + lane] = glm::vec3(out[0][lane], out[1][lane], out[2][lane]);
+				faceAreas[face + lane] = out[3][lane];
+			}
+		}
+#endif
+
+		for (; face < end; face++)
+		{
+			const glm::vec3& p0 = positions[indices[face * 3]];
+			const glm::vec3& p1 = positions[indices[face * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[face * 3 + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+
+			faceNormals[face] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+			faceAreas[face] = length * 0.5f;
+		}
+	});
+}
+
+///////////////////////////////////////////////////
+//	Generate()
+//
+//	Generate split vertices with smooth normals and
+//  tangents.  The steps are:
+//
+//	1. face normals and areas (SIMD, parallel)
+//	2. weld coincident positions, so that UV seams do
+//	   not break the smoothing, and list the corners
+//	   touching each welded position
+//	3. for every corner, sum the area and angle weighted
+//	   normals of the faces around its position that are
+//	   within the crease angle of its own face - each
+//	   corner is written by one thread only, so the
+//	   parallel accumulation needs no atomics
+//	4. merge corners of the same input vertex whose
+//	   normals match into one output vertex
+//	5. accumulate and orthonormalize the tangents
+///////////////////////////////////////////////////
+bool MeshNormals::Generate(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec2>& uvs,
+	const std::vector<GLuint>& indices,
+	std::vector<MESH_VERTEX>& vertices,
+	std::vector<GLuint>& outIndices,
+	std::vector<GLuint>* pSourceVertex)
+{
+	PERF_SCOPE("NormalGeneration");
+
+	vertices.clear();
+	outIndices.clear();
+	if (pSourceVertex != NULL)
+	{
+		pSourceVertex->clear();
+	}
+
+	if ((positions.empty() == true) || (indices.size() < 3) ||
+		((uvs.empty() == false) && (uvs.size() != positions.size())))
+	{
+		return(false);
+	}
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (indices[i] >= positions.size())
+		{
+			return(false);
+		}
+	}
+
+	size_t nCorners = indices.size() - (indices.size() % 3);
+	size_t nFaces = nCorners / 3;
+
+	// 1. face normals and areas
+	std::vector<glm::vec3> faceNormals;
+	std::vector<float> faceAreas;
+	CalculateFaceNormals(positions, indices, faceNormals, faceAreas);
+
+	// corner angles, used as the second weight
+	std::vector<float> cornerAngles(nCorners);
+	ParallelFor(nFaces, m_nThreads, g_ItemsPerChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t face = begin; face < end; face++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				cornerAngles[face * 3 + corner] = CornerAngle(
+					positions[indices[face * 3 + corner]],
+					positions[indices[face * 3 + (corner + 1) % 3]],
+					positions[indices[face * 3 + (corner + 2) % 3]]);
+			}
+		}
+	});
+
+	// 2. weld positions and build the corner lists
+	std::vector<GLuint> welded;
+	GLuint nWelded = WeldPositions(positions, welded);
+
+	std::vector<GLuint> cornerStart(nWelded + 1, 0);
+	std::vector<GLuint> cornerList(nCorners);
+	for (size_t c = 0; c < nCorners; c++)
+	{
+		cornerStart[welded[indices[c]] + 1]++;
+	}
+	for (size_t i = 1; i < cornerStart.size(); i++)
+	{
+		cornerStart[i] += cornerStart[i - 1];
+	}
+	std::vector<GLuint> fill(cornerStart.begin(), cornerStart.end() - 1);
+	for (size_t c = 0; c < nCorners; c++)
+	{
+		cornerList[fill[welded[indices[c]]]++] = (GLuint)c;
+	}
+
+	// 3. smooth normal of every corner
+	std::vector<glm::vec3> cornerNormals(nCorners);
+	ParallelFor(nCorners, m_nThreads, g_ItemsPerChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; c++)
+		{
+			const glm::vec3& faceNormal = faceNormals[c / 3];
+			GLuint position = welded[indices[c]];
+			glm::vec3 sum(0.0f);
+
+			for (GLuint i = cornerStart[position]; i < cornerStart[position + 1]; i++)
+			{
+				GLuint other = cornerList[i];
+				const glm::vec3& otherNormal = faceNormals[other / 3];
+				if (glm::dot(faceNormal, otherNormal) >= m_creaseCosine)
+				{
+					sum += otherNormal * (faceAreas[other / 3] * cornerAngles[other]);
+				}
+			}
+
+			float length = glm::length(sum);
+			cornerNormals[c] = (length > 0.0f) ? sum / length : faceNormal;
+		}
+	});
+
+	// 4. merge matching corners into output vertices
+	std::vector<GLuint> firstOutput(positions.size(), ~0u);
+	std::vector<GLuint> nextOutput;
+	std::vector<GLuint> sourceVertex;
+	outIndices.resize(nCorners);
+	for (size_t c = 0; c < nCorners; c++)
+	{
+		GLuint source = indices[c];
+		GLuint match = firstOutput[source];
+		while ((match != ~0u) &&
+			(glm::dot(vertices[match].normal, cornerNormals[c]) < g_SameNormalCosine))
+		{
+			match = nextOutput[match];
+		}
+
+		if (match == ~0u)
+		{
+			MESH_VERTEX vertex;
+			vertex.position = positions[source];
+			vertex.normal = cornerNormals[c];
+			vertex.uv = (uvs.empty() == true) ? glm::vec2(0.0f, 0.0f) : uvs[source];
+			vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+			match = (GLuint)vertices.size();
+			vertices.push_back(vertex);
+			sourceVertex.push_back(source);
+			nextOutput.push_back(firstOutput[source]);
+			firstOutput[source] = match;
+		}
+		outIndices[c] = match;
+	}
+
+	// 5. tangents from the uv gradients of each face
+	std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+	if (uvs.empty() == false)
+	{
+		for (size_t face = 0; face < nFaces; face++)
+		{
+			const MESH_VERTEX& v0 = vertices[outIndices[face * 3]];
+			const MESH_VERTEX& v1 = vertices[outIndices[face * 3 + 1]];
+			const MESH_VERTEX& v2 = vertices[outIndices[face * 3 + 2]];
+			glm::vec3 e1 = v1.position - v0.position;
+			glm::vec3 e2 = v2.position - v0.position;
+			glm::vec2 d1 = v1.uv - v0.uv;
+			glm::vec2 d2 = v2.uv - v0.uv;
+			float determinant = d1.x * d2.y - d2.x * d1.y;
+			if (std::fabs(determinant) < 1e-12f)
+			{
+				continue;
+			}
+
+			float r = 1.0f / determinant;
+			glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+			glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				tangents[outIndices[face * 3 + corner]] += tangent;
+				bitangents[outIndices[face * 3 + corner]] += bitangent;
+			}
+		}
+	}
+
+	ParallelFor(vertices.size(), m_nThreads, g_ItemsPerChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			const glm::vec3& n = vertices[v].normal;
+
+			// Gram-Schmidt, falling back to any perpendicular
+			// direction when the uvs give no tangent
+			glm::vec3 t = tangents[v] - n * glm::dot(n, tangents[v]);
+			if (glm::length(t) < 1e-8f)
+			{
+				glm::vec3 axis = (std::fabs(n.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				t = glm::cross(axis, n);
+			}
+			t = glm::normalize(t);
+
+			float handedness = (glm::dot(glm::cross(n, t), bitangents[v]) < 0.0f) ? -1.0f : 1.0f;
+			vertices[v].tangent = glm::vec4(t, handedness);
+		}
+	});
+
+	if (pSourceVertex != NULL)
+	{
+		pSourceVertex->swap(sourceVertex);
+	}
+
+	return(true);
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshnormals.h
+// ============
+// generate smooth normals and tangents for indexed triangle meshes, splitting
+// vertices along hard edges
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshNormals
+ *
+ *  This class contains the code for generating vertex
+ *  normals and tangents for any indexed triangle mesh.
+ *  It is shared by the procedural shape generators and
+ *  by mesh importers.
+ ***********************************************************/
+class MeshNormals
+{
+public:
+	// one vertex of the generated mesh
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+		glm::vec4 tangent;  // w holds the bitangent sign
+	};
+
+	// constructor
+	MeshNormals();
+
+	// set the crease angle in degrees - faces meeting at a
+	// sharper angle than this get separate vertices
+	void SetCreaseAngle(float degrees);
+
+	// set the number of worker threads, zero uses one per core
+	void SetThreadCount(unsigned int nThreads);
+
+	// generate the vertices and indices of the passed in mesh,
+	// uvs may be empty - sourceVertex receives the input vertex
+	// each generated vertex was created from
+	bool Generate(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<GLuint>& indices,
+		std::vector<MESH_VERTEX>& vertices,
+		std::vector<GLuint>& outIndices,
+		std::vector<GLuint>* pSourceVertex = NULL);
+
+	// calculate the unit normal and area of every triangle
+	void CalculateFaceNormals(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<GLuint>& indices,
+		std::vector<glm::vec3>& faceNormals,
+		std::vector<float>& faceAreas);
+
+private:
+	// cosine of the crease angle
+	float m_creaseCosine;
+	// number of worker threads
+	unsigned int m_nThreads;
+};
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshWeld.cpp
+// ========
+// give coincident positions of a mesh the same id, so the seams the shape
+// generators split can be treated as connected
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshWeld.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace
+{
+	// grid used when welding coincident positions together
+	const double g_WeldScale = 10000.0;
+
+	// point of the weld grid, with the full rounded
+	// coordinates so far apart positions never match
+	struct WELD_POINT
+	{
+		int64_t x;
+		int64_t y;
+		int64_t z;
+
+		bool operator==(const WELD_POINT& other) const
+		{
+			return((x == other.x) && (y == other.y) && (z == other.z));
+		}
+	};
+
+	struct WELD_POINT_HASH
+	{
+		size_t operator()(const WELD_POINT& point) const
+		{
+			uint64_t hash = (uint64_t)point.x * 0x9E3779B97F4A7C15ULL;
+			hash = (hash ^ (uint64_t)point.y) * 0xC2B2AE3D27D4EB4FULL;
+			hash = (hash ^ (uint64_t)point.z) * 0x165667B19E3779F9ULL;
+			return((size_t)(hash ^ (hash >> 29)));
+		}
+	};
+}
+
+///////////////////////////////////////////////////
+//	WeldPositions()
+//
+//	Give coincident positions the same id.  The
+//  positions are rounded to the weld grid and matched
+//  on all of their rounded coordinates.
+///////////////////////////////////////////////////
+GLuint WeldPositions(
+	const std::vector<glm::vec3>& positions,
+	std::vector<GLuint>& welded)
+{
+	std::unordered_map<WELD_POINT, GLuint, WELD_POINT_HASH> weldedIDs;
+	welded.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const glm::vec3& p = positions[i];
+		WELD_POINT point;
+		point.x = (int64_t)std::llround((double)p.x * g_WeldScale);
+		point.y = (int64_t)std::llround((double)p.y * g_WeldScale);
+		point.z = (int64_t)std::llround((double)p.z * g_WeldScale);
+
+		std::unordered_map<WELD_POINT, GLuint, WELD_POINT_HASH>::iterator found = weldedIDs.find(point);
+		if (found == weldedIDs.end())
+		{
+			GLuint id = (GLuint)weldedIDs.size();
+			weldedIDs[point] = id;
+			welded[i] = id;
+		}
+		else
+		{
+			welded[i] = found->second;
+		}
+	}
+
+	return((GLuint)weldedIDs.size());
+}
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshweld.h
+// ============
+// give coincident positions of a mesh the same id, so the seams the shape
+// generators split can be treated as connected
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// give the passed in positions that round to the same point
+// of a fine grid the same id, returning the number of ids -
+// welded receives the id of each position
+GLuint WeldPositions(
+	const std::vector<glm::vec3>& positions,
+	std::vector<GLuint>& welded);
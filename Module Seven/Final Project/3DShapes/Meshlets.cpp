@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// Meshlets.cpp
+// ========
+// split triangle meshes into small clusters (meshlets) that carry their own
+// bounding sphere and normal cone, so hidden clusters can be rejected on the
+// CPU before any triangles are submitted
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Meshlets.h"
+#include "MeshWeld.h"
+#include "PerfCounters.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+// SSE is available on every x86 target we build for, other
+// targets fall back to the scalar culling loop
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define MESHLETS_USE_SSE
+#endif
+
+namespace
+{
+	// normal cones wider than this cannot reject anything useful
+	const float g_MinConeDot = 0.1f;
+
+	// read the position of the passed in vertex
+	glm::vec3 GetPosition(const GLfloat* vertexData, GLuint floatsPerVertex, GLuint vertex)
+	{
+		const GLfloat* p = vertexData + (size_t)vertex * floatsPerVertex;
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+
+	// read the element at the passed in position of the list
+	GLuint GetElement(const GLuint* indices, GLuint element)
+	{
+		if (indices == NULL)
+		{
+			return(element);
+		}
+		return(indices[element]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	MeshletSet()
+//
+//	The constructor for the class
+///////////////////////////////////////////////////
+MeshletSet::MeshletSet()
+{
+	m_nMeshlets = 0;
+	m_bConeCullingSafe = false;
+}
+
+///////////////////////////////////////////////////
+//	Build()
+//
+//	Walk the triangle list in order and close the
+//  current meshlet whenever adding the next triangle
+//  would exceed the vertex or triangle limit.  The
+//  triangle order is not changed, so partial draws
+//  such as the half sphere still work on the result.
+///////////////////////////////////////////////////
+void MeshletSet::Build(
+	const GLfloat* vertexData,
+	GLuint floatsPerVertex,
+	GLuint nVertices,
+	const GLuint* indices,
+	GLuint nElements)
+{
+	PERF_SCOPE("MeshletBuild");
+
+	m_nMeshlets = 0;
+	m_firstElement.clear();
+	m_elementCount.clear();
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_radius.clear();
+	m_coneAxisX.clear();
+	m_coneAxisY.clear();
+	m_coneAxisZ.clear();
+	m_coneCutoff.clear();
+
+	if ((vertexData == NULL) || (nVertices == 0) || (nElements < 3))
+	{
+		return;
+	}
+
+	m_bConeCullingSafe = CheckClosedOutward(vertexData, floatsPerVertex, nVertices, indices, nElements);
+
+	// the meshlet each vertex was last added to
+	std::vector<GLuint> vertexMeshlet(nVertices, ~0u);
+	GLuint currentMeshlet = 0;
+	GLuint firstElement = 0;
+	GLuint meshletVertices = 0;
+	GLuint meshletTriangles = 0;
+	GLuint nTriangleElements = nElements - (nElements % 3);
+
+	for (GLuint element = 0; element < nTriangleElements; element += 3)
+	{
+		GLuint tri[3] = {
+			GetElement(indices, element),
+			GetElement(indices, element + 1),
+			GetElement(indices, element + 2) };
+
+		// count the vertices this triangle would add
+		GLuint newVertices = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			bool bSeen = (vertexMeshlet[tri[i]] == currentMeshlet);
+			for (int j = 0; j < i; j++)
+			{
+				bSeen = bSeen || (tri[j] == tri[i]);
+			}
+			if (bSeen == false)
+			{
+				newVertices++;
+			}
+		}
+
+		if ((meshletVertices + newVertices > MAX_VERTICES) ||
+			(meshletTriangles + 1 > MAX_TRIANGLES))
+		{
+			AddMeshlet(vertexData, floatsPerVertex, indices, firstElement, element - firstElement);
+			currentMeshlet++;
+			firstElement = element;
+			meshletVertices = 0;
+			meshletTriangles = 0;
+			newVertices = 3 - (tri[0] == tri[1]) - (tri[2] == tri[0] || tri[2] == tri[1]);
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			vertexMeshlet[tri[i]] = currentMeshlet;
+		}
+		meshletVertices += newVertices;
+		meshletTriangles++;
+	}
+
+	if (meshletTriangles > 0)
+	{
+		AddMeshlet(vertexData, floatsPerVertex, indices, firstElement, nTriangleElements - firstElement);
+	}
+
+	// pad the arrays so the SIMD loop never reads past the end, the
+	// padding meshlets are empty and are never emitted
+	while ((m_centerX.size() % 4) != 0)
+	{
+		m_firstElement.push_back(0);
+		m_elementCount.push_back(0);
+		m_centerX.push_back(0.0f);
+		m_centerY.push_back(0.0f);
+		m_centerZ.push_back(0.0f);
+		m_radius.push_back(0.0f);
+		m_coneAxisX.push_back(0.0f);
+		m_coneAxisY.push_back(0.0f);
+		m_coneAxisZ.push_back(0.0f);
+		m_coneCutoff.push_back(1.0f);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddMeshlet()
+//
+//	Calculate the bounding sphere and the normal cone
+//  for the passed in element range and append it to
+//  the meshlet table.
+///////////////////////////////////////////////////
+void MeshletSet::AddMeshlet(
+	const GLfloat* vertexData,
+	GLuint floatsPerVertex,
+	const GLuint* indices,
+	GLuint firstElement,
+	GLuint nElements)
+{
+	glm::vec3 minBounds(1e30f);
+	glm::vec3 maxBounds(-1e30f);
+	glm::vec3 normalSum(0.0f);
+	std::vector<glm::vec3> normals;
+
+	normals.reserve(nElements / 3);
+	for (GLuint element = firstElement; element < firstElement + nElements; element += 3)
+	{
+		glm::vec3 p0 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element));
+		glm::vec3 p1 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element + 1));
+		glm::vec3 p2 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element + 2));
+
+		minBounds = glm::min(minBounds, glm::min(p0, glm::min(p1, p2)));
+		maxBounds = glm::max(maxBounds, glm::max(p0, glm::max(p1, p2)));
+
+		// degenerate triangles are never rasterized, so they do
+		// not widen the normal cone
+		glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(faceNormal);
+		if (area > 0.0f)
+		{
+			faceNormal /= area;
+			normals.push_back(faceNormal);
+			normalSum += faceNormal;
+		}
+	}
+
+	glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+	float radius = 0.0f;
+	for (GLuint element = firstElement; element < firstElement + nElements; element++)
+	{
+		glm::vec3 p = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element));
+		radius = std::max(radius, glm::length(p - center));
+	}
+
+	// the cutoff stays at one (never culled) unless every triangle
+	// normal lies well inside the cone around the average normal
+	glm::vec3 coneAxis(0.0f, 1.0f, 0.0f);
+	float coneCutoff = 1.0f;
+	float sumLength = glm::length(normalSum);
+	if ((m_bConeCullingSafe == true) && (sumLength > 0.0f))
+	{
+		coneAxis = normalSum / sumLength;
+		float minDot = 1.0f;
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			minDot = std::min(minDot, glm::dot(coneAxis, normals[i]));
+		}
+		if (minDot > g_MinConeDot)
+		{
+			coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	m_firstElement.push_back((GLint)firstElement);
+	m_elementCount.push_back((GLsizei)nElements);
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_radius.push_back(radius);
+	m_coneAxisX.push_back(coneAxis.x);
+	m_coneAxisY.push_back(coneAxis.y);
+	m_coneAxisZ.push_back(coneAxis.z);
+	m_coneCutoff.push_back(coneCutoff);
+	m_nMeshlets++;
+}
+
+///////////////////////////////////////////////////
+//	CheckClosedOutward()
+//
+//	Back-facing clusters can only be rejected when the
+//  mesh is closed and every triangle faces outward.
+//  Vertices are welded by position first, since the
+//  generated meshes duplicate vertices along seams.
+///////////////////////////////////////////////////
+bool MeshletSet::CheckClosedOutward(
+	const GLfloat* vertexData,
+	GLuint floatsPerVertex,
+	GLuint nVertices,
+	const GLuint* indices,
+	GLuint nElements) const
+{
+	std::vector<glm::vec3> positions(nVertices);
+	for (GLuint i = 0; i < nVertices; i++)
+	{
+		positions[i] = GetPosition(vertexData, floatsPerVertex, i);
+	}
+	std::vector<GLuint> welded;
+	WeldPositions(positions, welded);
+
+	// every directed edge must appear exactly once, and its
+	// reverse must belong to the neighboring triangle
+	std::unordered_map<uint64_t, int> edges;
+	double signedVolume = 0.0;
+	for (GLuint element = 0; element + 2 < nElements; element += 3)
+	{
+		GLuint v[3];
+		for (int i = 0; i < 3; i++)
+		{
+			v[i] = welded[GetElement(indices, element + i)];
+		}
+		if ((v[0] == v[1]) || (v[1] == v[2]) || (v[2] == v[0]))
+		{
+			continue;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			uint64_t key = ((uint64_t)v[i] << 32) | v[(i + 1) % 3];
+			if (++edges[key] > 1)
+			{
+				return(false);
+			}
+		}
+
+		glm::vec3 p0 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element));
+		glm::vec3 p1 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element + 1));
+		glm::vec3 p2 = GetPosition(vertexData, floatsPerVertex, GetElement(indices, element + 2));
+		signedVolume += glm::dot(p0, glm::cross(p1, p2));
+	}
+
+	for (std::unordered_map<uint64_t, int>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+	{
+		uint64_t reverse = (it->first << 32) | (it->first >> 32);
+		if (edges.find(reverse) == edges.end())
+		{
+			return(false);
+		}
+	}
+
+	return(signedVolume > 0.0);
+}
+
+///////////////////////////////////////////////////
+//	Cull()
+//
+//	Test the meshlets in object space - the frustum
+//  planes are extracted from the model-view-projection
+//  matrix and the camera is moved into object space,
+//  which keeps both tests exact under non-uniform
+//  scaling.  Four meshlets are tested per iteration.
+///////////////////////////////////////////////////
+GLuint MeshletSet::Cull(
+	const glm::mat4& modelViewProjection,
+	const glm::vec3& objectCameraPosition,
+	GLuint elementLimit,
+	bool bAllowConeCulling,
+	std::vector<GLint>& firsts,
+	std::vector<GLsizei>& counts) const
+{
+	PERF_SCOPE("MeshletCull");
+
+	firsts.clear();
+	counts.clear();
+
+	// left, right, bottom, top, near and far planes
+	glm::vec4 planes[6];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(
+			modelViewProjection[0][i], modelViewProjection[1][i],
+			modelViewProjection[2][i], modelViewProjection[3][i]);
+		glm::vec4 w(
+			modelViewProjection[0][3], modelViewProjection[1][3],
+			modelViewProjection[2][3], modelViewProjection[3][3]);
+		planes[i * 2] = w + row;
+		planes[i * 2 + 1] = w - row;
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+		if (length > 0.0f)
+		{
+			planes[i] *= 1.0f / length;
+		}
+	}
+
+	bool bConeTest = bAllowConeCulling && m_bConeCullingSafe;
+	GLuint nVisible = 0;
+	GLuint nPadded = (GLuint)m_centerX.size();
+
+	for (GLuint base = 0; base < nPadded; base += 4)
+	{
+		int visibleMask = 0;
+
+#ifdef MESHLETS_USE_SSE
+		__m128 cx = _mm_loadu_ps(&m_centerX[base]);
+		__m128 cy = _mm_loadu_ps(&m_centerY[base]);
+		__m128 cz = _mm_loadu_ps(&m_centerZ[base]);
+		__m128 r = _mm_loadu_ps(&m_radius[base]);
+		__m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+		__m128 visible = _mm_cmpeq_ps(r, r);
+
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)),
+					_mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+				_mm_add_ps(
+					_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)),
+					_mm_set1_ps(planes[p].w)));
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(d, negR));
+		}
+
+		if (bConeTest == true)
+		{
+			__m128 dx = _mm_sub_ps(cx, _mm_set1_ps(objectCameraPosition.x));
+			__m128 dy = _mm_sub_ps(cy, _mm_set1_ps(objectCameraPosition.y));
+			__m128 dz = _mm_sub_ps(cz, _mm_set1_ps(objectCameraPosition.z));
+			__m128 distance = _mm_sqrt_ps(_mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+				_mm_mul_ps(dz, dz)));
+			__m128 along = _mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(dx, _mm_loadu_ps(&m_coneAxisX[base])),
+					_mm_mul_ps(dy, _mm_loadu_ps(&m_coneAxisY[base]))),
+				_mm_mul_ps(dz, _mm_loadu_ps(&m_coneAxisZ[base])));
+			__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_coneCutoff[base]), distance), r);
+			visible = _mm_andnot_ps(_mm_cmpge_ps(along, limit), visible);
+		}
+
+		visibleMask = _mm_movemask_ps(visible);
+#else
+		for (GLuint lane = 0; lane < 4; lane++)
+		{
+			GLuint m = base + lane;
+			glm::vec3 center(m_centerX[m], m_centerY[m], m_centerZ[m]);
+			bool bVisible = true;
+
+			for (int p = 0; (p < 6) && (bVisible == true); p++)
+			{
+				float d = glm::dot(glm::vec3(planes[p].x, planes[p].y, planes[p].z), center) + planes[p].w;
+				bVisible = (d >= -m_radius[m]);
+			}
+
+			if ((bVisible == true) && (bConeTest == true))
+			{
+				glm::vec3 toCenter = center - objectCameraPosition;
+				glm::vec3 axis(m_coneAxisX[m], m_coneAxisY[m], m_coneAxisZ[m]);
+				bVisible = glm::dot(toCenter, axis) < (m_coneCutoff[m] * glm::length(toCenter) + m_radius[m]);
+			}
+
+			if (bVisible == true)
+			{
+				visibleMask |= (1 << lane);
+			}
+		}
+#endif
+
+		// emit the visible ranges, merging meshlets that are
+		// next to each other in the element list
+		for (GLuint lane = 0; lane < 4; lane++)
+		{
+			GLuint m = base + lane;
+			if (((visibleMask & (1 << lane)) == 0) || (m_elementCount[m] == 0))
+			{
+				continue;
+			}
+
+			GLint first = m_firstElement[m];
+			GLint last = std::min<GLint>(first + m_elementCount[m], (GLint)elementLimit);
+			if (last <= first)
+			{
+				continue;
+			}
+			nVisible++;
+
+			if ((counts.empty() == false) && (firsts.back() + counts.back() == first))
+			{
+				counts.back() = last - firsts.back();
+			}
+			else
+			{
+				firsts.push_back(first);
+				counts.push_back(last - first);
+			}
+		}
+	}
+
+	// partial draws may end in the middle of a triangle
+	if (counts.empty() == false)
+	{
+		counts.back() -= counts.back() % 3;
+		if (counts.back() == 0)
+		{
+			firsts.pop_back();
+			counts.pop_back();
+		}
+	}
+
+	return(nVisible);
+}
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlets.h
+// ============
+// split triangle meshes into small clusters (meshlets) that carry their own
+// bounding sphere and normal cone, so hidden clusters can be rejected on the
+// CPU before any triangles are submitted
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshletSet
+ *
+ *  This class contains the meshlet table for one mesh.  The
+ *  meshlets are contiguous ranges of the mesh's element list
+ *  (index buffer, or vertex order for non-indexed meshes),
+ *  so culled results can be emitted directly as multi-draw
+ *  ranges without touching the GPU buffers.
+ ***********************************************************/
+class MeshletSet
+{
+public:
+	// limits used when splitting a mesh into meshlets
+	static const GLuint MAX_VERTICES = 64;
+	static const GLuint MAX_TRIANGLES = 124;
+
+	// constructor
+	MeshletSet();
+
+	// split the triangle list into meshlets and calculate
+	// the bounds used for culling - pass NULL indices for
+	// non-indexed triangle lists
+	void Build(
+		const GLfloat* vertexData,
+		GLuint floatsPerVertex,
+		GLuint nVertices,
+		const GLuint* indices,
+		GLuint nElements);
+
+	// test every meshlet against the view frustum and normal
+	// cone, and write the visible element ranges - adjacent
+	// visible meshlets are merged into a single range
+	GLuint Cull(
+		const glm::mat4& modelViewProjection,
+		const glm::vec3& objectCameraPosition,
+		GLuint elementLimit,
+		bool bAllowConeCulling,
+		std::vector<GLint>& firsts,
+		std::vector<GLsizei>& counts) const;
+
+	// number of meshlets built for the mesh
+	GLuint GetMeshletCount() const { return(m_nMeshlets); }
+
+	// true when the mesh is closed and wound outward, which
+	// is required for normal cone culling to be safe
+	bool IsConeCullingSafe() const { return(m_bConeCullingSafe); }
+
+private:
+	// total meshlets - the arrays below are padded up to a
+	// multiple of four so they can be tested in SIMD batches
+	GLuint m_nMeshlets;
+	bool m_bConeCullingSafe;
+
+	// element range covered by each meshlet
+	std::vector<GLint> m_firstElement;
+	std::vector<GLsizei> m_elementCount;
+
+	// bounding spheres in object space, structure of arrays
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+
+	// normal cones in object space, structure of arrays
+	std::vector<float> m_coneAxisX;
+	std::vector<float> m_coneAxisY;
+	std::vector<float> m_coneAxisZ;
+	std::vector<float> m_coneCutoff;
+
+	// calculate the bounds for the triangles of one meshlet
+	void AddMeshlet(
+		const GLfloat* vertexData,
+		GLuint floatsPerVertex,
+		const GLuint* indices,
+		GLuint firstElement,
+		GLuint nElements);
+
+	// check whether the mesh is closed with consistent outward
+	// winding once coincident vertices are welded together
+	bool CheckClosedOutward(
+		const GLfloat* vertexData,
+		GLuint floatsPerVertex,
+		GLuint nVertices,
+		const GLuint* indices,
+		GLuint nElements) const;
+};
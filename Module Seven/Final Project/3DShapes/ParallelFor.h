@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// parallelfor.h
+// ============
+// run a loop over a range of items on worker threads, the range handed out
+// in chunks
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This function is used for running the passed in function
+ *  over [0, count) on the passed in number of threads, zero
+ *  using one per core.  The function is called with the
+ *  begin and end of a chunk of the range, and the chunks
+ *  are handed out as threads finish their last one, so
+ *  threads that get cheap items take more of them.  Ranges
+ *  of less than two chunks run on the calling thread.
+ ***********************************************************/
+template <typename FUNCTION>
+void ParallelFor(size_t count, unsigned int nThreads, size_t chunkSize, FUNCTION function)
+{
+	chunkSize = std::max<size_t>(1, chunkSize);
+
+	size_t nWorkers = nThreads;
+	if (nWorkers == 0)
+	{
+		nWorkers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	nWorkers = std::min(nWorkers, std::max<size_t>(1, count / chunkSize));
+
+	if (nWorkers <= 1)
+	{
+		function((size_t)0, count);
+		return;
+	}
+
+	std::atomic<size_t> nextChunk(0);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < nWorkers; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			size_t begin = nextChunk.fetch_add(chunkSize);
+			while (begin < count)
+			{
+				function(begin, std::min(count, begin + chunkSize));
+				begin = nextChunk.fetch_add(chunkSize);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
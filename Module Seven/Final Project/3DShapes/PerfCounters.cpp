@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// PerfCounters.cpp
+// ============
+// region profiler that records wall time and the CPU hardware counters
+// (cycles, instructions, cache misses, branch misses) of scoped code regions
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> PerfCounters::m_bEnabled(false);
+
+namespace
+{
+	// the region table - regions are never removed, so the
+	// pointers handed out stay valid
+	std::mutex g_RegionMutex;
+	std::vector<std::unique_ptr<PerfCounters::REGION>> g_Regions;
+
+	const char* g_CounterNames[PerfCounters::MAX_COUNTERS] = {
+		"cycles", "instructions", "cache-misses", "branch-misses" };
+
+#ifdef __linux__
+	// the hardware event behind each counter
+	const uint64_t g_CounterEvents[PerfCounters::MAX_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES };
+
+	/***********************************************************
+	 *  THREAD_COUNTERS
+	 *
+	 *  The counter group of one thread.  All the counters are
+	 *  read with one system call through the group leader.
+	 *  Counters the CPU does not have are left out of the
+	 *  group and read as zero.
+	 ***********************************************************/
+	struct THREAD_COUNTERS
+	{
+		bool bOpened;
+		int leader;
+		int fds[PerfCounters::MAX_COUNTERS];
+		// position of each counter in the group read, or -1
+		int slots[PerfCounters::MAX_COUNTERS];
+		int nSlots;
+
+		THREAD_COUNTERS()
+		{
+			bOpened = false;
+			leader = -1;
+			nSlots = 0;
+			for (int i = 0; i < PerfCounters::MAX_COUNTERS; i++)
+			{
+				fds[i] = -1;
+				slots[i] = -1;
+			}
+		}
+
+		~THREAD_COUNTERS()
+		{
+			for (int i = 0; i < PerfCounters::MAX_COUNTERS; i++)
+			{
+				if (fds[i] >= 0)
+				{
+					close(fds[i]);
+				}
+			}
+		}
+
+		void Open()
+		{
+			bOpened = true;
+			for (int i = 0; i < PerfCounters::MAX_COUNTERS; i++)
+			{
+				perf_event_attr attr;
+				memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = g_CounterEvents[i];
+				attr.disabled = (leader < 0) ? 1 : 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP |
+					PERF_FORMAT_TOTAL_TIME_ENABLED |
+					PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+				// this thread, any CPU
+				int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+				if (fd < 0)
+				{
+					continue;
+				}
+				if (leader < 0)
+				{
+					leader = fd;
+				}
+				fds[i] = fd;
+				slots[i] = nSlots++;
+			}
+
+			if (leader >= 0)
+			{
+				ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			}
+		}
+
+		bool Read(uint64_t values[PerfCounters::MAX_COUNTERS])
+		{
+			// nr, time enabled, time running, then one value per counter
+			uint64_t buffer[3 + PerfCounters::MAX_COUNTERS];
+
+			if (bOpened == false)
+			{
+				Open();
+			}
+			if ((leader < 0) || (read(leader, buffer, sizeof(buffer)) < (ssize_t)(sizeof(uint64_t) * 3)))
+			{
+				return(false);
+			}
+
+			// scale up when the kernel had to share the counters
+			// with other groups for part of the time
+			double scale = 1.0;
+			if ((buffer[2] > 0) && (buffer[2] < buffer[1]))
+			{
+				scale = (double)buffer[1] / (double)buffer[2];
+			}
+
+			for (int i = 0; i < PerfCounters::MAX_COUNTERS; i++)
+			{
+				values[i] = 0;
+				if ((slots[i] >= 0) && ((uint64_t)slots[i] < buffer[0]))
+				{
+					values[i] = (uint64_t)(buffer[3 + slots[i]] * scale);
+				}
+			}
+
+			return(true);
+		}
+	};
+
+	thread_local THREAD_COUNTERS t_Counters;
+#endif
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for turning the recording on or off.
+ ***********************************************************/
+void PerfCounters::Enable(bool bEnable)
+{
+	m_bEnabled.store(bEnable, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  HasHardwareCounters()
+ *
+ *  This method is used for checking whether the hardware
+ *  counters can be read, which depends on the platform and
+ *  on the kernel's perf_event_paranoid setting.
+ ***********************************************************/
+bool PerfCounters::HasHardwareCounters()
+{
+#ifdef __linux__
+	uint64_t values[MAX_COUNTERS];
+	return(t_Counters.Read(values));
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  GetRegion()
+ *
+ *  This method is used for finding the region with the
+ *  passed in name, adding it the first time it is used.
+ ***********************************************************/
+PerfCounters::REGION* PerfCounters::GetRegion(const char* name)
+{
+	std::lock_guard<std::mutex> lock(g_RegionMutex);
+
+	for (size_t i = 0; i < g_Regions.size(); i++)
+	{
+		if (strcmp(g_Regions[i]->name, name) == 0)
+		{
+			return(g_Regions[i].get());
+		}
+	}
+
+	REGION* pRegion = new REGION();
+	pRegion->name = name;
+	pRegion->calls = 0;
+	pRegion->nanoseconds = 0;
+	for (int i = 0; i < MAX_COUNTERS; i++)
+	{
+		pRegion->counters[i] = 0;
+	}
+	g_Regions.push_back(std::unique_ptr<REGION>(pRegion));
+
+	return(pRegion);
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  This method is used for reading the calling thread's
+ *  counters along with a steady clock.
+ ***********************************************************/
+void PerfCounters::Sample(COUNTER_SAMPLE& sample)
+{
+#ifdef __linux__
+	if (t_Counters.Read(sample.values) == false)
+	{
+		memset(sample.values, 0, sizeof(sample.values));
+	}
+#else
+	memset(sample.values, 0, sizeof(sample.values));
+#endif
+
+	sample.nanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/***********************************************************
+ *  AddSample()
+ *
+ *  This method is used for adding the difference between
+ *  two samples to the totals of a region.
+ ***********************************************************/
+void PerfCounters::AddSample(
+	REGION* pRegion,
+	const COUNTER_SAMPLE& start,
+	const COUNTER_SAMPLE& end)
+{
+	pRegion->calls.fetch_add(1, std::memory_order_relaxed);
+	pRegion->nanoseconds.fetch_add(end.nanoseconds - start.nanoseconds, std::memory_order_relaxed);
+
+	for (int i = 0; i < MAX_COUNTERS; i++)
+	{
+		if (end.values[i] > start.values[i])
+		{
+			pRegion->counters[i].fetch_add(end.values[i] - start.values[i], std::memory_order_relaxed);
+		}
+	}
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing one line per region
+ *  with its totals, the instructions per cycle, and the
+ *  cache and branch misses per thousand instructions.
+ ***********************************************************/
+void PerfCounters::Report(std::ostream& stream)
+{
+	std::vector<REGION*> regions;
+	char line[256];
+
+	{
+		std::lock_guard<std::mutex> lock(g_RegionMutex);
+		for (size_t i = 0; i < g_Regions.size(); i++)
+		{
+			regions.push_back(g_Regions[i].get());
+		}
+	}
+
+	std::sort(regions.begin(), regions.end(), [](REGION* a, REGION* b)
+	{
+		return(a->nanoseconds.load() > b->nanoseconds.load());
+	});
+
+	snprintf(line, sizeof(line), "%-32s %10s %12s %16s %16s %6s %14s %8s %14s %8s",
+		"region", "calls", "total ms",
+		g_CounterNames[COUNTER_CYCLES], g_CounterNames[COUNTER_INSTRUCTIONS], "IPC",
+		g_CounterNames[COUNTER_CACHE_MISSES], "MPKI",
+		g_CounterNames[COUNTER_BRANCH_MISSES], "MPKI");
+	stream << "PROFILER" << (HasHardwareCounters() ? "" : " (no hardware counters, wall time only)") << "\n" << line << "\n";
+
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		REGION* pRegion = regions[i];
+		uint64_t calls = pRegion->calls.load();
+		if (calls == 0)
+		{
+			continue;
+		}
+
+		double cycles = (double)pRegion->counters[COUNTER_CYCLES].load();
+		double instructions = (double)pRegion->counters[COUNTER_INSTRUCTIONS].load();
+		double cacheMisses = (double)pRegion->counters[COUNTER_CACHE_MISSES].load();
+		double branchMisses = (double)pRegion->counters[COUNTER_BRANCH_MISSES].load();
+		double perKilo = (instructions > 0.0) ? 1000.0 / instructions : 0.0;
+
+		snprintf(line, sizeof(line), "%-32s %10llu %12.3f %16.0f %16.0f %6.2f %14.0f %8.3f %14.0f %8.3f",
+			pRegion->name,
+			(unsigned long long)calls,
+			pRegion->nanoseconds.load() / 1.0e6,
+			cycles,
+			instructions,
+			(cycles > 0.0) ? instructions / cycles : 0.0,
+			cacheMisses,
+			cacheMisses * perKilo,
+			branchMisses,
+			branchMisses * perKilo);
+		stream << line << "\n";
+	}
+	stream.flush();
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for clearing the totals, so a run
+ *  can skip its warm up.
+ ***********************************************************/
+void PerfCounters::Reset()
+{
+	std::lock_guard<std::mutex> lock(g_RegionMutex);
+
+	for (size_t i = 0; i < g_Regions.size(); i++)
+	{
+		g_Regions[i]->calls = 0;
+		g_Regions[i]->nanoseconds = 0;
+		for (int c = 0; c < MAX_COUNTERS; c++)
+		{
+			g_Regions[i]->counters[c] = 0;
+		}
+	}
+}
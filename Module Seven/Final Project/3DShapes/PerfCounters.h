@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.h
+// ============
+// region profiler that records wall time and the CPU hardware counters
+// (cycles, instructions, cache misses, branch misses) of scoped code regions
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/***********************************************************
+ *  PerfCounters
+ *
+ *  This class contains the region table and the access to
+ *  the hardware counters.  Regions are timed by placing
+ *  PERF_SCOPE("name") at the start of a block.  On Linux
+ *  each thread opens its own perf_event counter group the
+ *  first time it enters a region; elsewhere, or when the
+ *  kernel does not allow the counters, only the wall time
+ *  is recorded.  Counts are inclusive of nested regions
+ *  and only cover the thread that entered the region.
+ ***********************************************************/
+class PerfCounters
+{
+public:
+	// the hardware counters read for each region
+	enum COUNTER
+	{
+		COUNTER_CYCLES = 0,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_CACHE_MISSES,
+		COUNTER_BRANCH_MISSES,
+		MAX_COUNTERS
+	};
+
+	// one reading of the calling thread's counters
+	struct COUNTER_SAMPLE
+	{
+		uint64_t values[MAX_COUNTERS];
+		uint64_t nanoseconds;
+	};
+
+	// totals for one named region, updated from any thread
+	struct REGION
+	{
+		const char* name;
+		std::atomic<uint64_t> calls;
+		std::atomic<uint64_t> nanoseconds;
+		std::atomic<uint64_t> counters[MAX_COUNTERS];
+	};
+
+	// turn the recording on or off, off costs one branch
+	// per scope
+	static void Enable(bool bEnable);
+	static bool IsEnabled() { return(m_bEnabled.load(std::memory_order_relaxed)); }
+
+	// check whether the hardware counters can be read on
+	// the calling thread
+	static bool HasHardwareCounters();
+
+	// find or add the region with the passed in name, which
+	// must stay valid for the life of the program
+	static REGION* GetRegion(const char* name);
+
+	// read the calling thread's counters and the clock
+	static void Sample(COUNTER_SAMPLE& sample);
+	// add the difference of two samples to a region
+	static void AddSample(
+		REGION* pRegion,
+		const COUNTER_SAMPLE& start,
+		const COUNTER_SAMPLE& end);
+
+	// print the region table, sorted by total time
+	static void Report(std::ostream& stream);
+	// clear the totals of every region
+	static void Reset();
+
+private:
+	static std::atomic<bool> m_bEnabled;
+};
+
+/***********************************************************
+ *  PerfScope
+ *
+ *  Samples the counters when constructed and adds the
+ *  difference to its region when destroyed.
+ ***********************************************************/
+class PerfScope
+{
+public:
+	PerfScope(PerfCounters::REGION* pRegion)
+	{
+		m_pRegion = NULL;
+		if (PerfCounters::IsEnabled() == true)
+		{
+			m_pRegion = pRegion;
+			PerfCounters::Sample(m_start);
+		}
+	}
+
+	~PerfScope()
+	{
+		if (NULL != m_pRegion)
+		{
+			PerfCounters::COUNTER_SAMPLE end;
+			PerfCounters::Sample(end);
+			PerfCounters::AddSample(m_pRegion, m_start, end);
+		}
+	}
+
+private:
+	PerfCounters::REGION* m_pRegion;
+	PerfCounters::COUNTER_SAMPLE m_start;
+};
+
+// time the rest of the enclosing block as the named region -
+// the region is looked up once per call site
+#define PERF_SCOPE_CONCAT2(a, b) a##b
+#define PERF_SCOPE_CONCAT(a, b) PERF_SCOPE_CONCAT2(a, b)
+#define PERF_SCOPE(name) \
+	static PerfCounters::REGION* PERF_SCOPE_CONCAT(perfRegion, __LINE__) = PerfCounters::GetRegion(name); \
+	PerfScope PERF_SCOPE_CONCAT(perfScope, __LINE__)(PERF_SCOPE_CONCAT(perfRegion, __LINE__))
@@ -15,8 +15,14 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "MeshNormals.h"
+#include "ParallelFor.h"
+#include "GLCapture.h"
+
 namespace
 {
 	const double M_PI = 3.14159265358979323846f;
@@ -24,25 +30,87 @@ namespace
 	const GLuint g_FloatsPerVertex = 3;	// Number of coordinates per vertex
 	const GLuint g_FloatsPerNormal = 3;	// Number of values per vertex color
 	const GLuint g_FloatsPerUV = 2;		// Number of texture coordinate values
+	const GLuint g_PrimitiveRestartIndex = 0xFFFFFFFF;	// Ends a strip in the part index buffers
+	const GLuint g_ColorStreamAttribute = 3;	// Vertex attribute fed by the color stream
+	const GLsizeiptr g_VertexBlockSize = 4 * 1024 * 1024;	// Bytes in each shared vertex buffer
+	const GLsizeiptr g_IndexBlockSize = 1024 * 1024;		// Bytes in each shared index buffer
+
+	// the buffers shared by every mesh owner, created when
+	// first asked for
+	GPUBufferAllocator* g_pVertexBuffers = NULL;
+	GPUBufferAllocator* g_pIndexBuffers = NULL;
 }
 
-ShapeMeshes::ShapeMeshes()
+ShapeMeshes::ShapeMeshes() :
+	m_vertexBuffers(GetVertexBuffers()),
+	m_indexBuffers(GetIndexBuffers())
 {
 	m_bMemoryLayoutDone = false;
+	m_bMeshletCulling = true;
+	m_bCullingViewSet = false;
+	m_viewProjection = glm::mat4(1.0f);
+	m_cameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_modelTransform = glm::mat4(1.0f);
+	m_nMeshletsTested = 0;
+	m_nMeshletsDrawn = 0;
+	m_nDrawCalls = 0;
+	m_vertexColorStream = 0;
+
+	for (int i = 0; i < MAX_MESH_TYPES; i++)
+	{
+		GLMesh* pMesh = GetMesh((MESH_TYPE)i);
+		pMesh->nVertices = 0;
+		pMesh->nIndices = 0;
+		pMesh->primitive = GL_TRIANGLES;
+		pMesh->colorStream = 0;
+		pMesh->vao = 0;
+		pMesh->vbos[0] = 0;
+		pMesh->vbos[1] = 0;
+		pMesh->vertexRange = 0;
+		pMesh->indexRange = 0;
+		pMesh->vertexOffset = 0;
+		pMesh->indexOffset = 0;
+	}
 }
 
 ///////////////////////////////////////////////////
-//	LoadBoxMesh()
+//	~ShapeMeshes()
+//
+//	Free the VAOs of the loaded meshes and give their
+//  ranges back to the shared buffers.
+///////////////////////////////////////////////////
+ShapeMeshes::~ShapeMeshes()
+{
+	for (int i = 0; i < MAX_MESH_TYPES; i++)
+	{
+		GLMesh* pMesh = GetMesh((MESH_TYPE)i);
+		if ((NULL != pMesh) && (pMesh->vao != 0))
+		{
+			glDeleteVertexArrays(1, &pMesh->vao);
+			pMesh->vao = 0;
+		}
+		if (NULL != pMesh)
+		{
+			m_vertexBuffers.Free(pMesh->vertexRange);
+			m_indexBuffers.Free(pMesh->indexRange);
+			pMesh->vertexRange = 0;
+			pMesh->indexRange = 0;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	BuildBoxMesh()
 //
 //	Create a box mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
 //	Correct triangle drawing command:
 //
 //	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadBoxMesh()
+void ShapeMeshes::BuildBoxMesh()
 {
 	// Position and Color data
 	GLfloat verts[] = {
@@ -105,38 +173,24 @@ void ShapeMeshes::LoadBoxMesh()
 	m_BoxMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 	m_BoxMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	glGenVertexArrays(1, &m_BoxMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_BoxMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(2, m_BoxMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_BoxMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BoxMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_BoxMesh, GL_TRIANGLES, verts, sizeof(verts) / sizeof(verts[0]), indices, m_BoxMesh.nIndices);
 }
 
 ///////////////////////////////////////////////////
-//	LoadConeMesh()
+//	BuildConeMesh()
 //
 //	Create a cole mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+//  The bottom and sides are stored as separate parts
+//  of a triangle strip index buffer, see DrawMeshParts()
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadConeMesh()
+void ShapeMeshes::BuildConeMesh()
 {
-	GLfloat verts[] = {
+	GLfloat bottomVerts[] = {
 		// cone bottom			// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -174,7 +228,9 @@ void ShapeMeshes::LoadConeMesh()
 		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
 		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
 		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
+	};
 
+	GLfloat sideVerts[] = {
 		// cone sides		// normals									// texture coords
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 		1.0f,0.5f,
 		0.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 		0.5f, 0.5f,
@@ -287,41 +343,40 @@ void ShapeMeshes::LoadConeMesh()
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 	1.0f, 0.5f
 	};
 
-	// store vertex and index count
-	m_ConeMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_ConeMesh.nIndices = 0;
+	// combine the generated parts into one vertex list
+	std::vector<GLfloat> verts;
+	GLuint nBottom = AppendMeshPart(verts, bottomVerts, sizeof(bottomVerts) / sizeof(bottomVerts[0]));
+	GLuint nSides = AppendMeshPart(verts, sideVerts, sizeof(sideVerts) / sizeof(sideVerts[0]));
 
-	// Create VAO
-	glGenVertexArrays(1, &m_ConeMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_ConeMesh.vao);
+	// store vertex count
+	m_ConeMesh.nVertices = nBottom + nSides;
 
-	// Create VBO
-	glGenBuffers(1, m_ConeMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ConeMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// keep the mesh data for the upload and for reading
+	// back on the CPU, the part indices are kept by
+	// BuildMeshParts()
+	KeepMeshData(m_ConeMesh, GL_TRIANGLE_STRIP, verts.data(), (GLuint)verts.size(), NULL, 0);
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// build the index data covering the separately drawn parts
+	GLMeshPartSource parts[] = {
+		{ PART_BOTTOM, GL_TRIANGLE_FAN, 0, nBottom },
+		{ PART_SIDES, GL_TRIANGLE_STRIP, nBottom, nSides } };
+	BuildMeshParts(m_ConeMesh, parts, sizeof(parts) / sizeof(parts[0]));
 }
 
 ///////////////////////////////////////////////////
-//	LoadCylinderMesh()
+//	BuildCylinderMesh()
 //
 //	Create a cylinder mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  The bottom, top and sides are stored as separate
+//  parts of a triangle strip index buffer, see
+//  DrawMeshParts()
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadCylinderMesh()
+void ShapeMeshes::BuildCylinderMesh()
 {
-	GLfloat verts[] = {
+	GLfloat bottomVerts[] = {
 		// cylinder bottom		// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -359,7 +414,9 @@ void ShapeMeshes::LoadCylinderMesh()
 		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
 		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
 		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
+	};
 
+	GLfloat topVerts[] = {
 		// cylinder top			// normals			// texture coords
 		1.0f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 1.0f, -0.17f,		0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
@@ -397,7 +454,9 @@ void ShapeMeshes::LoadCylinderMesh()
 		.87f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
 		.94f, 1.0f, 0.34f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
 		.98f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
+	};
 
+	GLfloat sideVerts[] = {
 		// cylinder body		// normals							// texture coords
 		1.0f, 1.0f, 0.0f,		0.993150651f, 0.5f, -0.116841137f,	0.0,1.0,
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, -0.116841137f,	0.0,0.0,
@@ -551,37 +610,40 @@ void ShapeMeshes::LoadCylinderMesh()
 
 	normal = CalculateTriangleNormal(glm::vec3(.98f, 1.0f, 0.17f), glm::vec3(.98f, 0.0f, 0.17f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-	// store vertex and index count
-	m_CylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_CylinderMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_CylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_CylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_CylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_CylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// combine the generated parts into one vertex list
+	std::vector<GLfloat> verts;
+	GLuint nBottom = AppendMeshPart(verts, bottomVerts, sizeof(bottomVerts) / sizeof(bottomVerts[0]));
+	GLuint nTop = AppendMeshPart(verts, topVerts, sizeof(topVerts) / sizeof(topVerts[0]));
+	GLuint nSides = AppendMeshPart(verts, sideVerts, sizeof(sideVerts) / sizeof(sideVerts[0]));
+
+	// store vertex count
+	m_CylinderMesh.nVertices = nBottom + nTop + nSides;
+
+	// keep the mesh data for the upload and for reading
+	// back on the CPU, the part indices are kept by
+	// BuildMeshParts()
+	KeepMeshData(m_CylinderMesh, GL_TRIANGLE_STRIP, verts.data(), (GLuint)verts.size(), NULL, 0);
+
+	// build the index data covering the separately drawn parts
+	GLMeshPartSource parts[] = {
+		{ PART_BOTTOM, GL_TRIANGLE_FAN, 0, nBottom },
+		{ PART_TOP, GL_TRIANGLE_FAN, nBottom, nTop },
+		{ PART_SIDES, GL_TRIANGLE_STRIP, nBottom + nTop, nSides } };
+	BuildMeshParts(m_CylinderMesh, parts, sizeof(parts) / sizeof(parts[0]));
 }
 
 ///////////////////////////////////////////////////
-//	LoadPlaneMesh()
+//	BuildPlaneMesh()
 //
 //	Create a plane mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 // 
 //  Correct triangle drawing command:
 //
 //	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadPlaneMesh()
+void ShapeMeshes::BuildPlaneMesh()
 {
 	// Vertex data
 	GLfloat verts[] = {
@@ -602,36 +664,23 @@ void ShapeMeshes::LoadPlaneMesh()
 	m_PlaneMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 	m_PlaneMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	// Generate the VAO for the mesh
-	glGenVertexArrays(1, &m_PlaneMesh.vao);
-	glBindVertexArray(m_PlaneMesh.vao);	// activate the VAO
-
-	// Create VBOs for the mesh
-	glGenBuffers(2, m_PlaneMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PlaneMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_PlaneMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_PlaneMesh, GL_TRIANGLES, verts, sizeof(verts) / sizeof(verts[0]), indices, m_PlaneMesh.nIndices);
 }
 
 ///////////////////////////////////////////////////
-//	LoadPrismMesh()
+//	BuildPrismMesh()
 //
 //	Create a prism mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
 //	Correct triangle drawing command:
 //
 //	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPrismMesh.nVertices);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadPrismMesh()
+void ShapeMeshes::BuildPrismMesh()
 {
 	// Vertex data
 	GLfloat verts[] = {
@@ -684,32 +733,23 @@ void ShapeMeshes::LoadPrismMesh()
 
 	m_PrismMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_PrismMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_PrismMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(1, m_PrismMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PrismMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_PrismMesh, GL_TRIANGLE_STRIP, verts, sizeof(verts) / sizeof(verts[0]), NULL, 0);
 }
 
 ///////////////////////////////////////////////////
-//	LoadPyramid3Mesh()
+//	BuildPyramid3Mesh()
 //
 //	Create a 3-sided pyramid mesh by specifying the 
-//  vertices and store it in a VAO/VBO.  The normals 
+//  vertices and keep it for UploadMesh().  The normals 
 //  and texture coordinates are also set.
 //
 //  Correct triangle drawing command:
 //
 //	glDrawArrays(GL_TRIANGLE_STRIP, 0, gPyramid3Mesh.nVertices);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadPyramid3Mesh()
+void ShapeMeshes::BuildPyramid3Mesh()
 {
 	// Vertex data
 	GLfloat verts[] = {
@@ -739,31 +779,24 @@ void ShapeMeshes::LoadPyramid3Mesh()
 	// Calculate total defined vertices
 	m_Pyramid3Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_Pyramid3Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid3Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid3Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid3Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_Pyramid3Mesh, GL_TRIANGLE_STRIP, verts, sizeof(verts) / sizeof(verts[0]), NULL, 0);
 }
 
 ///////////////////////////////////////////////////
-//	LoadPyramid4Mesh()
+//	BuildPyramid4Mesh()
 //
 //	Create a 4-sided pyramid mesh by specifying the 
-//  vertices and store it in a VAO/VBO.  The normals 
+//  vertices and keep it for UploadMesh().  The normals 
 //  and texture coordinates are also set.
 //
 //  Correct triangle drawing command:
 //
 //	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid4Mesh.nVertices);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadPyramid4Mesh()
+void ShapeMeshes::BuildPyramid4Mesh()
 {
 	// Vertex data
 	GLfloat verts[] = {
@@ -802,31 +835,24 @@ void ShapeMeshes::LoadPyramid4Mesh()
 	// Calculate total defined vertices
 	m_Pyramid4Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_Pyramid4Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid4Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid4Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid4Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_Pyramid4Mesh, GL_TRIANGLE_STRIP, verts, sizeof(verts) / sizeof(verts[0]), NULL, 0);
 }
 
 ///////////////////////////////////////////////////
-//	LoadSphereMesh()
+//	BuildSphereMesh()
 //
 //	Create a sphere mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
 //  Correct triangle drawing command:
 //
 //	glDrawElements(GL_TRIANGLES, meshes.gSphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadSphereMesh()
+void ShapeMeshes::BuildSphereMesh()
 {
 	GLfloat verts[] = {
 		// vertex data					// texture coords			// index
@@ -1683,40 +1709,33 @@ void ShapeMeshes::LoadSphereMesh()
 		combined_values.push_back(verts[i + 4]);
 	}
 
-	// Create VAO
-	glGenVertexArrays(1, &m_SphereMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_SphereMesh.vao);
-
-	// Create VBOs
-	glGenBuffers(2, m_SphereMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_SphereMesh.vbos[0]); // Activates the vertex buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereMesh.vbos[1]); // Activates the index buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// split the sphere into meshlets for culling
+	m_SphereMesh.meshlets.Build(
+		combined_values.data(),
+		floatsPerVertex + floatsPerNormal + floatsPerUV,
+		combined_values.size() / (floatsPerVertex + floatsPerNormal + floatsPerUV),
+		indices,
+		m_SphereMesh.nIndices);
+
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_SphereMesh, GL_TRIANGLES, combined_values.data(), (GLuint)combined_values.size(), indices, m_SphereMesh.nIndices);
 }
 
 ///////////////////////////////////////////////////
-//	LoadTaperedCylinderMesh()
+//	BuildTaperedCylinderMesh()
 //
 //	Create a tapered cylinder mesh by specifying the 
-//  vertices and store it in a VAO/VBO.  The normals 
+//  vertices and keep it for UploadMesh().  The normals 
 //  and texture coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  The bottom, top and sides are stored as separate
+//  parts of a triangle strip index buffer, see
+//  DrawMeshParts()
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadTaperedCylinderMesh()
+void ShapeMeshes::BuildTaperedCylinderMesh()
 {
-	GLfloat verts[] = {
+	GLfloat bottomVerts[] = {
 		// cylinder bottom		// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -1754,7 +1773,9 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
 		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
 		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
+	};
 
+	GLfloat topVerts[] = {
 		// cylinder top			// normals			// texture coords
 		0.5f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
 		.49f, 1.0f, -0.085f,	0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
@@ -1792,7 +1813,9 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 		.435f, 1.0f, 0.25f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
 		.47f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
 		.49f, 1.0f, 0.085f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
+	};
 
+	GLfloat sideVerts[] = {
 		// cylinder body		// normals							// texture coords
 		0.5f, 1.0f, 0.0f,		0.993150651, 0.5f, -0.116841137f,	0.25,1.0,
 		1.0f, 0.0f, 0.0f,		0.993150651, 0.5f, -0.116841137f,	0.0,0.0,
@@ -1942,37 +1965,40 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, 0.116841137f,	1.0, 0.0
 	};
 
-	// store vertex and index count
-	m_TaperedCylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_TaperedCylinderMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_TaperedCylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_TaperedCylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TaperedCylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// combine the generated parts into one vertex list
+	std::vector<GLfloat> verts;
+	GLuint nBottom = AppendMeshPart(verts, bottomVerts, sizeof(bottomVerts) / sizeof(bottomVerts[0]));
+	GLuint nTop = AppendMeshPart(verts, topVerts, sizeof(topVerts) / sizeof(topVerts[0]));
+	GLuint nSides = AppendMeshPart(verts, sideVerts, sizeof(sideVerts) / sizeof(sideVerts[0]));
+
+	// store vertex count
+	m_TaperedCylinderMesh.nVertices = nBottom + nTop + nSides;
+
+	// keep the mesh data for the upload and for reading
+	// back on the CPU, the part indices are kept by
+	// BuildMeshParts()
+	KeepMeshData(m_TaperedCylinderMesh, GL_TRIANGLE_STRIP, verts.data(), (GLuint)verts.size(), NULL, 0);
+
+	// build the index data covering the separately drawn parts
+	GLMeshPartSource parts[] = {
+		{ PART_BOTTOM, GL_TRIANGLE_FAN, 0, nBottom },
+		{ PART_TOP, GL_TRIANGLE_FAN, nBottom, nTop },
+		{ PART_SIDES, GL_TRIANGLE_STRIP, nBottom + nTop, nSides } };
+	BuildMeshParts(m_TaperedCylinderMesh, parts, sizeof(parts) / sizeof(parts[0]));
 }
 
 ///////////////////////////////////////////////////
-//	LoadTorusMesh()
+//	BuildTorusMesh()
 //
 //	Create a torus mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  keep it for UploadMesh().  The normals and texture
 //  coordinates are also set.
 //
 //	Correct triangle drawing command:
 //
 //	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadTorusMesh(float thickness)
+void ShapeMeshes::BuildTorusMesh(float thickness)
 {
 	int _mainSegments = 30;
 	int _tubeSegments = 30;
@@ -1988,6 +2014,8 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 	auto tubeSegmentAngleStep = glm::radians(360.0f / float(_tubeSegments));
 
 	std::vector<glm::vec3> vertex_list;
+	// grid point each listed vertex was taken from
+	std::vector<GLuint> vertex_grid;
 	std::vector<std::vector<glm::vec3>> segments_list;
 	std::vector<glm::vec2> texture_coords;
 	glm::vec3 center(0.0f, 0.0f, 0.0f);
@@ -2029,11 +2057,60 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 		currentMainSegmentAngle += mainSegmentAngleStep;
 	}
 
+	// generate smooth normals from the indexed segment grid,
+	// wound so that the face normals point out of the tube
+	std::vector<glm::vec3> grid_positions;
+	std::vector<GLuint> grid_indices;
+	for (int i = 0; i < _mainSegments; i++)
+	{
+		for (int j = 0; j < _tubeSegments; j++)
+		{
+			GLuint a = i * _tubeSegments + j;
+			GLuint b = i * _tubeSegments + (j + 1) % _tubeSegments;
+			GLuint c = ((i + 1) % _mainSegments) * _tubeSegments + (j + 1) % _tubeSegments;
+			GLuint d = ((i + 1) % _mainSegments) * _tubeSegments + j;
+
+			grid_positions.push_back(segments_list[i][j]);
+			grid_indices.push_back(a);
+			grid_indices.push_back(c);
+			grid_indices.push_back(b);
+			grid_indices.push_back(a);
+			grid_indices.push_back(d);
+			grid_indices.push_back(c);
+		}
+	}
+
+	MeshNormals normalGenerator;
+	std::vector<MeshNormals::MESH_VERTEX> grid_vertices;
+	std::vector<GLuint> generated_indices;
+	std::vector<GLuint> grid_source;
+	std::vector<glm::vec3> grid_normals(grid_positions.size(), glm::vec3(0.0f));
+
+	normalGenerator.SetCreaseAngle(180.0f);
+	normalGenerator.Generate(
+		grid_positions,
+		std::vector<glm::vec2>(),
+		grid_indices,
+		grid_vertices,
+		generated_indices,
+		&grid_source);
+	for (size_t i = 0; i < grid_vertices.size(); i++)
+	{
+		grid_normals[grid_source[i]] = grid_vertices[i].normal;
+	}
+
 	float horizontalStep = 1.0 / _mainSegments;
 	float verticalStep = 1.0 / _tubeSegments;
 	float u = 0.0;
 	float v = 0.0;
 
+	// index of a segment point in the grid, carried along with
+	// each listed vertex to find its generated normal
+	auto GridIndex = [&](int i, int j)
+	{
+		return((GLuint)(i * _tubeSegments + j));
+	};
+
 	// connect the various segments together, forming triangles
 	for (int i = 0; i < _mainSegments; i++)
 	{
@@ -2042,18 +2119,25 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 			if (((i + 1) < _mainSegments) && ((j + 1) < _tubeSegments))
 			{
 				vertex_list.push_back(segments_list[i][j]);
+				vertex_grid.push_back(GridIndex(i, j));
 				texture_coords.push_back(glm::vec2(u, v));
 				vertex_list.push_back(segments_list[i][j + 1]);
+				vertex_grid.push_back(GridIndex(i, j + 1));
 				texture_coords.push_back(glm::vec2(u, v + verticalStep));
 				vertex_list.push_back(segments_list[i + 1][j + 1]);
+				vertex_grid.push_back(GridIndex(i + 1, j + 1));
 				texture_coords.push_back(glm::vec2(u + horizontalStep, v + verticalStep));
 				vertex_list.push_back(segments_list[i][j]);
+				vertex_grid.push_back(GridIndex(i, j));
 				texture_coords.push_back(glm::vec2(u, v));
 				vertex_list.push_back(segments_list[i + 1][j]);
+				vertex_grid.push_back(GridIndex(i + 1, j));
 				texture_coords.push_back(glm::vec2(u + horizontalStep, v));
 				vertex_list.push_back(segments_list[i + 1][j + 1]);
+				vertex_grid.push_back(GridIndex(i + 1, j + 1));
 				texture_coords.push_back(glm::vec2(u + horizontalStep, v - verticalStep));
 				vertex_list.push_back(segments_list[i][j]);
+				vertex_grid.push_back(GridIndex(i, j));
 				texture_coords.push_back(glm::vec2(u, v));
 			}
 			else
@@ -2061,52 +2145,73 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 				if (((i + 1) == _mainSegments) && ((j + 1) == _tubeSegments))
 				{
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[i][0]);
+					vertex_grid.push_back(GridIndex(i, 0));
 					texture_coords.push_back(glm::vec2(u, 0));
 					vertex_list.push_back(segments_list[0][0]);
+					vertex_grid.push_back(GridIndex(0, 0));
 					texture_coords.push_back(glm::vec2(0, 0));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[0][j]);
+					vertex_grid.push_back(GridIndex(0, j));
 					texture_coords.push_back(glm::vec2(0, v));
 					vertex_list.push_back(segments_list[0][0]);
+					vertex_grid.push_back(GridIndex(0, 0));
 					texture_coords.push_back(glm::vec2(0, 0));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 				}
 				else if ((i + 1) == _mainSegments)
 				{
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[i][j + 1]);
+					vertex_grid.push_back(GridIndex(i, j + 1));
 					texture_coords.push_back(glm::vec2(u, v + verticalStep));
 					vertex_list.push_back(segments_list[0][j + 1]);
+					vertex_grid.push_back(GridIndex(0, j + 1));
 					texture_coords.push_back(glm::vec2(0, v + verticalStep));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[0][j]);
+					vertex_grid.push_back(GridIndex(0, j));
 					texture_coords.push_back(glm::vec2(0, v));
 					vertex_list.push_back(segments_list[0][j + 1]);
+					vertex_grid.push_back(GridIndex(0, j + 1));
 					texture_coords.push_back(glm::vec2(0, v + verticalStep));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 				}
 				else if ((j + 1) == _tubeSegments)
 				{
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[i][0]);
+					vertex_grid.push_back(GridIndex(i, 0));
 					texture_coords.push_back(glm::vec2(u, 0));
 					vertex_list.push_back(segments_list[i + 1][0]);
+					vertex_grid.push_back(GridIndex(i + 1, 0));
 					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 					vertex_list.push_back(segments_list[i + 1][j]);
+					vertex_grid.push_back(GridIndex(i + 1, j));
 					texture_coords.push_back(glm::vec2(u + horizontalStep, v));
 					vertex_list.push_back(segments_list[i + 1][0]);
+					vertex_grid.push_back(GridIndex(i + 1, 0));
 					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
 					vertex_list.push_back(segments_list[i][j]);
+					vertex_grid.push_back(GridIndex(i, j));
 					texture_coords.push_back(glm::vec2(u, v));
 				}
 
@@ -2123,37 +2228,7 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 	for (int i = 0; i < vertex_list.size(); i++)
 	{
 		vertex = vertex_list[i];
-		normal = normalize(vertex);
-		if (vertex.x < 0)
-		{
-			if (normal.x > 0)
-				normal.x *= -1;
-		}
-		else if (vertex.x > 0)
-		{
-			if (normal.x < 0)
-				normal.x *= -1;
-		}
-		if (vertex.y < 0)
-		{
-			if (normal.y > 0)
-				normal.y *= -1;
-		}
-		else if (vertex.y > 0)
-		{
-			if (normal.y < 0)
-				normal.y *= -1;
-		}
-		if (vertex.z < 0)
-		{
-			if (normal.z > 0)
-				normal.z *= -1;
-		}
-		else if (vertex.z > 0)
-		{
-			if (normal.z < 0)
-				normal.z *= -1;
-		}
+		normal = grid_normals[vertex_grid[i]];
 		text_coord = texture_coords[i];
 		combined_values.push_back(vertex.x);
 		combined_values.push_back(vertex.y);
@@ -2169,21 +2244,218 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 	m_TorusMesh.nVertices = vertex_list.size();
 	m_TorusMesh.nIndices = 0;
 
-	// Create VAO
-	glGenVertexArrays(1, &m_TorusMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TorusMesh.vao);
+	// split the torus triangle list into meshlets for culling
+	m_TorusMesh.meshlets.Build(
+		combined_values.data(),
+		g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV,
+		m_TorusMesh.nVertices,
+		NULL,
+		m_TorusMesh.nVertices);
+
+	// keep the mesh data for the upload and for reading
+	// back on the CPU
+	KeepMeshData(m_TorusMesh, GL_TRIANGLES, combined_values.data(), (GLuint)combined_values.size(), NULL, 0);
+}
 
-	// Create VBOs
-	glGenBuffers(1, m_TorusMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TorusMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
-	if (m_bMemoryLayoutDone == false)
+///////////////////////////////////////////////////
+//	LoadBoxMesh()
+//
+//	Build the box mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadBoxMesh()
+{
+	BuildBoxMesh();
+	UploadMesh(m_BoxMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadConeMesh()
+//
+//	Build the cone mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadConeMesh()
+{
+	BuildConeMesh();
+	UploadMesh(m_ConeMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadCylinderMesh()
+//
+//	Build the cylinder mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadCylinderMesh()
+{
+	BuildCylinderMesh();
+	UploadMesh(m_CylinderMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadPlaneMesh()
+//
+//	Build the plane mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadPlaneMesh()
+{
+	BuildPlaneMesh();
+	UploadMesh(m_PlaneMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadPrismMesh()
+//
+//	Build the prism mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadPrismMesh()
+{
+	BuildPrismMesh();
+	UploadMesh(m_PrismMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadPyramid3Mesh()
+//
+//	Build the 3-sided pyramid mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadPyramid3Mesh()
+{
+	BuildPyramid3Mesh();
+	UploadMesh(m_Pyramid3Mesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadPyramid4Mesh()
+//
+//	Build the 4-sided pyramid mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadPyramid4Mesh()
+{
+	BuildPyramid4Mesh();
+	UploadMesh(m_Pyramid4Mesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadSphereMesh()
+//
+//	Build the sphere mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadSphereMesh()
+{
+	BuildSphereMesh();
+	UploadMesh(m_SphereMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadTaperedCylinderMesh()
+//
+//	Build the tapered cylinder mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadTaperedCylinderMesh()
+{
+	BuildTaperedCylinderMesh();
+	UploadMesh(m_TaperedCylinderMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadTorusMesh()
+//
+//	Build the torus mesh and store it in a VAO/VBO.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadTorusMesh(float thickness)
+{
+	BuildTorusMesh(thickness);
+	UploadMesh(m_TorusMesh);
+}
+
+///////////////////////////////////////////////////
+//	LoadMeshes()
+//
+//	Load several meshes at once.  Building the mesh data
+//  makes no GL calls and each mesh only writes its own
+//  data, so the meshes are built on worker threads that
+//  each take the next mesh until none are left.  The
+//  builds then no longer add up, the slowest one sets
+//  the time.  The uploads follow as one batch on the
+//  calling thread, which must own the GL context, in
+//  the passed in order.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadMeshes(const MESH_TYPE* meshes, GLuint nMeshes)
+{
+	ParallelFor(nMeshes, 0, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t mesh = begin; mesh < end; mesh++)
+		{
+			BuildMesh(meshes[mesh]);
+		}
+	});
+
+	for (GLuint i = 0; i < nMeshes; i++)
 	{
-		SetShaderMemoryLayout();
+		GLMesh* pMesh = GetMesh(meshes[i]);
+		if (NULL != pMesh)
+		{
+			UploadMesh(*pMesh);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	BuildMesh()
+//
+//	Build the mesh data of the passed in type, the torus
+//  gets the default thickness.
+///////////////////////////////////////////////////
+void ShapeMeshes::BuildMesh(MESH_TYPE mesh)
+{
+	switch (mesh)
+	{
+	case MESH_BOX: BuildBoxMesh(); break;
+	case MESH_CONE: BuildConeMesh(); break;
+	case MESH_CYLINDER: BuildCylinderMesh(); break;
+	case MESH_PLANE: BuildPlaneMesh(); break;
+	case MESH_PRISM: BuildPrismMesh(); break;
+	case MESH_PYRAMID3: BuildPyramid3Mesh(); break;
+	case MESH_PYRAMID4: BuildPyramid4Mesh(); break;
+	case MESH_SPHERE: BuildSphereMesh(); break;
+	case MESH_TAPERED_CYLINDER: BuildTaperedCylinderMesh(); break;
+	case MESH_TORUS: BuildTorusMesh(); break;
+	default: break;
 	}
 }
 
+///////////////////////////////////////////////////
+//	UploadMesh()
+//
+//	Create the VAO of a built mesh and store its kept
+//  vertices and indices in the shared mesh buffers.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadMesh(GLMesh& mesh)
+{
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+
+	UploadVertexData(mesh, mesh.vertexData.data(), sizeof(GLfloat) * mesh.vertexData.size());
+	if (mesh.indexData.empty() == false)
+	{
+		UploadIndexData(mesh, mesh.indexData.data(), sizeof(GLuint) * mesh.indexData.size());
+	}
+
+	// only the part index buffers are strips, they end each
+	// part with the restart index, which never appears in
+	// the other index buffers, so it can stay enabled for
+	// every draw
+	if ((mesh.primitive == GL_TRIANGLE_STRIP) && (mesh.indexData.empty() == false))
+	{
+		glPrimitiveRestartIndex(g_PrimitiveRestartIndex);
+		glEnable(GL_PRIMITIVE_RESTART);
+	}
+
+	if (m_bMemoryLayoutDone == false)
+	{
+		SetShaderMemoryLayout(mesh.vertexOffset);
+	}
+}
 
 
 ///////////////////////////////////////////////////
@@ -2194,9 +2466,15 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMesh()
 {
-	glBindVertexArray(m_BoxMesh.vao);
+	if (RecordDraw(MESH_BOX, 0, false) == true)
+	{
+		return;
+	}
+
+	BindMesh(m_BoxMesh);
 
-	glDrawElements(GL_TRIANGLES, m_BoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	m_nDrawCalls++;
+	glDrawElements(GL_TRIANGLES, m_BoxMesh.nIndices, GL_UNSIGNED_INT, (void*)m_BoxMesh.indexOffset);
 
 	glBindVertexArray(0);
 }
@@ -2210,13 +2488,21 @@ void ShapeMeshes::DrawBoxMesh()
 void ShapeMeshes::DrawConeMesh(
 	bool bDrawBottom)
 {
-	glBindVertexArray(m_ConeMesh.vao);
+	GLuint partMask = (1 << PART_SIDES);
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
+		partMask |= (1 << PART_BOTTOM);
 	}
-	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+
+	if (RecordDraw(MESH_CONE, partMask, false) == true)
+	{
+		return;
+	}
+
+	BindMesh(m_ConeMesh);
+
+	DrawMeshParts(m_ConeMesh, partMask);
 
 	glBindVertexArray(0);
 }
@@ -2232,21 +2518,30 @@ void ShapeMeshes::DrawCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_CylinderMesh.vao);
+	GLuint partMask = 0;
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
+		partMask |= (1 << PART_BOTTOM);
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 36);	//top
+		partMask |= (1 << PART_TOP);
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+		partMask |= (1 << PART_SIDES);
+	}
+
+	if (RecordDraw(MESH_CYLINDER, partMask, false) == true)
+	{
+		return;
 	}
 
+	BindMesh(m_CylinderMesh);
+
+	DrawMeshParts(m_CylinderMesh, partMask);
+
 	glBindVertexArray(0);
 }
 
@@ -2258,9 +2553,15 @@ void ShapeMeshes::DrawCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPlaneMesh()
 {
-	glBindVertexArray(m_PlaneMesh.vao);
+	if (RecordDraw(MESH_PLANE, 0, false) == true)
+	{
+		return;
+	}
 
-	glDrawElements(GL_TRIANGLES, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	BindMesh(m_PlaneMesh);
+
+	m_nDrawCalls++;
+	glDrawElements(GL_TRIANGLES, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)m_PlaneMesh.indexOffset);
 	
 	glBindVertexArray(0);
 }
@@ -2273,8 +2574,14 @@ void ShapeMeshes::DrawPlaneMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPrismMesh()
 {
-	glBindVertexArray(m_PrismMesh.vao);
+	if (RecordDraw(MESH_PRISM, 0, false) == true)
+	{
+		return;
+	}
+
+	BindMesh(m_PrismMesh);
 
+	m_nDrawCalls++;
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_PrismMesh.nVertices);
 
 	glBindVertexArray(0);
@@ -2288,8 +2595,14 @@ void ShapeMeshes::DrawPrismMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid3Mesh()
 {
-	glBindVertexArray(m_Pyramid3Mesh.vao);
+	if (RecordDraw(MESH_PYRAMID3, 0, false) == true)
+	{
+		return;
+	}
 
+	BindMesh(m_Pyramid3Mesh);
+
+	m_nDrawCalls++;
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid3Mesh.nVertices);
 
 	glBindVertexArray(0);
@@ -2303,8 +2616,14 @@ void ShapeMeshes::DrawPyramid3Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid4Mesh()
 {
-	glBindVertexArray(m_Pyramid4Mesh.vao);
-
+	if (RecordDraw(MESH_PYRAMID4, 0, false) == true)
+	{
+		return;
+	}
+
+	BindMesh(m_Pyramid4Mesh);
+
+	m_nDrawCalls++;
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid4Mesh.nVertices);
 
 	glBindVertexArray(0);
@@ -2318,9 +2637,18 @@ void ShapeMeshes::DrawPyramid4Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
+	if (RecordDraw(MESH_SPHERE, 0, false) == true)
+	{
+		return;
+	}
 
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	BindMesh(m_SphereMesh);
+
+	if (DrawCulledMeshlets(m_SphereMesh, m_SphereMesh.nIndices, true) == false)
+	{
+		m_nDrawCalls++;
+		glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices, GL_UNSIGNED_INT, (void*)m_SphereMesh.indexOffset);
+	}
 
 	glBindVertexArray(0);
 }
@@ -2333,9 +2661,19 @@ void ShapeMeshes::DrawSphereMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
+	if (RecordDraw(MESH_SPHERE, 0, true) == true)
+	{
+		return;
+	}
 
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices/2, GL_UNSIGNED_INT, (void*)0);
+	BindMesh(m_SphereMesh);
+
+	// the half sphere is open, so only frustum culling applies
+	if (DrawCulledMeshlets(m_SphereMesh, m_SphereMesh.nIndices/2, false) == false)
+	{
+		m_nDrawCalls++;
+		glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices/2, GL_UNSIGNED_INT, (void*)m_SphereMesh.indexOffset);
+	}
 
 	glBindVertexArray(0);
 }
@@ -2351,21 +2689,30 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
+	GLuint partMask = 0;
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
+		partMask |= (1 << PART_BOTTOM);
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 72);	//top
+		partMask |= (1 << PART_TOP);
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+		partMask |= (1 << PART_SIDES);
+	}
+
+	if (RecordDraw(MESH_TAPERED_CYLINDER, partMask, false) == true)
+	{
+		return;
 	}
 
+	BindMesh(m_TaperedCylinderMesh);
+
+	DrawMeshParts(m_TaperedCylinderMesh, partMask);
+
 	glBindVertexArray(0);
 }
 
@@ -2377,9 +2724,18 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	if (RecordDraw(MESH_TORUS, 0, false) == true)
+	{
+		return;
+	}
+
+	BindMesh(m_TorusMesh);
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices);
+	if (DrawCulledMeshlets(m_TorusMesh, m_TorusMesh.nVertices, true) == false)
+	{
+		m_nDrawCalls++;
+		glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices);
+	}
 
 	glBindVertexArray(0);
 }
@@ -2392,13 +2748,787 @@ void ShapeMeshes::DrawTorusMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	if (RecordDraw(MESH_TORUS, 0, true) == true)
+	{
+		return;
+	}
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices/2);
+	BindMesh(m_TorusMesh);
+
+	// the half torus is open, so only frustum culling applies
+	if (DrawCulledMeshlets(m_TorusMesh, m_TorusMesh.nVertices/2, false) == false)
+	{
+		m_nDrawCalls++;
+		glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices/2);
+	}
 
 	glBindVertexArray(0);
 }
 
+///////////////////////////////////////////////////
+//	AppendMeshPart()
+//
+//	Append the interleaved vertex data of one generated
+//  part to the mesh vertex list, and return the number
+//  of vertices in the part.
+///////////////////////////////////////////////////
+GLuint ShapeMeshes::AppendMeshPart(
+	std::vector<GLfloat>& verts,
+	const GLfloat* partVerts,
+	GLuint nFloats)
+{
+	verts.insert(verts.end(), partVerts, partVerts + nFloats);
+
+	return(nFloats / (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+}
+
+///////////////////////////////////////////////////
+//	BuildMeshParts()
+//
+//	Build the triangle strip index data for the passed
+//  in parts and store the index range of each part.
+//  Fans are re-ordered into zig-zag strips covering
+//  the same polygon, and the parts are separated by
+//  the primitive restart index, so that neighboring
+//  parts can be drawn as one range.
+///////////////////////////////////////////////////
+void ShapeMeshes::BuildMeshParts(
+	GLMesh& mesh,
+	const GLMeshPartSource* parts,
+	GLuint nParts)
+{
+	std::vector<GLuint> indices;
+
+	for (int i = 0; i < MAX_MESH_PARTS; i++)
+	{
+		mesh.parts[i].firstIndex = 0;
+		mesh.parts[i].nIndices = 0;
+	}
+
+	for (GLuint i = 0; i < nParts; i++)
+	{
+		const GLMeshPartSource& part = parts[i];
+
+		if (indices.empty() == false)
+		{
+			indices.push_back(g_PrimitiveRestartIndex);
+		}
+		mesh.parts[part.part].firstIndex = (GLint)indices.size();
+
+		if (part.mode == GL_TRIANGLE_FAN)
+		{
+			// v0, v1, vn-1, v2, vn-2, ... covers the fan polygon
+			GLuint low = part.firstVertex + 1;
+			GLuint high = part.firstVertex + part.nVertices - 1;
+			indices.push_back(part.firstVertex);
+			while (low <= high)
+			{
+				indices.push_back(low++);
+				if (low <= high)
+				{
+					indices.push_back(high--);
+				}
+			}
+		}
+		else
+		{
+			for (GLuint v = 0; v < part.nVertices; v++)
+			{
+				indices.push_back(part.firstVertex + v);
+			}
+		}
+
+		mesh.parts[part.part].nIndices = (GLsizei)indices.size() - mesh.parts[part.part].firstIndex;
+	}
+
+	mesh.nIndices = (GLuint)indices.size();
+	mesh.indexData = indices;
+}
+
+///////////////////////////////////////////////////
+//	DrawMeshParts()
+//
+//	Draw any combination of the parts of a mesh with a
+//  single call.  Parts that are next to each other in
+//  the index buffer are merged into one range, since
+//  the restart index between them ends the strip.  The
+//  mesh VAO must already be bound.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMeshParts(
+	GLMesh& mesh,
+	GLuint partMask)
+{
+	GLsizei counts[MAX_MESH_PARTS];
+	const void* offsets[MAX_MESH_PARTS];
+	GLsizei nRanges = 0;
+	GLint rangeEnd = -1;
+
+	for (int i = 0; i < MAX_MESH_PARTS; i++)
+	{
+		const GLMeshPart& part = mesh.parts[i];
+		if (((partMask & (1 << i)) == 0) || (part.nIndices == 0))
+		{
+			continue;
+		}
+
+		if ((nRanges > 0) && (rangeEnd + 1 == part.firstIndex))
+		{
+			counts[nRanges - 1] += part.nIndices + 1;
+		}
+		else
+		{
+			offsets[nRanges] = (const void*)(mesh.indexOffset + sizeof(GLuint) * part.firstIndex);
+			counts[nRanges] = part.nIndices;
+			nRanges++;
+		}
+		rangeEnd = part.firstIndex + part.nIndices;
+	}
+
+	if (nRanges == 1)
+	{
+		m_nDrawCalls++;
+		glDrawElements(GL_TRIANGLE_STRIP, counts[0], GL_UNSIGNED_INT, offsets[0]);
+	}
+	else if (nRanges > 1)
+	{
+		m_nDrawCalls++;
+		glMultiDrawElements(GL_TRIANGLE_STRIP, counts, GL_UNSIGNED_INT, offsets, nRanges);
+	}
+}
+
+///////////////////////////////////////////////////
+//	EnableMeshletCulling()
+//
+//	Turn the CPU culling of meshlets on or off.  When
+//  off, the large meshes are drawn in a single call.
+///////////////////////////////////////////////////
+void ShapeMeshes::EnableMeshletCulling(bool bEnable)
+{
+	m_bMeshletCulling = bEnable;
+}
+
+///////////////////////////////////////////////////
+//	SetCullingView()
+//
+//	Store the view-projection matrix and the camera
+//  position used to cull meshlets this frame.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetCullingView(
+	const glm::mat4& viewProjection,
+	const glm::vec3& cameraPosition)
+{
+	m_viewProjection = viewProjection;
+	m_cameraPosition = cameraPosition;
+	m_bCullingViewSet = true;
+}
+
+///////////////////////////////////////////////////
+//	SetModelTransform()
+//
+//	Store the model matrix of the next drawn mesh.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetModelTransform(const glm::mat4& model)
+{
+	m_modelTransform = model;
+}
+
+///////////////////////////////////////////////////
+//	GetMeshletStats()
+//
+//	Get the number of meshlets tested and drawn since
+//  the stats were last reset.
+///////////////////////////////////////////////////
+void ShapeMeshes::GetMeshletStats(GLuint& nTested, GLuint& nDrawn)
+{
+	nTested = m_nMeshletsTested;
+	nDrawn = m_nMeshletsDrawn;
+}
+
+///////////////////////////////////////////////////
+//	ResetMeshletStats()
+//
+//	Clear the meshlet totals, called once per frame.
+///////////////////////////////////////////////////
+void ShapeMeshes::ResetMeshletStats()
+{
+	m_nMeshletsTested = 0;
+	m_nMeshletsDrawn = 0;
+}
+
+///////////////////////////////////////////////////
+//	GetDrawCallCount()
+//
+//	Get the number of GL draw calls issued since the
+//  count was last reset.  A multi-draw counts as one.
+///////////////////////////////////////////////////
+GLuint ShapeMeshes::GetDrawCallCount()
+{
+	return(m_nDrawCalls);
+}
+
+///////////////////////////////////////////////////
+//	ResetDrawCallCount()
+//
+//	Clear the draw call count, called once per frame.
+///////////////////////////////////////////////////
+void ShapeMeshes::ResetDrawCallCount()
+{
+	m_nDrawCalls = 0;
+}
+
+///////////////////////////////////////////////////
+//	DrawCulledMeshlets()
+//
+//	Cull the meshlets of the passed in mesh and draw
+//  the surviving ranges with one multi-draw call.  The
+//  mesh VAO must already be bound.  Returns false when
+//  the mesh has no meshlets or no view has been set,
+//  so the caller can fall back to a plain draw.
+///////////////////////////////////////////////////
+bool ShapeMeshes::DrawCulledMeshlets(
+	GLMesh& mesh,
+	GLuint elementLimit,
+	bool bClosedDraw)
+{
+	if ((m_bMeshletCulling == false) ||
+		(m_bCullingViewSet == false) ||
+		(mesh.meshlets.GetMeshletCount() == 0))
+	{
+		return(false);
+	}
+
+	glm::mat4 modelViewProjection = m_viewProjection * m_modelTransform;
+	glm::vec4 objectCamera = glm::inverse(m_modelTransform) * glm::vec4(m_cameraPosition, 1.0f);
+
+	GLuint nVisible = mesh.meshlets.Cull(
+		modelViewProjection,
+		glm::vec3(objectCamera.x, objectCamera.y, objectCamera.z) / objectCamera.w,
+		elementLimit,
+		bClosedDraw,
+		m_culledFirsts,
+		m_culledCounts);
+
+	m_nMeshletsTested += mesh.meshlets.GetMeshletCount();
+	m_nMeshletsDrawn += nVisible;
+
+	if (m_culledCounts.empty() == true)
+	{
+		return(true);
+	}
+
+	if (mesh.nIndices > 0)
+	{
+		// indexed meshes need byte offsets into the index buffer
+		m_culledOffsets.resize(m_culledFirsts.size());
+		for (size_t i = 0; i < m_culledFirsts.size(); i++)
+		{
+			m_culledOffsets[i] = (const void*)(mesh.indexOffset + sizeof(GLuint) * m_culledFirsts[i]);
+		}
+		m_nDrawCalls++;
+		glMultiDrawElements(
+			GL_TRIANGLES,
+			m_culledCounts.data(),
+			GL_UNSIGNED_INT,
+			m_culledOffsets.data(),
+			(GLsizei)m_culledCounts.size());
+	}
+	else
+	{
+		m_nDrawCalls++;
+		glMultiDrawArrays(
+			GL_TRIANGLES,
+			m_culledFirsts.data(),
+			m_culledCounts.data(),
+			(GLsizei)m_culledCounts.size());
+	}
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	SetDrawRecorder()
+//
+//	Set the function that receives the draws while a
+//  scene is being captured.  Pass an empty function to
+//  go back to drawing on the GPU.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetDrawRecorder(std::function<void(const MESH_DRAW&)> recorder)
+{
+	m_drawRecorder = recorder;
+}
+
+///////////////////////////////////////////////////
+//	DrawMesh()
+//
+//	Replay a draw that was captured with the recorder
+//  by calling the matching draw method.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMesh(const MESH_DRAW& draw)
+{
+	bool bDrawBottom = ((draw.partMask & (1 << PART_BOTTOM)) != 0);
+	bool bDrawTop = ((draw.partMask & (1 << PART_TOP)) != 0);
+	bool bDrawSides = ((draw.partMask & (1 << PART_SIDES)) != 0);
+
+	switch (draw.mesh)
+	{
+	case MESH_BOX:
+		DrawBoxMesh();
+		break;
+	case MESH_CONE:
+		DrawConeMesh(bDrawBottom);
+		break;
+	case MESH_CYLINDER:
+		DrawCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_PLANE:
+		DrawPlaneMesh();
+		break;
+	case MESH_PRISM:
+		DrawPrismMesh();
+		break;
+	case MESH_PYRAMID3:
+		DrawPyramid3Mesh();
+		break;
+	case MESH_PYRAMID4:
+		DrawPyramid4Mesh();
+		break;
+	case MESH_SPHERE:
+		if (draw.bHalf == true)
+			DrawHalfSphereMesh();
+		else
+			DrawSphereMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		DrawTaperedCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_TORUS:
+		if (draw.bHalf == true)
+			DrawHalfTorusMesh();
+		else
+			DrawTorusMesh();
+		break;
+	default:
+		break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetMeshVertexData()
+//
+//	Get the CPU copy of the interleaved vertex data of
+//  a loaded mesh, see FLOATS_PER_VERTEX.  The data is
+//  empty when the mesh has not been loaded.
+///////////////////////////////////////////////////
+const std::vector<GLfloat>& ShapeMeshes::GetMeshVertexData(MESH_TYPE mesh)
+{
+	static const std::vector<GLfloat> noVertices;
+
+	GLMesh* pMesh = GetMesh(mesh);
+	if (NULL == pMesh)
+	{
+		return(noVertices);
+	}
+
+	return(pMesh->vertexData);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshVertexRange()
+//
+//	Get the allocation of a loaded mesh's vertices in
+//  the shared vertex buffers, zero when the mesh has
+//  not been loaded.
+///////////////////////////////////////////////////
+GLuint ShapeMeshes::GetMeshVertexRange(MESH_TYPE mesh)
+{
+	GLMesh* pMesh = GetMesh(mesh);
+	if (NULL == pMesh)
+	{
+		return(0);
+	}
+
+	return(pMesh->vertexRange);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshTriangles()
+//
+//	Get the triangles rendered by the passed in draw as
+//  a list of vertex index triples, with the winding the
+//  GPU would see.  Strips are split at restart indices
+//  and their degenerate triangles are dropped.
+///////////////////////////////////////////////////
+bool ShapeMeshes::GetMeshTriangles(
+	const MESH_DRAW& draw,
+	std::vector<GLuint>& triangles)
+{
+	GLMesh* pMesh = GetMesh(draw.mesh);
+	std::vector<GLuint> elements;
+
+	triangles.clear();
+
+	if ((NULL == pMesh) || (pMesh->vertexData.empty() == true))
+	{
+		return(false);
+	}
+
+	// gather the drawn elements in the order they are drawn
+	if ((pMesh->primitive == GL_TRIANGLE_STRIP) && (pMesh->indexData.empty() == false))
+	{
+		for (int i = 0; i < MAX_MESH_PARTS; i++)
+		{
+			const GLMeshPart& part = pMesh->parts[i];
+			if (((draw.partMask & (1 << i)) == 0) || (part.nIndices == 0))
+			{
+				continue;
+			}
+
+			if (elements.empty() == false)
+			{
+				elements.push_back(g_PrimitiveRestartIndex);
+			}
+			elements.insert(
+				elements.end(),
+				pMesh->indexData.begin() + part.firstIndex,
+				pMesh->indexData.begin() + part.firstIndex + part.nIndices);
+		}
+	}
+	else
+	{
+		GLuint nElements = (GLuint)pMesh->indexData.size();
+		if (nElements == 0)
+		{
+			nElements = (GLuint)pMesh->vertexData.size() / FLOATS_PER_VERTEX;
+		}
+		if (draw.bHalf == true)
+		{
+			nElements /= 2;
+		}
+
+		for (GLuint i = 0; i < nElements; i++)
+		{
+			if (pMesh->indexData.empty() == false)
+				elements.push_back(pMesh->indexData[i]);
+			else
+				elements.push_back(i);
+		}
+	}
+
+	if (pMesh->primitive == GL_TRIANGLES)
+	{
+		triangles.assign(elements.begin(), elements.begin() + (elements.size() - (elements.size() % 3)));
+		return(true);
+	}
+
+	// walk the strips - every other triangle is wound the
+	// opposite way, so its first two vertices are swapped
+	size_t stripStart = 0;
+	for (size_t i = 0; i < elements.size(); i++)
+	{
+		if (elements[i] == g_PrimitiveRestartIndex)
+		{
+			stripStart = i + 1;
+			continue;
+		}
+		if (i < stripStart + 2)
+		{
+			continue;
+		}
+
+		GLuint a = elements[i - 2];
+		GLuint b = elements[i - 1];
+		GLuint c = elements[i];
+		if ((a == b) || (b == c) || (a == c))
+		{
+			continue;
+		}
+		if (((i - stripStart) % 2) == 1)
+		{
+			std::swap(a, b);
+		}
+
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	SetVertexColorStream()
+//
+//	Set the buffer that feeds vertex attribute 3 for
+//  the next draws.  The buffer holds one vec4 for each
+//  vertex of the drawn mesh.  Zero disables the stream,
+//  and the attribute reads as constant white.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetVertexColorStream(GLuint colorBuffer)
+{
+	m_vertexColorStream = colorBuffer;
+
+	if (colorBuffer == 0)
+	{
+		glVertexAttrib4f(g_ColorStreamAttribute, 1.0f, 1.0f, 1.0f, 1.0f);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetMeshBufferBytes()
+//
+//	Get the bytes of the shared buffers taken by the
+//  loaded meshes.
+///////////////////////////////////////////////////
+GLsizeiptr ShapeMeshes::GetMeshBufferBytes()
+{
+	GLsizeiptr bytes = 0;
+	for (int i = 0; i < MAX_MESH_TYPES; i++)
+	{
+		GLMesh* pMesh = GetMesh((MESH_TYPE)i);
+		bytes += m_vertexBuffers.GetSize(pMesh->vertexRange) + m_indexBuffers.GetSize(pMesh->indexRange);
+	}
+	return(bytes);
+}
+
+///////////////////////////////////////////////////
+//	GetVertexBuffers()
+//
+//	Get the vertex buffers shared by every mesh owner.
+///////////////////////////////////////////////////
+GPUBufferAllocator& ShapeMeshes::GetVertexBuffers()
+{
+	if (NULL == g_pVertexBuffers)
+	{
+		g_pVertexBuffers = new GPUBufferAllocator(g_VertexBlockSize);
+	}
+	return(*g_pVertexBuffers);
+}
+
+///////////////////////////////////////////////////
+//	GetIndexBuffers()
+//
+//	Get the index buffers shared by every mesh owner.
+///////////////////////////////////////////////////
+GPUBufferAllocator& ShapeMeshes::GetIndexBuffers()
+{
+	if (NULL == g_pIndexBuffers)
+	{
+		g_pIndexBuffers = new GPUBufferAllocator(g_IndexBlockSize);
+	}
+	return(*g_pIndexBuffers);
+}
+
+///////////////////////////////////////////////////
+//	DestroyMeshBuffers()
+//
+//	Free the shared buffers, once every mesh owner has
+//  been freed.  They are created again when next
+//  asked for.
+///////////////////////////////////////////////////
+void ShapeMeshes::DestroyMeshBuffers()
+{
+	delete g_pVertexBuffers;
+	g_pVertexBuffers = NULL;
+	delete g_pIndexBuffers;
+	g_pIndexBuffers = NULL;
+}
+
+///////////////////////////////////////////////////
+//	CompactMeshBuffers()
+//
+//	Move mesh data towards the start of the shared
+//  buffers, up to the passed in number of bytes, and
+//  free the buffers left empty.  Meant to be called
+//  once per frame, the owners pick up the new places
+//  when they next bind their meshes.
+///////////////////////////////////////////////////
+GLsizeiptr ShapeMeshes::CompactMeshBuffers(GLsizeiptr maxBytes)
+{
+	return(GetVertexBuffers().Compact(maxBytes) + GetIndexBuffers().Compact(maxBytes));
+}
+
+///////////////////////////////////////////////////
+//	GetMeshBufferStats()
+//
+//	Get the occupancy and fragmentation of the shared
+//  vertex and index buffers.
+///////////////////////////////////////////////////
+void ShapeMeshes::GetMeshBufferStats(
+	GPUBufferAllocator::ALLOCATOR_STATS& vertexStats,
+	GPUBufferAllocator::ALLOCATOR_STATS& indexStats)
+{
+	GetVertexBuffers().GetStats(vertexStats);
+	GetIndexBuffers().GetStats(indexStats);
+}
+
+///////////////////////////////////////////////////
+//	UploadVertexData()
+//
+//	Copy the vertices of a mesh into a range of the
+//  shared vertex buffers, freeing any range the mesh
+//  had before, and bind the buffer for the memory
+//  layout that follows.  The mesh VAO must already be
+//  bound.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadVertexData(
+	GLMesh& mesh,
+	const void* data,
+	GLsizeiptr size)
+{
+	m_vertexBuffers.Free(mesh.vertexRange);
+	mesh.vertexRange = m_vertexBuffers.Allocate(size, data);
+	mesh.vbos[0] = m_vertexBuffers.GetBuffer(mesh.vertexRange);
+	mesh.vertexOffset = m_vertexBuffers.GetOffset(mesh.vertexRange);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+}
+
+///////////////////////////////////////////////////
+//	UploadIndexData()
+//
+//	Copy the indices of a mesh into a range of the
+//  shared index buffers and bind the buffer to the
+//  mesh VAO, which must already be bound.  The draws
+//  add the offset of the range to their index offsets.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadIndexData(
+	GLMesh& mesh,
+	const void* data,
+	GLsizeiptr size)
+{
+	m_indexBuffers.Free(mesh.indexRange);
+	mesh.indexRange = m_indexBuffers.Allocate(size, data);
+	mesh.vbos[1] = m_indexBuffers.GetBuffer(mesh.indexRange);
+	mesh.indexOffset = m_indexBuffers.GetOffset(mesh.indexRange);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
+}
+
+///////////////////////////////////////////////////
+//	KeepMeshData()
+//
+//	Keep a CPU copy of the vertices and indices sent to
+//  the GPU, so the scene geometry can be processed
+//  offline without reading the buffers back.
+///////////////////////////////////////////////////
+void ShapeMeshes::KeepMeshData(
+	GLMesh& mesh,
+	GLenum primitive,
+	const GLfloat* verts,
+	GLuint nFloats,
+	const GLuint* indices,
+	GLuint nIndices)
+{
+	mesh.primitive = primitive;
+	mesh.vertexData.assign(verts, verts + nFloats);
+	mesh.indexData.clear();
+
+	if (NULL != indices)
+	{
+		mesh.indexData.assign(indices, indices + nIndices);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetMesh()
+//
+//	Get the mesh for the passed in type, or NULL when
+//  the type is not valid.
+///////////////////////////////////////////////////
+ShapeMeshes::GLMesh* ShapeMeshes::GetMesh(MESH_TYPE mesh)
+{
+	switch (mesh)
+	{
+	case MESH_BOX: return(&m_BoxMesh);
+	case MESH_CONE: return(&m_ConeMesh);
+	case MESH_CYLINDER: return(&m_CylinderMesh);
+	case MESH_PLANE: return(&m_PlaneMesh);
+	case MESH_PRISM: return(&m_PrismMesh);
+	case MESH_PYRAMID3: return(&m_Pyramid3Mesh);
+	case MESH_PYRAMID4: return(&m_Pyramid4Mesh);
+	case MESH_SPHERE: return(&m_SphereMesh);
+	case MESH_TAPERED_CYLINDER: return(&m_TaperedCylinderMesh);
+	case MESH_TORUS: return(&m_TorusMesh);
+	default: return(NULL);
+	}
+}
+
+///////////////////////////////////////////////////
+//	RecordDraw()
+//
+//	Pass the draw to the recorder when one is set.
+//  Returns true when the draw was recorded, so the
+//  calling draw method returns without drawing.
+///////////////////////////////////////////////////
+bool ShapeMeshes::RecordDraw(
+	MESH_TYPE mesh,
+	GLuint partMask,
+	bool bHalf)
+{
+	if (m_drawRecorder == nullptr)
+	{
+		return(false);
+	}
+
+	MESH_DRAW draw;
+	draw.mesh = mesh;
+	draw.partMask = partMask;
+	draw.bHalf = bHalf;
+	m_drawRecorder(draw);
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	BindMesh()
+//
+//	Bind the VAO of the passed in mesh.  The vertex
+//  color stream is part of the VAO state, so it is only
+//  re-pointed when the mesh was last bound with a
+//  different stream.  The same goes for the mesh data,
+//  which is only re-pointed after compaction moved it.
+///////////////////////////////////////////////////
+void ShapeMeshes::BindMesh(GLMesh& mesh)
+{
+	glBindVertexArray(mesh.vao);
+
+	GLuint vertexBuffer = m_vertexBuffers.GetBuffer(mesh.vertexRange);
+	GLintptr vertexOffset = m_vertexBuffers.GetOffset(mesh.vertexRange);
+	if ((vertexBuffer != mesh.vbos[0]) || (vertexOffset != mesh.vertexOffset))
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		SetShaderMemoryLayout(vertexOffset);
+		mesh.vbos[0] = vertexBuffer;
+		mesh.vertexOffset = vertexOffset;
+	}
+
+	if (mesh.indexRange != 0)
+	{
+		GLuint indexBuffer = m_indexBuffers.GetBuffer(mesh.indexRange);
+		if (indexBuffer != mesh.vbos[1])
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+			mesh.vbos[1] = indexBuffer;
+		}
+		mesh.indexOffset = m_indexBuffers.GetOffset(mesh.indexRange);
+	}
+
+	if (mesh.colorStream != m_vertexColorStream)
+	{
+		if (m_vertexColorStream != 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_vertexColorStream);
+			glVertexAttribPointer(g_ColorStreamAttribute, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+			glEnableVertexAttribArray(g_ColorStreamAttribute);
+		}
+		else
+		{
+			glDisableVertexAttribArray(g_ColorStreamAttribute);
+		}
+		mesh.colorStream = m_vertexColorStream;
+	}
+}
+
 glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
 {
 	glm::vec3 Normal(0, 0, 0);
@@ -2410,7 +3540,7 @@ glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::
 	float v2z = p2.z - p1.z;
 	Normal.x = v1y * v2z - v1z * v2y;
 	Normal.y = v1z * v2x - v1x * v2z;
-	Normal.y = v1x * v2y - v1y * v2x;
+	Normal.z = v1x * v2y - v1y * v2x;
 	float len = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
 	if (len == 0)
 	{
@@ -2427,21 +3557,22 @@ glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::
 
 
 
-void ShapeMeshes::SetShaderMemoryLayout()
+void ShapeMeshes::SetShaderMemoryLayout(GLintptr vertexOffset)
 {
 	// The following code defines the layout of the mesh data in memory - each mesh needs
-	// to have the same memory layout so that the data is retrieved properly by the shaders
+	// to have the same memory layout so that the data is retrieved properly by the shaders.
+	// The mesh starts at vertexOffset in the shared vertex buffer
 
 	// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
 	GLint stride = sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV);// The number of floats before each
 
 	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, g_FloatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+	glVertexAttribPointer(0, g_FloatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)vertexOffset);
 	glEnableVertexAttribArray(0);
 
-	glVertexAttribPointer(1, g_FloatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * g_FloatsPerVertex));
+	glVertexAttribPointer(1, g_FloatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(vertexOffset + sizeof(float) * g_FloatsPerVertex));
 	glEnableVertexAttribArray(1);
 
-	glVertexAttribPointer(2, g_FloatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal)));
+	glVertexAttribPointer(2, g_FloatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(vertexOffset + sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal)));
 	glEnableVertexAttribArray(2);
 }
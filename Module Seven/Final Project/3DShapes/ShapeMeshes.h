@@ -14,6 +14,12 @@
 
 #include <glm/glm.hpp>
 
+#include <functional>
+#include <vector>
+
+#include "Meshlets.h"
+#include "GPUBufferAllocator.h"
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -25,16 +31,82 @@ class ShapeMeshes
 public:
 	// constructor
 	ShapeMeshes();
+	// destructor
+	~ShapeMeshes();
+
+	// the parts of a mesh that can be drawn separately,
+	// in the order they are stored in the index buffer
+	enum MESH_PART
+	{
+		PART_BOTTOM = 0,
+		PART_TOP,
+		PART_SIDES,
+		MAX_MESH_PARTS
+	};
+
+	// the available 3D shapes, used to record and replay draws
+	enum MESH_TYPE
+	{
+		MESH_BOX = 0,
+		MESH_CONE,
+		MESH_CYLINDER,
+		MESH_PLANE,
+		MESH_PRISM,
+		MESH_PYRAMID3,
+		MESH_PYRAMID4,
+		MESH_SPHERE,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MAX_MESH_TYPES
+	};
+
+	// one draw of a shape mesh, as issued by the Draw methods
+	struct MESH_DRAW
+	{
+		MESH_TYPE mesh;     // Which mesh is drawn
+		GLuint partMask;    // Drawn parts, bits of MESH_PART
+		bool bHalf;         // Half sphere or half torus
+	};
+
+	// number of floats in each interleaved vertex of the
+	// CPU mesh data - position, normal, texture coords
+	static const GLuint FLOATS_PER_VERTEX = 8;
 
 private:
 
+	// stores the index buffer range of one mesh part
+	struct GLMeshPart
+	{
+		GLint firstIndex;   // First index of the part
+		GLsizei nIndices;   // Number of indices for the part
+	};
+
+	// describes one generated part of the vertex data
+	struct GLMeshPartSource
+	{
+		MESH_PART part;     // Which part the vertices are
+		GLenum mode;        // Primitive the vertices were generated for
+		GLuint firstVertex; // First vertex of the part
+		GLuint nVertices;   // Number of vertices for the part
+	};
+
 	// stores the GL data relative to a given mesh
 	struct GLMesh
 	{
 		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
+		GLuint vbos[2];     // Shared buffers holding the vertices and indices
+		GLuint vertexRange; // Allocations in the shared buffers
+		GLuint indexRange;
+		GLintptr vertexOffset; // Byte offsets the VAO and draws use
+		GLintptr indexOffset;
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		MeshletSet meshlets; // Clusters used for culling large meshes
+		GLMeshPart parts[MAX_MESH_PARTS]; // Separately drawn parts
+		GLenum primitive;   // Primitive the mesh is drawn with
+		std::vector<GLfloat> vertexData; // CPU copy of the vertices
+		std::vector<GLuint> indexData;   // CPU copy of the indices
+		GLuint colorStream; // Vertex color buffer bound to the VAO
 	};
 
 	// the available 3D shapes
@@ -51,6 +123,37 @@ private:
 
 	bool m_bMemoryLayoutDone;
 
+	// the large buffers the mesh data is placed in, shared
+	// with every other mesh owner
+	GPUBufferAllocator& m_vertexBuffers;
+	GPUBufferAllocator& m_indexBuffers;
+
+	// state used for culling meshlets against the view
+	bool m_bMeshletCulling;
+	bool m_bCullingViewSet;
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_cameraPosition;
+	glm::mat4 m_modelTransform;
+
+	// reused buffers for the culled multi-draw ranges
+	std::vector<GLint> m_culledFirsts;
+	std::vector<GLsizei> m_culledCounts;
+	std::vector<const void*> m_culledOffsets;
+
+	// meshlet totals for the current frame
+	GLuint m_nMeshletsTested;
+	GLuint m_nMeshletsDrawn;
+	// GL draw calls issued for the current frame
+	GLuint m_nDrawCalls;
+
+	// when set, draws are passed to the recorder instead
+	// of being sent to the GPU
+	std::function<void(const MESH_DRAW&)> m_drawRecorder;
+
+	// per-vertex color buffer for the next draws, zero
+	// uses the constant attribute value
+	GLuint m_vertexColorStream;
+
 public:
 	// methods for loading the shape mesh data 
 	// into memory
@@ -64,6 +167,9 @@ public:
 	void LoadSphereMesh();
 	void LoadTaperedCylinderMesh();
 	void LoadTorusMesh(float thickness = 0.2);
+	// build the data of the passed in meshes in parallel,
+	// then upload them all on the calling thread
+	void LoadMeshes(const MESH_TYPE* meshes, GLuint nMeshes);
 
 	// methods for drawing the shape mesh in the
 	// display window
@@ -87,9 +193,80 @@ public:
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
 
+	// methods for culling meshlets of the large meshes -
+	// the view is set once per frame and the model
+	// transform before each drawn mesh
+	void EnableMeshletCulling(bool bEnable);
+	void SetCullingView(
+		const glm::mat4& viewProjection,
+		const glm::vec3& cameraPosition);
+	void SetModelTransform(const glm::mat4& model);
+	void GetMeshletStats(GLuint& nTested, GLuint& nDrawn);
+	void ResetMeshletStats();
+	GLuint GetDrawCallCount();
+	void ResetDrawCallCount();
+
+	// methods for capturing and replaying the draws of
+	// a scene - while a recorder is set nothing is drawn
+	void SetDrawRecorder(std::function<void(const MESH_DRAW&)> recorder);
+	void DrawMesh(const MESH_DRAW& draw);
+
+	// methods for reading back the loaded mesh data on the
+	// CPU - the triangles are indices into the vertex data
+	// covering exactly what the passed in draw renders
+	const std::vector<GLfloat>& GetMeshVertexData(MESH_TYPE mesh);
+	// the range of the loaded vertices in GetVertexBuffers(),
+	// in the same layout, zero when the mesh is not loaded
+	GLuint GetMeshVertexRange(MESH_TYPE mesh);
+	bool GetMeshTriangles(
+		const MESH_DRAW& draw,
+		std::vector<GLuint>& triangles);
+
+	// set a buffer of one vec4 per mesh vertex that is fed
+	// to vertex attribute 3 for the next draws, or zero to
+	// use a constant white value
+	void SetVertexColorStream(GLuint colorBuffer);
+
+	// the bytes the loaded meshes take in the shared buffers
+	GLsizeiptr GetMeshBufferBytes();
+
+	// the buffers shared by every mesh owner - the loaded
+	// shapes and other meshes such as the HLOD proxies - so
+	// the ranges one owner frees are reused by the others.
+	// Owners read the place of their data again through the
+	// handles, as compaction moves it.  Destroyed after the
+	// last owner and before the GL context
+	static GPUBufferAllocator& GetVertexBuffers();
+	static GPUBufferAllocator& GetIndexBuffers();
+	static void DestroyMeshBuffers();
+
+	// methods for keeping the shared mesh buffers packed,
+	// compaction moves at most maxBytes of each kind
+	static GLsizeiptr CompactMeshBuffers(GLsizeiptr maxBytes);
+	static void GetMeshBufferStats(
+		GPUBufferAllocator::ALLOCATOR_STATS& vertexStats,
+		GPUBufferAllocator::ALLOCATOR_STATS& indexStats);
 
 private:
 
+	// methods for building the shape mesh data on the CPU,
+	// without any GL calls
+	void BuildBoxMesh();
+	void BuildConeMesh();
+	void BuildCylinderMesh();
+	void BuildPlaneMesh();
+	void BuildPrismMesh();
+	void BuildPyramid3Mesh();
+	void BuildPyramid4Mesh();
+	void BuildSphereMesh();
+	void BuildTaperedCylinderMesh();
+	void BuildTorusMesh(float thickness = 0.2);
+	void BuildMesh(MESH_TYPE mesh);
+
+	// called to create the VAO of a built mesh and place
+	// its data in the shared buffers
+	void UploadMesh(GLMesh& mesh);
+
 	// called to calculate the normal for 
 	// the passed in coordinates
 	glm::vec3 CalculateTriangleNormal(
@@ -97,5 +274,63 @@ private:
 
 	// called to set the memory layout 
 	// template for shader data
-	void SetShaderMemoryLayout();
+	void SetShaderMemoryLayout(GLintptr vertexOffset);
+
+	// called to place the mesh data in the shared buffers
+	void UploadVertexData(
+		GLMesh& mesh,
+		const void* data,
+		GLsizeiptr size);
+	void UploadIndexData(
+		GLMesh& mesh,
+		const void* data,
+		GLsizeiptr size);
+
+	// called to append the vertices of one generated part
+	GLuint AppendMeshPart(
+		std::vector<GLfloat>& verts,
+		const GLfloat* partVerts,
+		GLuint nFloats);
+
+	// called to build the part index data of a mesh
+	void BuildMeshParts(
+		GLMesh& mesh,
+		const GLMeshPartSource* parts,
+		GLuint nParts);
+
+	// called to draw the selected parts of a mesh
+	void DrawMeshParts(
+		GLMesh& mesh,
+		GLuint partMask);
+
+	// called to keep a CPU copy of the loaded mesh data
+	void KeepMeshData(
+		GLMesh& mesh,
+		GLenum primitive,
+		const GLfloat* verts,
+		GLuint nFloats,
+		const GLuint* indices,
+		GLuint nIndices);
+
+	// called to find the mesh of the passed in type
+	GLMesh* GetMesh(MESH_TYPE mesh);
+
+	// called at the start of each draw method, returns true
+	// when the draw was recorded and must not be sent to
+	// the GPU
+	bool RecordDraw(
+		MESH_TYPE mesh,
+		GLuint partMask,
+		bool bHalf);
+
+	// called to bind the VAO of a mesh for drawing along
+	// with the current vertex color stream
+	void BindMesh(GLMesh& mesh);
+
+	// called to draw the meshlets of a mesh that survive
+	// culling, returns false when culling is not possible
+	bool DrawCulledMeshlets(
+		GLMesh& mesh,
+		GLuint elementLimit,
+		bool bClosedDraw);
 };
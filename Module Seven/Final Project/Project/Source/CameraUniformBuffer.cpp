@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+// CameraUniformBuffer.cpp
+// ============
+// the camera matrices in a uniform buffer filled on the GPU from a persistently
+// mapped staging buffer, with a second camera of the frame that can be latched
+// after the frame's CPU work and just before its draws
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraUniformBuffer.h"
+#include "GLCapture.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const char* g_CameraBlockName = "CameraBlock";
+	// uniform buffer binding point of the camera block
+	const GLuint g_CameraBinding = 0;
+	// frames that can be in flight before a slot is reused
+	const GLuint g_SlotCount = 3;
+	// staging entries per slot, the written camera and the
+	// latched camera
+	const GLuint g_EntryWritten = 0;
+	const GLuint g_EntryLatched = 1;
+	const GLuint g_EntryCount = 2;
+	// longest wait for the GPU to free a slot
+	const GLuint64 g_FenceTimeout = 1000000000;
+}
+
+/***********************************************************
+ *  CameraUniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraUniformBuffer::CameraUniformBuffer()
+{
+	m_buffer = 0;
+	m_stagingBuffer = 0;
+	m_pMapped = NULL;
+	m_slotStride = 0;
+	m_slot = 0;
+	m_bFrameStarted = false;
+	m_bLatched = false;
+}
+
+/***********************************************************
+ *  ~CameraUniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraUniformBuffer::~CameraUniformBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer with a slot
+ *  per frame in flight.  Where immutable storage is
+ *  supported a staging buffer with two entries per slot is
+ *  mapped persistent and coherent, otherwise each write is
+ *  sent with glBufferSubData().
+ ***********************************************************/
+bool CameraUniformBuffer::Create()
+{
+	Destroy();
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_slotStride = (GLsizeiptr)(((sizeof(CAMERA_BLOCK) + alignment - 1) / alignment) * alignment);
+	GLsizeiptr size = m_slotStride * g_SlotCount;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if ((GLEW_VERSION_4_4 == GL_TRUE) || (GLEW_ARB_buffer_storage == GL_TRUE))
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr stagingSize = size * g_EntryCount;
+		glGenBuffers(1, &m_stagingBuffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+		glBufferStorage(GL_COPY_READ_BUFFER, stagingSize, NULL, flags);
+		m_pMapped = (GLubyte*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, stagingSize, flags);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	if (glGetError() == GL_OUT_OF_MEMORY)
+	{
+		std::cout << "CameraUniformBuffer: could not create the camera buffer" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_fences.assign(g_SlotCount, (GLsync)0);
+	m_slot = 0;
+	m_bFrameStarted = false;
+	m_bLatched = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the fences and the
+ *  buffers.
+ ***********************************************************/
+void CameraUniformBuffer::Destroy()
+{
+	for (size_t i = 0; i < m_fences.size(); i++)
+	{
+		if (m_fences[i] != 0)
+		{
+			glDeleteSync(m_fences[i]);
+		}
+	}
+	m_fences.clear();
+
+	if (m_stagingBuffer != 0)
+	{
+		if (NULL != m_pMapped)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+			glUnmapBuffer(GL_COPY_READ_BUFFER);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers(1, &m_stagingBuffer);
+		m_stagingBuffer = 0;
+	}
+
+	if (m_buffer != 0)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame.  The commands
+ *  of the last frame are fenced, then the next slot is
+ *  waited for, so both its staging entries and its uniform
+ *  buffer slot are free to be written.
+ ***********************************************************/
+void CameraUniformBuffer::BeginFrame()
+{
+	if (m_buffer == 0)
+	{
+		return;
+	}
+
+	if (m_bFrameStarted == true)
+	{
+		m_fences[m_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_slot = (m_slot + 1) % g_SlotCount;
+	}
+	m_bFrameStarted = true;
+	m_bLatched = false;
+
+	if (m_fences[m_slot] != 0)
+	{
+		GLenum result = glClientWaitSync(m_fences[m_slot], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			std::cout << "CameraUniformBuffer: timed out waiting for the GPU" << std::endl;
+		}
+		glDeleteSync(m_fences[m_slot]);
+		m_fences[m_slot] = 0;
+	}
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the camera of the
+ *  current frame.  Through the persistent mapping it is
+ *  written into the first staging entry of the slot, which
+ *  the copy queued by UploadFrame() reads.  Otherwise it is
+ *  sent straight to the uniform buffer slot.
+ ***********************************************************/
+void CameraUniformBuffer::Write(const CAMERA_BLOCK& block)
+{
+	if (m_buffer == 0)
+	{
+		return;
+	}
+
+	GLintptr offset = (GLintptr)(m_slot * m_slotStride);
+	if (NULL != m_pMapped)
+	{
+		GLintptr stagingOffset = (GLintptr)((m_slot * g_EntryCount + g_EntryWritten) * m_slotStride);
+		memcpy(m_pMapped + stagingOffset, &block, sizeof(CAMERA_BLOCK));
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(CAMERA_BLOCK), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+}
+
+/***********************************************************
+ *  UploadFrame()
+ *
+ *  This method is used for queuing the copy of the written
+ *  camera into the uniform buffer slot of the current
+ *  frame, and binding that slot to the camera binding
+ *  point.  It is called once per frame before the first
+ *  draw, so the draws only read the slot once the copy has
+ *  filled it.
+ ***********************************************************/
+void CameraUniformBuffer::UploadFrame()
+{
+	if (m_buffer == 0)
+	{
+		return;
+	}
+
+	GLintptr offset = (GLintptr)(m_slot * m_slotStride);
+	if (m_stagingBuffer != 0)
+	{
+		QueueCopy(g_EntryWritten);
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, g_CameraBinding, m_buffer, offset, sizeof(CAMERA_BLOCK));
+}
+
+/***********************************************************
+ *  Latch()
+ *
+ *  This method is used for replacing the camera of the
+ *  current frame with one sampled later.  It is written
+ *  into the second staging entry of the slot, which no
+ *  queued copy reads, then copied over the uniform buffer
+ *  slot.  The copy is queued after the first one and before
+ *  the draws that follow, and the GL keeps that order, so
+ *  no draw reads the slot between the two copies.  Without
+ *  the staging buffer the camera is sent with
+ *  glBufferSubData(), which the GL orders the same way.
+ *  The entry is only written once per frame, so it is never
+ *  rewritten while its copy is pending.
+ ***********************************************************/
+bool CameraUniformBuffer::Latch(const CAMERA_BLOCK& block)
+{
+	if ((m_buffer == 0) || (m_bLatched == true))
+	{
+		return(false);
+	}
+
+	GLintptr offset = (GLintptr)(m_slot * m_slotStride);
+	if (NULL != m_pMapped)
+	{
+		GLintptr stagingOffset = (GLintptr)((m_slot * g_EntryCount + g_EntryLatched) * m_slotStride);
+		memcpy(m_pMapped + stagingOffset, &block, sizeof(CAMERA_BLOCK));
+		QueueCopy(g_EntryLatched);
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(CAMERA_BLOCK), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	m_bLatched = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  QueueCopy()
+ *
+ *  This method is used for queuing the copy of a staging
+ *  entry of the current slot into its uniform buffer slot.
+ *  The copy reads the entry when the GPU runs it, so the
+ *  entry is not written again until the slot's fence.
+ ***********************************************************/
+void CameraUniformBuffer::QueueCopy(GLuint entry)
+{
+	GLintptr offset = (GLintptr)(m_slot * m_slotStride);
+	GLintptr stagingOffset = (GLintptr)((m_slot * g_EntryCount + entry) * m_slotStride);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, offset, sizeof(CAMERA_BLOCK));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BindProgram()
+ *
+ *  This method is used for pointing the camera block of a
+ *  program at the camera binding point.
+ ***********************************************************/
+bool CameraUniformBuffer::BindProgram(GLuint program)
+{
+	if (program == 0)
+	{
+		return(false);
+	}
+
+	GLuint blockIndex = glGetUniformBlockIndex(program, g_CameraBlockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	glUniformBlockBinding(program, blockIndex, g_CameraBinding);
+	return(true);
+}
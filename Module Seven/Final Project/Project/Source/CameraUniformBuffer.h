@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerauniformbuffer.h
+// ============
+// the camera matrices in a uniform buffer filled on the GPU from a persistently
+// mapped staging buffer, with a second camera of the frame that can be latched
+// after the frame's CPU work and just before its draws
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  CameraUniformBuffer
+ *
+ *  This class contains the uniform buffer read by shaders
+ *  that declare the CameraBlock uniform block.  The buffer
+ *  holds a few slots used in turn, one per frame, and the
+ *  CPU never writes a slot while draws may read it.  Where
+ *  the GL supports it the camera is written into a staging
+ *  buffer that stays mapped for the whole run, and a copy
+ *  into the frame's slot is queued before the first draw
+ *  of the frame.
+ *
+ *  The frame can latch a second camera, sampled after its
+ *  CPU work and right before its draws are recorded - this
+ *  is called late latching.  The latched camera has its
+ *  own staging entry, so the CPU never writes an entry a
+ *  queued copy may be reading, and its copy is queued after
+ *  the first one.  The GL runs the copies and the draws in
+ *  the order they were queued, so every draw of the frame
+ *  reads the one latched camera, never a mix of two.
+ *
+ *  A fence is placed after each frame, and a slot and its
+ *  staging entries are only written again once the GPU has
+ *  finished the frame that last read them.
+ ***********************************************************/
+class CameraUniformBuffer
+{
+public:
+	// the camera block as the shaders read it, std140 layout
+	struct CAMERA_BLOCK
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;   // w is unused
+	};
+
+	// constructor
+	CameraUniformBuffer();
+	// destructor
+	~CameraUniformBuffer();
+
+	// create and map the buffer
+	bool Create();
+	// unmap and free the buffer
+	void Destroy();
+	bool IsCreated() const { return(m_buffer != 0); }
+
+	// fence the last frame and move to the next slot once
+	// the GPU is done with it
+	void BeginFrame();
+	// write the camera of the current frame, before the copy
+	// of the frame is queued
+	void Write(const CAMERA_BLOCK& block);
+	// queue the copy of the written camera into the slot of
+	// the current frame and bind it, before the first draw
+	void UploadFrame();
+	// write the latched camera and queue its copy over the
+	// slot of the current frame, before the draws that should
+	// see it - false when the frame has already latched
+	bool Latch(const CAMERA_BLOCK& block);
+
+	// connect the camera block of a program to the buffer,
+	// false when the program has no camera block
+	static bool BindProgram(GLuint program);
+
+private:
+	GLuint m_buffer;
+	// staging buffer with two entries per slot, the written
+	// and the latched camera, zero when the camera is written
+	// straight into the uniform buffer
+	GLuint m_stagingBuffer;
+	GLubyte* m_pMapped;
+	// bytes between the slots, rounded up to the uniform
+	// buffer offset alignment
+	GLsizeiptr m_slotStride;
+	GLuint m_slot;
+	// fence after the last frame that used each slot
+	std::vector<GLsync> m_fences;
+	bool m_bFrameStarted;
+	bool m_bLatched;
+
+	// queue the copy of a staging entry of the current slot
+	// into the uniform buffer slot
+	void QueueCopy(GLuint entry);
+};
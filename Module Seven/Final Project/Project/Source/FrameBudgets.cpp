@@ -0,0 +1,313 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameBudgets.cpp
+// ============
+// per-frame performance budgets read from a checked in file and checked
+// against frames of the reference scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameBudgets.h"
+#include "GLCapture.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace
+{
+	// the names used in the budgets file
+	const char* g_BudgetNames[FrameBudgets::MAX_BUDGETS] = {
+		"draw_calls", "state_changes", "uniform_uploads",
+		"heap_allocations", "triangles", "cpu_ms" };
+
+	// frames drawn before measuring, so the buffers that
+	// grow on first use have reached their size
+	const int g_WarmupFrames = 3;
+	const int g_DefaultFrames = 20;
+	// the CPU time varies between runs, recorded budgets
+	// get this much room above the measured time
+	const double g_CpuHeadroom = 1.5;
+}
+
+/***********************************************************
+ *  FrameBudgets()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameBudgets::FrameBudgets()
+{
+	for (int i = 0; i < MAX_BUDGETS; i++)
+	{
+		m_limits[i] = 0.0;
+		m_bLimitSet[i] = false;
+	}
+	m_nFrames = g_DefaultFrames;
+	m_referenceCore = -1;
+}
+
+/***********************************************************
+ *  GetBudgetName()
+ *
+ *  This method is used for getting the name of a budget as
+ *  it is written in the budgets file.
+ ***********************************************************/
+const char* FrameBudgets::GetBudgetName(BUDGET budget)
+{
+	return(((budget >= 0) && (budget < MAX_BUDGETS)) ? g_BudgetNames[budget] : "");
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the budgets file.
+ ***********************************************************/
+bool FrameBudgets::Load(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (NULL == file)
+	{
+		std::cout << "FrameBudgets: could not open " << filename << std::endl;
+		return(false);
+	}
+
+	char line[256];
+	int lineNumber = 0;
+	bool bLoaded = true;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		lineNumber++;
+
+		char* pComment = strchr(line, '#');
+		if (NULL != pComment)
+		{
+			*pComment = '\0';
+		}
+
+		char name[64];
+		double value = 0.0;
+		int nRead = sscanf(line, "%63s %lf", name, &value);
+		if (nRead <= 0)
+		{
+			continue;
+		}
+
+		bool bKnown = false;
+		if (nRead == 2)
+		{
+			if (strcmp(name, "frames") == 0)
+			{
+				m_nFrames = std::max(1, (int)value);
+				bKnown = true;
+			}
+			else if (strcmp(name, "reference_core") == 0)
+			{
+				m_referenceCore = (int)value;
+				bKnown = true;
+			}
+			for (int i = 0; (i < MAX_BUDGETS) && (bKnown == false); i++)
+			{
+				if (strcmp(name, g_BudgetNames[i]) == 0)
+				{
+					m_limits[i] = value;
+					m_bLimitSet[i] = true;
+					bKnown = true;
+				}
+			}
+		}
+
+		if (bKnown == false)
+		{
+			std::cout << "FrameBudgets: " << filename << ":" << lineNumber << ": cannot read " << line << std::endl;
+			bLoaded = false;
+		}
+	}
+	fclose(file);
+
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the measured values as
+ *  the budgets, keeping the frame count and the reference
+ *  core.  The counts are written as measured, so any
+ *  extra work fails the next check.
+ ***********************************************************/
+bool FrameBudgets::Save(const char* filename, const FRAME_MEASURE& measured) const
+{
+	FILE* file = fopen(filename, "w");
+	if (NULL == file)
+	{
+		std::cout << "FrameBudgets: could not write " << filename << std::endl;
+		return(false);
+	}
+
+	fprintf(file, "# per-frame budgets of the reference scene, checked with --check-budgets\n");
+	fprintf(file, "# and written with --record-budgets.  A frame over any budget fails\n");
+	fprintf(file, "# the check, so raise a budget only for intended extra work.\n");
+	fprintf(file, "frames %d\n", m_nFrames);
+	fprintf(file, "reference_core %d\n", m_referenceCore);
+	for (int i = 0; i < MAX_BUDGETS; i++)
+	{
+		if (i == BUDGET_CPU_MS)
+		{
+			fprintf(file, "%s %.2f\n", g_BudgetNames[i], measured.values[i] * g_CpuHeadroom);
+		}
+		else
+		{
+			fprintf(file, "%s %.0f\n", g_BudgetNames[i], measured.values[i]);
+		}
+	}
+
+	bool bWritten = (ferror(file) == 0);
+	fclose(file);
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  PinToReferenceCore()
+ *
+ *  This method is used for moving the calling thread to
+ *  the reference core named in the budgets file.
+ ***********************************************************/
+bool FrameBudgets::PinToReferenceCore() const
+{
+	if (m_referenceCore < 0)
+	{
+		return(true);
+	}
+
+#ifdef __linux__
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(m_referenceCore, &cpus);
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+	{
+		std::cout << "FrameBudgets: could not run on core " << m_referenceCore << std::endl;
+		return(false);
+	}
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Measure()
+ *
+ *  This method is used for drawing the frames of the check
+ *  with the passed in function.  Each count keeps its
+ *  worst frame, the CPU time is the median of the frames.
+ *  The GPU is waited on between frames, outside of the
+ *  measured time.
+ ***********************************************************/
+void FrameBudgets::Measure(std::function<void()> renderFrame, FRAME_MEASURE& measured) const
+{
+	std::vector<double> cpuTimes;
+
+	for (int i = 0; i < MAX_BUDGETS; i++)
+	{
+		measured.values[i] = 0.0;
+	}
+
+	for (int i = 0; i < g_WarmupFrames; i++)
+	{
+		renderFrame();
+		glFinish();
+	}
+
+	AllocationCounter::Enable(true);
+	for (int frame = 0; frame < m_nFrames; frame++)
+	{
+		GLCapture::ResetCallStats();
+		AllocationCounter::Reset();
+		double cpuStart = GetThreadCpuMs();
+
+		renderFrame();
+
+		double cpuTime = GetThreadCpuMs() - cpuStart;
+		uint64_t nAllocations = AllocationCounter::GetCount();
+		const GLCapture::CALL_STATS& stats = GLCapture::GetCallStats();
+
+		measured.values[BUDGET_DRAW_CALLS] = std::max(measured.values[BUDGET_DRAW_CALLS], (double)stats.drawCalls);
+		measured.values[BUDGET_STATE_CHANGES] = std::max(measured.values[BUDGET_STATE_CHANGES], (double)stats.stateChanges);
+		measured.values[BUDGET_UNIFORM_UPLOADS] = std::max(measured.values[BUDGET_UNIFORM_UPLOADS], (double)stats.uniformUploads);
+		measured.values[BUDGET_HEAP_ALLOCATIONS] = std::max(measured.values[BUDGET_HEAP_ALLOCATIONS], (double)nAllocations);
+		measured.values[BUDGET_TRIANGLES] = std::max(measured.values[BUDGET_TRIANGLES], (double)stats.triangles);
+		cpuTimes.push_back(cpuTime);
+
+		glFinish();
+	}
+	AllocationCounter::Enable(false);
+
+	std::sort(cpuTimes.begin(), cpuTimes.end());
+	measured.values[BUDGET_CPU_MS] = cpuTimes[cpuTimes.size() / 2];
+}
+
+/***********************************************************
+ *  Check()
+ *
+ *  This method is used for printing one line per budget
+ *  and checking the measured values against the budgets.
+ *  Budgets missing from the file are not checked.
+ ***********************************************************/
+bool FrameBudgets::Check(const FRAME_MEASURE& measured, std::ostream& stream) const
+{
+	char line[128];
+	bool bPassed = true;
+
+	snprintf(line, sizeof(line), "%-18s %12s %12s  %s", "budget", "measured", "limit", "result");
+	stream << "FRAME BUDGETS (" << m_nFrames << " frames)\n" << line << "\n";
+
+	for (int i = 0; i < MAX_BUDGETS; i++)
+	{
+		const char* result = "not set";
+		if (m_bLimitSet[i] == true)
+		{
+			result = (measured.values[i] <= m_limits[i]) ? "ok" : "OVER BUDGET";
+			if (measured.values[i] > m_limits[i])
+			{
+				bPassed = false;
+			}
+		}
+
+		snprintf(line, sizeof(line), "%-18s %12.2f %12.2f  %s",
+			g_BudgetNames[i], measured.values[i], m_limits[i], result);
+		stream << line << "\n";
+	}
+	stream << (bPassed ? "PASSED" : "FAILED") << std::endl;
+
+	return(bPassed);
+}
+
+/***********************************************************
+ *  GetThreadCpuMs()
+ *
+ *  This method is used for reading the CPU time of the
+ *  calling thread.  The driver's own threads are left out,
+ *  which matters on software renderers.  Platforms without
+ *  a thread clock use the wall time.
+ ***********************************************************/
+double FrameBudgets::GetThreadCpuMs()
+{
+#ifdef __linux__
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+	{
+		return(time.tv_sec * 1000.0 + time.tv_nsec / 1.0e6);
+	}
+#endif
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
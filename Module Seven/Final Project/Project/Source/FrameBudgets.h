@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// framebudgets.h
+// ============
+// per-frame performance budgets read from a checked in file and checked
+// against frames of the reference scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+
+/***********************************************************
+ *  FrameBudgets
+ *
+ *  This class contains the budgets of one frame.  The
+ *  budgets file holds one "name value" line per budget,
+ *  with # starting a comment.  Measure() draws frames of
+ *  the scene and keeps the worst count of each kind and
+ *  the median CPU time, which Check() compares against
+ *  the budgets.  The counts come from the GLCapture hooks
+ *  and the AllocationCounter, so the hooks must be
+ *  installed.
+ ***********************************************************/
+class FrameBudgets
+{
+public:
+	enum BUDGET
+	{
+		BUDGET_DRAW_CALLS = 0,
+		BUDGET_STATE_CHANGES,
+		BUDGET_UNIFORM_UPLOADS,
+		BUDGET_HEAP_ALLOCATIONS,
+		BUDGET_TRIANGLES,
+		BUDGET_CPU_MS,
+		MAX_BUDGETS
+	};
+
+	// the values measured for one kind of budget each
+	struct FRAME_MEASURE
+	{
+		double values[MAX_BUDGETS];
+	};
+
+	// constructor
+	FrameBudgets();
+
+	// read the budgets, fails when the file is missing or
+	// has a line that cannot be read
+	bool Load(const char* filename);
+	// write the measured values as the new budgets
+	bool Save(const char* filename, const FRAME_MEASURE& measured) const;
+
+	// run the calling thread on the reference core, so the
+	// CPU time is comparable between runs
+	bool PinToReferenceCore() const;
+	// draw the warm up frames and then the measured frames
+	void Measure(std::function<void()> renderFrame, FRAME_MEASURE& measured) const;
+	// print each budget with its measured value, returns
+	// false when any budget is exceeded
+	bool Check(const FRAME_MEASURE& measured, std::ostream& stream) const;
+
+	static const char* GetBudgetName(BUDGET budget);
+
+private:
+	double m_limits[MAX_BUDGETS];
+	bool m_bLimitSet[MAX_BUDGETS];
+	// measured frames, after the warm up frames
+	int m_nFrames;
+	// CPU the frames are measured on, -1 for any
+	int m_referenceCore;
+
+	// CPU time used by the calling thread
+	static double GetThreadCpuMs();
+};
@@ -0,0 +1,930 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameGraph.cpp
+// ============
+// the render passes of a frame with the textures they read and write, ordered
+// and culled from those declarations, with the transient targets aliased
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameGraph.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	// handle of the default framebuffer among the textures
+	const GLuint g_Backbuffer = 0;
+	// most color attachments of one pass
+	const GLuint g_MaxColorAttachments = 8;
+}
+
+/***********************************************************
+ *  FrameGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameGraph::FrameGraph()
+{
+	m_backbufferWidth = 0;
+	m_backbufferHeight = 0;
+	m_bCompiled = false;
+	m_bViewportChanged = false;
+	m_bMemoryBarriers = false;
+	Clear();
+}
+
+/***********************************************************
+ *  ~FrameGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameGraph::~FrameGraph()
+{
+	FreeGLObjects();
+}
+
+/***********************************************************
+ *  SetBackbufferSize()
+ *
+ *  This method is used for setting the size of the default
+ *  framebuffer, the viewport of the passes drawing to it.
+ *  It can be called every frame.  When the size changes
+ *  after the graph was compiled, the graph is compiled
+ *  again, so the textures that follow the backbuffer are
+ *  created at the new size.  A minimized window has no
+ *  size and keeps the textures it had.
+ ***********************************************************/
+void FrameGraph::SetBackbufferSize(GLsizei width, GLsizei height)
+{
+	if ((width <= 0) || (height <= 0) ||
+		((width == m_backbufferWidth) && (height == m_backbufferHeight)))
+	{
+		return;
+	}
+
+	m_backbufferWidth = width;
+	m_backbufferHeight = height;
+	m_resources[g_Backbuffer].desc.width = width;
+	m_resources[g_Backbuffer].desc.height = height;
+	m_resources[g_Backbuffer].size = m_resources[g_Backbuffer].desc;
+
+	if (m_bCompiled == true)
+	{
+		m_bViewportChanged = true;
+		if (Compile() == false)
+		{
+			std::cout << "FrameGraph: could not resize the textures to " << width << "x" << height << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for adding a transient texture.  It
+ *  only gets a GL texture at Compile() when a kept pass
+ *  uses it.
+ ***********************************************************/
+GLuint FrameGraph::CreateTexture(const char* name, const TEXTURE_DESC& desc)
+{
+	RESOURCE resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.size = desc;
+	resource.allocation = -1;
+	resource.firstPass = -1;
+	resource.lastPass = -1;
+	m_resources.push_back(resource);
+	m_bCompiled = false;
+
+	return((GLuint)(m_resources.size() - 1));
+}
+
+/***********************************************************
+ *  AddPass()
+ *
+ *  This method is used for adding a pass.  The order the
+ *  passes are added in only matters between passes
+ *  writing the same texture.
+ ***********************************************************/
+GLuint FrameGraph::AddPass(const char* name, PASS_FUNCTION execute)
+{
+	PASS pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.bSideEffect = false;
+	pass.bCulled = false;
+	pass.bBarrier = false;
+	pass.framebuffer = 0;
+	pass.width = 0;
+	pass.height = 0;
+	m_passes.push_back(pass);
+	m_bCompiled = false;
+
+	return((GLuint)(m_passes.size() - 1));
+}
+
+/***********************************************************
+ *  ReadTexture()
+ *
+ *  This method is used for declaring a texture the pass
+ *  samples.
+ ***********************************************************/
+void FrameGraph::ReadTexture(GLuint pass, GLuint texture)
+{
+	if ((pass >= m_passes.size()) || (texture >= m_resources.size()))
+	{
+		std::cout << "FrameGraph: pass " << pass << " reads an unknown texture" << std::endl;
+		return;
+	}
+
+	m_passes[pass].reads.push_back(texture);
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  WriteTexture()
+ *
+ *  This method is used for declaring a texture the pass
+ *  draws into.  A pass writes either the backbuffer or
+ *  transient textures, never both.
+ ***********************************************************/
+void FrameGraph::WriteTexture(GLuint pass, GLuint texture)
+{
+	if ((pass >= m_passes.size()) || (texture >= m_resources.size()))
+	{
+		std::cout << "FrameGraph: pass " << pass << " writes an unknown texture" << std::endl;
+		return;
+	}
+
+	m_passes[pass].writes.push_back(texture);
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  SetSideEffect()
+ *
+ *  This method is used for keeping a pass whose output is
+ *  used outside of the graph, like a read back.
+ ***********************************************************/
+void FrameGraph::SetSideEffect(GLuint pass)
+{
+	if (pass < m_passes.size())
+	{
+		m_passes[pass].bSideEffect = true;
+		m_bCompiled = false;
+	}
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for turning the declarations into
+ *  the execution order, the barriers, the aliased textures
+ *  and the framebuffers.  The GL objects of the last
+ *  compile are freed first.
+ ***********************************************************/
+bool FrameGraph::Compile()
+{
+	FreeGLObjects();
+	m_order.clear();
+	m_bCompiled = false;
+
+	m_stats.nPasses = (GLuint)m_passes.size();
+	m_stats.nCulledPasses = 0;
+	m_stats.nTextures = 0;
+	m_stats.nAllocated = 0;
+	m_stats.nBarriers = 0;
+	m_stats.naiveBytes = 0;
+	m_stats.allocatedBytes = 0;
+
+	// the passes each pass has to run after: a pass only
+	// reading a texture waits for all of its writers, and a
+	// pass writing a texture waits for the writers added
+	// before it
+	std::vector<std::vector<GLuint>> dependencies(m_passes.size());
+	for (GLuint pass = 0; pass < m_passes.size(); pass++)
+	{
+		const PASS& current = m_passes[pass];
+		for (GLuint other = 0; other < m_passes.size(); other++)
+		{
+			if (other == pass)
+			{
+				continue;
+			}
+
+			const std::vector<GLuint>& otherWrites = m_passes[other].writes;
+			bool bDepends = false;
+			for (size_t i = 0; (i < current.reads.size()) && (bDepends == false); i++)
+			{
+				GLuint texture = current.reads[i];
+				bool bAlsoWrites = std::find(current.writes.begin(), current.writes.end(), texture) != current.writes.end();
+				bool bOtherWrites = std::find(otherWrites.begin(), otherWrites.end(), texture) != otherWrites.end();
+				bDepends = (bOtherWrites == true) && ((bAlsoWrites == false) || (other < pass));
+			}
+			for (size_t i = 0; (i < current.writes.size()) && (bDepends == false); i++)
+			{
+				GLuint texture = current.writes[i];
+				bool bOtherWrites = std::find(otherWrites.begin(), otherWrites.end(), texture) != otherWrites.end();
+				bDepends = (bOtherWrites == true) && (other < pass);
+			}
+
+			if (bDepends == true)
+			{
+				dependencies[pass].push_back(other);
+			}
+		}
+	}
+
+	CullPasses(dependencies);
+	if (OrderPasses(dependencies) == false)
+	{
+		return(false);
+	}
+
+	// lifetimes of the textures in execution order, and the
+	// barriers in front of passes reading what was written
+	std::vector<bool> written(m_resources.size(), false);
+	for (GLuint index = 0; index < m_order.size(); index++)
+	{
+		PASS& pass = m_passes[m_order[index]];
+		pass.bBarrier = false;
+		for (size_t i = 0; i < pass.reads.size(); i++)
+		{
+			if (written[pass.reads[i]] == true)
+			{
+				pass.bBarrier = true;
+			}
+		}
+		if (pass.bBarrier == true)
+		{
+			m_stats.nBarriers++;
+		}
+
+		for (int access = 0; access < 2; access++)
+		{
+			const std::vector<GLuint>& textures = (access == 0) ? pass.reads : pass.writes;
+			for (size_t i = 0; i < textures.size(); i++)
+			{
+				RESOURCE& resource = m_resources[textures[i]];
+				if (resource.firstPass < 0)
+				{
+					resource.firstPass = (int)index;
+				}
+				resource.lastPass = (int)index;
+			}
+		}
+		for (size_t i = 0; i < pass.writes.size(); i++)
+		{
+			written[pass.writes[i]] = true;
+		}
+	}
+
+	// textures without a size take the backbuffer size
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		RESOURCE& resource = m_resources[i];
+		resource.size = resource.desc;
+		if ((resource.desc.width <= 0) || (resource.desc.height <= 0))
+		{
+			resource.size.width = m_backbufferWidth;
+			resource.size.height = m_backbufferHeight;
+		}
+	}
+
+	AliasTextures();
+	if (CreateFramebuffers() == false)
+	{
+		FreeGLObjects();
+		return(false);
+	}
+
+	m_bMemoryBarriers = (GLEW_VERSION_4_2 == GL_TRUE) || (GLEW_ARB_shader_image_load_store == GL_TRUE);
+	m_bCompiled = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for drawing the kept passes in
+ *  order.  The framebuffer and the viewport are only set
+ *  when they change, so a graph with a single pass on the
+ *  backbuffer issues no GL calls of its own, apart from
+ *  one viewport after the backbuffer was resized.
+ *
+ *  GL already orders framebuffer writes before later
+ *  texture fetches, the memory barrier covers passes that
+ *  write through image stores.
+ ***********************************************************/
+void FrameGraph::Execute()
+{
+	if (m_bCompiled == false)
+	{
+		return;
+	}
+
+	GLuint boundFramebuffer = 0;
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		PASS& pass = m_passes[m_order[i]];
+
+		if ((pass.bBarrier == true) && (m_bMemoryBarriers == true))
+		{
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+		}
+		if ((pass.framebuffer != boundFramebuffer) || (m_bViewportChanged == true))
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+			glViewport(0, 0, pass.width, pass.height);
+			boundFramebuffer = pass.framebuffer;
+			m_bViewportChanged = false;
+		}
+
+		pass.execute();
+	}
+
+	if (boundFramebuffer != 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, m_backbufferWidth, m_backbufferHeight);
+	}
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the GL texture behind a
+ *  transient texture, zero when it is not used.
+ ***********************************************************/
+GLuint FrameGraph::GetTexture(GLuint texture) const
+{
+	if ((texture >= m_resources.size()) || (m_resources[texture].allocation < 0))
+	{
+		return(0);
+	}
+
+	return(m_allocations[m_resources[texture].allocation].texture);
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the pass order, the
+ *  culled passes and which GL texture each transient
+ *  texture was given.
+ ***********************************************************/
+void FrameGraph::Report(std::ostream& stream) const
+{
+	stream << "Frame graph: " << m_stats.nPasses << " passes, "
+		<< m_stats.nCulledPasses << " culled, "
+		<< m_stats.nBarriers << " barriers" << "\n";
+
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		const PASS& pass = m_passes[m_order[i]];
+		stream << "  " << (i + 1) << ". " << pass.name;
+		if (pass.bBarrier == true)
+		{
+			stream << " (barrier)";
+		}
+		stream << "\n";
+	}
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		if (m_passes[i].bCulled == true)
+		{
+			stream << "  culled " << m_passes[i].name << "\n";
+		}
+	}
+
+	for (size_t i = 1; i < m_resources.size(); i++)
+	{
+		const RESOURCE& resource = m_resources[i];
+		if (resource.allocation < 0)
+		{
+			stream << "  " << resource.name << ": unused" << "\n";
+		}
+		else
+		{
+			stream << "  " << resource.name << ": texture " << resource.allocation
+				<< ", passes " << (resource.firstPass + 1) << "-" << (resource.lastPass + 1) << "\n";
+		}
+	}
+
+	stream << std::fixed << std::setprecision(2)
+		<< "  " << m_stats.nTextures << " textures in " << m_stats.nAllocated << " GL textures, "
+		<< m_stats.allocatedBytes / (1024.0 * 1024.0) << " MB instead of "
+		<< m_stats.naiveBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+	stream.unsetf(std::ios::floatfield);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing the GL objects and
+ *  dropping the passes and textures, leaving only the
+ *  backbuffer.
+ ***********************************************************/
+void FrameGraph::Clear()
+{
+	FreeGLObjects();
+	m_passes.clear();
+	m_resources.clear();
+	m_order.clear();
+	m_bCompiled = false;
+
+	RESOURCE backbuffer;
+	backbuffer.name = "Backbuffer";
+	backbuffer.desc.width = m_backbufferWidth;
+	backbuffer.desc.height = m_backbufferHeight;
+	backbuffer.desc.format = GL_RGBA8;
+	backbuffer.size = backbuffer.desc;
+	backbuffer.allocation = -1;
+	backbuffer.firstPass = -1;
+	backbuffer.lastPass = -1;
+	m_resources.push_back(backbuffer);
+
+	m_stats.nPasses = 0;
+	m_stats.nCulledPasses = 0;
+	m_stats.nTextures = 0;
+	m_stats.nAllocated = 0;
+	m_stats.nBarriers = 0;
+	m_stats.naiveBytes = 0;
+	m_stats.allocatedBytes = 0;
+}
+
+/***********************************************************
+ *  OrderPasses()
+ *
+ *  This method is used for sorting the kept passes so each
+ *  runs after the passes it depends on.  Among the passes
+ *  that are ready the one added first runs first, which
+ *  keeps the order stable between compiles.
+ ***********************************************************/
+bool FrameGraph::OrderPasses(std::vector<std::vector<GLuint>>& dependencies)
+{
+	std::vector<GLuint> nWaiting(m_passes.size(), 0);
+	size_t nKept = 0;
+	for (GLuint pass = 0; pass < m_passes.size(); pass++)
+	{
+		if (m_passes[pass].bCulled == true)
+		{
+			continue;
+		}
+		nKept++;
+		for (size_t i = 0; i < dependencies[pass].size(); i++)
+		{
+			if (m_passes[dependencies[pass][i]].bCulled == false)
+			{
+				nWaiting[pass]++;
+			}
+		}
+	}
+
+	std::vector<bool> ordered(m_passes.size(), false);
+	while (m_order.size() < nKept)
+	{
+		GLuint next = 0;
+		bool bFound = false;
+		for (GLuint pass = 0; (pass < m_passes.size()) && (bFound == false); pass++)
+		{
+			if ((m_passes[pass].bCulled == false) && (ordered[pass] == false) && (nWaiting[pass] == 0))
+			{
+				next = pass;
+				bFound = true;
+			}
+		}
+
+		if (bFound == false)
+		{
+			std::cout << "FrameGraph: the passes read each other's output and cannot be ordered" << std::endl;
+			m_order.clear();
+			return(false);
+		}
+
+		ordered[next] = true;
+		m_order.push_back(next);
+		for (GLuint pass = 0; pass < m_passes.size(); pass++)
+		{
+			if ((ordered[pass] == false) &&
+				(std::find(dependencies[pass].begin(), dependencies[pass].end(), next) != dependencies[pass].end()))
+			{
+				nWaiting[pass]--;
+			}
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CullPasses()
+ *
+ *  This method is used for keeping the passes that write
+ *  the backbuffer or have a side effect, and every pass
+ *  those depend on, and culling the rest.
+ ***********************************************************/
+void FrameGraph::CullPasses(const std::vector<std::vector<GLuint>>& dependencies)
+{
+	std::vector<GLuint> pending;
+	for (GLuint pass = 0; pass < m_passes.size(); pass++)
+	{
+		PASS& current = m_passes[pass];
+		bool bWritesBackbuffer =
+			std::find(current.writes.begin(), current.writes.end(), g_Backbuffer) != current.writes.end();
+
+		current.bCulled = true;
+		if ((bWritesBackbuffer == true) || (current.bSideEffect == true))
+		{
+			current.bCulled = false;
+			pending.push_back(pass);
+		}
+	}
+
+	while (pending.empty() == false)
+	{
+		GLuint pass = pending.back();
+		pending.pop_back();
+		for (size_t i = 0; i < dependencies[pass].size(); i++)
+		{
+			GLuint other = dependencies[pass][i];
+			if (m_passes[other].bCulled == true)
+			{
+				m_passes[other].bCulled = false;
+				pending.push_back(other);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		if (m_passes[i].bCulled == true)
+		{
+			m_stats.nCulledPasses++;
+		}
+	}
+}
+
+/***********************************************************
+ *  AliasTextures()
+ *
+ *  This method is used for giving each used transient
+ *  texture a GL texture.  In order of first use, a texture
+ *  takes over a GL texture of the same size and format
+ *  whose last user has already run, and only gets a new
+ *  one when there is none.  The texture is defined with
+ *  the pixel format and type that match its internal
+ *  format, which depth stencil and integer formats need.
+ ***********************************************************/
+void FrameGraph::AliasTextures()
+{
+	std::vector<GLuint> used;
+	for (GLuint texture = 1; texture < m_resources.size(); texture++)
+	{
+		if (m_resources[texture].firstPass >= 0)
+		{
+			used.push_back(texture);
+		}
+	}
+	std::stable_sort(used.begin(), used.end(), [this](GLuint a, GLuint b)
+		{
+			return(m_resources[a].firstPass < m_resources[b].firstPass);
+		});
+
+	for (size_t i = 0; i < used.size(); i++)
+	{
+		RESOURCE& resource = m_resources[used[i]];
+		GLsizeiptr bytes = GetTextureBytes(resource.size);
+
+		resource.allocation = -1;
+		for (size_t j = 0; (j < m_allocations.size()) && (resource.allocation < 0); j++)
+		{
+			const ALLOCATION& allocation = m_allocations[j];
+			if ((allocation.desc.width == resource.size.width) &&
+				(allocation.desc.height == resource.size.height) &&
+				(allocation.desc.format == resource.size.format) &&
+				(allocation.lastPass < resource.firstPass))
+			{
+				resource.allocation = (int)j;
+			}
+		}
+
+		if (resource.allocation < 0)
+		{
+			ALLOCATION allocation;
+			allocation.desc = resource.size;
+			allocation.texture = 0;
+			allocation.lastPass = -1;
+
+			GLenum format = GL_RED;
+			GLenum type = GL_FLOAT;
+			GetPixelFormat(resource.size.format, format, type);
+			glGenTextures(1, &allocation.texture);
+			glBindTexture(GL_TEXTURE_2D, allocation.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, resource.size.format, resource.size.width, resource.size.height, 0,
+				format, type, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			m_allocations.push_back(allocation);
+			resource.allocation = (int)(m_allocations.size() - 1);
+			m_stats.allocatedBytes += bytes;
+		}
+
+		m_allocations[resource.allocation].lastPass = resource.lastPass;
+		m_stats.naiveBytes += bytes;
+	}
+
+	m_stats.nTextures = (GLuint)used.size();
+	m_stats.nAllocated = (GLuint)m_allocations.size();
+}
+
+/***********************************************************
+ *  CreateFramebuffers()
+ *
+ *  This method is used for creating a framebuffer for each
+ *  kept pass that writes transient textures, with the
+ *  color textures attached in the declared order and the
+ *  depth texture as the depth attachment.
+ ***********************************************************/
+bool FrameGraph::CreateFramebuffers()
+{
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		PASS& pass = m_passes[m_order[i]];
+		pass.framebuffer = 0;
+		pass.width = m_backbufferWidth;
+		pass.height = m_backbufferHeight;
+
+		bool bWritesBackbuffer =
+			std::find(pass.writes.begin(), pass.writes.end(), g_Backbuffer) != pass.writes.end();
+		if ((pass.writes.empty() == true) || (bWritesBackbuffer == true))
+		{
+			if ((bWritesBackbuffer == true) && (pass.writes.size() > 1))
+			{
+				std::cout << "FrameGraph: pass " << pass.name << " writes the backbuffer and textures" << std::endl;
+				return(false);
+			}
+			continue;
+		}
+
+		GLenum colorAttachments[g_MaxColorAttachments];
+		GLuint nColor = 0;
+		glGenFramebuffers(1, &pass.framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		for (size_t j = 0; j < pass.writes.size(); j++)
+		{
+			const RESOURCE& resource = m_resources[pass.writes[j]];
+			GLuint texture = m_allocations[resource.allocation].texture;
+			pass.width = resource.size.width;
+			pass.height = resource.size.height;
+
+			if (IsDepthFormat(resource.size.format) == true)
+			{
+				GLenum attachment = (IsStencilFormat(resource.size.format) == true) ?
+					GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			}
+			else if (nColor < g_MaxColorAttachments)
+			{
+				colorAttachments[nColor] = GL_COLOR_ATTACHMENT0 + nColor;
+				glFramebufferTexture2D(GL_FRAMEBUFFER, colorAttachments[nColor], GL_TEXTURE_2D, texture, 0);
+				nColor++;
+			}
+		}
+
+		// a single color attachment is the default draw buffer
+		if (nColor == 0)
+		{
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else if (nColor > 1)
+		{
+			glDrawBuffers(nColor, colorAttachments);
+		}
+
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		if (status != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "FrameGraph: framebuffer of pass " << pass.name << " is not complete, status " << status << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FreeGLObjects()
+ *
+ *  This method is used for freeing the framebuffers and
+ *  textures of the last compile.
+ ***********************************************************/
+void FrameGraph::FreeGLObjects()
+{
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		if (m_passes[i].framebuffer != 0)
+		{
+			glDeleteFramebuffers(1, &m_passes[i].framebuffer);
+			m_passes[i].framebuffer = 0;
+		}
+	}
+	for (size_t i = 0; i < m_allocations.size(); i++)
+	{
+		glDeleteTextures(1, &m_allocations[i].texture);
+	}
+	m_allocations.clear();
+
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].allocation = -1;
+		m_resources[i].firstPass = -1;
+		m_resources[i].lastPass = -1;
+	}
+}
+
+/***********************************************************
+ *  IsDepthFormat()
+ *
+ *  This method is used for checking whether a format is
+ *  attached as depth.
+ ***********************************************************/
+bool FrameGraph::IsDepthFormat(GLenum format)
+{
+	switch (format)
+	{
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH32F_STENCIL8:
+		return(true);
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  IsStencilFormat()
+ *
+ *  This method is used for checking whether a depth format
+ *  also has stencil, so it is attached as depth stencil.
+ ***********************************************************/
+bool FrameGraph::IsStencilFormat(GLenum format)
+{
+	return((format == GL_DEPTH24_STENCIL8) || (format == GL_DEPTH32F_STENCIL8));
+}
+
+/***********************************************************
+ *  GetPixelFormat()
+ *
+ *  This method is used for picking the pixel format and
+ *  type passed to glTexImage2D with a sized internal
+ *  format.  No pixels are uploaded, but GL still rejects
+ *  combinations that do not match, such as a float type
+ *  for a depth stencil or an integer format.
+ ***********************************************************/
+void FrameGraph::GetPixelFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+	switch (internalFormat)
+	{
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32:
+		format = GL_DEPTH_COMPONENT;
+		type = GL_UNSIGNED_INT;
+		break;
+	case GL_DEPTH_COMPONENT32F:
+		format = GL_DEPTH_COMPONENT;
+		type = GL_FLOAT;
+		break;
+	case GL_DEPTH24_STENCIL8:
+		format = GL_DEPTH_STENCIL;
+		type = GL_UNSIGNED_INT_24_8;
+		break;
+	case GL_DEPTH32F_STENCIL8:
+		format = GL_DEPTH_STENCIL;
+		type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+		break;
+	case GL_R8I:
+	case GL_R16I:
+	case GL_R32I:
+		format = GL_RED_INTEGER;
+		type = GL_INT;
+		break;
+	case GL_R8UI:
+	case GL_R16UI:
+	case GL_R32UI:
+		format = GL_RED_INTEGER;
+		type = GL_UNSIGNED_INT;
+		break;
+	case GL_RG8I:
+	case GL_RG16I:
+	case GL_RG32I:
+		format = GL_RG_INTEGER;
+		type = GL_INT;
+		break;
+	case GL_RG8UI:
+	case GL_RG16UI:
+	case GL_RG32UI:
+		format = GL_RG_INTEGER;
+		type = GL_UNSIGNED_INT;
+		break;
+	case GL_RGBA8I:
+	case GL_RGBA16I:
+	case GL_RGBA32I:
+		format = GL_RGBA_INTEGER;
+		type = GL_INT;
+		break;
+	case GL_RGBA8UI:
+	case GL_RGBA16UI:
+	case GL_RGBA32UI:
+	case GL_RGB10_A2UI:
+		format = GL_RGBA_INTEGER;
+		type = GL_UNSIGNED_INT;
+		break;
+	case GL_R8:
+	case GL_R16F:
+	case GL_R32F:
+		format = GL_RED;
+		type = GL_FLOAT;
+		break;
+	case GL_RG8:
+	case GL_RG16F:
+	case GL_RG32F:
+		format = GL_RG;
+		type = GL_FLOAT;
+		break;
+	case GL_RGB8:
+	case GL_RGB16F:
+	case GL_RGB32F:
+	case GL_R11F_G11F_B10F:
+	case GL_SRGB8:
+		format = GL_RGB;
+		type = GL_FLOAT;
+		break;
+	default:
+		format = GL_RGBA;
+		type = GL_FLOAT;
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method is used for estimating the memory of a
+ *  texture from its format, with the 24 bit depth formats
+ *  padded to 32 bits as drivers store them.
+ ***********************************************************/
+GLsizeiptr FrameGraph::GetTextureBytes(const TEXTURE_DESC& desc)
+{
+	GLsizeiptr bytesPerPixel = 4;
+	switch (desc.format)
+	{
+	case GL_R8:
+	case GL_R8I:
+	case GL_R8UI:
+		bytesPerPixel = 1;
+		break;
+	case GL_RG8:
+	case GL_RG8I:
+	case GL_RG8UI:
+	case GL_R16F:
+	case GL_R16I:
+	case GL_R16UI:
+	case GL_DEPTH_COMPONENT16:
+		bytesPerPixel = 2;
+		break;
+	case GL_RGBA16F:
+	case GL_RGBA16I:
+	case GL_RGBA16UI:
+	case GL_RG32F:
+	case GL_RG32I:
+	case GL_RG32UI:
+	case GL_DEPTH32F_STENCIL8:
+		bytesPerPixel = 8;
+		break;
+	case GL_RGBA32F:
+	case GL_RGBA32I:
+	case GL_RGBA32UI:
+		bytesPerPixel = 16;
+		break;
+	default:
+		bytesPerPixel = 4;
+		break;
+	}
+
+	return((GLsizeiptr)desc.width * desc.height * bytesPerPixel);
+}
@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.h
+// ============
+// the render passes of a frame with the textures they read and write, ordered
+// and culled from those declarations, with the transient targets aliased
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <ostream>
+#include <vector>
+
+/***********************************************************
+ *  FrameGraph
+ *
+ *  This class contains the passes of a frame.  Each pass
+ *  declares the textures it reads and writes, and the
+ *  graph owns the transient textures and framebuffers
+ *  instead of each pass managing its own.
+ *
+ *  Compile() works out everything from the declarations:
+ *   - a pass that only reads a texture runs after every
+ *     pass writing it, the writes to one texture run in
+ *     the order the passes were added
+ *   - passes whose output nothing uses are culled, the
+ *     output is used when it is the backbuffer, is read by
+ *     a kept pass, or the pass is marked as having a side
+ *     effect, such as a read back
+ *   - a barrier is placed before each pass reading what an
+ *     earlier pass wrote
+ *   - transient textures of the same size and format whose
+ *     lifetimes do not overlap share one GL texture
+ *
+ *  The graph is compiled once and executed every frame,
+ *  and is compiled again when its passes change.  Texture
+ *  sizes of zero follow the backbuffer, and those textures
+ *  are created again when the backbuffer size changes.
+ ***********************************************************/
+class FrameGraph
+{
+public:
+	// a transient texture of the graph
+	struct TEXTURE_DESC
+	{
+		GLsizei width;      // Zero follows the backbuffer size
+		GLsizei height;
+		GLenum format;      // Sized internal format, depth formats are depth attachments
+	};
+
+	// figures of the last compile
+	struct GRAPH_STATS
+	{
+		GLuint nPasses;           // Passes added
+		GLuint nCulledPasses;     // Passes dropped because nothing used their output
+		GLuint nTextures;         // Transient textures used by the kept passes
+		GLuint nAllocated;        // GL textures created for them
+		GLuint nBarriers;         // Barriers placed between the passes
+		GLsizeiptr naiveBytes;    // Memory with a GL texture per transient texture
+		GLsizeiptr allocatedBytes; // Memory with the aliasing
+	};
+
+	// draws one pass, the framebuffer of the pass is bound
+	typedef std::function<void()> PASS_FUNCTION;
+
+	// constructor
+	FrameGraph();
+	// destructor
+	~FrameGraph();
+
+	// set the size of the default framebuffer, a compiled
+	// graph creates its textures again when it changes
+	void SetBackbufferSize(GLsizei width, GLsizei height);
+	void GetBackbufferSize(GLsizei& width, GLsizei& height) const { width = m_backbufferWidth; height = m_backbufferHeight; }
+	// the handle of the default framebuffer
+	GLuint GetBackbuffer() const { return(0); }
+
+	// add a transient texture, returns its handle
+	GLuint CreateTexture(const char* name, const TEXTURE_DESC& desc);
+	// add a pass, returns its handle
+	GLuint AddPass(const char* name, PASS_FUNCTION execute);
+	// declare the textures a pass samples
+	void ReadTexture(GLuint pass, GLuint texture);
+	// declare the textures a pass draws into, which become
+	// its framebuffer attachments in the declared order
+	void WriteTexture(GLuint pass, GLuint texture);
+	// keep a pass even when nothing reads its output
+	void SetSideEffect(GLuint pass);
+
+	// order and cull the passes and create the textures and
+	// framebuffers, false when the passes cannot be ordered
+	// or a framebuffer is not complete
+	bool Compile();
+	// draw the kept passes, the default framebuffer must be
+	// bound before and is bound again after
+	void Execute();
+
+	// the GL texture of a transient texture, valid after
+	// Compile()
+	GLuint GetTexture(GLuint texture) const;
+
+	void GetStats(GRAPH_STATS& stats) const { stats = m_stats; }
+	// print the pass order, the culled passes and the
+	// texture aliasing of the last compile
+	void Report(std::ostream& stream) const;
+
+	// free the GL objects and drop the passes and textures
+	void Clear();
+
+private:
+	struct RESOURCE
+	{
+		const char* name;
+		TEXTURE_DESC desc;
+		TEXTURE_DESC size;      // The desc with the backbuffer size filled in
+		int allocation;         // Index of the GL texture, -1 when unused
+		int firstPass;          // Execution order of the first and last use
+		int lastPass;
+	};
+
+	struct PASS
+	{
+		const char* name;
+		PASS_FUNCTION execute;
+		std::vector<GLuint> reads;
+		std::vector<GLuint> writes;
+		bool bSideEffect;
+		bool bCulled;
+		bool bBarrier;          // Reads what an earlier pass wrote
+		GLuint framebuffer;     // Zero for the default framebuffer
+		GLsizei width;          // Viewport of the framebuffer
+		GLsizei height;
+	};
+
+	// one GL texture, shared by the aliased transient textures
+	struct ALLOCATION
+	{
+		TEXTURE_DESC desc;
+		GLuint texture;
+		int lastPass;           // Execution order of the last use so far
+	};
+
+	// called to order the passes, false on a cycle
+	bool OrderPasses(std::vector<std::vector<GLuint>>& dependencies);
+	// called to mark the passes nothing uses
+	void CullPasses(const std::vector<std::vector<GLuint>>& dependencies);
+	// called to share GL textures between the transient
+	// textures that are never used at the same time
+	void AliasTextures();
+	// called to create the framebuffer of each kept pass
+	bool CreateFramebuffers();
+	// called to free the GL objects of the last compile
+	void FreeGLObjects();
+
+	static bool IsDepthFormat(GLenum format);
+	static bool IsStencilFormat(GLenum format);
+	// the pixel format and type glTexImage2D accepts for a
+	// sized internal format
+	static void GetPixelFormat(GLenum internalFormat, GLenum& format, GLenum& type);
+	static GLsizeiptr GetTextureBytes(const TEXTURE_DESC& desc);
+
+	std::vector<RESOURCE> m_resources;  // [0] is the backbuffer
+	std::vector<PASS> m_passes;
+	std::vector<ALLOCATION> m_allocations;
+	// kept passes in execution order
+	std::vector<GLuint> m_order;
+
+	GLsizei m_backbufferWidth;
+	GLsizei m_backbufferHeight;
+	bool m_bCompiled;
+	// the next pass sets its viewport even on the backbuffer
+	bool m_bViewportChanged;
+	// the GL has barriers for image stores
+	bool m_bMemoryBarriers;
+	GRAPH_STATS m_stats;
+};
@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameTaskScheduler.cpp
+// ============
+// runs slices of prioritized background work in the time left over by each
+// frame, carrying the rest forward to the next frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTaskScheduler.h"
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// frames a task can wait before it gets a slice past
+	// the budget
+	const uint64_t g_StarvationFrames = 30;
+	// time given to the slice of a task that waited too
+	// long when the frame has less left
+	const double g_StarvedSliceMs = 1.0;
+}
+
+/***********************************************************
+ *  FrameTaskScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameTaskScheduler::FrameTaskScheduler()
+{
+	m_bRunning = false;
+	m_nextId = 1;
+	m_frame = 0;
+	ResetStats();
+}
+
+/***********************************************************
+ *  AddTask()
+ *
+ *  This method is used for queueing a task.  Tasks queued
+ *  by a running slice join the queue after the frame.
+ ***********************************************************/
+GLuint FrameTaskScheduler::AddTask(
+	const char* name,
+	TASK_PRIORITY priority,
+	TASK_FUNCTION function)
+{
+	TASK task;
+	task.id = m_nextId++;
+	task.name = name;
+	task.priority = priority;
+	task.function = function;
+	task.lastRunFrame = m_frame;
+	task.bRemoved = false;
+
+	if (m_bRunning == true)
+	{
+		m_addedTasks.push_back(task);
+	}
+	else
+	{
+		m_tasks.push_back(task);
+	}
+
+	return(task.id);
+}
+
+/***********************************************************
+ *  RemoveTask()
+ *
+ *  This method is used for dropping a task before it has
+ *  finished.  While the tasks are running it is only
+ *  marked, and dropped after the frame.
+ ***********************************************************/
+void FrameTaskScheduler::RemoveTask(GLuint id)
+{
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		if (m_tasks[i].id == id)
+		{
+			m_tasks[i].bRemoved = true;
+		}
+	}
+	for (size_t i = 0; i < m_addedTasks.size(); i++)
+	{
+		if (m_addedTasks[i].id == id)
+		{
+			m_addedTasks[i].bRemoved = true;
+		}
+	}
+
+	if (m_bRunning == false)
+	{
+		UpdateQueue();
+	}
+}
+
+/***********************************************************
+ *  IsPending()
+ *
+ *  This method is used for checking whether a task is
+ *  still queued.
+ ***********************************************************/
+bool FrameTaskScheduler::IsPending(GLuint id) const
+{
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		if ((m_tasks[i].id == id) && (m_tasks[i].bRemoved == false))
+		{
+			return(true);
+		}
+	}
+	for (size_t i = 0; i < m_addedTasks.size(); i++)
+	{
+		if ((m_addedTasks[i].id == id) && (m_addedTasks[i].bRemoved == false))
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for dropping every task.
+ ***********************************************************/
+void FrameTaskScheduler::Clear()
+{
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		m_tasks[i].bRemoved = true;
+	}
+	m_addedTasks.clear();
+
+	if (m_bRunning == false)
+	{
+		UpdateQueue();
+	}
+}
+
+/***********************************************************
+ *  RunTasks()
+ *
+ *  This method is used for running the tasks in the time
+ *  left in the frame.  The tasks that waited too long get
+ *  a slice first, whatever the budget, and are given at
+ *  least a short fixed time for it.  Then the highest
+ *  priority task runs slice after slice while there is
+ *  time left.  With no time left no other slice runs, and
+ *  the tasks do no work in a slice past their budget.  A
+ *  slice is never cut short, so the last one can run past
+ *  the budget, which the stats record.
+ ***********************************************************/
+void FrameTaskScheduler::RunTasks(double budgetMs)
+{
+	PERF_SCOPE("FrameTasks");
+
+	m_frame++;
+	m_bRunning = true;
+
+	double startMs = GetTimeMs();
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		TASK& task = m_tasks[i];
+		if ((task.bRemoved == false) && (m_frame - task.lastRunFrame > g_StarvationFrames))
+		{
+			m_stats.nStarvedSlices++;
+			double sliceMs = std::max(g_StarvedSliceMs, budgetMs - (GetTimeMs() - startMs));
+			if (RunSlice(task, sliceMs) == true)
+			{
+				task.bRemoved = true;
+			}
+		}
+	}
+
+	double usedMs = GetTimeMs() - startMs;
+	while (usedMs < budgetMs)
+	{
+		int next = FindNextTask();
+		if (next < 0)
+		{
+			break;
+		}
+
+		if (RunSlice(m_tasks[next], budgetMs - usedMs) == true)
+		{
+			m_tasks[next].bRemoved = true;
+		}
+		usedMs = GetTimeMs() - startMs;
+	}
+
+	m_bRunning = false;
+	UpdateQueue();
+
+	m_stats.usedMs += usedMs;
+	m_stats.maxOverrunMs = std::max(m_stats.maxOverrunMs, usedMs - budgetMs);
+	m_stats.maxPending = std::max(m_stats.maxPending, (GLuint)m_tasks.size());
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		m_stats.maxWaitFrames = std::max(m_stats.maxWaitFrames, (GLuint)(m_frame - m_tasks[i].lastRunFrame));
+	}
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the backlog and the
+ *  starvation figures since the last reset.
+ ***********************************************************/
+void FrameTaskScheduler::GetStats(SCHEDULER_STATS& stats) const
+{
+	stats = m_stats;
+	stats.nPending = (GLuint)(m_tasks.size() + m_addedTasks.size());
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the stats, the queued
+ *  tasks are kept.
+ ***********************************************************/
+void FrameTaskScheduler::ResetStats()
+{
+	m_stats.nPending = 0;
+	m_stats.maxPending = 0;
+	m_stats.nSlices = 0;
+	m_stats.nStarvedSlices = 0;
+	m_stats.nFinished = 0;
+	m_stats.maxWaitFrames = 0;
+	m_stats.usedMs = 0.0;
+	m_stats.maxOverrunMs = 0.0;
+}
+
+/***********************************************************
+ *  RunSlice()
+ *
+ *  This method is used for running one slice of a task.
+ ***********************************************************/
+bool FrameTaskScheduler::RunSlice(TASK& task, double budgetMs)
+{
+	bool bFinished = task.function(std::max(0.0, budgetMs));
+
+	task.lastRunFrame = m_frame;
+	m_stats.nSlices++;
+	if (bFinished == true)
+	{
+		m_stats.nFinished++;
+	}
+
+	return(bFinished);
+}
+
+/***********************************************************
+ *  FindNextTask()
+ *
+ *  This method is used for finding the task to run next,
+ *  the highest priority one, and among those the one that
+ *  has waited longest.
+ ***********************************************************/
+int FrameTaskScheduler::FindNextTask() const
+{
+	int next = -1;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		const TASK& task = m_tasks[i];
+		if (task.bRemoved == true)
+		{
+			continue;
+		}
+
+		if ((next < 0) ||
+			(task.priority < m_tasks[next].priority) ||
+			((task.priority == m_tasks[next].priority) && (task.lastRunFrame < m_tasks[next].lastRunFrame)))
+		{
+			next = (int)i;
+		}
+	}
+
+	return(next);
+}
+
+/***********************************************************
+ *  UpdateQueue()
+ *
+ *  This method is used for dropping the finished and the
+ *  removed tasks, and for queueing the tasks added while
+ *  the tasks were running.
+ ***********************************************************/
+void FrameTaskScheduler::UpdateQueue()
+{
+	size_t nKept = 0;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		if (m_tasks[i].bRemoved == false)
+		{
+			if (nKept != i)
+			{
+				m_tasks[nKept] = m_tasks[i];
+			}
+			nKept++;
+		}
+	}
+	m_tasks.resize(nKept);
+
+	for (size_t i = 0; i < m_addedTasks.size(); i++)
+	{
+		if (m_addedTasks[i].bRemoved == false)
+		{
+			m_tasks.push_back(m_addedTasks[i]);
+		}
+	}
+	m_addedTasks.clear();
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This method is used for reading the wall clock.
+ ***********************************************************/
+double FrameTaskScheduler::GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
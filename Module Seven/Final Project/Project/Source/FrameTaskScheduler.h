@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametaskscheduler.h
+// ============
+// runs slices of prioritized background work in the time left over by each
+// frame, carrying the rest forward to the next frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  FrameTaskScheduler
+ *
+ *  This class contains the queue of maintenance work that
+ *  must not land in one frame, like buffer compaction or
+ *  rebuilds of derived data.  Each task is resumable: it
+ *  is called with the milliseconds left in the frame, does
+ *  one slice of its work and returns true once it has
+ *  finished.
+ *
+ *  RunTasks() is called once per frame after the scene is
+ *  drawn.  It runs slices of the highest priority task,
+ *  the one waiting longest first among equals, until the
+ *  budget is used up, and leaves the rest for the next
+ *  frames.  A task that has waited too many frames gets
+ *  one short slice even when the frame has no time left,
+ *  so low priority work still finishes under a heavy load.
+ *  The tasks themselves keep to the time they are given,
+ *  a slice with none does no work.
+ ***********************************************************/
+class FrameTaskScheduler
+{
+public:
+	enum TASK_PRIORITY
+	{
+		PRIORITY_HIGH = 0,
+		PRIORITY_NORMAL,
+		PRIORITY_LOW,
+		MAX_PRIORITIES
+	};
+
+	// one slice of a task, gets the milliseconds left in the
+	// frame and returns true when the task has finished
+	typedef std::function<bool(double budgetMs)> TASK_FUNCTION;
+
+	// backlog and starvation figures since the last reset
+	struct SCHEDULER_STATS
+	{
+		GLuint nPending;        // Tasks not finished yet, the backlog
+		GLuint maxPending;      // Largest backlog at the end of a frame
+		GLuint nSlices;         // Slices run
+		GLuint nStarvedSlices;  // Slices run past the budget for waiting too long
+		GLuint nFinished;       // Tasks finished
+		GLuint maxWaitFrames;   // Most frames a pending task went without a slice
+		double usedMs;          // Time spent in the slices
+		double maxOverrunMs;    // Most a frame's slices ran past its budget
+	};
+
+	// constructor
+	FrameTaskScheduler();
+
+	// queue a task, returns its id, never zero
+	GLuint AddTask(
+		const char* name,
+		TASK_PRIORITY priority,
+		TASK_FUNCTION function);
+	// drop a task before it has finished
+	void RemoveTask(GLuint id);
+	// check whether a task is still queued
+	bool IsPending(GLuint id) const;
+	// drop every task
+	void Clear();
+
+	// run slices until the budget is used up
+	void RunTasks(double budgetMs);
+
+	void GetStats(SCHEDULER_STATS& stats) const;
+	void ResetStats();
+
+private:
+	struct TASK
+	{
+		GLuint id;
+		const char* name;
+		TASK_PRIORITY priority;
+		TASK_FUNCTION function;
+		uint64_t lastRunFrame;  // Frame of the last slice, or of queueing
+		bool bRemoved;          // Dropped while the tasks were running
+	};
+
+	// called to run one slice of a task, returns true when
+	// the task has finished
+	bool RunSlice(TASK& task, double budgetMs);
+	// called to find the next task to run, -1 when none
+	int FindNextTask() const;
+	// called to move the tasks queued by slices into the
+	// queue and to drop the finished and removed ones
+	void UpdateQueue();
+
+	static double GetTimeMs();
+
+	std::vector<TASK> m_tasks;
+	// tasks queued while the tasks are running
+	std::vector<TASK> m_addedTasks;
+	bool m_bRunning;
+	GLuint m_nextId;
+	uint64_t m_frame;
+
+	SCHEDULER_STATS m_stats;
+};
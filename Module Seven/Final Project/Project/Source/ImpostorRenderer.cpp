@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// ImpostorRenderer.cpp
+// ============
+// draws spheres, cylinders and cones as bounding boxes, with a fragment
+// shader that ray casts the exact curved surface inside each box
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorRenderer.h"
+#include "GLCapture.h"
+
+#include <iostream>
+
+namespace
+{
+	const char* g_ModelName = "model";
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_ShapeName = "primitiveShape";
+	const char* g_PartsName = "primitiveParts";
+	const char* g_HalfName = "bHalfSphere";
+
+	// the shapes as the impostor shader knows them
+	const int g_ShapeSphere = 0;
+	const int g_ShapeCylinder = 1;
+	const int g_ShapeCone = 2;
+
+	// vertex attribute location of the box corners
+	const GLuint g_PositionAttribute = 0;
+
+	// corners of the box around the unit primitives, the
+	// vertex shader fits the height to each shape
+	const GLfloat g_BoxVertices[] = {
+		-1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,
+		 1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,
+		 1.0f, -1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,
+		-1.0f,  1.0f,  1.0f
+	};
+
+	// faces of the box, counter-clockwise seen from outside
+	const GLushort g_BoxIndices[] = {
+		4, 5, 6,  4, 6, 7,    // +z
+		1, 0, 3,  1, 3, 2,    // -z
+		5, 1, 2,  5, 2, 6,    // +x
+		0, 4, 7,  0, 7, 3,    // -x
+		7, 6, 2,  7, 2, 3,    // +y
+		0, 1, 5,  0, 5, 4     // -y
+	};
+	const GLsizei g_BoxIndexCount = sizeof(g_BoxIndices) / sizeof(g_BoxIndices[0]);
+}
+
+/***********************************************************
+ *  ImpostorRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorRenderer::ImpostorRenderer()
+{
+	m_vao = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_pImpostorShader = NULL;
+	m_previousProgram = 0;
+	m_bPreviousCullFace = GL_FALSE;
+	m_previousCullFaceMode = GL_BACK;
+	m_nDrawCalls = 0;
+}
+
+/***********************************************************
+ *  ~ImpostorRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorRenderer::~ImpostorRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the box that every
+ *  impostor is drawn with and loading the impostor shader.
+ ***********************************************************/
+bool ImpostorRenderer::Create()
+{
+	Destroy();
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(g_BoxVertices), g_BoxVertices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(g_BoxIndices), g_BoxIndices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+	glEnableVertexAttribArray(g_PositionAttribute);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (glGetError() == GL_OUT_OF_MEMORY)
+	{
+		std::cout << "ImpostorRenderer: out of memory for the impostor box" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_pImpostorShader = new ShaderManager();
+	m_pImpostorShader->LoadShaders(
+		"../../Utilities/shaders/impostorVertexShader.glsl",
+		"../../Utilities/shaders/impostorFragmentShader.glsl");
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the GL objects and the
+ *  impostor shader.
+ ***********************************************************/
+void ImpostorRenderer::Destroy()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	if (m_vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (NULL != m_pImpostorShader)
+	{
+		delete m_pImpostorShader;
+		m_pImpostorShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  CanDraw()
+ *
+ *  This method is used for checking whether a draw is one
+ *  of the primitives the impostor shader can ray cast -
+ *  full or half spheres, cylinders and cones with any of
+ *  their parts.
+ ***********************************************************/
+bool ImpostorRenderer::CanDraw(const ShapeMeshes::MESH_DRAW& draw)
+{
+	return((draw.mesh == ShapeMeshes::MESH_SPHERE) ||
+		(draw.mesh == ShapeMeshes::MESH_CYLINDER) ||
+		(draw.mesh == ShapeMeshes::MESH_CONE));
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for making the impostor program the
+ *  current one and sending it the camera.  The previous
+ *  program and face culling are saved for End().
+ ***********************************************************/
+void ImpostorRenderer::Begin(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	glGetIntegerv(GL_CURRENT_PROGRAM, &m_previousProgram);
+	m_bPreviousCullFace = glIsEnabled(GL_CULL_FACE);
+	glGetIntegerv(GL_CULL_FACE_MODE, &m_previousCullFaceMode);
+
+	if (NULL == m_pImpostorShader)
+	{
+		return;
+	}
+
+	m_pImpostorShader->use();
+	m_pImpostorShader->setMat4Value(g_ViewName, view);
+	m_pImpostorShader->setMat4Value(g_ProjectionName, projection);
+	m_pImpostorShader->setVec3Value(g_ViewPositionName, cameraPosition);
+
+	// the rays are cast from the back faces of the boxes
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+	glBindVertexArray(m_vao);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing one primitive as its
+ *  bounding box, the shader finds the surface inside.
+ ***********************************************************/
+void ImpostorRenderer::Draw(const ShapeMeshes::MESH_DRAW& draw, const glm::mat4& model)
+{
+	if ((NULL == m_pImpostorShader) || (CanDraw(draw) == false))
+	{
+		return;
+	}
+
+	int shape = g_ShapeSphere;
+	if (draw.mesh == ShapeMeshes::MESH_CYLINDER)
+	{
+		shape = g_ShapeCylinder;
+	}
+	else if (draw.mesh == ShapeMeshes::MESH_CONE)
+	{
+		shape = g_ShapeCone;
+	}
+
+	m_pImpostorShader->setMat4Value(g_ModelName, model);
+	m_pImpostorShader->setIntValue(g_ShapeName, shape);
+	m_pImpostorShader->setIntValue(g_PartsName, (int)draw.partMask);
+	m_pImpostorShader->setBoolValue(g_HalfName, draw.bHalf);
+
+	// a mirroring transform turns the box inside out
+	glCullFace((glm::determinant(glm::mat3(model)) < 0.0f) ? GL_BACK : GL_FRONT);
+
+	glDrawElements(GL_TRIANGLES, g_BoxIndexCount, GL_UNSIGNED_SHORT, (void*)0);
+	m_nDrawCalls++;
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for restoring the program and the
+ *  face culling saved by Begin().
+ ***********************************************************/
+void ImpostorRenderer::End()
+{
+	glBindVertexArray(0);
+
+	glCullFace((GLenum)m_previousCullFaceMode);
+	if (m_bPreviousCullFace == GL_FALSE)
+	{
+		glDisable(GL_CULL_FACE);
+	}
+
+	glUseProgram(m_previousProgram);
+}
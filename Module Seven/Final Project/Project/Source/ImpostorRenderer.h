@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrenderer.h
+// ============
+// draws spheres, cylinders and cones as bounding boxes, with a fragment
+// shader that ray casts the exact curved surface inside each box
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShapeMeshes.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ImpostorRenderer
+ *
+ *  This class contains the code for drawing the analytic
+ *  primitives as impostors.  Each sphere, cylinder or cone
+ *  is drawn as the 8 corners of its bounding box instead of
+ *  its hundreds of triangles.  The fragment shader casts
+ *  the view ray through the box in object space, hits the
+ *  exact surface of the primitive, writes the depth of the
+ *  hit and lights it with the scene lights.  The curved
+ *  silhouettes are exact at every distance.
+ *
+ *  Only the back faces of the boxes are drawn, so the
+ *  impostors still work with the camera inside a box, and
+ *  each pixel of a box is shaded once.
+ *
+ *  Between Begin() and End() the impostor program is the
+ *  current one, the caller sends the surface settings of
+ *  each object through GetShaderManager() before Draw().
+ ***********************************************************/
+class ImpostorRenderer
+{
+public:
+	// constructor
+	ImpostorRenderer();
+	// destructor
+	~ImpostorRenderer();
+
+	// create the box geometry and load the impostor shader
+	bool Create();
+	// free the GL objects and the shader
+	void Destroy();
+	bool IsCreated() const { return(m_vao != 0); }
+
+	// check whether the passed in draw has an impostor
+	static bool CanDraw(const ShapeMeshes::MESH_DRAW& draw);
+
+	// start drawing impostors from the passed in camera,
+	// the current program is saved
+	void Begin(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// draw one primitive with the passed in transform
+	void Draw(const ShapeMeshes::MESH_DRAW& draw, const glm::mat4& model);
+	// stop drawing impostors, the saved program and the
+	// face culling are restored
+	void End();
+
+	// the impostor shader, for the surface settings
+	ShaderManager* GetShaderManager() { return(m_pImpostorShader); }
+
+	// impostor draw calls since the last reset
+	GLuint GetDrawCallCount() const { return(m_nDrawCalls); }
+	void ResetDrawCallCount() { m_nDrawCalls = 0; }
+
+private:
+	GLuint m_vao;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	ShaderManager* m_pImpostorShader;
+
+	// state saved by Begin() for End()
+	GLint m_previousProgram;
+	GLboolean m_bPreviousCullFace;
+	GLint m_previousCullFaceMode;
+
+	GLuint m_nDrawCalls;
+};
@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+// LightBaker.cpp
+// ============
+// offline baking of the static scene lighting and ambient occlusion into
+// per-vertex colors, traced on the CPU across all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightBaker.h"
+#include "PerfCounters.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	// identifies a baked lighting file and its layout version
+	const char g_BakeFileMagic[4] = { 'B', 'A', 'K', 'E' };
+	const uint32_t g_BakeFileVersion = 2;
+	// default rays traced per vertex for the indirect bounce
+	const unsigned int g_DefaultBounceSamples = 64;
+	// default rays traced per vertex for the ambient occlusion,
+	// and the distance in world units that still occludes
+	const unsigned int g_DefaultOcclusionSamples = 64;
+	const float g_DefaultOcclusionDistance = 1.5f;
+	// vertices handed to a worker thread at a time
+	const size_t g_VerticesPerChunk = 64;
+	// ray offset relative to the size of the scene
+	const float g_RayOffsetScale = 1.0e-4f;
+	const float g_TwoPi = 6.28318530718f;
+
+	/***********************************************************
+	 *  NextRandom()
+	 *
+	 *  Xorshift random number in [0, 1).  Each vertex seeds
+	 *  its own state, so a bake gives the same result with
+	 *  any number of threads.
+	 ***********************************************************/
+	float NextRandom(unsigned int& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return((state >> 8) * (1.0f / 16777216.0f));
+	}
+
+	/***********************************************************
+	 *  SampleCosineHemisphere()
+	 *
+	 *  Pick a direction around the normal with a density
+	 *  proportional to the cosine, so the diffuse estimate
+	 *  is a plain average of the traced rays.
+	 ***********************************************************/
+	glm::vec3 SampleCosineHemisphere(const glm::vec3& normal, unsigned int& state)
+	{
+		// orthonormal basis around the normal (Duff et al.)
+		float sign = (normal.z >= 0.0f) ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+		float phi = g_TwoPi * NextRandom(state);
+		float r2 = NextRandom(state);
+		float r = std::sqrt(r2);
+
+		return(tangent * (r * std::cos(phi)) +
+			bitangent * (r * std::sin(phi)) +
+			normal * std::sqrt(std::max(0.0f, 1.0f - r2)));
+	}
+}
+
+/***********************************************************
+ *  LightBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightBaker::LightBaker()
+{
+	m_nThreads = 0;
+	m_nBounceSamples = g_DefaultBounceSamples;
+	m_nOcclusionSamples = g_DefaultOcclusionSamples;
+	m_occlusionDistance = g_DefaultOcclusionDistance;
+	m_rayOffset = g_RayOffsetScale;
+}
+
+/***********************************************************
+ *  SetThreadCount()
+ *
+ *  This method is used for setting how many threads trace
+ *  the scene, zero uses one thread per core.
+ ***********************************************************/
+void LightBaker::SetThreadCount(unsigned int nThreads)
+{
+	m_nThreads = nThreads;
+}
+
+/***********************************************************
+ *  SetBounceSamples()
+ *
+ *  This method is used for setting the number of rays
+ *  traced per vertex for the indirect bounce.  Zero bakes
+ *  direct lighting only.
+ ***********************************************************/
+void LightBaker::SetBounceSamples(unsigned int nSamples)
+{
+	m_nBounceSamples = nSamples;
+}
+
+/***********************************************************
+ *  SetOcclusionSamples()
+ *
+ *  This method is used for setting the number of rays
+ *  traced per vertex for the ambient occlusion.  Zero
+ *  leaves every vertex fully open.
+ ***********************************************************/
+void LightBaker::SetOcclusionSamples(unsigned int nSamples)
+{
+	m_nOcclusionSamples = nSamples;
+}
+
+/***********************************************************
+ *  SetOcclusionDistance()
+ *
+ *  This method is used for setting how far away geometry
+ *  can be and still occlude a vertex.  Short distances
+ *  keep the darkening to contact areas and creases.
+ ***********************************************************/
+void LightBaker::SetOcclusionDistance(float distance)
+{
+	m_occlusionDistance = distance;
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light to the scene.
+ ***********************************************************/
+void LightBaker::AddLight(const BAKE_LIGHT& light)
+{
+	m_lights.push_back(light);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding a drawn object to the
+ *  scene.  The vertex data must stay valid until the
+ *  baking is done.
+ ***********************************************************/
+void LightBaker::AddObject(const BAKE_OBJECT& object)
+{
+	m_objects.push_back(object);
+}
+
+/***********************************************************
+ *  GetObjectLighting()
+ *
+ *  This method is used for getting the baked lighting of
+ *  an object, in the order the objects were added.
+ ***********************************************************/
+const std::vector<glm::vec4>& LightBaker::GetObjectLighting(size_t object) const
+{
+	return(m_objectLighting[object]);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for tracing the lighting of every
+ *  vertex used by the object triangles.  Vertices that no
+ *  drawn triangle uses are left white.
+ ***********************************************************/
+bool LightBaker::Bake()
+{
+	PERF_SCOPE("LightBake");
+
+	struct BAKE_VERTEX
+	{
+		GLuint object;
+		GLuint vertex;
+	};
+	std::vector<BAKE_VERTEX> jobs;
+
+	if (m_objects.empty() == true)
+	{
+		std::cout << "LightBaker: no objects to bake" << std::endl;
+		return(false);
+	}
+
+	BuildScene();
+
+	// list the vertices that are drawn by each object
+	m_objectLighting.resize(m_objects.size());
+	for (GLuint i = 0; i < m_objects.size(); i++)
+	{
+		const BAKE_OBJECT& object = m_objects[i];
+		std::vector<bool> bUsed(object.nVertices, false);
+
+		m_objectLighting[i].assign(object.nVertices, glm::vec4(1.0f));
+		for (size_t t = 0; t < object.triangles.size(); t++)
+		{
+			if ((object.triangles[t] < object.nVertices) && (bUsed[object.triangles[t]] == false))
+			{
+				bUsed[object.triangles[t]] = true;
+				BAKE_VERTEX job;
+				job.object = i;
+				job.vertex = object.triangles[t];
+				jobs.push_back(job);
+			}
+		}
+	}
+
+	std::cout << "LightBaker: baking " << jobs.size() << " vertices, "
+		<< m_sceneBVH.GetTriangleCount() << " triangles, "
+		<< m_lights.size() << " lights" << std::endl;
+
+	ParallelFor(jobs.size(), m_nThreads, g_VerticesPerChunk, [&](size_t begin, size_t end)
+	{
+		// counted on each worker thread, LightBake only covers
+		// the calling thread
+		PERF_SCOPE("LightBakeChunk");
+
+		for (size_t j = begin; j < end; j++)
+		{
+			const BAKE_OBJECT& object = m_objects[jobs[j].object];
+			const GLfloat* vertex = object.vertexData + jobs[j].vertex * object.floatsPerVertex;
+
+			// move the vertex into world space - normals use the
+			// inverse transpose so non-uniform scales stay correct
+			glm::vec4 position = object.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));
+			glm::vec3 normal = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+			float length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				normal /= length;
+			}
+
+			glm::vec3 worldPosition(position.x, position.y, position.z);
+			unsigned int randomState = (jobs[j].object * 0x9E3779B9u) ^ (jobs[j].vertex * 0x85EBCA6Bu) ^ 0x27D4EB2Fu;
+			if (randomState == 0)
+			{
+				randomState = 1;
+			}
+
+			// the ambient light is left to the shader, with the
+			// material and the specular light
+			glm::vec3 light = CalculateDirectLight(worldPosition, normal);
+			float occlusion = 1.0f;
+			if (length > 0.0f)
+			{
+				light += CalculateBounceLight(worldPosition, normal, randomState);
+				occlusion = CalculateOcclusion(worldPosition, normal, randomState);
+			}
+
+			m_objectLighting[jobs[j].object][jobs[j].vertex] = glm::vec4(light, occlusion);
+		}
+	});
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for transforming the triangles of
+ *  every object into world space and building the tree
+ *  that the rays are traced against.
+ ***********************************************************/
+void LightBaker::BuildScene()
+{
+	std::vector<glm::vec3> vertices;
+
+	m_triangleAlbedo.clear();
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		const BAKE_OBJECT& object = m_objects[i];
+
+		for (size_t t = 0; t + 2 < object.triangles.size(); t += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const GLfloat* vertex = object.vertexData + object.triangles[t + corner] * object.floatsPerVertex;
+				glm::vec4 position = object.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+				vertices.push_back(glm::vec3(position.x, position.y, position.z));
+			}
+			m_triangleAlbedo.push_back(object.albedo);
+		}
+	}
+
+	m_sceneBVH.Build(vertices);
+
+	// offset the rays relative to the scene size, so they do
+	// not hit the surface they start on
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	m_sceneBVH.GetBounds(boundsMin, boundsMax);
+	m_rayOffset = std::max(g_RayOffsetScale, glm::length(boundsMax - boundsMin) * g_RayOffsetScale);
+}
+
+/***********************************************************
+ *  CalculateDirectLight()
+ *
+ *  This method is used for adding up the diffuse light from
+ *  each light source at a surface point.  The light is
+ *  only counted when it is not blocked.
+ ***********************************************************/
+glm::vec3 LightBaker::CalculateDirectLight(
+	const glm::vec3& position,
+	const glm::vec3& normal) const
+{
+	glm::vec3 light(0.0f);
+	glm::vec3 origin = position + normal * m_rayOffset;
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		const BAKE_LIGHT& source = m_lights[i];
+
+		if (glm::dot(source.diffuseColor, source.diffuseColor) <= 0.0f)
+		{
+			continue;
+		}
+
+		glm::vec3 toLight = source.position - origin;
+		float distance = glm::length(toLight);
+		if (distance <= 0.0f)
+		{
+			continue;
+		}
+		toLight /= distance;
+
+		float cosine = glm::dot(normal, toLight);
+		if (cosine <= 0.0f)
+		{
+			continue;
+		}
+
+		if (m_sceneBVH.IsOccluded(origin, toLight, distance) == false)
+		{
+			light += source.diffuseColor * cosine;
+		}
+	}
+
+	return(light);
+}
+
+/***********************************************************
+ *  CalculateBounceLight()
+ *
+ *  This method is used for tracing cosine weighted rays
+ *  into the scene and averaging the direct light that the
+ *  surfaces they hit reflect back.
+ ***********************************************************/
+glm::vec3 LightBaker::CalculateBounceLight(
+	const glm::vec3& position,
+	const glm::vec3& normal,
+	unsigned int& randomState) const
+{
+	glm::vec3 light(0.0f);
+	glm::vec3 origin = position + normal * m_rayOffset;
+
+	if (m_nBounceSamples == 0)
+	{
+		return(light);
+	}
+
+	for (unsigned int i = 0; i < m_nBounceSamples; i++)
+	{
+		glm::vec3 direction = SampleCosineHemisphere(normal, randomState);
+		SceneBVH::RAY_HIT hit;
+
+		if (m_sceneBVH.Intersect(origin, direction, 1.0e30f, hit) == false)
+		{
+			continue;
+		}
+
+		// light the side of the hit triangle facing the ray
+		glm::vec3 hitNormal = m_sceneBVH.GetTriangleNormal(hit.triangle);
+		if (glm::dot(hitNormal, direction) > 0.0f)
+		{
+			hitNormal = -hitNormal;
+		}
+
+		glm::vec3 hitPosition = origin + direction * hit.distance;
+		light += m_triangleAlbedo[hit.triangle] * CalculateDirectLight(hitPosition, hitNormal);
+	}
+
+	return(light / (float)m_nBounceSamples);
+}
+
+/***********************************************************
+ *  CalculateOcclusion()
+ *
+ *  This method is used for tracing short cosine weighted
+ *  rays from a vertex.  The rays that escape give the
+ *  open fraction of the hemisphere, weighted the way
+ *  diffuse light from it would be.
+ ***********************************************************/
+float LightBaker::CalculateOcclusion(
+	const glm::vec3& position,
+	const glm::vec3& normal,
+	unsigned int& randomState) const
+{
+	glm::vec3 origin = position + normal * m_rayOffset;
+	unsigned int nOpen = 0;
+
+	if (m_nOcclusionSamples == 0)
+	{
+		return(1.0f);
+	}
+
+	for (unsigned int i = 0; i < m_nOcclusionSamples; i++)
+	{
+		glm::vec3 direction = SampleCosineHemisphere(normal, randomState);
+
+		if (m_sceneBVH.IsOccluded(origin, direction, m_occlusionDistance) == false)
+		{
+			nOpen++;
+		}
+	}
+
+	return((float)nOpen / (float)m_nOcclusionSamples);
+}
+
+/***********************************************************
+ *  SaveBakedLighting()
+ *
+ *  This method is used for writing the baked lighting to
+ *  a binary file - the object count, then the vertex count
+ *  and the values of each object.
+ ***********************************************************/
+bool LightBaker::SaveBakedLighting(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		std::cout << "LightBaker: could not write " << filename << std::endl;
+		return(false);
+	}
+
+	uint32_t nObjects = (uint32_t)m_objectLighting.size();
+	file.write(g_BakeFileMagic, sizeof(g_BakeFileMagic));
+	file.write((const char*)&g_BakeFileVersion, sizeof(g_BakeFileVersion));
+	file.write((const char*)&nObjects, sizeof(nObjects));
+
+	for (size_t i = 0; i < m_objectLighting.size(); i++)
+	{
+		uint32_t nVertices = (uint32_t)m_objectLighting[i].size();
+		file.write((const char*)&nVertices, sizeof(nVertices));
+		file.write((const char*)m_objectLighting[i].data(), sizeof(glm::vec4) * nVertices);
+	}
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  LoadBakedLighting()
+ *
+ *  This method is used for reading lighting baked earlier.
+ *  The file must match the added objects, otherwise the
+ *  scene has changed and it has to be baked again.
+ ***********************************************************/
+bool LightBaker::LoadBakedLighting(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	char magic[sizeof(g_BakeFileMagic)];
+	uint32_t version = 0;
+	uint32_t nObjects = 0;
+
+	if (file.is_open() == false)
+	{
+		std::cout << "LightBaker: could not read " << filename << std::endl;
+		return(false);
+	}
+
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&nObjects, sizeof(nObjects));
+	if ((file.good() == false) ||
+		(memcmp(magic, g_BakeFileMagic, sizeof(magic)) != 0) ||
+		(version != g_BakeFileVersion))
+	{
+		std::cout << "LightBaker: " << filename << " is not a baked lighting file" << std::endl;
+		return(false);
+	}
+
+	if (nObjects != m_objects.size())
+	{
+		std::cout << "LightBaker: " << filename << " was baked for a different scene, bake it again" << std::endl;
+		return(false);
+	}
+
+	std::vector<std::vector<glm::vec4>> objectLighting(nObjects);
+	for (uint32_t i = 0; i < nObjects; i++)
+	{
+		uint32_t nVertices = 0;
+		file.read((char*)&nVertices, sizeof(nVertices));
+		if ((file.good() == false) || (nVertices != m_objects[i].nVertices))
+		{
+			std::cout << "LightBaker: " << filename << " was baked for a different scene, bake it again" << std::endl;
+			return(false);
+		}
+
+		objectLighting[i].resize(nVertices);
+		file.read((char*)objectLighting[i].data(), sizeof(glm::vec4) * nVertices);
+	}
+
+	if (file.good() == false)
+	{
+		std::cout << "LightBaker: " << filename << " is truncated" << std::endl;
+		return(false);
+	}
+
+	m_objectLighting.swap(objectLighting);
+
+	return(true);
+}
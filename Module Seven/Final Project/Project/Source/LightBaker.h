@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightbaker.h
+// ============
+// offline baking of the static scene lighting and ambient occlusion into
+// per-vertex colors, traced on the CPU across all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneBVH.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightBaker
+ *
+ *  This class contains the code for baking the lighting of
+ *  a static scene.  Every vertex of every object receives
+ *  the direct diffuse light with shadow rays and one
+ *  bounce of indirect diffuse light, along with how much
+ *  of its hemisphere is open (ambient occlusion).  Only the
+ *  light arriving at the surface is baked - the material,
+ *  the ambient light and the view dependent specular light
+ *  are applied when drawing.  The results can be saved and
+ *  loaded, so the baking only has to be done when the
+ *  scene changes.
+ ***********************************************************/
+class LightBaker
+{
+public:
+	// a static point light
+	struct BAKE_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 diffuseColor;
+	};
+
+	// one drawn object - the vertex data is interleaved with
+	// the position first and the normal after it, and the
+	// triangles index into it
+	struct BAKE_OBJECT
+	{
+		const GLfloat* vertexData;
+		GLuint floatsPerVertex;
+		GLuint nVertices;
+		std::vector<GLuint> triangles;
+		glm::mat4 model;
+		glm::vec3 albedo;   // Diffuse color used for the bounce
+	};
+
+	// constructor
+	LightBaker();
+
+	// set the number of worker threads, zero uses one per core
+	void SetThreadCount(unsigned int nThreads);
+
+	// set the number of rays traced per vertex for the
+	// indirect bounce
+	void SetBounceSamples(unsigned int nSamples);
+
+	// set the number of rays traced per vertex for the
+	// ambient occlusion, and how far away geometry still
+	// occludes - zero samples leaves every vertex open
+	void SetOcclusionSamples(unsigned int nSamples);
+	void SetOcclusionDistance(float distance);
+
+	// add the lights and objects of the scene to be baked
+	void AddLight(const BAKE_LIGHT& light);
+	void AddObject(const BAKE_OBJECT& object);
+
+	// trace the lighting for every vertex of every object
+	bool Bake();
+
+	// the baked lighting of one object, one value for each
+	// vertex with the diffuse light in rgb and the fraction
+	// of the hemisphere that is not occluded in alpha
+	const std::vector<glm::vec4>& GetObjectLighting(size_t object) const;
+	size_t GetObjectCount() const { return(m_objects.size()); }
+
+	// save the baked lighting, or load lighting baked earlier
+	// for the same objects
+	bool SaveBakedLighting(const char* filename) const;
+	bool LoadBakedLighting(const char* filename);
+
+private:
+	// number of worker threads
+	unsigned int m_nThreads;
+	// number of rays per vertex for the indirect bounce
+	unsigned int m_nBounceSamples;
+	// number of rays per vertex for the ambient occlusion
+	unsigned int m_nOcclusionSamples;
+	// occluders further away than this are ignored
+	float m_occlusionDistance;
+
+	std::vector<BAKE_LIGHT> m_lights;
+	std::vector<BAKE_OBJECT> m_objects;
+	std::vector<std::vector<glm::vec4>> m_objectLighting;
+
+	// the scene in world space, with the albedo of each
+	// triangle for the bounce
+	SceneBVH m_sceneBVH;
+	std::vector<glm::vec3> m_triangleAlbedo;
+	// distance rays start off the surface
+	float m_rayOffset;
+
+	// build the world space scene used for tracing
+	void BuildScene();
+
+	// diffuse light arriving directly from the lights,
+	// with shadows
+	glm::vec3 CalculateDirectLight(
+		const glm::vec3& position,
+		const glm::vec3& normal) const;
+
+	// light arriving after one bounce off the scene
+	glm::vec3 CalculateBounceLight(
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		unsigned int& randomState) const;
+
+	// fraction of the occlusion rays that escape without
+	// hitting anything
+	float CalculateOcclusion(
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		unsigned int& randomState) const;
+};
@@ -1,5 +1,6 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +14,25 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "FrameGraph.h"
+#include "OverdrawView.h"
+#include "VulkanRenderer.h"
+#include "PerfCounters.h"
+#include "GLCapture.h"
+#include "StressBenchmark.h"
+#include "RenderService.h"
+#include "ThumbnailRenderer.h"
+#include "SharedFrameRing.h"
+#include "ResourceCache.h"
+#include "FrameBudgets.h"
+#include "TripleBuffer.h"
+#include "FrameTaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
 
 // Namespace for declaring global variables
 namespace
@@ -29,12 +49,129 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// background work run in the time left over by each
+	// frame
+	FrameTaskScheduler* g_TaskScheduler = NULL;
+	GLuint g_CompactionTask = 0;
+	// mesh frees the last queued compaction covers
+	uint64_t g_CompactedFrees = 0;
+	// ranges filling the first block of the shared vertex
+	// and index buffers, and the start of the second, while
+	// the compaction check loads the scene
+	std::vector<GLuint> g_MeshBlockFillers[2];
+	std::vector<GLuint> g_MeshLeadFillers[2];
+
+	// overdraw counting and heatmap, only created in the
+	// overdraw debug mode
+	OverdrawView* g_OverdrawView = nullptr;
+	// render passes of the frame
+	FrameGraph* g_FrameGraph = nullptr;
+	// shared memory the frames are written into for local
+	// consumers, only created when asked for
+	SharedFrameRing* g_FrameRing = nullptr;
+
+	// file holding the baked static lighting of the scene
+	const char* const BAKED_LIGHTING_FILE = "SceneLighting.bake";
+#ifdef USE_VULKAN_BACKEND
+	// pipeline cache of the Vulkan backend, kept between runs
+	const char* const VULKAN_PIPELINE_CACHE_FILE = "VulkanPipeline.cache";
+#endif
+	// checked in per-frame budgets of the scene
+	const char* const FRAME_BUDGETS_FILE = "../../Utilities/budgets/frame_budgets.txt";
+	// mesh data moved per step of the compaction task to
+	// keep the shared mesh buffers packed, the steps are
+	// repeated until the slice has used its time
+	const GLsizeiptr MESH_COMPACT_STEP_BYTES = 32 * 1024;
+	// size of the ranges the compaction check fills the
+	// shared mesh buffers with, and how many go in front of
+	// the scene meshes
+	const GLsizeiptr MESH_FILLER_BYTES = 64 * 1024;
+	const GLuint MESH_LEAD_FILLERS = 4;
+
+	// command line options
+	bool g_bBakeLighting = false;		// --bake-lighting: bake the lighting and exit
+	bool g_bBakedLighting = false;		// --baked-lighting: render with the baked lighting
+	bool g_bOverdraw = false;			// --overdraw: show the overdraw heatmap
+	bool g_bOverdrawCapture = false;	// --overdraw-capture: save the heatmap of each camera pose and exit
+	bool g_bOverdrawHidden = false;		// --overdraw-hidden: count every rasterized fragment, not only the ones passing the depth test
+	float g_OverdrawScale = 0.0f;		// --overdraw-scale N: overdraw shown as the hottest heatmap color, zero keeps the default
+	bool g_bPerfCounters = false;		// --perf-counters: profile the hot paths and print the table on exit
+	bool g_bGLCapture = false;			// --gl-capture: hook GL so F12 saves the GL calls of the next frame
+	int g_GLCaptureFrame = -1;			// --gl-capture-frame N: save the GL calls of frame N
+	double g_GLCaptureSlowMs = 0.0;		// --gl-capture-slow-ms MS: save the frame after the first one slower than MS
+	bool g_bStressBenchmark = false;	// --stress-benchmark: sweep generated scenes, print the table and exit
+	int g_StressMaxObjects = 0;			// --stress-max-objects N: leave the larger scenes out of the sweep
+	bool g_bStressHLOD = false;			// --stress-hlod: draw the far clusters of the stress scenes as HLOD proxies
+	bool g_bCheckBudgets = false;		// --check-budgets: check the frame budgets and exit, failing when over
+	bool g_bRecordBudgets = false;		// --record-budgets: write the measured frames as the new budgets and exit
+	bool g_bCheckCompaction = false;	// --check-compaction: fragment the shared mesh buffers, compact them, check the scene draws the same and exit
+	int g_BenchmarkFrames = 0;			// --benchmark-frames N: profile N frames along the camera path and exit
+	bool g_bSpinPlatter = false;		// --spin-platter: spin the turntable platter, drawn from the captured objects
+	bool g_bImpostors = false;			// --impostors: ray cast the spheres, cylinders and cones in their bounding boxes
+	bool g_bLateLatch = false;			// --late-latch: sample the camera again just before the draws, only read by the --baked-lighting shaders
+	bool g_bInputLatency = false;		// --input-latency: report the time from mouse input to the submitted frame
+	bool g_bRenderThread = false;		// --render-thread: render on a thread of its own, fed input snapshots by the event thread
+	double g_FrameTargetMs = 1000.0 / 60.0;	// --frame-target-ms MS: frame time the background tasks fit into
+	bool g_bTaskStats = false;			// --task-stats: report the background task backlog once a second
+	bool g_bFrameGraphReport = false;	// --frame-graph-report: print the pass order and texture aliasing of the frame graph
+	const char* g_RenderServiceSocket = NULL;	// --render-service PATH: serve renders to other processes on the Unix socket PATH until stopped
+	double g_RenderServiceWindowMs = 2.0;	// --render-service-window-ms MS: time the oldest request waits for compatible ones
+	int g_RenderServiceBatch = 16;		// --render-service-batch N: most requests drawn in one pass
+	int g_Thumbnails = 0;				// --thumbnails N: draw N thumbnails of scene variants on worker threads and exit
+	int g_ThumbnailWorkers = 0;			// --thumbnail-workers N: draw the thumbnails on N threads, zero uses every core
+	int g_ThumbnailSize = 128;			// --thumbnail-size N: width and height of each thumbnail
+	const char* g_ThumbnailDir = NULL;	// --thumbnail-dir DIR: save each thumbnail to DIR
+	bool g_bThumbnailScaling = false;	// --thumbnail-scaling: draw the batch again on 1, 2, 4... workers and report the speedup
+	const char* g_FrameRingName = NULL;	// --frame-ring NAME: write each frame into the shared memory ring NAME, starting with /, for local consumers
+	int g_FrameRingSlots = 4;			// --frame-ring-slots N: frames the ring holds before the oldest is overwritten
+	int g_CacheBudgetMB = -1;			// --cache-budget-mb N: keep up to N MB of textures and meshes no scene holds, for the next scene
+	int g_SceneReloads = 0;				// --scene-reloads N: close and open the scene N times, report the load times and exit
+#ifdef USE_VULKAN_BACKEND
+	int g_VulkanFrames = 0;				// --vulkan-frames N: draw N frames along the camera path with the Vulkan backend, save each pose and exit
+	int g_VulkanWorkers = 0;			// --vulkan-workers N: record the Vulkan draws on N threads, zero uses every core
+	bool g_bVulkanValidation = false;	// --vulkan-validation: enable the Vulkan validation layer when installed
+#endif
+
+	// timing of the interactive frame loop
+	int g_FrameIndex = 0;
+	double g_LastFrameTime = 0.0;
+	double g_LastStatsTime = 0.0;
+	double g_LastLatencyTime = 0.0;
+	double g_LastTaskStatsTime = 0.0;
+	double g_LastFrameRingTime = 0.0;
+	// longest wait for window events on the event thread
+	const double INPUT_WAIT_SECONDS = 0.002;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ParseCommandLine(int argc, char* argv[]);
+bool BuildFrameGraph();
+void RenderFrame(bool bLateLatch, TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput);
+void LatchFrameCamera(TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput);
+void DrawScene();
+void RunFrameTasks(double frameStart);
+bool CompactMeshSlice(double budgetMs);
+bool StreamTextureSlice(double budgetMs);
+void RunFrame(TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput);
+void RunRenderThread();
+void CaptureOverdraw();
+void UpdateGLCapture(int frameIndex, double frameMs);
+bool CheckBudgets();
+void FillMeshBuffers(std::vector<GLuint> fillers[2], GLuint maxFillers);
+void FreeMeshBuffers(std::vector<GLuint> fillers[2]);
+bool CheckCompaction();
+void RunCameraPath(int nFrames);
+#ifdef USE_VULKAN_BACKEND
+bool RunVulkanCameraPath(int nFrames);
+#endif
+bool RunThumbnails(int nThumbnails);
+bool RunSceneReloads(int nReloads);
+void ReportMeshBuffers();
+void DestroyManagers();
 
 
 /***********************************************************
@@ -45,6 +182,19 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	ParseCommandLine(argc, argv);
+
+#ifdef __linux__
+	// the thumbnails scale with the worker threads, so the
+	// software rasterizer should not add threads of its own
+	// to each context - set before GLFW loads the driver,
+	// and only when not already chosen
+	if (g_Thumbnails > 0)
+	{
+		setenv("LP_NUM_THREADS", "1", 0);
+	}
+#endif
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -57,6 +207,16 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
+	// captures run without showing the window, so they can
+	// be taken on build machines
+	bool bOffscreen = (g_bOverdrawCapture == true) || (g_bStressBenchmark == true) || (g_bCheckBudgets == true) ||
+		(g_BenchmarkFrames > 0) || (NULL != g_RenderServiceSocket) || (g_Thumbnails > 0) ||
+		(g_SceneReloads > 0) || (g_bCheckCompaction == true);
+	if (bOffscreen == true)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
 
@@ -66,47 +226,1377 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the GL hooks have to be in place before the shaders,
+	// meshes and textures are created, so captures know them
+	if ((g_bGLCapture == true) && (GLCapture::Install() == false))
+	{
+		std::cout << "WARNING: GL capture is not available" << std::endl;
+		g_bGLCapture = false;
+	}
+	// the budget check counts the GL calls with the hooks
+	if ((g_bCheckBudgets == true) && (GLCapture::IsInstalled() == false) && (GLCapture::Install() == false))
+	{
+		std::cout << "ERROR: The budget check needs the GL hooks" << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
 		"../../Utilities/shaders/vertexShader.glsl",
 		"../../Utilities/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	if (g_CacheBudgetMB >= 0)
+	{
+		ResourceCache::SetBudget((size_t)g_CacheBudgetMB * 1024 * 1024);
+	}
+
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	// the window shows the scene before its textures are in,
+	// the captures and benchmarks load them all up front
+	g_SceneManager->SetTextureStreaming(bOffscreen == false);
+	// the compaction check places the scene meshes in the
+	// second blocks of the shared buffers, behind a few
+	// fillers
+	if (g_bCheckCompaction == true)
+	{
+		FillMeshBuffers(g_MeshBlockFillers, 0);
+		FillMeshBuffers(g_MeshLeadFillers, MESH_LEAD_FILLERS);
+	}
 	g_SceneManager->PrepareScene();
+	g_TaskScheduler = new FrameTaskScheduler();
+	if (g_SceneManager->HasPendingTextures() == true)
+	{
+		g_TaskScheduler->AddTask(
+			"TextureStreaming",
+			FrameTaskScheduler::PRIORITY_NORMAL,
+			StreamTextureSlice);
+	}
+
+	// bake the static lighting offline, the lights and the
+	// scene geometry never change at run time
+	if (g_bBakeLighting == true)
+	{
+		bool bBaked = g_SceneManager->BakeSceneLighting(BAKED_LIGHTING_FILE);
+		if (bBaked == true)
+		{
+			std::cout << "INFO: Baked lighting saved to " << BAKED_LIGHTING_FILE << std::endl;
+		}
+		DestroyManagers();
+		glfwTerminate();
+		return((bBaked == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the benchmark draws its own scenes offscreen
+	if (g_bStressBenchmark == true)
+	{
+		StressBenchmark benchmark(g_SceneManager, g_ViewManager);
+		if (g_StressMaxObjects > 0)
+		{
+			benchmark.SetMaxObjects((GLuint)g_StressMaxObjects);
+		}
+		benchmark.SetHLOD(g_bStressHLOD);
+		g_SceneManager->SetImpostors(g_bImpostors);
+		bool bFinished = benchmark.Run(std::cout);
+		DestroyManagers();
+		glfwTerminate();
+		return((bFinished == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (g_bCheckBudgets == true)
+	{
+		bool bPassed = (BuildFrameGraph() == true) && (CheckBudgets() == true);
+		DestroyManagers();
+		glfwTerminate();
+		return((bPassed == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (g_bCheckCompaction == true)
+	{
+		bool bPassed = (BuildFrameGraph() == true) && (CheckCompaction() == true);
+		DestroyManagers();
+		glfwTerminate();
+		return((bPassed == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the render service keeps the scene loaded and draws it
+	// from the captured objects for other processes
+	if (NULL != g_RenderServiceSocket)
+	{
+		g_SceneManager->CaptureSceneObjects();
+
+		RenderService service(g_SceneManager, g_ViewManager);
+		service.SetBatching(g_RenderServiceWindowMs, (GLuint)std::max(1, g_RenderServiceBatch));
+		bool bFinished = service.Run(g_RenderServiceSocket, std::cout);
+		DestroyManagers();
+		glfwTerminate();
+		return((bFinished == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the thumbnail workers draw the captured objects in
+	// contexts of their own, sharing the scene textures
+	if (g_Thumbnails > 0)
+	{
+		bool bFinished = RunThumbnails(g_Thumbnails);
+		DestroyManagers();
+		glfwTerminate();
+		return((bFinished == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// reopening the scene shows what the resource cache
+	// saves over loading it cold
+	if (g_SceneReloads > 0)
+	{
+		bool bFinished = RunSceneReloads(g_SceneReloads);
+		DestroyManagers();
+		glfwTerminate();
+		return((bFinished == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+#ifdef USE_VULKAN_BACKEND
+	// the Vulkan backend draws the captured scene headless,
+	// the GL window only hosts the mesh building
+	if (g_VulkanFrames > 0)
+	{
+		bool bFinished = RunVulkanCameraPath(g_VulkanFrames);
+		DestroyManagers();
+		glfwTerminate();
+		return((bFinished == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+#endif
+
+	// switch to the cheap baked lighting shaders when the
+	// lighting has been baked for the current scene
+	if (g_bBakedLighting == true)
+	{
+		if (g_SceneManager->LoadBakedLighting(BAKED_LIGHTING_FILE) == true)
+		{
+			g_ShaderManager->LoadShaders(
+				"../../Utilities/shaders/bakedVertexShader.glsl",
+				"../../Utilities/shaders/bakedFragmentShader.glsl");
+			g_ShaderManager->use();
+			// the ambient and specular light stay live
+			g_SceneManager->UploadSceneLights();
+		}
+		else
+		{
+			std::cout << "WARNING: No baked lighting, run with --bake-lighting first" << std::endl;
+			g_bBakedLighting = false;
+		}
+	}
+
+	// the animated platter and the impostors are drawn from
+	// the captured objects, which the baked lighting has
+	// already captured
+	if (((g_bSpinPlatter == true) || (g_bImpostors == true)) && (g_bBakedLighting == false))
+	{
+		g_SceneManager->CaptureSceneObjects();
+	}
+	if (g_bImpostors == true)
+	{
+		if (g_bBakedLighting == true)
+		{
+			std::cout << "WARNING: The impostors are not drawn with baked lighting" << std::endl;
+		}
+		g_SceneManager->SetImpostors(true);
+	}
+
+	// the overdraw view draws the scene with the counting
+	// shaders into its own target
+	if ((g_bOverdraw == true) || (g_bOverdrawCapture == true))
+	{
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(g_Window, &width, &height);
+
+		g_OverdrawView = new OverdrawView();
+		if (g_OverdrawView->Create(width, height) == false)
+		{
+			DestroyManagers();
+			glfwTerminate();
+			return(EXIT_FAILURE);
+		}
+		g_OverdrawView->SetCountHiddenFragments(g_bOverdrawHidden);
+		if (g_OverdrawScale > 0.0f)
+		{
+			g_OverdrawView->SetHeatmapScale(g_OverdrawScale);
+		}
+
+		g_ShaderManager->LoadShaders(
+			"../../Utilities/shaders/overdrawVertexShader.glsl",
+			"../../Utilities/shaders/overdrawFragmentShader.glsl");
+		g_ShaderManager->use();
+	}
+
+	if (BuildFrameGraph() == false)
+	{
+		DestroyManagers();
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
+	if (g_bOverdrawCapture == true)
+	{
+		CaptureOverdraw();
+		DestroyManagers();
+		glfwTerminate();
+		return(EXIT_SUCCESS);
+	}
+
+	// the benchmark runs after the lighting and overdraw
+	// setup, so A/B runs can compare those configurations
+	if (g_BenchmarkFrames > 0)
+	{
+		RunCameraPath(g_BenchmarkFrames);
+		DestroyManagers();
+		glfwTerminate();
+		return(EXIT_SUCCESS);
+	}
+
+	g_LastStatsTime = glfwGetTime();
+	g_LastLatencyTime = glfwGetTime();
+	g_LastTaskStatsTime = glfwGetTime();
+	g_LastFrameRingTime = glfwGetTime();
+	g_LastFrameTime = glfwGetTime();
+
+	// the ring is sized for the window at launch, larger
+	// frames after a resize are left out and reported
+	if (NULL != g_FrameRingName)
+	{
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(g_Window, &width, &height);
+
+		g_FrameRing = new SharedFrameRing();
+		if (g_FrameRing->Create(g_FrameRingName, width, height, (GLuint)std::max(2, g_FrameRingSlots)) == false)
+		{
+			DestroyManagers();
+			glfwTerminate();
+			return(EXIT_FAILURE);
+		}
+		std::cout << "INFO: Writing the frames to the shared memory ring " << g_FrameRingName << std::endl;
+	}
+
+	if (g_bRenderThread == true)
+	{
+		RunRenderThread();
+	}
+	else
+	{
+		// loop will keep running until the application is closed 
+		// or until an error has occurred
+		while (!glfwWindowShouldClose(g_Window))
+		{
+			RunFrame(NULL);
+
+			// query the latest GLFW events
+			glfwPollEvents();
+		}
+	}
+
+	DestroyManagers();
+
+	// Terminates the program successfully
+	exit(EXIT_SUCCESS); 
+}
+
+/***********************************************************
+ *  RunFrame()
+ *
+ *  This function is used to draw, measure and submit one
+ *  frame of the interactive loop.  On the render thread
+ *  the input comes from the passed in snapshots, otherwise
+ *  it is NULL and the events are polled directly.
+ ***********************************************************/
+void RunFrame(TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput)
+{
+	// the render thread takes the newest input before each
+	// frame
+	if ((NULL != pInput) && (pInput->Update() == true))
+	{
+		g_ViewManager->ApplyInput(pInput->GetReadValue());
+	}
+
+	// the render thread takes the window size from the
+	// snapshot, GLFW only answers on the main thread
+	int width = 0;
+	int height = 0;
+	if (NULL != pInput)
+	{
+		width = pInput->GetReadValue().framebufferWidth;
+		height = pInput->GetReadValue().framebufferHeight;
+	}
+	else
+	{
+		glfwGetFramebufferSize(g_Window, &width, &height);
+	}
+
+	// the passes and their targets follow a resized window
+	g_FrameGraph->SetBackbufferSize(width, height);
+
+	double frameTime = glfwGetTime();
+	if (g_bGLCapture == true)
+	{
+		UpdateGLCapture(g_FrameIndex, (frameTime - g_LastFrameTime) * 1000.0);
+		GLCapture::BeginFrame();
+	}
+	g_LastFrameTime = frameTime;
+
+	RenderFrame(g_bLateLatch, pInput);
+	RunFrameTasks(frameTime);
+
+	if (g_bGLCapture == true)
+	{
+		GLCapture::EndFrame();
+	}
+	g_FrameIndex++;
+
+	// report the overdraw once a second
+	if ((NULL != g_OverdrawView) && (glfwGetTime() - g_LastStatsTime >= 1.0))
+	{
+		const OverdrawView::OVERDRAW_STATS& stats = g_OverdrawView->GetStats();
+		std::cout << "Overdraw: average " << stats.averageOverdraw
+			<< ", max " << stats.maxOverdraw
+			<< ", per screen pixel " << stats.averageScreen << std::endl;
+		g_LastStatsTime = glfwGetTime();
+	}
+
+	// report the background task backlog once a second
+	if ((g_bTaskStats == true) && (NULL != g_TaskScheduler) && (glfwGetTime() - g_LastTaskStatsTime >= 1.0))
+	{
+		FrameTaskScheduler::SCHEDULER_STATS stats;
+		g_TaskScheduler->GetStats(stats);
+		std::cout << "Tasks: backlog " << stats.nPending << " (peak " << stats.maxPending << ")"
+			<< ", " << stats.nSlices << " slices in " << stats.usedMs << " ms"
+			<< ", " << stats.nFinished << " finished"
+			<< ", " << stats.nStarvedSlices << " starved, longest wait " << stats.maxWaitFrames << " frames"
+			<< ", worst overrun " << stats.maxOverrunMs << " ms" << std::endl;
+		g_TaskScheduler->ResetStats();
+		g_LastTaskStatsTime = glfwGetTime();
+	}
+
+	// report the frame ring and its consumers once a second
+	if ((NULL != g_FrameRing) && (glfwGetTime() - g_LastFrameRingTime >= 1.0))
+	{
+		SharedFrameRing::RING_STATS stats;
+		g_FrameRing->GetStats(stats);
+		std::cout << "Frame ring: " << stats.nWritten << " frames written"
+			<< " (" << stats.nSkipped << " too large)"
+			<< ", write average " << stats.averageWriteMs << " ms"
+			<< ", " << stats.nConsumers << " consumers"
+			<< ", furthest behind " << stats.maxLag << " frames" << std::endl;
+		g_FrameRing->ResetStats();
+		g_LastFrameRingTime = glfwGetTime();
+	}
+
+	// hand the finished frame to the local consumers, with
+	// the camera it was drawn with
+	if (NULL != g_FrameRing)
+	{
+		SharedFrameRing::FRAME_INFO info;
+		info.frameID = (uint64_t)(g_FrameIndex - 1);
+		info.view = g_ViewManager->GetViewMatrix();
+		info.projection = g_ViewManager->GetProjectionMatrix();
+		info.cameraPosition = g_ViewManager->GetCameraPosition();
+		info.frameMs = (float)((glfwGetTime() - frameTime) * 1000.0);
+		g_FrameRing->WriteFrame(info, width, height);
+	}
+	g_ViewManager->SubmitFrame();
+
+	// report the input latency once a second
+	if ((g_bInputLatency == true) && (glfwGetTime() - g_LastLatencyTime >= 1.0))
+	{
+		ViewManager::INPUT_LATENCY latency;
+		g_ViewManager->GetInputLatency(latency);
+		if (latency.nFrames > 0)
+		{
+			std::cout << "Input latency: event to submit average " << latency.averageMs
+				<< " ms, max " << latency.maxMs
+				<< " ms over " << latency.nFrames << " frames" << std::endl;
+		}
+		g_ViewManager->ResetInputLatency();
+		g_LastLatencyTime = glfwGetTime();
+	}
+
+	// Flips the the back buffer with the front buffer every frame.
+	glfwSwapBuffers(g_Window);
+}
+
+/***********************************************************
+ *  RunRenderThread()
+ *
+ *  This function is used to run the interactive loop on
+ *  two threads.  The main thread only pumps the window
+ *  events, as GLFW requires, and publishes an input
+ *  snapshot after each pump through a triple buffer.  The
+ *  render thread owns the GL context and draws frames from
+ *  the newest snapshot, so a slow frame no longer holds up
+ *  the events and a burst of events no longer holds up the
+ *  frame.
+ ***********************************************************/
+void RunRenderThread()
+{
+	TripleBuffer<ViewManager::INPUT_SNAPSHOT> input;
+	std::atomic<bool> bRendering(true);
+
+	ViewManager::INPUT_SNAPSHOT snapshot = {};
+	snapshot.firstEventTime = -1.0;
+
+	// the first frame starts from the input at launch
+	g_ViewManager->SetSnapshotInput(true);
+	g_ViewManager->CaptureInput(snapshot, true);
+	input.GetWriteValue() = snapshot;
+	input.Publish();
+
+	// the render thread owns the GL context from here on
+	glfwMakeContextCurrent(NULL);
+	std::thread renderThread([&input, &bRendering]()
+	{
+		glfwMakeContextCurrent(g_Window);
+		while (bRendering.load() == true)
+		{
+			RunFrame(&input);
+		}
+		glfwMakeContextCurrent(NULL);
+	});
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// wake up now and then without events, so the held
+		// keys keep being published
+		glfwWaitEventsTimeout(INPUT_WAIT_SECONDS);
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		g_ViewManager->CaptureInput(snapshot, input.IsPublishedRead());
+		input.GetWriteValue() = snapshot;
+		input.Publish();
+	}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	bRendering.store(false);
+	renderThread.join();
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+	// the GL objects are freed on this thread
+	glfwMakeContextCurrent(g_Window);
+	g_ViewManager->SetSnapshotInput(false);
+}
 
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This function is used to draw one frame of the scene
+ *  into the back buffer.  With the late latch the camera
+ *  is sampled again from the passed in input, or from the
+ *  polled events when it is NULL, after the frame's CPU
+ *  work and before its draws.
+ ***********************************************************/
+void RenderFrame(bool bLateLatch, TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput)
+{
+	PERF_SCOPE("RenderFrame");
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
 
-		// query the latest GLFW events
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView();
+
+	// cull the large meshes against the prepared view
+	g_SceneManager->SetCullingView(
+		g_ViewManager->GetViewMatrix(),
+		g_ViewManager->GetProjectionMatrix(),
+		g_ViewManager->GetCameraPosition());
+
+	// move the animated objects to the frame time
+	if (g_bSpinPlatter == true)
+	{
+		g_SceneManager->AnimateSceneObjects(glfwGetTime());
+	}
+
+	if (bLateLatch == true)
+	{
+		LatchFrameCamera(pInput);
+	}
+
+	// draw the passes of the frame
+	g_FrameGraph->Execute();
+}
+
+/***********************************************************
+ *  RunFrameTasks()
+ *
+ *  This function is used to run the background work in
+ *  what is left of the frame target after the draws, so
+ *  the moved mesh data and the streamed textures are first
+ *  used by the next frame.  It is kept out of RenderFrame(),
+ *  so the budget check measures the draws alone.  Mesh
+ *  compaction is only queued once a mesh range has been
+ *  freed since the last compaction was queued.
+ ***********************************************************/
+void RunFrameTasks(double frameStart)
+{
+	if (NULL == g_TaskScheduler)
+	{
+		return;
+	}
+
+	if (g_TaskScheduler->IsPending(g_CompactionTask) == false)
+	{
+		GPUBufferAllocator::ALLOCATOR_STATS vertexStats;
+		GPUBufferAllocator::ALLOCATOR_STATS indexStats;
+		g_SceneManager->GetMeshBufferStats(vertexStats, indexStats);
+
+		uint64_t nFrees = vertexStats.nFrees + indexStats.nFrees;
+		if (nFrees != g_CompactedFrees)
+		{
+			g_CompactedFrees = nFrees;
+			g_CompactionTask = g_TaskScheduler->AddTask(
+				"MeshCompaction",
+				FrameTaskScheduler::PRIORITY_LOW,
+				CompactMeshSlice);
+		}
+	}
+
+	double elapsedMs = (glfwGetTime() - frameStart) * 1000.0;
+	g_TaskScheduler->RunTasks(std::max(0.0, g_FrameTargetMs - elapsedMs));
+}
+
+/***********************************************************
+ *  LatchFrameCamera()
+ *
+ *  This function is used to move the camera by the input
+ *  that arrived during the frame's CPU work, right before
+ *  its draws are recorded.  Only the shaders with the
+ *  camera block read the latched camera, which today are
+ *  the baked lighting shaders, so the late latch is turned
+ *  off with a warning for the other scene shaders.
+ ***********************************************************/
+void LatchFrameCamera(TripleBuffer<ViewManager::INPUT_SNAPSHOT>* pInput)
+{
+	if (NULL != pInput)
+	{
+		if (pInput->Update() == true)
+		{
+			g_ViewManager->ApplyInput(pInput->GetReadValue());
+		}
+	}
+	else
+	{
 		glfwPollEvents();
 	}
+	if (g_ViewManager->LatchSceneView() == false)
+	{
+		std::cout << "WARNING: The scene shader has no camera block, late latching only works with --baked-lighting" << std::endl;
+		g_bLateLatch = false;
+	}
+}
+
+/***********************************************************
+ *  BuildFrameGraph()
+ *
+ *  This function is used to add the render passes of the
+ *  frame to the graph and compile it.  The overdraw view
+ *  counts the scene offscreen and draws the heatmap,
+ *  otherwise the scene is drawn straight to the backbuffer.
+ ***********************************************************/
+bool BuildFrameGraph()
+{
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(g_Window, &width, &height);
+
+	if (NULL == g_FrameGraph)
+	{
+		g_FrameGraph = new FrameGraph();
+	}
+	g_FrameGraph->Clear();
+	g_FrameGraph->SetBackbufferSize(width, height);
+
+	if (NULL != g_OverdrawView)
+	{
+		g_OverdrawView->AddPasses(*g_FrameGraph, DrawScene);
+	}
+	else
+	{
+		GLuint scenePass = g_FrameGraph->AddPass("Scene", []()
+			{
+				// Clear the frame and z buffers
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				DrawScene();
+			});
+		g_FrameGraph->WriteTexture(scenePass, g_FrameGraph->GetBackbuffer());
+	}
+
+	if (g_FrameGraph->Compile() == false)
+	{
+		std::cout << "ERROR: The frame graph could not be compiled" << std::endl;
+		return(false);
+	}
+	if (g_bFrameGraphReport == true)
+	{
+		g_FrameGraph->Report(std::cout);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DrawScene()
+ *
+ *  This function is used to draw the scene objects into
+ *  the bound framebuffer.
+ ***********************************************************/
+void DrawScene()
+{
+	// refresh the 3D scene
+	if ((g_bBakedLighting == true) || (g_bSpinPlatter == true) || (g_bImpostors == true))
+	{
+		g_SceneManager->RenderSceneObjects();
+	}
+	else
+	{
+		g_SceneManager->RenderScene();
+	}
+}
+
+/***********************************************************
+ *  CompactMeshSlice()
+ *
+ *  This function is used as the mesh compaction task, each
+ *  slice moves the mesh data in small steps until the
+ *  passed in time is used, and a slice with no time does
+ *  nothing - the scheduler gives a task that waited too
+ *  long a slice with time.  The task has finished once a
+ *  step finds nothing left to move.
+ ***********************************************************/
+bool CompactMeshSlice(double budgetMs)
+{
+	double startTime = glfwGetTime();
+	while ((glfwGetTime() - startTime) * 1000.0 < budgetMs)
+	{
+		if (g_SceneManager->CompactMeshBuffers(MESH_COMPACT_STEP_BYTES) == 0)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  StreamTextureSlice()
+ *
+ *  This function is used as the texture streaming task,
+ *  each slice loads the queued scene textures one at a
+ *  time until the passed in time is used.  A texture is
+ *  never split, so the last one can run past the time.
+ *  The task has finished once every texture is loaded.
+ ***********************************************************/
+bool StreamTextureSlice(double budgetMs)
+{
+	double startTime = glfwGetTime();
+	while ((glfwGetTime() - startTime) * 1000.0 < budgetMs)
+	{
+		if (g_SceneManager->StreamNextTexture() == false)
+		{
+			return(true);
+		}
+	}
+
+	return(g_SceneManager->HasPendingTextures() == false);
+}
+
+/***********************************************************
+ *  CaptureOverdraw()
+ *
+ *  This function is used to render the overdraw heatmap
+ *  from each standard camera pose, saving each heatmap
+ *  and printing its statistics on one line.
+ ***********************************************************/
+void CaptureOverdraw()
+{
+	for (int pose = 0; pose < ViewManager::GetCameraPoseCount(); pose++)
+	{
+		std::string poseName = ViewManager::GetCameraPoseName(pose);
+		std::string filename = "overdraw_" + poseName + ".ppm";
+
+		g_ViewManager->SetCameraPose(pose);
+		RenderFrame(false, NULL);
+		g_OverdrawView->SaveFramebuffer(filename.c_str());
+
+		const OverdrawView::OVERDRAW_STATS& stats = g_OverdrawView->GetStats();
+		std::cout << "OVERDRAW pose=" << poseName
+			<< " average=" << stats.averageOverdraw
+			<< " max=" << stats.maxOverdraw
+			<< " screen=" << stats.averageScreen
+			<< " covered=" << stats.coveredPixels
+			<< " image=" << filename << std::endl;
+	}
+}
+
+/***********************************************************
+ *  CheckBudgets()
+ *
+ *  This function is used to draw frames of the scene from
+ *  the default camera pose and check them against the
+ *  budgets file, or to write them as the new budgets.
+ ***********************************************************/
+bool CheckBudgets()
+{
+	FrameBudgets budgets;
+	FrameBudgets::FRAME_MEASURE measured;
+
+	if ((budgets.Load(FRAME_BUDGETS_FILE) == false) && (g_bRecordBudgets == false))
+	{
+		return(false);
+	}
+	if (budgets.PinToReferenceCore() == false)
+	{
+		std::cout << "WARNING: The CPU time is not measured on the reference core" << std::endl;
+	}
+
+	g_ViewManager->SetCameraPose(0);
+	budgets.Measure([]() { RenderFrame(false, NULL); }, measured);
+
+	if (g_bRecordBudgets == true)
+	{
+		budgets.Check(measured, std::cout);
+		if (budgets.Save(FRAME_BUDGETS_FILE, measured) == false)
+		{
+			return(false);
+		}
+		std::cout << "INFO: Frame budgets saved to " << FRAME_BUDGETS_FILE << std::endl;
+		return(true);
+	}
+
+	return(budgets.Check(measured, std::cout));
+}
+
+/***********************************************************
+ *  FillMeshBuffers()
+ *
+ *  This function is used to fill the free ranges of the
+ *  shared vertex and index buffers, up to the end of their
+ *  last blocks, with ranges of 0xFF bytes nothing draws.
+ *  The free list of the last few bytes may round up past
+ *  them, so filling stops at the filler that needed a new
+ *  block, or after maxFillers when it is not zero.  An
+ *  empty buffer gets its first block filled.
+ ***********************************************************/
+void FillMeshBuffers(std::vector<GLuint> fillers[2], GLuint maxFillers)
+{
+	GPUBufferAllocator* allocators[2] = { &ShapeMeshes::GetVertexBuffers(), &ShapeMeshes::GetIndexBuffers() };
+	std::vector<unsigned char> fillerData(MESH_FILLER_BYTES, 0xFF);
+
+	for (int i = 0; i < 2; i++)
+	{
+		GPUBufferAllocator::ALLOCATOR_STATS stats;
+		allocators[i]->GetStats(stats);
+		GLuint nBlocks = std::max(stats.nBlocks, 1u);
+
+		bool bFull = false;
+		GLuint nFillers = 0;
+		while ((bFull == false) && ((maxFillers == 0) || (nFillers < maxFillers)))
+		{
+			GLsizeiptr size = (stats.largestFree > 0) ? std::min(MESH_FILLER_BYTES, stats.largestFree) : MESH_FILLER_BYTES;
+			GLuint filler = allocators[i]->Allocate(size, fillerData.data());
+			allocators[i]->GetStats(stats);
+
+			bFull = (filler == 0) || (stats.nBlocks > nBlocks);
+			if (bFull == true)
+			{
+				allocators[i]->Free(filler);
+			}
+			else
+			{
+				fillers[i].push_back(filler);
+				nFillers++;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FreeMeshBuffers()
+ *
+ *  This function is used to free the fillers placed by
+ *  FillMeshBuffers().
+ ***********************************************************/
+void FreeMeshBuffers(std::vector<GLuint> fillers[2])
+{
+	GPUBufferAllocator* allocators[2] = { &ShapeMeshes::GetVertexBuffers(), &ShapeMeshes::GetIndexBuffers() };
+
+	for (int i = 0; i < 2; i++)
+	{
+		for (size_t f = 0; f < fillers[i].size(); f++)
+		{
+			allocators[i]->Free(fillers[i][f]);
+		}
+		fillers[i].clear();
+	}
+}
+
+/***********************************************************
+ *  CheckCompaction()
+ *
+ *  This function is used to check the compaction of the
+ *  shared mesh buffers.  The scene was loaded into second
+ *  blocks, behind a few fillers that are freed to leave
+ *  a hole.  Compaction must move the meshes into it, then
+ *  the ranges they left are filled with 0xFF bytes and
+ *  the scene must draw the same, so a draw still reading
+ *  the old place would show.  Once every filler is freed,
+ *  compaction must move the meshes into the first blocks
+ *  and free the second ones.
+ ***********************************************************/
+bool CheckCompaction()
+{
+	GPUBufferAllocator::ALLOCATOR_STATS fragmented[2];
+	GPUBufferAllocator::ALLOCATOR_STATS compacted[2];
+	std::vector<GLuint> overwriteFillers[2];
+	std::vector<unsigned char> drawnPixels;
+	std::vector<unsigned char> movedPixels;
+	std::vector<unsigned char> packedPixels;
+	const char* kinds[2] = { "vertex", "index" };
+
+	// called to draw the scene and read back the frame
+	auto drawScene = [](std::vector<unsigned char>& pixels)
+	{
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(g_Window, &width, &height);
+
+		RenderFrame(false, NULL);
+		pixels.resize((size_t)width * height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	};
+
+	// called to compact the buffers until nothing moves,
+	// returns the bytes moved
+	auto compactAll = []()
+	{
+		GLsizeiptr movedBytes = 0;
+		GLsizeiptr stepBytes = g_SceneManager->CompactMeshBuffers(MESH_COMPACT_STEP_BYTES);
+		while (stepBytes > 0)
+		{
+			movedBytes += stepBytes;
+			stepBytes = g_SceneManager->CompactMeshBuffers(MESH_COMPACT_STEP_BYTES);
+		}
+		return(movedBytes);
+	};
+
+	g_ViewManager->SetCameraPose(0);
+	drawScene(drawnPixels);
+
+	// the meshes move within the second blocks, which they
+	// keep from being freed, so their old ranges can be
+	// overwritten
+	FreeMeshBuffers(g_MeshLeadFillers);
+	g_SceneManager->GetMeshBufferStats(fragmented[0], fragmented[1]);
+	GLsizeiptr movedBytes = compactAll();
+	FillMeshBuffers(overwriteFillers, 0);
+	drawScene(movedPixels);
+
+	// then into the first blocks, leaving the second empty
+	FreeMeshBuffers(overwriteFillers);
+	FreeMeshBuffers(g_MeshBlockFillers);
+	GLsizeiptr packedBytes = compactAll();
+	g_SceneManager->GetMeshBufferStats(compacted[0], compacted[1]);
+	drawScene(packedPixels);
+
+	bool bShrunk = (movedBytes > 0) && (packedBytes > 0);
+	for (int i = 0; i < 2; i++)
+	{
+		bShrunk = (bShrunk == true) &&
+			(compacted[i].capacity < fragmented[i].capacity) &&
+			(compacted[i].fragmentation < fragmented[i].fragmentation);
+
+		std::cout << "MESH_COMPACTION buffers=" << kinds[i]
+			<< " blocks=" << fragmented[i].nBlocks << "->" << compacted[i].nBlocks
+			<< " capacity_kb=" << fragmented[i].capacity / 1024.0 << "->" << compacted[i].capacity / 1024.0
+			<< " fragmentation=" << fragmented[i].fragmentation * 100.0f << "%->" << compacted[i].fragmentation * 100.0f << "%"
+			<< std::endl;
+	}
+	bool bDrawn = (movedPixels == drawnPixels) && (packedPixels == drawnPixels);
+	std::cout << "MESH_COMPACTION moved_kb=" << movedBytes / 1024.0 << "+" << packedBytes / 1024.0
+		<< " image=" << ((bDrawn == true) ? "identical" : "DIFFERENT") << std::endl;
+
+	if (bShrunk == false)
+	{
+		std::cout << "ERROR: Compaction did not shrink the shared mesh buffers" << std::endl;
+	}
+	if (bDrawn == false)
+	{
+		std::cout << "ERROR: The scene draws differently after compaction" << std::endl;
+	}
+
+	return((bShrunk == true) && (bDrawn == true));
+}
+
+/***********************************************************
+ *  RunCameraPath()
+ *
+ *  This function is used to draw the passed in number of
+ *  frames along the standard camera poses, with the profile
+ *  taken after one warm up pass over the poses.  The GPU is
+ *  waited on every frame, so its time shows in the profile.
+ ***********************************************************/
+void RunCameraPath(int nFrames)
+{
+	int nPoses = ViewManager::GetCameraPoseCount();
+
+	for (int pose = 0; pose < nPoses; pose++)
+	{
+		g_ViewManager->SetCameraPose(pose);
+		RenderFrame(false, NULL);
+		glFinish();
+	}
+	PerfCounters::Reset();
+
+	for (int frame = 0; frame < nFrames; frame++)
+	{
+		g_ViewManager->SetCameraPose((frame * nPoses) / nFrames);
+		RenderFrame(false, NULL);
+
+		PERF_SCOPE("FrameFinish");
+		glFinish();
+	}
+}
+
+#ifdef USE_VULKAN_BACKEND
+/***********************************************************
+ *  RunVulkanCameraPath()
+ *
+ *  This function is used to draw the passed in number of
+ *  frames along the standard camera poses with the Vulkan
+ *  backend, printing the average recording and submit
+ *  times.  Each pose is then saved as an image, so the
+ *  output can be compared with the GL renderer.
+ ***********************************************************/
+bool RunVulkanCameraPath(int nFrames)
+{
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(g_Window, &width, &height);
+
+	VulkanRenderer::RENDERER_SETTINGS settings;
+	settings.width = (uint32_t)width;
+	settings.height = (uint32_t)height;
+	settings.nWorkers = (uint32_t)std::max(0, g_VulkanWorkers);
+	settings.objectsPerBatch = 0;
+	settings.bValidation = g_bVulkanValidation;
+	settings.pipelineCacheFile = VULKAN_PIPELINE_CACHE_FILE;
+
+	VulkanRenderer renderer;
+	if (renderer.Create(settings) == false)
+	{
+		std::cout << "ERROR: The Vulkan backend is not available" << std::endl;
+		return(false);
+	}
+
+	if (g_SceneManager->BuildVulkanScene(renderer) == false)
+	{
+		std::cout << "ERROR: The scene could not be uploaded to Vulkan" << std::endl;
+		return(false);
+	}
+
+	int nPoses = ViewManager::GetCameraPoseCount();
+	double recordMs = 0.0;
+	double submitMs = 0.0;
+	for (int frame = 0; frame < nFrames; frame++)
+	{
+		g_ViewManager->SetCameraPose((frame * nPoses) / nFrames);
+		g_ViewManager->PrepareSceneView();
+		if (renderer.RenderFrame(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetCameraPosition()) == false)
+		{
+			return(false);
+		}
+
+		recordMs += renderer.GetStats().recordMs;
+		submitMs += renderer.GetStats().submitMs;
+	}
+
+	const VulkanRenderer::FRAME_STATS& stats = renderer.GetStats();
+	std::cout << "VULKAN frames=" << nFrames
+		<< " draws=" << stats.nDrawCalls
+		<< " batches=" << stats.nBatches
+		<< " workers=" << stats.nWorkers
+		<< " record_ms=" << recordMs / nFrames
+		<< " submit_ms=" << submitMs / nFrames << std::endl;
+
+	for (int pose = 0; pose < nPoses; pose++)
+	{
+		std::string filename = std::string("vulkan_") + ViewManager::GetCameraPoseName(pose) + ".ppm";
+
+		g_ViewManager->SetCameraPose(pose);
+		g_ViewManager->PrepareSceneView();
+		if ((renderer.RenderFrame(
+				g_ViewManager->GetViewMatrix(),
+				g_ViewManager->GetProjectionMatrix(),
+				g_ViewManager->GetCameraPosition()) == false) ||
+			(renderer.SaveImage(filename.c_str()) == false))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+#endif
+
+/***********************************************************
+ *  RunThumbnails()
+ *
+ *  This function is used to draw thumbnails of the passed
+ *  in number of scene variants, each seen from its own
+ *  point on an orbit around the scene, with the scene
+ *  turned on the turntable and every object tinted.  The
+ *  thumbnails are hashed, so the scaling runs can check
+ *  that every worker count draws the same images.
+ ***********************************************************/
+bool RunThumbnails(int nThumbnails)
+{
+	const glm::vec3 TINTS[] = {
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(1.0f, 0.8f, 0.7f),
+		glm::vec3(0.7f, 0.85f, 1.0f),
+		glm::vec3(0.8f, 1.0f, 0.75f) };
+	const int N_TINTS = sizeof(TINTS) / sizeof(TINTS[0]);
+	const glm::vec3 ORBIT_TARGET(0.0f, 1.0f, -1.0f);
+	const float GOLDEN_ANGLE = 137.50776f;
+
+	ThumbnailRenderer::THUMBNAIL_SETTINGS settings;
+	settings.width = std::max(1, g_ThumbnailSize);
+	settings.height = std::max(1, g_ThumbnailSize);
+	settings.nWorkers = (GLuint)std::max(0, g_ThumbnailWorkers);
+
+	ThumbnailRenderer renderer;
+	if (renderer.Create(g_Window, settings) == false)
+	{
+		std::cout << "ERROR: The thumbnail worker contexts could not be created" << std::endl;
+		return(false);
+	}
+
+	g_SceneManager->CaptureSceneObjects();
+	if (g_SceneManager->BuildThumbnailScene(renderer) == false)
+	{
+		std::cout << "ERROR: The scene could not be uploaded for the thumbnails" << std::endl;
+		return(false);
+	}
+
+	std::vector<ThumbnailRenderer::THUMBNAIL_VARIANT> variants(nThumbnails);
+	for (int i = 0; i < nThumbnails; i++)
+	{
+		ThumbnailRenderer::THUMBNAIL_VARIANT& variant = variants[i];
+		float azimuth = glm::radians(GOLDEN_ANGLE * i);
+		float elevation = glm::radians(15.0f + 30.0f * ((i * 7) % 11) / 10.0f);
+		float distance = 16.0f + 6.0f * ((i * 3) % 5) / 4.0f;
+
+		variant.cameraTarget = ORBIT_TARGET;
+		variant.cameraPosition = ORBIT_TARGET + distance * glm::vec3(
+			cos(elevation) * sin(azimuth), sin(elevation), cos(elevation) * cos(azimuth));
+		variant.fieldOfView = 45.0f + 5.0f * (i % 4);
+		variant.turntableDegrees = 30.0f * (i % 12);
+		variant.tint = TINTS[i % N_TINTS];
+		variant.backgroundColor = glm::vec3(0.1f, 0.1f, 0.12f);
+	}
+
+	GLsizei width = renderer.GetWidth();
+	GLsizei height = renderer.GetHeight();
+	std::vector<unsigned long long> hashes(variants.size());
+	std::atomic<bool> bSaved(true);
+
+	// called on the worker threads, each thumbnail has its
+	// own hash slot and file, a failed save is flagged for
+	// all of them
+	ThumbnailRenderer::THUMBNAIL_FUNCTION onThumbnail = [&](size_t variant, const unsigned char* pPixels)
+	{
+		size_t rowBytes = (size_t)width * 3;
+		unsigned long long hash = 14695981039346656037ULL;
+		for (size_t b = 0; b < rowBytes * height; b++)
+		{
+			hash = (hash ^ pPixels[b]) * 1099511628211ULL;
+		}
+		hashes[variant] = hash;
+
+		if (NULL != g_ThumbnailDir)
+		{
+			char filename[1024];
+			snprintf(filename, sizeof(filename), "%s/thumbnail_%05d.ppm", g_ThumbnailDir, (int)variant);
+			FILE* file = fopen(filename, "wb");
+			if (NULL == file)
+			{
+				bSaved.store(false);
+				return;
+			}
+			fprintf(file, "P6\n%d %d\n255\n", width, height);
+			for (GLsizei y = height - 1; y >= 0; y--)
+			{
+				fwrite(pPixels + y * rowBytes, 1, rowBytes, file);
+			}
+			fclose(file);
+		}
+	};
+
+	if (renderer.Render(variants, onThumbnail) == false)
+	{
+		std::cout << "ERROR: The thumbnails could not be drawn" << std::endl;
+		return(false);
+	}
+	if (bSaved.load() == false)
+	{
+		std::cout << "WARNING: Not every thumbnail could be saved to " << g_ThumbnailDir << std::endl;
+	}
+
+	const ThumbnailRenderer::BATCH_STATS& stats = renderer.GetStats();
+	std::cout << "THUMBNAILS count=" << stats.nThumbnails
+		<< " workers=" << stats.nWorkers
+		<< " size=" << width << "x" << height
+		<< " seconds=" << stats.seconds
+		<< " per_second=" << stats.thumbnailsPerSecond << std::endl;
+
+	if (g_bThumbnailScaling == false)
+	{
+		return(true);
+	}
+
+	// draw the batch again on each worker count, the first
+	// batch having warmed up the driver and the contexts
+	std::vector<unsigned long long> firstHashes = hashes;
+	std::vector<GLuint> workerCounts;
+	for (GLuint nWorkers = 1; nWorkers < renderer.GetWorkerCount(); nWorkers *= 2)
+	{
+		workerCounts.push_back(nWorkers);
+	}
+	workerCounts.push_back(renderer.GetWorkerCount());
+
+	double baseRate = 0.0;
+	bool bIdentical = true;
+	for (size_t i = 0; i < workerCounts.size(); i++)
+	{
+		if (renderer.Render(variants, onThumbnail, workerCounts[i]) == false)
+		{
+			std::cout << "ERROR: The thumbnails could not be drawn" << std::endl;
+			return(false);
+		}
+
+		bool bMatched = (hashes == firstHashes);
+		bIdentical = (bIdentical == true) && (bMatched == true);
+		if (i == 0)
+		{
+			baseRate = stats.thumbnailsPerSecond;
+		}
+
+		std::cout << "THUMBNAIL_SCALING workers=" << stats.nWorkers
+			<< " seconds=" << stats.seconds
+			<< " per_second=" << stats.thumbnailsPerSecond
+			<< " speedup=" << ((baseRate > 0.0) ? stats.thumbnailsPerSecond / baseRate : 0.0)
+			<< " images=" << ((bMatched == true) ? "identical" : "DIFFERENT") << std::endl;
+	}
+
+	if (bIdentical == false)
+	{
+		std::cout << "ERROR: The thumbnails differ between worker counts" << std::endl;
+	}
+
+	return(bIdentical);
+}
+
+/***********************************************************
+ *  RunSceneReloads()
+ *
+ *  This function is used to close the scene and open it
+ *  again the passed in number of times, timing each open
+ *  until the GL work is done.  The cache is cleared before
+ *  the first open, so it loads cold, and the ones after it
+ *  find what is left in the cache under its budget.
+ ***********************************************************/
+bool RunSceneReloads(int nReloads)
+{
+	double coldMs = 0.0;
+	double warmMs = 0.0;
+	ResourceCache::CACHE_STATS stats;
+
+	for (int i = 0; i < nReloads; i++)
+	{
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+		if (i == 0)
+		{
+			ResourceCache::Clear();
+		}
+
+		ResourceCache::GetStats(stats);
+		GLuint nHits = stats.nHits;
+		GLuint nMisses = stats.nMisses;
+
+		double startTime = glfwGetTime();
+		g_SceneManager = new SceneManager(g_ShaderManager);
+		g_SceneManager->PrepareScene();
+		glFinish();
+		double loadMs = (glfwGetTime() - startTime) * 1000.0;
+
+		ResourceCache::GetStats(stats);
+		std::cout << "INFO: Scene load " << i << " took " << loadMs << " ms, "
+			<< stats.nHits - nHits << " cached, "
+			<< stats.nMisses - nMisses << " loaded" << std::endl;
+
+		if (i == 0)
+		{
+			coldMs = loadMs;
+		}
+		else
+		{
+			warmMs += loadMs;
+		}
+	}
+
+	ResourceCache::GetStats(stats);
+	std::cout << "SCENE_RELOADS reloads=" << nReloads
+		<< " cold_ms=" << coldMs
+		<< " warm_ms=" << ((nReloads > 1) ? warmMs / (nReloads - 1) : 0.0)
+		<< " hits=" << stats.nHits
+		<< " misses=" << stats.nMisses
+		<< " evictions=" << stats.nEvictions
+		<< " cached_mb=" << stats.loadedBytes / (1024.0 * 1024.0)
+		<< " budget_mb=" << stats.budgetBytes / (1024.0 * 1024.0) << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateGLCapture()
+ *
+ *  This function is used to request a GL capture of the
+ *  coming frame when F12 is pressed, when the frame index
+ *  given on the command line is reached, or after the
+ *  first frame slower than the given limit.  Slow frames
+ *  usually come in runs, so the next frame shows the same
+ *  problem.
+ ***********************************************************/
+void UpdateGLCapture(int frameIndex, double frameMs)
+{
+	static bool bF12Down = false;
+	static bool bSlowCaptured = false;
+
+	bool bCapture = false;
+
+	bool bF12 = g_ViewManager->IsKeyDown(GLFW_KEY_F12);
+	if ((bF12 == true) && (bF12Down == false))
+	{
+		bCapture = true;
+	}
+	bF12Down = bF12;
+
+	if (frameIndex == g_GLCaptureFrame)
+	{
+		bCapture = true;
+	}
+
+	// the first frame has no previous frame to time
+	if ((g_GLCaptureSlowMs > 0.0) && (frameIndex > 1) && (frameMs > g_GLCaptureSlowMs) && (bSlowCaptured == false))
+	{
+		std::cout << "INFO: Frame " << frameIndex - 1 << " took " << frameMs << " ms, capturing frame " << frameIndex << std::endl;
+		bSlowCaptured = true;
+		bCapture = true;
+	}
+
+	if ((bCapture == true) && (GLCapture::IsCapturePending() == false))
+	{
+		GLCapture::RequestCapture("frame_" + std::to_string(frameIndex) + ".glcap");
+	}
+}
+
+/***********************************************************
+ *  ReportMeshBuffers()
+ *
+ *  This function is used to print the occupancy and the
+ *  fragmentation of the shared vertex and index buffers.
+ ***********************************************************/
+void ReportMeshBuffers()
+{
+	if (NULL == g_SceneManager)
+	{
+		return;
+	}
+
+	GPUBufferAllocator::ALLOCATOR_STATS stats[2];
+	const char* kinds[2] = { "vertex", "index" };
+	char line[160];
+
+	g_SceneManager->GetMeshBufferStats(stats[0], stats[1]);
+
+	snprintf(line, sizeof(line), "%-8s %7s %7s %6s %12s %12s %10s %14s %10s",
+		"buffers", "blocks", "meshes", "holes", "capacity KB", "used KB", "occupancy", "fragmentation", "moved KB");
+	std::cout << "MESH BUFFERS\n" << line << "\n";
+	for (int i = 0; i < 2; i++)
+	{
+		snprintf(line, sizeof(line), "%-8s %7u %7u %6u %12.1f %12.1f %9.1f%% %13.1f%% %10.1f",
+			kinds[i],
+			stats[i].nBlocks,
+			stats[i].nAllocations,
+			stats[i].nFreeRanges,
+			stats[i].capacity / 1024.0,
+			stats[i].usedBytes / 1024.0,
+			stats[i].occupancy * 100.0f,
+			stats[i].fragmentation * 100.0f,
+			stats[i].movedBytes / 1024.0);
+		std::cout << line << "\n";
+	}
+	std::cout << std::flush;
+}
+
+/***********************************************************
+ *  DestroyManagers()
+ *
+ *  This function is used to free the manager objects.
+ ***********************************************************/
+void DestroyManagers()
+{
+	// every exit path comes through here, so the profile
+	// is printed once, before the managers are freed
+	if (g_bPerfCounters == true)
+	{
+		PerfCounters::Report(std::cout);
+		ReportMeshBuffers();
+	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameRing)
+	{
+		delete g_FrameRing;
+		g_FrameRing = NULL;
+	}
+	if (NULL != g_TaskScheduler)
+	{
+		delete g_TaskScheduler;
+		g_TaskScheduler = NULL;
+	}
+	if (NULL != g_FrameGraph)
+	{
+		delete g_FrameGraph;
+		g_FrameGraph = NULL;
+	}
+	if (NULL != g_OverdrawView)
+	{
+		delete g_OverdrawView;
+		g_OverdrawView = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	// the textures and meshes the scenes let go of are
+	// still loaded, and go before the context with the
+	// buffers the meshes shared
+	ResourceCache::Clear();
+	ShapeMeshes::DestroyMeshBuffers();
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
@@ -117,9 +1607,6 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
-
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
 }
 
 /***********************************************************
@@ -175,3 +1662,192 @@ bool InitializeGLEW()
 
 	return(true);
 }
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the command line options.
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bake-lighting") == 0)
+		{
+			g_bBakeLighting = true;
+		}
+		else if (strcmp(argv[i], "--baked-lighting") == 0)
+		{
+			g_bBakedLighting = true;
+		}
+		else if (strcmp(argv[i], "--overdraw") == 0)
+		{
+			g_bOverdraw = true;
+		}
+		else if (strcmp(argv[i], "--overdraw-capture") == 0)
+		{
+			g_bOverdrawCapture = true;
+		}
+		else if (strcmp(argv[i], "--overdraw-hidden") == 0)
+		{
+			g_bOverdraw = true;
+			g_bOverdrawHidden = true;
+		}
+		else if ((strcmp(argv[i], "--overdraw-scale") == 0) && (i + 1 < argc))
+		{
+			g_bOverdraw = true;
+			g_OverdrawScale = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--perf-counters") == 0)
+		{
+			g_bPerfCounters = true;
+			PerfCounters::Enable(true);
+		}
+		else if (strcmp(argv[i], "--gl-capture") == 0)
+		{
+			g_bGLCapture = true;
+		}
+		else if ((strcmp(argv[i], "--gl-capture-frame") == 0) && (i + 1 < argc))
+		{
+			g_bGLCapture = true;
+			g_GLCaptureFrame = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--gl-capture-slow-ms") == 0) && (i + 1 < argc))
+		{
+			g_bGLCapture = true;
+			g_GLCaptureSlowMs = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stress-benchmark") == 0)
+		{
+			g_bStressBenchmark = true;
+		}
+		else if ((strcmp(argv[i], "--stress-max-objects") == 0) && (i + 1 < argc))
+		{
+			g_bStressBenchmark = true;
+			g_StressMaxObjects = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stress-hlod") == 0)
+		{
+			g_bStressBenchmark = true;
+			g_bStressHLOD = true;
+		}
+		else if (strcmp(argv[i], "--check-budgets") == 0)
+		{
+			g_bCheckBudgets = true;
+		}
+		else if (strcmp(argv[i], "--check-compaction") == 0)
+		{
+			g_bCheckCompaction = true;
+		}
+		else if (strcmp(argv[i], "--record-budgets") == 0)
+		{
+			g_bCheckBudgets = true;
+			g_bRecordBudgets = true;
+		}
+		else if ((strcmp(argv[i], "--benchmark-frames") == 0) && (i + 1 < argc))
+		{
+			g_BenchmarkFrames = atoi(argv[++i]);
+			g_bPerfCounters = true;
+			PerfCounters::Enable(true);
+		}
+		else if (strcmp(argv[i], "--spin-platter") == 0)
+		{
+			g_bSpinPlatter = true;
+		}
+		else if (strcmp(argv[i], "--impostors") == 0)
+		{
+			g_bImpostors = true;
+		}
+		else if (strcmp(argv[i], "--late-latch") == 0)
+		{
+			g_bLateLatch = true;
+			g_bInputLatency = true;
+		}
+		else if (strcmp(argv[i], "--input-latency") == 0)
+		{
+			g_bInputLatency = true;
+		}
+		else if (strcmp(argv[i], "--render-thread") == 0)
+		{
+			g_bRenderThread = true;
+		}
+		else if ((strcmp(argv[i], "--frame-target-ms") == 0) && (i + 1 < argc))
+		{
+			g_FrameTargetMs = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--task-stats") == 0)
+		{
+			g_bTaskStats = true;
+		}
+		else if (strcmp(argv[i], "--frame-graph-report") == 0)
+		{
+			g_bFrameGraphReport = true;
+		}
+		else if ((strcmp(argv[i], "--render-service") == 0) && (i + 1 < argc))
+		{
+			g_RenderServiceSocket = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--render-service-window-ms") == 0) && (i + 1 < argc))
+		{
+			g_RenderServiceWindowMs = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--render-service-batch") == 0) && (i + 1 < argc))
+		{
+			g_RenderServiceBatch = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--thumbnails") == 0) && (i + 1 < argc))
+		{
+			g_Thumbnails = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--thumbnail-workers") == 0) && (i + 1 < argc))
+		{
+			g_ThumbnailWorkers = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--thumbnail-size") == 0) && (i + 1 < argc))
+		{
+			g_ThumbnailSize = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--thumbnail-dir") == 0) && (i + 1 < argc))
+		{
+			g_ThumbnailDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--thumbnail-scaling") == 0)
+		{
+			g_bThumbnailScaling = true;
+		}
+		else if ((strcmp(argv[i], "--frame-ring") == 0) && (i + 1 < argc))
+		{
+			g_FrameRingName = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--frame-ring-slots") == 0) && (i + 1 < argc))
+		{
+			g_FrameRingSlots = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--cache-budget-mb") == 0) && (i + 1 < argc))
+		{
+			g_CacheBudgetMB = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--scene-reloads") == 0) && (i + 1 < argc))
+		{
+			g_SceneReloads = atoi(argv[++i]);
+		}
+#ifdef USE_VULKAN_BACKEND
+		else if ((strcmp(argv[i], "--vulkan-frames") == 0) && (i + 1 < argc))
+		{
+			g_VulkanFrames = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--vulkan-workers") == 0) && (i + 1 < argc))
+		{
+			g_VulkanWorkers = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vulkan-validation") == 0)
+		{
+			g_bVulkanValidation = true;
+		}
+#endif
+		else
+		{
+			std::cout << "WARNING: Unknown option " << argv[i] << std::endl;
+		}
+	}
+}
@@ -0,0 +1,305 @@
+///////////////////////////////////////////////////////////////////////////////
+// OverdrawView.cpp
+// ============
+// debug view that counts the fragments written to each pixel and shows the
+// counts as a heatmap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OverdrawView.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+	// the counts are floats, since blending is not supported
+	// on integer targets - they stay exact up to 2^24
+	const GLenum g_CountFormat = GL_R32F;
+	// overdraw shown as the hottest color by default
+	const float g_DefaultHeatmapScale = 8.0f;
+	const GLenum g_DepthFormat = GL_DEPTH_COMPONENT24;
+	const char* g_CountTextureName = "overdrawCounts";
+	const char* g_HeatmapScaleName = "heatmapScale";
+}
+
+/***********************************************************
+ *  OverdrawView()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OverdrawView::OverdrawView()
+{
+	m_width = 0;
+	m_height = 0;
+	m_pGraph = NULL;
+	m_countTexture = 0;
+	m_heatmapVAO = 0;
+	m_pHeatmapShader = NULL;
+	m_bCountHidden = false;
+	m_heatmapScale = g_DefaultHeatmapScale;
+	m_stats.averageOverdraw = 0.0f;
+	m_stats.averageScreen = 0.0f;
+	m_stats.maxOverdraw = 0.0f;
+	m_stats.coveredPixels = 0;
+}
+
+/***********************************************************
+ *  ~OverdrawView()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OverdrawView::~OverdrawView()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for loading the shader that draws
+ *  the heatmap.  The counting target is created by the
+ *  frame graph, and follows the size of the window.
+ ***********************************************************/
+bool OverdrawView::Create(int width, int height)
+{
+	Destroy();
+
+	m_width = width;
+	m_height = height;
+
+	glGenVertexArrays(1, &m_heatmapVAO);
+
+	m_pHeatmapShader = new ShaderManager();
+	m_pHeatmapShader->LoadShaders(
+		"../../Utilities/shaders/heatmapVertexShader.glsl",
+		"../../Utilities/shaders/heatmapFragmentShader.glsl");
+
+	m_counts.resize((size_t)width * height);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the GL objects, the
+ *  counting target belongs to the frame graph.
+ ***********************************************************/
+void OverdrawView::Destroy()
+{
+	if (m_heatmapVAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_heatmapVAO);
+		m_heatmapVAO = 0;
+	}
+	if (NULL != m_pHeatmapShader)
+	{
+		delete m_pHeatmapShader;
+		m_pHeatmapShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetCountHiddenFragments()
+ *
+ *  This method is used for choosing between counting the
+ *  fragments that pass the depth test in draw order, which
+ *  is the shading work a depth pre-pass would remove, and
+ *  counting every rasterized fragment.
+ ***********************************************************/
+void OverdrawView::SetCountHiddenFragments(bool bCountHidden)
+{
+	m_bCountHidden = bCountHidden;
+}
+
+/***********************************************************
+ *  SetHeatmapScale()
+ *
+ *  This method is used for setting the overdraw that maps
+ *  to the hottest heatmap color.
+ ***********************************************************/
+void OverdrawView::SetHeatmapScale(float maxOverdraw)
+{
+	m_heatmapScale = std::max(1.0f, maxOverdraw);
+}
+
+/***********************************************************
+ *  AddPasses()
+ *
+ *  This method is used for adding the counting target and
+ *  the two passes to the graph.  The counting pass is kept
+ *  for its read back even if nothing read its output.  The
+ *  targets have no size of their own, so the graph gives
+ *  them the backbuffer size and creates them again when
+ *  the window is resized.
+ ***********************************************************/
+void OverdrawView::AddPasses(FrameGraph& graph, std::function<void()> drawScene)
+{
+	m_pGraph = &graph;
+
+	FrameGraph::TEXTURE_DESC countDesc = { 0, 0, g_CountFormat };
+	FrameGraph::TEXTURE_DESC depthDesc = { 0, 0, g_DepthFormat };
+	m_countTexture = graph.CreateTexture("OverdrawCounts", countDesc);
+	GLuint depthTexture = graph.CreateTexture("OverdrawDepth", depthDesc);
+
+	GLuint countPass = graph.AddPass("OverdrawCount", [this, drawScene]()
+		{
+			BeginCount();
+			drawScene();
+			EndCount();
+		});
+	graph.WriteTexture(countPass, m_countTexture);
+	graph.WriteTexture(countPass, depthTexture);
+	graph.SetSideEffect(countPass);
+
+	GLuint heatmapPass = graph.AddPass("OverdrawHeatmap", [this]()
+		{
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			DrawHeatmap();
+		});
+	graph.ReadTexture(heatmapPass, m_countTexture);
+	graph.WriteTexture(heatmapPass, graph.GetBackbuffer());
+}
+
+/***********************************************************
+ *  BeginCount()
+ *
+ *  This method is used for clearing the counting target
+ *  and setting up additive blending, so each fragment the
+ *  counting shader writes adds one to its pixel.
+ ***********************************************************/
+void OverdrawView::BeginCount()
+{
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+
+	if (m_bCountHidden == true)
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+}
+
+/***********************************************************
+ *  EndCount()
+ *
+ *  This method is used for restoring the default drawing
+ *  state and reading back the counts for the statistics.
+ *  The read back stalls on the GPU, which is acceptable
+ *  for a debug view.  The counts are read at the current
+ *  size of the target, which changes with the window.
+ ***********************************************************/
+void OverdrawView::EndCount()
+{
+	GLsizei width = 0;
+	GLsizei height = 0;
+	m_pGraph->GetBackbufferSize(width, height);
+	m_width = width;
+	m_height = height;
+	m_counts.resize((size_t)m_width * m_height);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, m_width, m_height, GL_RED, GL_FLOAT, m_counts.data());
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_DEPTH_TEST);
+
+	double total = 0.0;
+	float maxCount = 0.0f;
+	GLuint nCovered = 0;
+	for (size_t i = 0; i < m_counts.size(); i++)
+	{
+		float count = m_counts[i];
+		if (count > 0.0f)
+		{
+			total += count;
+			maxCount = std::max(maxCount, count);
+			nCovered++;
+		}
+	}
+
+	m_stats.averageOverdraw = (nCovered > 0) ? (float)(total / nCovered) : 0.0f;
+	m_stats.averageScreen = (m_counts.empty() == false) ? (float)(total / m_counts.size()) : 0.0f;
+	m_stats.maxOverdraw = maxCount;
+	m_stats.coveredPixels = nCovered;
+}
+
+/***********************************************************
+ *  DrawHeatmap()
+ *
+ *  This method is used for drawing the counts over the
+ *  bound framebuffer with a full screen triangle.  The
+ *  program that was in use is restored afterwards, so the
+ *  scene shader keeps receiving its settings.
+ ***********************************************************/
+void OverdrawView::DrawHeatmap()
+{
+	GLint previousProgram = 0;
+
+	if ((NULL == m_pHeatmapShader) || (NULL == m_pGraph))
+	{
+		return;
+	}
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	m_pHeatmapShader->use();
+	glActiveTexture(GL_TEXTURE15);
+	glBindTexture(GL_TEXTURE_2D, m_pGraph->GetTexture(m_countTexture));
+	m_pHeatmapShader->setSampler2DValue(g_CountTextureName, 15);
+	m_pHeatmapShader->setFloatValue(g_HeatmapScaleName, m_heatmapScale);
+
+	glBindVertexArray(m_heatmapVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  SaveFramebuffer()
+ *
+ *  This method is used for writing the bound framebuffer
+ *  to a binary PPM image, which needs no image library.
+ ***********************************************************/
+bool OverdrawView::SaveFramebuffer(const char* filename) const
+{
+	std::vector<unsigned char> pixels((size_t)m_width * m_height * 3);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	FILE* file = fopen(filename, "wb");
+	if (NULL == file)
+	{
+		std::cout << "OverdrawView: could not write " << filename << std::endl;
+		return(false);
+	}
+
+	// the rows are read bottom up, PPM stores them top down
+	fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+	for (int y = m_height - 1; y >= 0; y--)
+	{
+		fwrite(&pixels[(size_t)y * m_width * 3], 1, (size_t)m_width * 3, file);
+	}
+	fclose(file);
+
+	return(true);
+}
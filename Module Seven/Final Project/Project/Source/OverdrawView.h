@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawview.h
+// ============
+// debug view that counts the fragments written to each pixel and shows the
+// counts as a heatmap
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameGraph.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  OverdrawView
+ *
+ *  This class contains the code for measuring overdraw.
+ *  It adds two passes to the frame graph: the counting
+ *  pass draws the scene with the counting shaders, where
+ *  every fragment that passes the depth test adds one to
+ *  its pixel in a transient target, and reads the counts
+ *  back for the frame statistics.  The heatmap pass then
+ *  draws the counts to the backbuffer.
+ ***********************************************************/
+class OverdrawView
+{
+public:
+	// overdraw measured for the last counted frame
+	struct OVERDRAW_STATS
+	{
+		float averageOverdraw;  // Fragments per covered pixel
+		float averageScreen;    // Fragments per screen pixel
+		float maxOverdraw;      // Most fragments on one pixel
+		GLuint coveredPixels;   // Pixels with at least one fragment
+	};
+
+	// constructor
+	OverdrawView();
+	// destructor
+	~OverdrawView();
+
+	// load the heatmap shader
+	bool Create(int width, int height);
+	// free the GL objects
+	void Destroy();
+
+	// count every fragment instead of only the ones passing
+	// the depth test, which shows the total rasterized work
+	void SetCountHiddenFragments(bool bCountHidden);
+	// set the overdraw shown as the hottest heatmap color
+	void SetHeatmapScale(float maxOverdraw);
+
+	// add the counting pass, which draws the scene with the
+	// passed function, and the heatmap pass to the graph
+	void AddPasses(FrameGraph& graph, std::function<void()> drawScene);
+
+	// get the overdraw of the last counted frame
+	const OVERDRAW_STATS& GetStats() const { return(m_stats); }
+
+	// save the bound framebuffer as a binary PPM image
+	bool SaveFramebuffer(const char* filename) const;
+
+private:
+	// set up additive blending into the bound counting target
+	void BeginCount();
+	// restore the drawing state and read back the counts
+	void EndCount();
+	// draw the counts as a heatmap over the bound framebuffer
+	void DrawHeatmap();
+
+	// size of the counting target
+	int m_width;
+	int m_height;
+
+	// graph owning the counting target, one float per pixel,
+	// and its depth
+	FrameGraph* m_pGraph;
+	GLuint m_countTexture;
+	// empty VAO for the full screen triangle
+	GLuint m_heatmapVAO;
+	// shader for drawing the heatmap
+	ShaderManager* m_pHeatmapShader;
+
+	bool m_bCountHidden;
+	float m_heatmapScale;
+
+	// reused buffer for reading back the counts
+	std::vector<float> m_counts;
+	OVERDRAW_STATS m_stats;
+};
@@ -0,0 +1,841 @@
+///////////////////////////////////////////////////////////////////////////////
+// RenderService.cpp
+// ============
+// serves renders of the resident scene to other local processes over a Unix
+// domain socket, batching the compatible requests into shared passes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderService.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// batching used until SetBatching() is called
+	const double g_DefaultBatchWindowMs = 2.0;
+	const GLuint g_DefaultMaxBatch = 16;
+	// connections waiting to be accepted
+	const int g_ListenBacklog = 16;
+	// longest wait for requests while none are waiting
+	const int g_IdleWaitMs = 100;
+	const double g_ReportMs = 1000.0;
+	// bytes per pixel of the shared images
+	const GLsizei g_PixelBytes = 4;
+
+#ifdef __linux__
+	// set by SIGINT and SIGTERM to stop the service
+	volatile sig_atomic_t g_bStopService = 0;
+
+	void StopService(int)
+	{
+		g_bStopService = 1;
+	}
+#endif
+}
+
+/***********************************************************
+ *  RenderService()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderService::RenderService(SceneManager* pSceneManager, ViewManager* pViewManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_batchWindowMs = g_DefaultBatchWindowMs;
+	m_maxBatch = g_DefaultMaxBatch;
+	m_listenSocket = -1;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_runStartMs = 0.0;
+	m_reportStartMs = 0.0;
+	m_reportBatches = 0;
+	m_runBatches = 0;
+	m_reportRejected = 0;
+	m_runRejected = 0;
+}
+
+/***********************************************************
+ *  ~RenderService()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderService::~RenderService()
+{
+	Close();
+	DestroyTarget();
+}
+
+/***********************************************************
+ *  SetBatching()
+ *
+ *  This method is used for setting how long the oldest
+ *  waiting request waits for compatible ones, and the most
+ *  requests drawn in one pass.  A longer window gives
+ *  larger batches at the cost of latency.
+ ***********************************************************/
+void RenderService::SetBatching(double windowMs, GLuint maxBatch)
+{
+	m_batchWindowMs = std::max(0.0, windowMs);
+	m_maxBatch = std::max((GLuint)1, maxBatch);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for serving requests until SIGINT
+ *  or SIGTERM.  The oldest waiting request is drawn, with
+ *  the ones compatible with it, once it has waited the
+ *  batching window or a full batch is waiting.
+ ***********************************************************/
+bool RenderService::Run(const char* socketPath, std::ostream& stream)
+{
+#ifdef __linux__
+	if (Listen(socketPath) == false)
+	{
+		return(false);
+	}
+
+	struct sigaction action;
+	struct sigaction oldInterrupt;
+	struct sigaction oldTerminate;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = StopService;
+	sigemptyset(&action.sa_mask);
+	// no SA_RESTART, so the signal wakes up poll()
+	action.sa_flags = 0;
+	g_bStopService = 0;
+	sigaction(SIGINT, &action, &oldInterrupt);
+	sigaction(SIGTERM, &action, &oldTerminate);
+
+	stream << "Render service: listening on " << m_socketPath
+		<< ", batching window " << m_batchWindowMs << " ms, up to " << m_maxBatch << " requests" << std::endl;
+
+	m_runStartMs = GetTimeMs();
+	m_reportStartMs = m_runStartMs;
+	while (g_bStopService == 0)
+	{
+		int timeoutMs = g_IdleWaitMs;
+		if (m_pending.empty() == false)
+		{
+			double waitedMs = GetTimeMs() - m_pending[0].receivedMs;
+			timeoutMs = std::min(g_IdleWaitMs, (int)ceil(std::max(0.0, m_batchWindowMs - waitedMs)));
+		}
+		Poll(timeoutMs);
+
+		while ((m_pending.empty() == false) &&
+			((GetTimeMs() - m_pending[0].receivedMs >= m_batchWindowMs) || (m_pending.size() >= m_maxBatch)))
+		{
+			RenderBatch();
+		}
+
+		// report the requests answered in the last second
+		double nowMs = GetTimeMs();
+		if (nowMs - m_reportStartMs >= g_ReportMs)
+		{
+			if (m_reportLatencies.empty() == false)
+			{
+				SERVICE_STATS stats;
+				GetStats(m_reportLatencies, m_reportBatches, m_reportRejected, (nowMs - m_reportStartMs) / 1000.0, stats);
+				stream << "Render service: " << stats.requestsPerSecond << " requests/s"
+					<< " in " << stats.nBatches << " batches"
+					<< ", latency average " << stats.averageMs
+					<< " ms, p95 " << stats.p95Ms
+					<< " ms, max " << stats.maxMs
+					<< " ms, " << stats.nRejected << " rejected" << std::endl;
+			}
+			m_reportLatencies.clear();
+			m_reportBatches = 0;
+			m_reportRejected = 0;
+			m_reportStartMs = nowMs;
+		}
+	}
+
+	sigaction(SIGINT, &oldInterrupt, NULL);
+	sigaction(SIGTERM, &oldTerminate, NULL);
+	Close();
+	DestroyTarget();
+
+	SERVICE_STATS stats;
+	GetStats(m_runLatencies, m_runBatches, m_runRejected, (GetTimeMs() - m_runStartMs) / 1000.0, stats);
+	stream << "RENDER_SERVICE requests=" << stats.nRequests
+		<< " rejected=" << stats.nRejected
+		<< " batches=" << stats.nBatches
+		<< " per_batch=" << ((stats.nBatches > 0) ? (double)(stats.nRequests - stats.nRejected) / stats.nBatches : 0.0)
+		<< " requests_per_second=" << stats.requestsPerSecond
+		<< " average_ms=" << stats.averageMs
+		<< " p95_ms=" << stats.p95Ms
+		<< " max_ms=" << stats.maxMs << std::endl;
+
+	return(true);
+#else
+	std::cout << "RenderService: Unix domain sockets are not available on this platform" << std::endl;
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Listen()
+ *
+ *  This method is used for opening the listening socket.
+ *  A socket file left by a service that did not stop
+ *  cleanly is replaced, any other file is left alone.
+ ***********************************************************/
+bool RenderService::Listen(const char* socketPath)
+{
+#ifdef __linux__
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		std::cout << "RenderService: the socket path " << socketPath << " is too long" << std::endl;
+		return(false);
+	}
+	strcpy(address.sun_path, socketPath);
+
+	struct stat status;
+	if ((lstat(socketPath, &status) == 0) && (S_ISSOCK(status.st_mode)))
+	{
+		unlink(socketPath);
+	}
+
+	m_listenSocket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listenSocket < 0)
+	{
+		std::cout << "RenderService: could not create the socket, " << strerror(errno) << std::endl;
+		return(false);
+	}
+	if ((bind(m_listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0) ||
+		(listen(m_listenSocket, g_ListenBacklog) != 0))
+	{
+		std::cout << "RenderService: could not listen on " << socketPath << ", " << strerror(errno) << std::endl;
+		close(m_listenSocket);
+		m_listenSocket = -1;
+		return(false);
+	}
+
+	m_socketPath = socketPath;
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for closing every connection and
+ *  the listening socket, and removing the socket file.
+ ***********************************************************/
+void RenderService::Close()
+{
+#ifdef __linux__
+	for (size_t i = 0; i < m_clients.size(); i++)
+	{
+		close(m_clients[i]);
+	}
+	m_clients.clear();
+	m_pending.clear();
+
+	if (m_listenSocket >= 0)
+	{
+		close(m_listenSocket);
+		m_listenSocket = -1;
+		unlink(m_socketPath.c_str());
+	}
+#endif
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for waiting up to the passed in time
+ *  for connections and requests, and taking every one that
+ *  has arrived.
+ ***********************************************************/
+void RenderService::Poll(int timeoutMs)
+{
+#ifdef __linux__
+	std::vector<struct pollfd> files(m_clients.size() + 1);
+	files[0].fd = m_listenSocket;
+	files[0].events = POLLIN;
+	files[0].revents = 0;
+	for (size_t i = 0; i < m_clients.size(); i++)
+	{
+		files[i + 1].fd = m_clients[i];
+		files[i + 1].events = POLLIN;
+		files[i + 1].revents = 0;
+	}
+
+	if (poll(files.data(), files.size(), timeoutMs) <= 0)
+	{
+		return;
+	}
+
+	for (size_t i = 1; i < files.size(); i++)
+	{
+		if ((files[i].revents != 0) && (ReceiveRequests(files[i].fd) == false))
+		{
+			DropClient(files[i].fd);
+		}
+	}
+
+	if ((files[0].revents & POLLIN) != 0)
+	{
+		int client = accept4(m_listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		while (client >= 0)
+		{
+			m_clients.push_back(client);
+			client = accept4(m_listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  ReceiveRequests()
+ *
+ *  This method is used for taking every message waiting on
+ *  a connection.  A message of the wrong size is kept as
+ *  a request that is answered with an error.
+ ***********************************************************/
+bool RenderService::ReceiveRequests(int client)
+{
+#ifdef __linux__
+	while (true)
+	{
+		PENDING_REQUEST pending;
+		memset(&pending.request, 0, sizeof(pending.request));
+		ssize_t nReceived = recv(client, &pending.request, sizeof(pending.request), MSG_TRUNC);
+		if (nReceived < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return((errno == EAGAIN) || (errno == EWOULDBLOCK));
+		}
+		if (nReceived == 0)
+		{
+			return(false);
+		}
+
+		if (nReceived != (ssize_t)sizeof(pending.request))
+		{
+			pending.request.magic = 0;
+		}
+		pending.client = client;
+		pending.receivedMs = GetTimeMs();
+		m_pending.push_back(pending);
+	}
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  DropClient()
+ *
+ *  This method is used for closing a connection, the
+ *  requests it left waiting are dropped.
+ ***********************************************************/
+void RenderService::DropClient(int client)
+{
+#ifdef __linux__
+	std::vector<int>::iterator found = std::find(m_clients.begin(), m_clients.end(), client);
+	if (found == m_clients.end())
+	{
+		return;
+	}
+	m_clients.erase(found);
+	close(client);
+
+	size_t nKept = 0;
+	for (size_t i = 0; i < m_pending.size(); i++)
+	{
+		if (m_pending[i].client != client)
+		{
+			m_pending[nKept++] = m_pending[i];
+		}
+	}
+	m_pending.resize(nKept);
+#endif
+}
+
+/***********************************************************
+ *  RenderBatch()
+ *
+ *  This method is used for drawing the oldest waiting
+ *  request together with the waiting requests compatible
+ *  with it, as tiles of one target.  A request that cannot
+ *  be drawn is answered on its own with an error.  The
+ *  other requests keep their order for the next batch.
+ ***********************************************************/
+void RenderService::RenderBatch()
+{
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+
+	const RENDER_REQUEST first = m_pending[0].request;
+	std::vector<BATCH_ENTRY> batch;
+	std::vector<PENDING_REQUEST> remaining;
+
+	if ((IsValidRequest(first) == false) || ((GLint)first.width > maxSize) || ((GLint)first.height > maxSize))
+	{
+		BATCH_ENTRY entry;
+		entry.pending = m_pending[0];
+		entry.reply.status = RENDER_BAD_REQUEST;
+		entry.imageFile = -1;
+		batch.push_back(entry);
+		remaining.assign(m_pending.begin() + 1, m_pending.end());
+	}
+	else
+	{
+		// the batch is limited to the tiles that fit in the
+		// largest target
+		GLsizei columns = std::max(1, maxSize / (GLint)first.width);
+		GLsizei rows = std::max(1, maxSize / (GLint)first.height);
+		size_t maxBatch = std::min((size_t)m_maxBatch, (size_t)columns * rows);
+
+		for (size_t i = 0; i < m_pending.size(); i++)
+		{
+			if ((batch.size() < maxBatch) &&
+				(IsValidRequest(m_pending[i].request) == true) &&
+				(IsCompatible(first, m_pending[i].request) == true))
+			{
+				BATCH_ENTRY entry;
+				entry.pending = m_pending[i];
+				entry.reply.status = RENDER_OK;
+				entry.imageFile = -1;
+				batch.push_back(entry);
+			}
+			else
+			{
+				remaining.push_back(m_pending[i]);
+			}
+		}
+	}
+	m_pending.swap(remaining);
+
+	double batchStartMs = GetTimeMs();
+	if (batch[0].reply.status == RENDER_OK)
+	{
+		GLsizei width = (GLsizei)first.width;
+		GLsizei height = (GLsizei)first.height;
+		GLsizei columns = std::min((GLsizei)batch.size(), std::max(1, maxSize / width));
+		GLsizei rows = ((GLsizei)batch.size() + columns - 1) / columns;
+
+		if (EnsureTarget(columns * width, rows * height) == true)
+		{
+			DrawTiles(batch, columns);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+			for (size_t i = 0; i < batch.size(); i++)
+			{
+				GLint x = (GLint)(i % columns) * width;
+				GLint y = (GLint)(i / columns) * height;
+				batch[i].imageFile = ReadTile(x, y, width, height);
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			if (batch[i].imageFile < 0)
+			{
+				batch[i].reply.status = RENDER_FAILED;
+			}
+		}
+		m_reportBatches++;
+		m_runBatches++;
+	}
+	double renderMs = GetTimeMs() - batchStartMs;
+
+	// the replies are sent once the whole batch is drawn, a
+	// connection that cannot take its reply is dropped after
+	std::vector<int> failedClients;
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		BATCH_ENTRY& entry = batch[i];
+		entry.reply.magic = RENDER_SERVICE_MAGIC;
+		entry.reply.id = entry.pending.request.id;
+		entry.reply.width = (entry.reply.status == RENDER_OK) ? entry.pending.request.width : 0;
+		entry.reply.height = (entry.reply.status == RENDER_OK) ? entry.pending.request.height : 0;
+		entry.reply.stride = entry.reply.width * g_PixelBytes;
+		entry.reply.batchSize = (GLuint)batch.size();
+		entry.reply.queueMs = (float)(batchStartMs - entry.pending.receivedMs);
+		entry.reply.renderMs = (float)renderMs;
+
+		if (std::find(failedClients.begin(), failedClients.end(), entry.pending.client) == failedClients.end())
+		{
+			if (SendReply(entry.pending.client, entry.reply, entry.imageFile) == false)
+			{
+				failedClients.push_back(entry.pending.client);
+			}
+		}
+#ifdef __linux__
+		if (entry.imageFile >= 0)
+		{
+			close(entry.imageFile);
+		}
+#endif
+
+		double latencyMs = GetTimeMs() - entry.pending.receivedMs;
+		m_reportLatencies.push_back(latencyMs);
+		m_runLatencies.push_back(latencyMs);
+		if (entry.reply.status != RENDER_OK)
+		{
+			m_reportRejected++;
+			m_runRejected++;
+		}
+	}
+
+	for (size_t i = 0; i < failedClients.size(); i++)
+	{
+		DropClient(failedClients[i]);
+	}
+}
+
+/***********************************************************
+ *  IsValidRequest()
+ *
+ *  This method is used for checking that a request is of
+ *  this version and that its size and pose can be drawn.
+ ***********************************************************/
+bool RenderService::IsValidRequest(const RENDER_REQUEST& request)
+{
+	if ((request.magic != RENDER_SERVICE_MAGIC) || (request.version != RENDER_SERVICE_VERSION))
+	{
+		return(false);
+	}
+	if ((request.width == 0) || (request.width > RENDER_SERVICE_MAX_SIZE) ||
+		(request.height == 0) || (request.height > RENDER_SERVICE_MAX_SIZE))
+	{
+		return(false);
+	}
+	if ((request.pose < -1) || (request.pose >= ViewManager::GetCameraPoseCount()))
+	{
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsCompatible()
+ *
+ *  This method is used for checking whether two requests
+ *  can be drawn in the same pass, which needs the same
+ *  tile size and the same scene state.  The cameras and
+ *  clear colors are set per tile.
+ ***********************************************************/
+bool RenderService::IsCompatible(const RENDER_REQUEST& a, const RENDER_REQUEST& b)
+{
+	return((a.width == b.width) &&
+		(a.height == b.height) &&
+		(a.flags == b.flags) &&
+		(a.platterSeconds == b.platterSeconds));
+}
+
+/***********************************************************
+ *  DrawTiles()
+ *
+ *  This method is used for drawing the requests of a batch
+ *  into the tiles of the target, in rows of the passed in
+ *  number of columns.  The impostors and the platter are
+ *  set once, then each tile gets its own camera and clear
+ *  color.
+ ***********************************************************/
+void RenderService::DrawTiles(std::vector<BATCH_ENTRY>& batch, GLsizei columns)
+{
+	const RENDER_REQUEST& first = batch[0].pending.request;
+	GLsizei width = (GLsizei)first.width;
+	GLsizei height = (GLsizei)first.height;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_SCISSOR_TEST);
+
+	m_pSceneManager->SetImpostors((first.flags & RENDER_IMPOSTORS) != 0);
+	m_pSceneManager->AnimateSceneObjects(first.platterSeconds);
+	m_pViewManager->SetViewSize(width, height);
+
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		const RENDER_REQUEST& request = batch[i].pending.request;
+		GLint x = (GLint)(i % columns) * width;
+		GLint y = (GLint)(i / columns) * height;
+
+		glViewport(x, y, width, height);
+		glScissor(x, y, width, height);
+		glClearColor(request.clearColor[0], request.clearColor[1], request.clearColor[2], request.clearColor[3]);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		if (request.pose >= 0)
+		{
+			m_pViewManager->SetCameraPose(request.pose);
+		}
+		else
+		{
+			m_pViewManager->SetCamera(
+				glm::vec3(request.position[0], request.position[1], request.position[2]),
+				glm::vec3(request.front[0], request.front[1], request.front[2]),
+				request.zoom,
+				request.bOrthographic != 0);
+		}
+
+		m_pViewManager->PrepareSceneView();
+		m_pSceneManager->SetCullingView(
+			m_pViewManager->GetViewMatrix(),
+			m_pViewManager->GetProjectionMatrix(),
+			m_pViewManager->GetCameraPosition());
+		m_pSceneManager->RenderSceneObjects();
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	m_pViewManager->SetViewSize(0, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  ReadTile()
+ *
+ *  This method is used for reading one tile of the bound
+ *  target into a new memfd.  The pixels go from GL straight
+ *  into the shared pages, then the memfd is sealed so the
+ *  client can map an image nobody can change any more.
+ ***********************************************************/
+int RenderService::ReadTile(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+#ifdef __linux__
+	size_t bytes = (size_t)width * (size_t)height * g_PixelBytes;
+
+	int imageFile = memfd_create("render-service-image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (imageFile < 0)
+	{
+		std::cout << "RenderService: could not create the image memory, " << strerror(errno) << std::endl;
+		return(-1);
+	}
+	if (ftruncate(imageFile, (off_t)bytes) != 0)
+	{
+		close(imageFile);
+		return(-1);
+	}
+
+	void* pImage = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, imageFile, 0);
+	if (pImage == MAP_FAILED)
+	{
+		close(imageFile);
+		return(-1);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pImage);
+	munmap(pImage, bytes);
+
+	// the write seal needs every writable mapping gone
+	if (fcntl(imageFile, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0)
+	{
+		close(imageFile);
+		return(-1);
+	}
+
+	return(imageFile);
+#else
+	return(-1);
+#endif
+}
+
+/***********************************************************
+ *  SendReply()
+ *
+ *  This method is used for sending a reply, with the image
+ *  memfd in its SCM_RIGHTS control data when there is one.
+ *  The connection does not block, so a client that stops
+ *  reading its replies fails here instead of stalling the
+ *  service.
+ ***********************************************************/
+bool RenderService::SendReply(int client, const RENDER_REPLY& reply, int imageFile)
+{
+#ifdef __linux__
+	struct iovec data;
+	data.iov_base = (void*)&reply;
+	data.iov_len = sizeof(reply);
+
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &data;
+	message.msg_iovlen = 1;
+	if (imageFile >= 0)
+	{
+		message.msg_control = control.buffer;
+		message.msg_controllen = sizeof(control.buffer);
+
+		struct cmsghdr* pHeader = CMSG_FIRSTHDR(&message);
+		pHeader->cmsg_level = SOL_SOCKET;
+		pHeader->cmsg_type = SCM_RIGHTS;
+		pHeader->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(pHeader), &imageFile, sizeof(int));
+	}
+
+	ssize_t nSent = sendmsg(client, &message, MSG_NOSIGNAL);
+	while ((nSent < 0) && (errno == EINTR))
+	{
+		nSent = sendmsg(client, &message, MSG_NOSIGNAL);
+	}
+
+	return(nSent == (ssize_t)sizeof(reply));
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  EnsureTarget()
+ *
+ *  This method is used for creating the offscreen color
+ *  and depth target when the current one is smaller than
+ *  the passed in size.  The target only grows, so the
+ *  batches after the largest one reuse it.
+ ***********************************************************/
+bool RenderService::EnsureTarget(GLsizei width, GLsizei height)
+{
+	if ((m_framebuffer != 0) && (width <= m_targetWidth) && (height <= m_targetHeight))
+	{
+		return(true);
+	}
+
+	width = std::max(width, m_targetWidth);
+	height = std::max(height, m_targetHeight);
+	DestroyTarget();
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "RenderService: " << width << "x" << height << " target is not complete, status " << status << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+
+	m_targetWidth = width;
+	m_targetHeight = height;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void RenderService::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for filling the stats from the
+ *  latencies of the answered requests, which are sorted.
+ ***********************************************************/
+void RenderService::GetStats(
+	std::vector<double>& latencies,
+	GLuint nBatches,
+	GLuint nRejected,
+	double seconds,
+	SERVICE_STATS& stats)
+{
+	stats.nRequests = (GLuint)latencies.size();
+	stats.nRejected = nRejected;
+	stats.nBatches = nBatches;
+	stats.averageMs = 0.0;
+	stats.p95Ms = 0.0;
+	stats.maxMs = 0.0;
+	stats.requestsPerSecond = (seconds > 0.0) ? latencies.size() / seconds : 0.0;
+
+	if (latencies.empty() == true)
+	{
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	double totalMs = 0.0;
+	for (size_t i = 0; i < latencies.size(); i++)
+	{
+		totalMs += latencies[i];
+	}
+	stats.averageMs = totalMs / latencies.size();
+	stats.p95Ms = latencies[(size_t)ceil(0.95 * latencies.size()) - 1];
+	stats.maxMs = latencies.back();
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This method is used for reading the wall clock.
+ ***********************************************************/
+double RenderService::GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderservice.h
+// ============
+// serves renders of the resident scene to other local processes over a Unix
+// domain socket, batching the compatible requests into shared passes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "RenderServiceFormat.h"
+
+#include <GL/glew.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  RenderService
+ *
+ *  This class contains the render daemon.  The scene,
+ *  textures and shaders stay loaded in the hidden window's
+ *  context, and requests arrive over a Unix domain socket
+ *  as RENDER_REQUEST messages.
+ *
+ *  Requests are gathered for a short batching window.  The
+ *  compatible ones, those with the same size, flags and
+ *  platter time, are drawn as tiles of one offscreen
+ *  target, so the scene state is set once per batch.  Each
+ *  tile is read back straight into a sealed memfd, which
+ *  is passed to the client with the reply, so the image
+ *  never goes through the socket.
+ *
+ *  The latency and throughput are reported once a second
+ *  while requests arrive, and for the whole run when the
+ *  service is stopped by SIGINT or SIGTERM.
+ ***********************************************************/
+class RenderService
+{
+public:
+	struct SERVICE_STATS
+	{
+		GLuint nRequests;         // Requests answered
+		GLuint nRejected;         // Requests answered with an error
+		GLuint nBatches;          // Passes drawn
+		double averageMs;         // From receiving a request to sending its reply
+		double p95Ms;
+		double maxMs;
+		double requestsPerSecond;
+	};
+
+	// constructor
+	RenderService(SceneManager* pSceneManager, ViewManager* pViewManager);
+	// destructor
+	~RenderService();
+
+	// set how long the first waiting request waits for
+	// others, and the most requests drawn in one pass
+	void SetBatching(double windowMs, GLuint maxBatch);
+
+	// serve requests on the passed in socket path until
+	// stopped, false when the socket cannot be opened
+	bool Run(const char* socketPath, std::ostream& stream);
+
+private:
+	// a received request waiting for its batch
+	struct PENDING_REQUEST
+	{
+		int client;             // Socket of the connection
+		RENDER_REQUEST request;
+		double receivedMs;
+	};
+
+	// the reply and image of a request in the batch
+	struct BATCH_ENTRY
+	{
+		PENDING_REQUEST pending;
+		RENDER_REPLY reply;
+		int imageFile;          // Sealed memfd, -1 when there is none
+	};
+
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+
+	double m_batchWindowMs;
+	GLuint m_maxBatch;
+
+	// listening socket, its path and the connections
+	int m_listenSocket;
+	std::string m_socketPath;
+	std::vector<int> m_clients;
+	std::vector<PENDING_REQUEST> m_pending;
+
+	// offscreen target the tiles of a batch are drawn into,
+	// grown to the largest batch so far
+	GLsizei m_targetWidth;
+	GLsizei m_targetHeight;
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// request latencies since the last report and the run
+	double m_runStartMs;
+	double m_reportStartMs;
+	std::vector<double> m_reportLatencies;
+	std::vector<double> m_runLatencies;
+	GLuint m_reportBatches;
+	GLuint m_runBatches;
+	GLuint m_reportRejected;
+	GLuint m_runRejected;
+
+	// called to open the socket, replacing a stale one
+	bool Listen(const char* socketPath);
+	// called to close the socket and every connection
+	void Close();
+	// called to wait for connections and requests
+	void Poll(int timeoutMs);
+	// called to take the messages of a connection, false
+	// when it has closed
+	bool ReceiveRequests(int client);
+	// called to drop a connection and its waiting requests
+	void DropClient(int client);
+
+	// called to take the oldest waiting request and the
+	// ones compatible with it, and draw them in one pass
+	void RenderBatch();
+	// called to check that a request can be drawn
+	static bool IsValidRequest(const RENDER_REQUEST& request);
+	static bool IsCompatible(const RENDER_REQUEST& a, const RENDER_REQUEST& b);
+	// called to draw the tiles of a batch into the target
+	void DrawTiles(std::vector<BATCH_ENTRY>& batch, GLsizei columns);
+	// called to read a tile into a new sealed memfd, -1 when
+	// it cannot be created
+	int ReadTile(GLint x, GLint y, GLsizei width, GLsizei height);
+	// called to send a reply, with the image when there is
+	// one, false when the connection cannot take it
+	bool SendReply(int client, const RENDER_REPLY& reply, int imageFile);
+
+	// create the offscreen target when it is smaller than
+	// the passed in size
+	bool EnsureTarget(GLsizei width, GLsizei height);
+	// free the offscreen target
+	void DestroyTarget();
+
+	// called to fill the stats from a list of latencies
+	static void GetStats(
+		std::vector<double>& latencies,
+		GLuint nBatches,
+		GLuint nRejected,
+		double seconds,
+		SERVICE_STATS& stats);
+	static double GetTimeMs();
+};
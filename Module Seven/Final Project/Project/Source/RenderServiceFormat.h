@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserviceformat.h
+// ============
+// messages shared by the render service and the processes asking it for
+// images over its Unix domain socket
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+// "RSRV" at the start of every message
+const uint32_t RENDER_SERVICE_MAGIC = 0x56525352;
+const uint32_t RENDER_SERVICE_VERSION = 1;
+// largest width and height of a requested image
+const uint32_t RENDER_SERVICE_MAX_SIZE = 4096;
+
+/***********************************************************
+ *  RENDER_REQUEST
+ *
+ *  One message on the socket, which is a SOCK_SEQPACKET
+ *  socket so each message arrives whole.  The camera is a
+ *  standard pose, or the position and front below when the
+ *  pose is -1.  Requests with the same size, flags and
+ *  platter time are compatible and drawn in one pass.
+ ***********************************************************/
+struct RENDER_REQUEST
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t id;            // Returned in the reply
+	int32_t pose;           // Standard camera pose, -1 for the camera below
+	float position[3];
+	float front[3];
+	float zoom;             // Vertical field of view in degrees
+	uint32_t bOrthographic;
+	uint32_t width;
+	uint32_t height;
+	float clearColor[4];
+	float platterSeconds;   // Time of the turntable animation
+	uint32_t flags;         // RENDER_REQUEST_FLAGS
+};
+
+enum RENDER_REQUEST_FLAGS
+{
+	// ray cast the spheres, cylinders and cones
+	RENDER_IMPOSTORS = 1
+};
+
+enum RENDER_STATUS
+{
+	RENDER_OK = 0,
+	RENDER_BAD_REQUEST,     // Wrong magic or version, size or pose out of range
+	RENDER_FAILED           // The image could not be drawn or shared
+};
+
+/***********************************************************
+ *  RENDER_REPLY
+ *
+ *  Sent for every request, in the order the requests of
+ *  one connection were drawn.  When the status is
+ *  RENDER_OK the message carries a memfd in its
+ *  SCM_RIGHTS control data, sealed so it can no longer be
+ *  changed, holding the RGBA image with the bottom row
+ *  first.  The receiver maps it and closes it when done.
+ ***********************************************************/
+struct RENDER_REPLY
+{
+	uint32_t magic;
+	uint32_t id;
+	uint32_t status;        // RENDER_STATUS
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;        // Bytes of one row of the image
+	uint32_t batchSize;     // Requests drawn in the same pass
+	float queueMs;          // From receiving the request to drawing its batch
+	float renderMs;         // Drawing and reading back the batch
+};
@@ -0,0 +1,322 @@
+///////////////////////////////////////////////////////////////////////////////
+// ResourceCache.cpp
+// ============
+// process wide cache of the GPU textures and meshes of the scenes, so a scene
+// opened again reuses what an earlier one loaded
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceCache.h"
+#include "GLCapture.h"
+
+namespace
+{
+	// budget used until SetBudget() is called
+	const size_t g_DefaultBudgetBytes = (size_t)256 * 1024 * 1024;
+
+	const uint64_t g_HashPrime = 1099511628211ULL;
+}
+
+std::mutex ResourceCache::m_lock;
+std::map<uint64_t, ResourceCache::ENTRY> ResourceCache::m_entries;
+std::list<uint64_t> ResourceCache::m_unheld;
+size_t ResourceCache::m_loadedBytes = 0;
+size_t ResourceCache::m_unheldBytes = 0;
+size_t ResourceCache::m_budgetBytes = g_DefaultBudgetBytes;
+GLuint ResourceCache::m_nHits = 0;
+GLuint ResourceCache::m_nMisses = 0;
+GLuint ResourceCache::m_nEvictions = 0;
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the bytes the loaded
+ *  entries may add up to, freeing unheld entries right
+ *  away when they are over the new budget.
+ ***********************************************************/
+void ResourceCache::SetBudget(size_t budgetBytes)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_budgetBytes = budgetBytes;
+	Trim(m_budgetBytes);
+}
+
+/***********************************************************
+ *  HashBytes()
+ *
+ *  This method is used for hashing the content of a
+ *  resource into its key.
+ ***********************************************************/
+uint64_t ResourceCache::HashBytes(const void* pData, size_t nBytes, uint64_t hash)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		hash = (hash ^ pBytes[i]) * g_HashPrime;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  AcquireTexture()
+ *
+ *  This method is used for holding a cached texture.
+ ***********************************************************/
+bool ResourceCache::AcquireTexture(uint64_t key, TEXTURE& texture)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	ENTRY* pEntry = Acquire(key, ENTRY_TEXTURE);
+	if (NULL == pEntry)
+	{
+		return(false);
+	}
+
+	texture = pEntry->texture;
+	return(true);
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for adding a loaded texture, held
+ *  once by the caller.
+ ***********************************************************/
+ResourceCache::TEXTURE ResourceCache::AddTexture(uint64_t& key, const TEXTURE& texture, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	ENTRY entry;
+	entry.type = ENTRY_TEXTURE;
+	entry.texture = texture;
+	entry.pMeshes = NULL;
+	entry.bytes = bytes;
+	return(Add(key, entry).texture);
+}
+
+/***********************************************************
+ *  AcquireMeshes()
+ *
+ *  This method is used for holding a cached mesh set.
+ ***********************************************************/
+ShapeMeshes* ResourceCache::AcquireMeshes(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	ENTRY* pEntry = Acquire(key, ENTRY_MESHES);
+	return((NULL != pEntry) ? pEntry->pMeshes : NULL);
+}
+
+/***********************************************************
+ *  AddMeshes()
+ *
+ *  This method is used for adding a loaded mesh set, held
+ *  once by the caller.
+ ***********************************************************/
+ShapeMeshes* ResourceCache::AddMeshes(uint64_t& key, ShapeMeshes* pMeshes, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	ENTRY entry;
+	entry.type = ENTRY_MESHES;
+	entry.texture.ID = 0;
+	entry.texture.averageColor = glm::vec3(0.0f);
+	entry.pMeshes = pMeshes;
+	entry.bytes = bytes;
+	return(Add(key, entry).pMeshes);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for letting go of an entry.  The
+ *  last holder moves it to the front of the unheld list,
+ *  where it is the last to be freed.
+ ***********************************************************/
+void ResourceCache::Release(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	auto found = m_entries.find(key);
+	if ((found == m_entries.end()) || (found->second.nHolders == 0))
+	{
+		return;
+	}
+
+	ENTRY& entry = found->second;
+	entry.nHolders--;
+	if (entry.nHolders == 0)
+	{
+		m_unheld.push_front(key);
+		entry.unheld = m_unheld.begin();
+		m_unheldBytes += entry.bytes;
+		Trim(m_budgetBytes);
+	}
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the size and use of the
+ *  cache.
+ ***********************************************************/
+void ResourceCache::GetStats(CACHE_STATS& stats)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	stats.nEntries = (GLuint)m_entries.size();
+	stats.nUnheld = (GLuint)m_unheld.size();
+	stats.loadedBytes = m_loadedBytes;
+	stats.unheldBytes = m_unheldBytes;
+	stats.budgetBytes = m_budgetBytes;
+	stats.nHits = m_nHits;
+	stats.nMisses = m_nMisses;
+	stats.nEvictions = m_nEvictions;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing every unheld entry.
+ ***********************************************************/
+void ResourceCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	Trim(0);
+}
+
+/***********************************************************
+ *  Acquire()
+ *
+ *  This method is used for finding an entry and holding it,
+ *  taking it off the unheld list.  Keys of different types
+ *  never match.
+ ***********************************************************/
+ResourceCache::ENTRY* ResourceCache::Acquire(uint64_t key, ENTRY_TYPE type)
+{
+	auto found = m_entries.find(key);
+	if ((found == m_entries.end()) || (found->second.type != type))
+	{
+		m_nMisses++;
+		return(NULL);
+	}
+
+	ENTRY& entry = found->second;
+	if (entry.nHolders == 0)
+	{
+		m_unheld.erase(entry.unheld);
+		m_unheldBytes -= entry.bytes;
+	}
+	entry.nHolders++;
+	m_nHits++;
+
+	return(&entry);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding an entry held once.  When
+ *  another scene has added the same content meanwhile, the
+ *  entry there is held instead and the passed in one freed,
+ *  so the caller goes on with what is returned.
+ *
+ *  A key already used by another type of entry is a hash
+ *  collision.  An unheld entry there is evicted first, so
+ *  its GL objects are not lost, while a held one is kept
+ *  and the key moved on to the next one not taken by
+ *  another type.
+ ***********************************************************/
+ResourceCache::ENTRY& ResourceCache::Add(uint64_t& key, ENTRY entry)
+{
+	auto found = m_entries.find(key);
+	while ((found != m_entries.end()) && (found->second.type != entry.type))
+	{
+		if (found->second.nHolders == 0)
+		{
+			m_unheld.erase(found->second.unheld);
+			m_loadedBytes -= found->second.bytes;
+			m_unheldBytes -= found->second.bytes;
+			Free(found->second);
+			m_entries.erase(found);
+			m_nEvictions++;
+			found = m_entries.end();
+		}
+		else
+		{
+			key++;
+			found = m_entries.find(key);
+		}
+	}
+
+	if (found != m_entries.end())
+	{
+		Free(entry);
+		if (found->second.nHolders == 0)
+		{
+			m_unheld.erase(found->second.unheld);
+			m_unheldBytes -= found->second.bytes;
+		}
+		found->second.nHolders++;
+		return(found->second);
+	}
+
+	ENTRY& added = m_entries[key];
+	added = entry;
+	added.nHolders = 1;
+	added.unheld = m_unheld.end();
+	m_loadedBytes += entry.bytes;
+
+	Trim(m_budgetBytes);
+
+	return(added);
+}
+
+/***********************************************************
+ *  Trim()
+ *
+ *  This method is used for freeing the least recently used
+ *  unheld entries until the loaded bytes fit.
+ ***********************************************************/
+void ResourceCache::Trim(size_t maxBytes)
+{
+	while ((m_loadedBytes > maxBytes) && (m_unheld.empty() == false))
+	{
+		uint64_t key = m_unheld.back();
+		m_unheld.pop_back();
+
+		auto found = m_entries.find(key);
+		if (found == m_entries.end())
+		{
+			continue;
+		}
+
+		m_loadedBytes -= found->second.bytes;
+		m_unheldBytes -= found->second.bytes;
+		Free(found->second);
+		m_entries.erase(found);
+		m_nEvictions++;
+	}
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for freeing the GL objects of an
+ *  entry.
+ ***********************************************************/
+void ResourceCache::Free(ENTRY& entry)
+{
+	if ((entry.type == ENTRY_TEXTURE) && (entry.texture.ID != 0))
+	{
+		glDeleteTextures(1, &entry.texture.ID);
+		entry.texture.ID = 0;
+	}
+	if (NULL != entry.pMeshes)
+	{
+		delete entry.pMeshes;
+		entry.pMeshes = NULL;
+	}
+}
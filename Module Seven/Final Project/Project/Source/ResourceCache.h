@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcecache.h
+// ============
+// process wide cache of the GPU textures and meshes of the scenes, so a scene
+// opened again reuses what an earlier one loaded
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+
+/***********************************************************
+ *  ResourceCache
+ *
+ *  This class contains the cache of loaded GPU resources,
+ *  shared by every scene of the process.  Entries are
+ *  keyed by a hash of their content - the file bytes of a
+ *  texture, the list of generated meshes of a mesh set -
+ *  and counted by the scenes holding them.
+ *
+ *  An entry no scene holds stays loaded, so the next scene
+ *  that needs it skips the decoding and upload.  Only when
+ *  the loaded entries add up to more than the budget are
+ *  the unheld ones freed, the least recently used first.
+ *  Held entries are never freed, so the budget can be
+ *  passed while the open scenes need more.
+ *
+ *  The entries are GL objects, so the cache is used on the
+ *  thread owning the GL context, and cleared before the
+ *  context goes.
+ ***********************************************************/
+class ResourceCache
+{
+public:
+	// a cached texture and what the scenes keep of it
+	struct TEXTURE
+	{
+		GLuint ID;
+		glm::vec3 averageColor;
+	};
+
+	struct CACHE_STATS
+	{
+		GLuint nEntries;
+		GLuint nUnheld;           // Entries no scene holds
+		size_t loadedBytes;
+		size_t unheldBytes;
+		size_t budgetBytes;
+		GLuint nHits;             // Acquires served from the cache
+		GLuint nMisses;
+		GLuint nEvictions;
+	};
+
+	// set the bytes the loaded entries may add up to before
+	// the unheld ones are freed
+	static void SetBudget(size_t budgetBytes);
+
+	// FNV-1a hash of the passed in bytes, continuing from
+	// the passed in hash to cover several pieces
+	static uint64_t HashBytes(const void* pData, size_t nBytes, uint64_t hash = HASH_SEED);
+
+	// hold the texture with the passed in key, false when it
+	// is not cached
+	static bool AcquireTexture(uint64_t key, TEXTURE& texture);
+	// add a texture the caller has loaded, held once by it,
+	// returning the texture to use - the cache frees it
+	// when evicted.  The key is moved on when a mesh set
+	// is held under it, and is the one to release
+	static TEXTURE AddTexture(uint64_t& key, const TEXTURE& texture, size_t bytes);
+
+	// hold the mesh set with the passed in key, NULL when it
+	// is not cached
+	static ShapeMeshes* AcquireMeshes(uint64_t key);
+	// add a mesh set the caller has loaded, held once by it,
+	// returning the mesh set to use - the cache deletes it
+	// when evicted.  The key is moved on when a texture is
+	// held under it, and is the one to release
+	static ShapeMeshes* AddMeshes(uint64_t& key, ShapeMeshes* pMeshes, size_t bytes);
+
+	// let go of an entry, which stays loaded until the
+	// budget is passed
+	static void Release(uint64_t key);
+
+	static void GetStats(CACHE_STATS& stats);
+	// free every unheld entry, before the GL context goes
+	static void Clear();
+
+	static const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+private:
+	enum ENTRY_TYPE
+	{
+		ENTRY_TEXTURE = 0,
+		ENTRY_MESHES
+	};
+
+	struct ENTRY
+	{
+		ENTRY_TYPE type;
+		TEXTURE texture;
+		ShapeMeshes* pMeshes;
+		size_t bytes;
+		GLuint nHolders;
+		// place in the unheld list while nobody holds it
+		std::list<uint64_t>::iterator unheld;
+	};
+
+	// called with the lock held to find and hold an entry
+	static ENTRY* Acquire(uint64_t key, ENTRY_TYPE type);
+	// called with the lock held to add an entry, or hold
+	// the one already added for the key, moving the key on
+	// past entries of another type that are held
+	static ENTRY& Add(uint64_t& key, ENTRY entry);
+	// called with the lock held to free unheld entries, the
+	// least recently used first, until the passed in bytes
+	// are loaded at most
+	static void Trim(size_t maxBytes);
+	static void Free(ENTRY& entry);
+
+	static std::mutex m_lock;
+	static std::map<uint64_t, ENTRY> m_entries;
+	// unheld entries, the most recently released first
+	static std::list<uint64_t> m_unheld;
+	static size_t m_loadedBytes;
+	static size_t m_unheldBytes;
+	static size_t m_budgetBytes;
+	static GLuint m_nHits;
+	static GLuint m_nMisses;
+	static GLuint m_nEvictions;
+};
@@ -0,0 +1,340 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneBVH.cpp
+// ============
+// bounding volume hierarchy over the world space triangles of a scene, used
+// for tracing rays on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const GLuint g_MaxLeafTriangles = 4;	// Triangles stored in one leaf
+	const GLuint g_MaxTreeDepth = 60;		// Keeps the traversal stack bounded
+	const float g_TriangleEpsilon = 1.0e-9f;	// Rejects rays parallel to a triangle
+
+	/***********************************************************
+	 *  IntersectBounds()
+	 *
+	 *  Slab test of a ray against a bounding box, using the
+	 *  inverse of the ray direction.  Returns the entry
+	 *  distance, or FLT_MAX when the box is missed.
+	 ***********************************************************/
+	float IntersectBounds(
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance)
+	{
+		float tMin = 0.0f;
+		float tMax = maxDistance;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tMin = std::max(tMin, t0);
+			tMax = std::min(tMax, t1);
+		}
+
+		return((tMin <= tMax) ? tMin : FLT_MAX);
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  passed in triangle soup.  Each node is split at the
+ *  median centroid along its longest axis, which keeps the
+ *  tree balanced and the build O(n log n).
+ ***********************************************************/
+void SceneBVH::Build(const std::vector<glm::vec3>& vertices)
+{
+	GLuint nTriangles = (GLuint)vertices.size() / 3;
+	std::vector<glm::vec3> centroids(nTriangles);
+
+	m_vertices.assign(vertices.begin(), vertices.begin() + nTriangles * 3);
+	m_triangleOrder.resize(nTriangles);
+	m_nodes.clear();
+
+	for (GLuint i = 0; i < nTriangles; i++)
+	{
+		centroids[i] = (m_vertices[i * 3] + m_vertices[i * 3 + 1] + m_vertices[i * 3 + 2]) / 3.0f;
+		m_triangleOrder[i] = i;
+	}
+
+	if (nTriangles > 0)
+	{
+		m_nodes.reserve(2 * nTriangles / g_MaxLeafTriangles + 1);
+		BuildNode(centroids, 0, nTriangles, 0);
+	}
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building the subtree over a
+ *  range of the triangle order, and returns the index of
+ *  the subtree's root node.
+ ***********************************************************/
+GLuint SceneBVH::BuildNode(
+	const std::vector<glm::vec3>& centroids,
+	GLuint first,
+	GLuint count,
+	GLuint depth)
+{
+	GLuint nodeIndex = (GLuint)m_nodes.size();
+	BVH_NODE node;
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	for (GLuint i = first; i < first + count; i++)
+	{
+		GLuint triangle = m_triangleOrder[i];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			node.boundsMin = glm::min(node.boundsMin, m_vertices[triangle * 3 + corner]);
+			node.boundsMax = glm::max(node.boundsMax, m_vertices[triangle * 3 + corner]);
+		}
+		centroidMin = glm::min(centroidMin, centroids[triangle]);
+		centroidMax = glm::max(centroidMax, centroids[triangle]);
+	}
+
+	// split along the axis where the centroids spread the most
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	if ((count <= g_MaxLeafTriangles) || (depth >= g_MaxTreeDepth) || (extent[axis] <= 0.0f))
+	{
+		node.offset = first;
+		node.nTriangles = count;
+		m_nodes.push_back(node);
+		return(nodeIndex);
+	}
+
+	GLuint half = count / 2;
+	std::nth_element(
+		m_triangleOrder.begin() + first,
+		m_triangleOrder.begin() + first + half,
+		m_triangleOrder.begin() + first + count,
+		[&centroids, axis](GLuint a, GLuint b) { return(centroids[a][axis] < centroids[b][axis]); });
+
+	node.nTriangles = 0;
+	m_nodes.push_back(node);
+
+	BuildNode(centroids, first, half, depth + 1);
+	GLuint secondChild = BuildNode(centroids, first + half, count - half, depth + 1);
+	m_nodes[nodeIndex].offset = secondChild;
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  Intersect()
+ *
+ *  This method is used for finding the closest triangle
+ *  along a ray.
+ ***********************************************************/
+bool SceneBVH::Intersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	RAY_HIT& hit) const
+{
+	return(Traverse(origin, direction, maxDistance, false, hit));
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for shadow rays, where any hit is
+ *  enough to stop the search.
+ ***********************************************************/
+bool SceneBVH::IsOccluded(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance) const
+{
+	RAY_HIT hit;
+	return(Traverse(origin, direction, maxDistance, true, hit));
+}
+
+/***********************************************************
+ *  GetTriangleNormal()
+ *
+ *  This method is used for getting the unit normal of a
+ *  triangle passed to Build().
+ ***********************************************************/
+glm::vec3 SceneBVH::GetTriangleNormal(GLuint triangle) const
+{
+	glm::vec3 normal = glm::cross(
+		m_vertices[triangle * 3 + 1] - m_vertices[triangle * 3],
+		m_vertices[triangle * 3 + 2] - m_vertices[triangle * 3]);
+	float length = glm::length(normal);
+
+	if (length > 0.0f)
+	{
+		normal /= length;
+	}
+
+	return(normal);
+}
+
+/***********************************************************
+ *  GetBounds()
+ *
+ *  This method is used for getting the bounds of the
+ *  whole scene, which are empty before the tree is built.
+ ***********************************************************/
+void SceneBVH::GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	if (m_nodes.empty() == true)
+	{
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+		return;
+	}
+
+	boundsMin = m_nodes[0].boundsMin;
+	boundsMax = m_nodes[0].boundsMax;
+}
+
+/***********************************************************
+ *  IntersectTriangle()
+ *
+ *  This method is used for testing a ray against both
+ *  sides of one triangle (Moller-Trumbore), and updates
+ *  the hit when the triangle is closer.
+ ***********************************************************/
+bool SceneBVH::IntersectTriangle(
+	GLuint triangle,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	RAY_HIT& hit) const
+{
+	const glm::vec3& p0 = m_vertices[triangle * 3];
+	glm::vec3 edge1 = m_vertices[triangle * 3 + 1] - p0;
+	glm::vec3 edge2 = m_vertices[triangle * 3 + 2] - p0;
+
+	glm::vec3 p = glm::cross(direction, edge2);
+	float determinant = glm::dot(edge1, p);
+	if (std::fabs(determinant) < g_TriangleEpsilon)
+	{
+		return(false);
+	}
+
+	float inverseDeterminant = 1.0f / determinant;
+	glm::vec3 s = origin - p0;
+	float u = glm::dot(s, p) * inverseDeterminant;
+	if ((u < 0.0f) || (u > 1.0f))
+	{
+		return(false);
+	}
+
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(direction, q) * inverseDeterminant;
+	if ((v < 0.0f) || (u + v > 1.0f))
+	{
+		return(false);
+	}
+
+	float distance = glm::dot(edge2, q) * inverseDeterminant;
+	if ((distance <= 0.0f) || (distance >= maxDistance))
+	{
+		return(false);
+	}
+
+	hit.distance = distance;
+	hit.triangle = triangle;
+	hit.u = u;
+	hit.v = v;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Traverse()
+ *
+ *  This method is used for walking the tree with a fixed
+ *  size stack.  The ray's max distance shrinks as closer
+ *  hits are found, which prunes the remaining nodes.
+ ***********************************************************/
+bool SceneBVH::Traverse(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	bool bAnyHit,
+	RAY_HIT& hit) const
+{
+	GLuint stack[g_MaxTreeDepth + 2];
+	int stackSize = 0;
+	bool bHit = false;
+	glm::vec3 inverseDirection(
+		1.0f / direction.x,
+		1.0f / direction.y,
+		1.0f / direction.z);
+
+	if (m_nodes.empty() == true)
+	{
+		return(false);
+	}
+
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--stackSize]];
+
+		if (IntersectBounds(node.boundsMin, node.boundsMax, origin, inverseDirection, maxDistance) == FLT_MAX)
+		{
+			continue;
+		}
+
+		if (node.nTriangles > 0)
+		{
+			for (GLuint i = node.offset; i < node.offset + node.nTriangles; i++)
+			{
+				if (IntersectTriangle(m_triangleOrder[i], origin, direction, maxDistance, hit) == true)
+				{
+					bHit = true;
+					maxDistance = hit.distance;
+					if (bAnyHit == true)
+					{
+						return(true);
+					}
+				}
+			}
+			continue;
+		}
+
+		// the first child is the next node in the array
+		GLuint firstChild = (GLuint)(&node - m_nodes.data()) + 1;
+		stack[stackSize++] = node.offset;
+		stack[stackSize++] = firstChild;
+	}
+
+	return(bHit);
+}
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the world space triangles of a scene, used
+// for tracing rays on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class contains the code for building a bounding
+ *  volume hierarchy over a triangle soup and tracing rays
+ *  against it.  Once built, the queries only read the
+ *  tree, so any number of threads can trace at once.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// the closest surface found along a ray
+	struct RAY_HIT
+	{
+		float distance;     // Distance along the ray
+		GLuint triangle;    // Triangle index passed to Build()
+		float u, v;         // Barycentric coords of the hit
+	};
+
+	// constructor
+	SceneBVH();
+
+	// build the tree over the passed in triangles, three
+	// vertices per triangle
+	void Build(const std::vector<glm::vec3>& vertices);
+
+	// find the closest triangle hit by the ray within the
+	// max distance, the direction must be normalized
+	bool Intersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		RAY_HIT& hit) const;
+
+	// check whether any triangle blocks the ray within the
+	// max distance, stops at the first hit found
+	bool IsOccluded(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance) const;
+
+	// the geometric normal of a triangle, following its
+	// winding
+	glm::vec3 GetTriangleNormal(GLuint triangle) const;
+
+	// bounds of all the triangles in the tree
+	void GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	GLuint GetTriangleCount() const { return((GLuint)m_vertices.size() / 3); }
+
+private:
+	// one node of the tree - inner nodes store their second
+	// child, the first child always follows the node
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		GLuint offset;      // Second child, or first triangle of a leaf
+		glm::vec3 boundsMax;
+		GLuint nTriangles;  // Zero for inner nodes
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<glm::vec3> m_vertices;
+	// triangle indices in leaf order
+	std::vector<GLuint> m_triangleOrder;
+
+	// build the subtree for a range of the triangle order
+	GLuint BuildNode(
+		const std::vector<glm::vec3>& centroids,
+		GLuint first,
+		GLuint count,
+		GLuint depth);
+
+	// test a ray against one triangle
+	bool IntersectTriangle(
+		GLuint triangle,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		RAY_HIT& hit) const;
+
+	// walk the tree for a ray, stopping at the first hit
+	// when bAnyHit is set
+	bool Traverse(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		bool bAnyHit,
+		RAY_HIT& hit) const;
+};
@@ -0,0 +1,619 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneHLOD.cpp
+// ============
+// hierarchical level of detail - groups of nearby objects merged into one
+// simplified proxy mesh that is drawn instead of the group when it is small
+// on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneHLOD.h"
+#include "ShapeMeshes.h"
+#include "GLCapture.h"
+#include "PerfCounters.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	const char* g_ViewProjectionName = "viewProjection";
+
+	// vertex attribute locations of the proxy shader
+	const GLuint g_PositionAttribute = 0;
+	const GLuint g_ColorAttribute = 1;
+
+	// the default settings
+	const GLuint g_DefaultObjectsPerCluster = 500;
+	const GLuint g_DefaultCellsPerCluster = 32;
+	const float g_DefaultScreenSize = 0.1f;
+
+	// clusters across the widest side of the scene, at most
+	const float g_MaxClustersAcross = 1024.0f;
+	// bits of each vertex clustering cell coordinate, and of
+	// each vertex index in a triangle key
+	const int g_KeyBits = 21;
+	const uint64_t g_KeyMask = ((uint64_t)1 << g_KeyBits) - 1;
+	// cluster of the objects that were not added, and proxy
+	// vertex of a cell no triangle uses
+	const GLuint g_NoCluster = 0xFFFFFFFF;
+	const GLuint g_NoVertex = 0xFFFFFFFF;
+}
+
+/***********************************************************
+ *  SceneHLOD()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneHLOD::SceneHLOD()
+{
+	m_settings = GetDefaultSettings();
+	m_nProxyTriangles = 0;
+	m_vao = 0;
+	m_vertexRange = 0;
+	m_indexRange = 0;
+	m_vertexBuffer = 0;
+	m_vertexOffset = 0;
+	m_indexBuffer = 0;
+	m_indexOffset = 0;
+	m_pProxyShader = NULL;
+	m_viewProjection = glm::mat4(1.0f);
+	m_nDrawCalls = 0;
+}
+
+/***********************************************************
+ *  ~SceneHLOD()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneHLOD::~SceneHLOD()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  GetDefaultSettings()
+ *
+ *  This method is used for getting the settings used when
+ *  none are passed in.
+ ***********************************************************/
+SceneHLOD::HLOD_SETTINGS SceneHLOD::GetDefaultSettings()
+{
+	HLOD_SETTINGS settings;
+	settings.objectsPerCluster = g_DefaultObjectsPerCluster;
+	settings.cellsPerCluster = g_DefaultCellsPerCluster;
+	settings.screenSize = g_DefaultScreenSize;
+	return(settings);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light to be baked into
+ *  the proxy colors.
+ ***********************************************************/
+void SceneHLOD::AddLight(const HLOD_LIGHT& light)
+{
+	m_lights.push_back(light);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object to be
+ *  clustered.
+ ***********************************************************/
+void SceneHLOD::AddObject(const HLOD_OBJECT& object)
+{
+	m_objects.push_back(object);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for clustering the added objects
+ *  and building the proxy of each cluster.  The clusters
+ *  are squares on the ground sized so each one holds about
+ *  the set number of objects at the average density of the
+ *  scene.  The proxies are built on all cores, then sent
+ *  to the GPU in one vertex and one index buffer.
+ ***********************************************************/
+bool SceneHLOD::Build(const HLOD_SETTINGS& settings)
+{
+	PERF_SCOPE("HLODBuild");
+
+	Destroy();
+	m_settings = settings;
+	m_settings.objectsPerCluster = std::max(m_settings.objectsPerCluster, 1u);
+	m_settings.cellsPerCluster = std::max(m_settings.cellsPerCluster, 1u);
+
+	if (m_objects.empty() == true)
+	{
+		m_lights.clear();
+		return(false);
+	}
+
+	// the ground covered by the object centers
+	glm::vec2 groundMin(FLT_MAX, FLT_MAX);
+	glm::vec2 groundMax(-FLT_MAX, -FLT_MAX);
+	GLuint maxIndex = 0;
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		glm::vec2 center(m_objects[i].bounds.x, m_objects[i].bounds.z);
+		groundMin = glm::min(groundMin, center);
+		groundMax = glm::max(groundMax, center);
+		maxIndex = std::max(maxIndex, m_objects[i].index);
+	}
+
+	glm::vec2 extent = glm::max(groundMax - groundMin, glm::vec2(0.001f, 0.001f));
+	float clusterSize = sqrt(extent.x * extent.y * m_settings.objectsPerCluster / (float)m_objects.size());
+	clusterSize = std::max(clusterSize, std::max(extent.x, extent.y) / g_MaxClustersAcross);
+	int nColumns = (int)(extent.x / clusterSize) + 1;
+	int nRows = (int)(extent.y / clusterSize) + 1;
+
+	// group the objects by the square holding their center
+	std::vector<std::vector<GLuint>> clusterObjects;
+	std::vector<int> squareCluster((size_t)nColumns * nRows, -1);
+	m_objectCluster.assign((size_t)maxIndex + 1, g_NoCluster);
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		int column = std::min((int)((m_objects[i].bounds.x - groundMin.x) / clusterSize), nColumns - 1);
+		int row = std::min((int)((m_objects[i].bounds.z - groundMin.y) / clusterSize), nRows - 1);
+		int& cluster = squareCluster[(size_t)row * nColumns + column];
+		if (cluster < 0)
+		{
+			cluster = (int)clusterObjects.size();
+			clusterObjects.push_back(std::vector<GLuint>());
+		}
+		clusterObjects[cluster].push_back((GLuint)i);
+		m_objectCluster[m_objects[i].index] = (GLuint)cluster;
+	}
+
+	// the proxies are independent, so each worker takes the
+	// next cluster until none are left
+	size_t nClusters = clusterObjects.size();
+	std::vector<std::vector<PROXY_VERTEX>> proxyVertices(nClusters);
+	std::vector<std::vector<GLuint>> proxyIndices(nClusters);
+	ParallelFor(nClusters, 0, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t cluster = begin; cluster < end; cluster++)
+		{
+			BuildProxy(clusterObjects[cluster], proxyVertices[cluster], proxyIndices[cluster]);
+		}
+	});
+
+	// join the proxies, offsetting the indices of each one
+	std::vector<PROXY_VERTEX> vertices;
+	std::vector<GLuint> indices;
+	m_clusters.resize(nClusters);
+	for (size_t c = 0; c < nClusters; c++)
+	{
+		CLUSTER& cluster = m_clusters[c];
+		GLuint firstVertex = (GLuint)vertices.size();
+
+		cluster.firstIndex = (GLuint)indices.size();
+		cluster.nIndices = (GLuint)proxyIndices[c].size();
+		cluster.bProxied = false;
+		vertices.insert(vertices.end(), proxyVertices[c].begin(), proxyVertices[c].end());
+		for (size_t i = 0; i < proxyIndices[c].size(); i++)
+		{
+			indices.push_back(firstVertex + proxyIndices[c][i]);
+		}
+
+		// the sphere around the center of the object bounds
+		// that holds every object sphere
+		glm::vec3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t i = 0; i < clusterObjects[c].size(); i++)
+		{
+			const glm::vec4& bounds = m_objects[clusterObjects[c][i]].bounds;
+			boundsMin = glm::min(boundsMin, glm::vec3(bounds) - bounds.w);
+			boundsMax = glm::max(boundsMax, glm::vec3(bounds) + bounds.w);
+		}
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < clusterObjects[c].size(); i++)
+		{
+			const glm::vec4& bounds = m_objects[clusterObjects[c][i]].bounds;
+			radius = std::max(radius, glm::length(glm::vec3(bounds) - center) + bounds.w);
+		}
+		cluster.bounds = glm::vec4(center, radius);
+	}
+	m_nProxyTriangles = (GLuint)(indices.size() / 3);
+
+	m_objects.clear();
+	m_objects.shrink_to_fit();
+	m_lights.clear();
+
+	if (UploadProxies(vertices, indices) == false)
+	{
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the proxies and the GL
+ *  objects.  The proxy ranges go back to the shared mesh
+ *  buffers, for the next proxies or other meshes.  Objects
+ *  added since the last build are kept.
+ ***********************************************************/
+void SceneHLOD::Destroy()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	if (m_vertexRange != 0)
+	{
+		ShapeMeshes::GetVertexBuffers().Free(m_vertexRange);
+		m_vertexRange = 0;
+	}
+	if (m_indexRange != 0)
+	{
+		ShapeMeshes::GetIndexBuffers().Free(m_indexRange);
+		m_indexRange = 0;
+	}
+	m_vertexBuffer = 0;
+	m_vertexOffset = 0;
+	m_indexBuffer = 0;
+	m_indexOffset = 0;
+	if (NULL != m_pProxyShader)
+	{
+		delete m_pProxyShader;
+		m_pProxyShader = NULL;
+	}
+
+	m_clusters.clear();
+	m_objectCluster.clear();
+	m_nProxyTriangles = 0;
+	m_drawCounts.clear();
+	m_drawStarts.clear();
+	m_drawOffsets.clear();
+}
+
+/***********************************************************
+ *  SelectProxies()
+ *
+ *  This method is used for picking the clusters drawn as
+ *  proxies.  The screen size of a cluster is the diameter
+ *  of its bounding sphere as a fraction of the screen
+ *  height - the radius over the distance, scaled by the
+ *  projection, which spans two units of the normalized
+ *  height.  Under an orthographic projection the distance
+ *  does not count.
+ ***********************************************************/
+void SceneHLOD::SelectProxies(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	m_viewProjection = projection * view;
+	m_drawCounts.clear();
+	m_drawStarts.clear();
+
+	bool bOrthographic = (projection[3][3] == 1.0f);
+	float projectionScale = projection[1][1];
+
+	for (size_t c = 0; c < m_clusters.size(); c++)
+	{
+		CLUSTER& cluster = m_clusters[c];
+		float radius = cluster.bounds.w;
+		float screenSize = radius * projectionScale;
+
+		if (bOrthographic == false)
+		{
+			float distance = glm::length(glm::vec3(cluster.bounds) - cameraPosition);
+			screenSize = (distance > radius) ? screenSize / distance : FLT_MAX;
+		}
+
+		cluster.bProxied = (screenSize < m_settings.screenSize);
+		if ((cluster.bProxied == true) && (cluster.nIndices > 0))
+		{
+			m_drawCounts.push_back((GLsizei)cluster.nIndices);
+			m_drawStarts.push_back((GLintptr)(cluster.firstIndex * sizeof(GLuint)));
+		}
+	}
+}
+
+/***********************************************************
+ *  IsObjectProxied()
+ *
+ *  This method is used for checking whether an object is
+ *  drawn by the proxy of its cluster this frame.
+ ***********************************************************/
+bool SceneHLOD::IsObjectProxied(GLuint index) const
+{
+	if ((index >= m_objectCluster.size()) || (m_objectCluster[index] == g_NoCluster))
+	{
+		return(false);
+	}
+
+	return(m_clusters[m_objectCluster[index]].bProxied);
+}
+
+/***********************************************************
+ *  DrawProxies()
+ *
+ *  This method is used for drawing the picked proxies with
+ *  one multi-draw call, from wherever compaction has left
+ *  them in the shared mesh buffers.
+ ***********************************************************/
+void SceneHLOD::DrawProxies()
+{
+	PERF_SCOPE("DrawProxies");
+
+	if ((m_drawCounts.empty() == true) || (NULL == m_pProxyShader))
+	{
+		return;
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	m_pProxyShader->use();
+	m_pProxyShader->setMat4Value(g_ViewProjectionName, m_viewProjection);
+
+	BindProxyBuffers();
+	m_drawOffsets.resize(m_drawStarts.size());
+	for (size_t i = 0; i < m_drawStarts.size(); i++)
+	{
+		m_drawOffsets[i] = (const void*)(m_indexOffset + m_drawStarts[i]);
+	}
+
+	glMultiDrawElements(
+		GL_TRIANGLES,
+		m_drawCounts.data(),
+		GL_UNSIGNED_INT,
+		m_drawOffsets.data(),
+		(GLsizei)m_drawCounts.size());
+	glBindVertexArray(0);
+	m_nDrawCalls++;
+
+	glUseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  BuildProxy()
+ *
+ *  This method is used for merging the objects of one
+ *  cluster into a proxy by vertex clustering.  A grid of
+ *  cells covers the cluster and every vertex falling in a
+ *  cell becomes the cell's single vertex, at the average
+ *  position and lit color.  Triangles with two corners in
+ *  one cell vanish, and a triangle already made from the
+ *  same three cells is not added twice.  Objects smaller
+ *  than a cell would vanish entirely and are skipped.
+ ***********************************************************/
+void SceneHLOD::BuildProxy(
+	const std::vector<GLuint>& objects,
+	std::vector<PROXY_VERTEX>& vertices,
+	std::vector<GLuint>& indices) const
+{
+	// one cell of the grid, summed over its vertices
+	struct CELL
+	{
+		glm::vec3 position;
+		glm::vec3 color;
+		GLuint nVertices;
+	};
+
+	glm::vec3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const glm::vec4& bounds = m_objects[objects[i]].bounds;
+		boundsMin = glm::min(boundsMin, glm::vec3(bounds) - bounds.w);
+		boundsMax = glm::max(boundsMax, glm::vec3(bounds) + bounds.w);
+	}
+	glm::vec3 extent = boundsMax - boundsMin;
+	float cellSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 0.000001f)) / m_settings.cellsPerCluster;
+	int maxCell = (int)m_settings.cellsPerCluster;
+
+	std::vector<CELL> cells;
+	std::unordered_map<uint64_t, GLuint> cellIndex;
+	std::unordered_set<uint64_t> triangleKeys;
+	std::vector<GLuint> vertexCells;
+	std::vector<GLuint> triangles;
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const HLOD_OBJECT& object = m_objects[objects[i]];
+		if ((object.bounds.w * 2.0f < cellSize) || (NULL == object.pTriangles))
+		{
+			continue;
+		}
+
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));
+
+		// find the cell of each vertex, adding its light
+		vertexCells.resize(object.nVertices);
+		for (GLuint v = 0; v < object.nVertices; v++)
+		{
+			const GLfloat* pVertex = object.vertexData + (size_t)v * object.floatsPerVertex;
+			glm::vec3 position = glm::vec3(object.model * glm::vec4(pVertex[0], pVertex[1], pVertex[2], 1.0f));
+			glm::vec3 normal = normalMatrix * glm::vec3(pVertex[3], pVertex[4], pVertex[5]);
+			if (glm::length(normal) > 0.0f)
+			{
+				normal = glm::normalize(normal);
+			}
+
+			glm::ivec3 cell = glm::clamp(
+				glm::ivec3(glm::floor((position - boundsMin) / cellSize)),
+				glm::ivec3(0, 0, 0),
+				glm::ivec3(maxCell, maxCell, maxCell));
+			uint64_t key = (uint64_t)cell.x | ((uint64_t)cell.y << g_KeyBits) | ((uint64_t)cell.z << (2 * g_KeyBits));
+
+			auto found = cellIndex.find(key);
+			if (found == cellIndex.end())
+			{
+				found = cellIndex.insert(std::make_pair(key, (GLuint)cells.size())).first;
+				CELL newCell;
+				newCell.position = glm::vec3(0.0f, 0.0f, 0.0f);
+				newCell.color = glm::vec3(0.0f, 0.0f, 0.0f);
+				newCell.nVertices = 0;
+				cells.push_back(newCell);
+			}
+
+			CELL& vertexCell = cells[found->second];
+			vertexCell.position += position;
+			vertexCell.color += object.albedo * CalculateLight(position, normal);
+			vertexCell.nVertices++;
+			vertexCells[v] = found->second;
+		}
+
+		// keep the triangles that still span three cells
+		const std::vector<GLuint>& objectTriangles = *object.pTriangles;
+		for (size_t t = 0; t + 2 < objectTriangles.size(); t += 3)
+		{
+			GLuint a = vertexCells[objectTriangles[t]];
+			GLuint b = vertexCells[objectTriangles[t + 1]];
+			GLuint c = vertexCells[objectTriangles[t + 2]];
+			if ((a == b) || (b == c) || (a == c))
+			{
+				continue;
+			}
+
+			GLuint sorted[3] = { a, b, c };
+			std::sort(sorted, sorted + 3);
+			uint64_t key = (uint64_t)sorted[0] |
+				(((uint64_t)sorted[1] & g_KeyMask) << g_KeyBits) |
+				(((uint64_t)sorted[2] & g_KeyMask) << (2 * g_KeyBits));
+			if (triangleKeys.insert(key).second == true)
+			{
+				triangles.push_back(a);
+				triangles.push_back(b);
+				triangles.push_back(c);
+			}
+		}
+	}
+
+	// only the cells used by a triangle become vertices
+	std::vector<GLuint> cellVertex(cells.size(), g_NoVertex);
+	vertices.clear();
+	indices.clear();
+	indices.reserve(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		GLuint cell = triangles[i];
+		if (cellVertex[cell] == g_NoVertex)
+		{
+			const CELL& source = cells[cell];
+			glm::vec3 color = glm::clamp(source.color / (float)source.nVertices, 0.0f, 1.0f);
+			PROXY_VERTEX vertex;
+
+			vertex.position = source.position / (float)source.nVertices;
+			vertex.color[0] = (GLubyte)(color.r * 255.0f + 0.5f);
+			vertex.color[1] = (GLubyte)(color.g * 255.0f + 0.5f);
+			vertex.color[2] = (GLubyte)(color.b * 255.0f + 0.5f);
+			vertex.color[3] = 255;
+			cellVertex[cell] = (GLuint)vertices.size();
+			vertices.push_back(vertex);
+		}
+		indices.push_back(cellVertex[cell]);
+	}
+}
+
+/***********************************************************
+ *  CalculateLight()
+ *
+ *  This method is used for lighting a proxy vertex with the
+ *  ambient and diffuse light of each baked light.  There
+ *  are no shadows, the proxies are only seen from afar.
+ ***********************************************************/
+glm::vec3 SceneHLOD::CalculateLight(const glm::vec3& position, const glm::vec3& normal) const
+{
+	glm::vec3 light(0.0f, 0.0f, 0.0f);
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		glm::vec3 toLight = m_lights[i].position - position;
+		float diffuse = 0.0f;
+		if (glm::length(toLight) > 0.0f)
+		{
+			diffuse = std::max(glm::dot(normal, glm::normalize(toLight)), 0.0f);
+		}
+		light += m_lights[i].ambientColor + m_lights[i].diffuseColor * diffuse;
+	}
+
+	return(light);
+}
+
+/***********************************************************
+ *  UploadProxies()
+ *
+ *  This method is used for sending the joined proxies to
+ *  the GPU, into ranges of the shared mesh buffers, and
+ *  loading the proxy shader.
+ ***********************************************************/
+bool SceneHLOD::UploadProxies(
+	const std::vector<PROXY_VERTEX>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	m_vertexRange = ShapeMeshes::GetVertexBuffers().Allocate(sizeof(PROXY_VERTEX) * vertices.size(), vertices.data());
+	m_indexRange = ShapeMeshes::GetIndexBuffers().Allocate(sizeof(GLuint) * indices.size(), indices.data());
+
+	glGenVertexArrays(1, &m_vao);
+	BindProxyBuffers();
+	glEnableVertexAttribArray(g_PositionAttribute);
+	glEnableVertexAttribArray(g_ColorAttribute);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if ((m_vertexRange == 0) || (m_indexRange == 0) || (glGetError() == GL_OUT_OF_MEMORY))
+	{
+		std::cout << "SceneHLOD: out of memory for " << m_nProxyTriangles << " proxy triangles" << std::endl;
+		return(false);
+	}
+
+	m_pProxyShader = new ShaderManager();
+	m_pProxyShader->LoadShaders(
+		"../../Utilities/shaders/hlodVertexShader.glsl",
+		"../../Utilities/shaders/hlodFragmentShader.glsl");
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindProxyBuffers()
+ *
+ *  This method is used for binding the proxy VAO.  The
+ *  vertex attributes and the index buffer are only pointed
+ *  again when compaction has moved the proxy ranges.
+ ***********************************************************/
+void SceneHLOD::BindProxyBuffers()
+{
+	GPUBufferAllocator& vertexBuffers = ShapeMeshes::GetVertexBuffers();
+	GPUBufferAllocator& indexBuffers = ShapeMeshes::GetIndexBuffers();
+
+	glBindVertexArray(m_vao);
+
+	GLuint vertexBuffer = vertexBuffers.GetBuffer(m_vertexRange);
+	GLintptr vertexOffset = vertexBuffers.GetOffset(m_vertexRange);
+	if ((vertexBuffer != m_vertexBuffer) || (vertexOffset != m_vertexOffset))
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(PROXY_VERTEX), (void*)vertexOffset);
+		glVertexAttribPointer(g_ColorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PROXY_VERTEX), (void*)(vertexOffset + sizeof(glm::vec3)));
+		m_vertexBuffer = vertexBuffer;
+		m_vertexOffset = vertexOffset;
+	}
+
+	GLuint indexBuffer = indexBuffers.GetBuffer(m_indexRange);
+	if (indexBuffer != m_indexBuffer)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		m_indexBuffer = indexBuffer;
+	}
+	m_indexOffset = indexBuffers.GetOffset(m_indexRange);
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenehlod.h
+// ============
+// hierarchical level of detail - groups of nearby objects merged into one
+// simplified proxy mesh that is drawn instead of the group when it is small
+// on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneHLOD
+ *
+ *  This class contains the code for building and drawing
+ *  the proxies of a large scene.  Build() splits the
+ *  objects into clusters on a grid over the ground, then
+ *  merges the triangles of each cluster into one proxy
+ *  simplified by vertex clustering - the vertices in each
+ *  cell of a small grid over the cluster become a single
+ *  vertex.  The lighting and the texture colors are baked
+ *  into the proxy vertex colors, so a proxy needs neither
+ *  textures nor a light loop.
+ *
+ *  Each frame SelectProxies() picks the clusters that are
+ *  smaller on screen than the threshold, the caller skips
+ *  their objects, and DrawProxies() draws all the picked
+ *  proxies with one multi-draw call.  However large the
+ *  scene, only the clusters near the camera are drawn one
+ *  object at a time.
+ ***********************************************************/
+class SceneHLOD
+{
+public:
+	// one object of the scene - the vertex data is
+	// interleaved with the position first and the normal
+	// after it, and the triangles index into it.  The data
+	// is only read by Build() and must outlive that call
+	struct HLOD_OBJECT
+	{
+		GLuint index;             // Index the caller draws the object by
+		const GLfloat* vertexData;
+		GLuint floatsPerVertex;
+		GLuint nVertices;
+		const std::vector<GLuint>* pTriangles;
+		glm::mat4 model;
+		glm::vec4 bounds;         // World space bounding sphere
+		glm::vec3 albedo;         // Object or average texture color
+	};
+
+	// a point light baked into the proxy colors
+	struct HLOD_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+	};
+
+	struct HLOD_SETTINGS
+	{
+		GLuint objectsPerCluster; // Sets the cluster size from the density of the objects
+		GLuint cellsPerCluster;   // Vertex clustering cells across the widest side of a cluster
+		float screenSize;         // Clusters whose diameter is below this fraction of the screen height draw their proxy
+	};
+
+	// constructor
+	SceneHLOD();
+	// destructor
+	~SceneHLOD();
+
+	// the settings used when none are passed in
+	static HLOD_SETTINGS GetDefaultSettings();
+
+	// add the lights and the objects to be clustered
+	void AddLight(const HLOD_LIGHT& light);
+	void AddObject(const HLOD_OBJECT& object);
+
+	// cluster the added objects, build the proxies and send
+	// them to the GPU - the added objects are released
+	bool Build(const HLOD_SETTINGS& settings);
+	// free the proxies and the GL objects
+	void Destroy();
+	bool IsBuilt() const { return(m_vao != 0); }
+
+	// pick the clusters drawn as proxies from the camera
+	void SelectProxies(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// check whether the object is covered by a picked proxy
+	bool IsObjectProxied(GLuint index) const;
+	// draw the picked proxies with the proxy shader, the
+	// current program is restored afterwards
+	void DrawProxies();
+
+	// sizes of the built proxies and of the last frame
+	GLuint GetClusterCount() const { return((GLuint)m_clusters.size()); }
+	GLuint GetProxyTriangleCount() const { return(m_nProxyTriangles); }
+	GLuint GetSelectedCount() const { return((GLuint)m_drawCounts.size()); }
+	GLuint GetDrawCallCount() const { return(m_nDrawCalls); }
+	void ResetDrawCallCount() { m_nDrawCalls = 0; }
+
+private:
+	// one cluster and the range of its proxy in the index
+	// buffer
+	struct CLUSTER
+	{
+		glm::vec4 bounds;         // Bounding sphere of the objects
+		GLuint firstIndex;
+		GLuint nIndices;
+		bool bProxied;            // Picked by the last SelectProxies()
+	};
+
+	// one vertex of a proxy
+	struct PROXY_VERTEX
+	{
+		glm::vec3 position;
+		GLubyte color[4];
+	};
+
+	HLOD_SETTINGS m_settings;
+	std::vector<HLOD_LIGHT> m_lights;
+	std::vector<HLOD_OBJECT> m_objects;
+
+	std::vector<CLUSTER> m_clusters;
+	// cluster of each object by its index
+	std::vector<GLuint> m_objectCluster;
+	GLuint m_nProxyTriangles;
+
+	GLuint m_vao;
+	// ranges of the proxies in the shared mesh buffers, and
+	// where the VAO last pointed, as compaction moves them
+	GLuint m_vertexRange;
+	GLuint m_indexRange;
+	GLuint m_vertexBuffer;
+	GLintptr m_vertexOffset;
+	GLuint m_indexBuffer;
+	GLintptr m_indexOffset;
+	ShaderManager* m_pProxyShader;
+
+	// the proxies picked by the last SelectProxies()
+	std::vector<GLsizei> m_drawCounts;
+	// byte offsets of the picked proxies in the index range,
+	// and in the shared index buffer when drawn
+	std::vector<GLintptr> m_drawStarts;
+	std::vector<const void*> m_drawOffsets;
+	glm::mat4 m_viewProjection;
+	GLuint m_nDrawCalls;
+
+	// called to simplify the objects of one cluster into
+	// its proxy, with indices starting at zero
+	void BuildProxy(
+		const std::vector<GLuint>& objects,
+		std::vector<PROXY_VERTEX>& vertices,
+		std::vector<GLuint>& indices) const;
+	// called to light a vertex with the baked lights
+	glm::vec3 CalculateLight(const glm::vec3& position, const glm::vec3& normal) const;
+	// called to send the proxies to the GPU
+	bool UploadProxies(
+		const std::vector<PROXY_VERTEX>& vertices,
+		const std::vector<GLuint>& indices);
+	// called to bind the VAO, pointing it at the proxy
+	// ranges again after compaction moved them
+	void BindProxyBuffers();
+};
@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "PerfCounters.h"
+#include "GLCapture.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,6 +18,15 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <tuple>
+
 // declaration of global variables
 namespace
 {
@@ -24,6 +35,17 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_ObjectIndexName = "objectIndex";
+	const char* g_StaticObjectsName = "staticObjects";
+	const char* g_DynamicObjectsName = "dynamicObjects";
+
+	// texture units of the object buffers, after the units
+	// used by the scene textures
+	const GLuint g_StaticObjectsUnit = 16;
+	const GLuint g_DynamicObjectsUnit = 17;
+
+	// speed of the turntable platter
+	const double g_PlatterRPM = 33.3;
 }
 
 /***********************************************************
@@ -35,6 +57,21 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_meshesKey = 0;
+	m_loadedTextures = 0;
+	m_bStreamTextures = false;
+	m_nextPendingTexture = 0;
+	m_bCapturingScene = false;
+	m_stressGridSize = 0.0f;
+	m_bObjectBuffersBuilt = false;
+	m_bImpostors = false;
+	m_frameView = glm::mat4(1.0f);
+	m_frameProjection = glm::mat4(1.0f);
+	m_frameCameraPosition = glm::vec3(0.0f);
+	for (int i = 0; i < ShapeMeshes::MAX_MESH_TYPES; i++)
+	{
+		m_meshBounds[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+	}
 }
 
 /***********************************************************
@@ -44,8 +81,23 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	DestroyBakedLighting();
+	m_objectBuffers.Destroy();
+	m_hlod.Destroy();
+	m_impostors.Destroy();
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
+	DestroyGLTextures();
+
+	// the cached meshes stay loaded for the next scene
+	if (m_meshesKey != 0)
+	{
+		ResourceCache::Release(m_meshesKey);
+		m_meshesKey = 0;
+	}
+	else
+	{
+		delete m_basicMeshes;
+	}
 	m_basicMeshes = NULL;
 }
 
@@ -55,7 +107,9 @@ SceneManager::~SceneManager()
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
  *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  the next available texture slot in memory.  A texture is
+ *  known by the bytes of its file, so one an earlier scene
+ *  loaded is taken from the resource cache instead.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
@@ -64,16 +118,52 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	int colorChannels = 0;
 	GLuint textureID = 0;
 
+	std::vector<unsigned char> fileData;
+	FILE* file = fopen(filename, "rb");
+	if (NULL != file)
+	{
+		fseek(file, 0, SEEK_END);
+		long fileBytes = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if (fileBytes > 0)
+		{
+			fileData.resize((size_t)fileBytes);
+			fileData.resize(fread(fileData.data(), 1, fileData.size(), file));
+		}
+		fclose(file);
+	}
+
+	uint64_t cacheKey = ResourceCache::HashBytes(fileData.data(), fileData.size());
+	ResourceCache::TEXTURE cached;
+	if ((fileData.empty() == false) && (ResourceCache::AcquireTexture(cacheKey, cached) == true))
+	{
+		std::cout << "Reused cached image:" << filename << std::endl;
+
+		m_textureIDs[m_loadedTextures].ID = cached.ID;
+		m_textureIDs[m_loadedTextures].tag = tag;
+		m_textureIDs[m_loadedTextures].averageColor = cached.averageColor;
+		m_textureIDs[m_loadedTextures].cacheKey = cacheKey;
+		m_loadedTextures++;
+
+		return true;
+	}
+
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	// try to parse the image data from the read image file
+	unsigned char* image = NULL;
+	if (fileData.empty() == false)
+	{
+		PERF_SCOPE("TextureDecode");
+		image = stbi_load_from_memory(
+			fileData.data(),
+			(int)fileData.size(),
+			&width,
+			&height,
+			&colorChannels,
+			0);
+	}
 
 	// if the image was successfully read from the image file
 	if (image)
@@ -99,19 +189,43 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		else
 		{
 			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			stbi_image_free(image);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDeleteTextures(1, &textureID);
 			return false;
 		}
 
 		// generate the texture mipmaps for mapping textures to lower resolutions
 		glGenerateMipmap(GL_TEXTURE_2D);
 
+		// keep the average color, used as the surface color when
+		// baking the bounced light
+		glm::vec3 averageColor(0.0f);
+		for (int i = 0; i < width * height; i++)
+		{
+			averageColor += glm::vec3(
+				image[i * colorChannels],
+				image[i * colorChannels + 1],
+				image[i * colorChannels + 2]);
+		}
+		averageColor /= (255.0f * width * height);
+
 		// free the image data from local memory
 		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
+		// hand the texture to the cache, counted as 4 bytes a
+		// texel with a third more for the mipmaps
+		ResourceCache::TEXTURE texture;
+		texture.ID = textureID;
+		texture.averageColor = averageColor;
+		texture = ResourceCache::AddTexture(cacheKey, texture, (size_t)width * height * 4 * 4 / 3);
+
 		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
+		m_textureIDs[m_loadedTextures].ID = texture.ID;
 		m_textureIDs[m_loadedTextures].tag = tag;
+		m_textureIDs[m_loadedTextures].averageColor = texture.averageColor;
+		m_textureIDs[m_loadedTextures].cacheKey = cacheKey;
 		m_loadedTextures++;
 
 		return true;
@@ -123,6 +237,70 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	return false;
 }
 
+/***********************************************************
+ *  AddSceneTexture()
+ *
+ *  This method is used for loading a texture of the scene,
+ *  or for queuing it when the textures are streamed in.
+ *  The queued textures are loaded in the same order, so
+ *  each one gets the same slot either way.
+ ***********************************************************/
+bool SceneManager::AddSceneTexture(const char* filename, std::string tag)
+{
+	if (m_bStreamTextures == false)
+	{
+		return(CreateGLTexture(filename, tag));
+	}
+
+	TEXTURE_FILE textureFile;
+	textureFile.filename = filename;
+	textureFile.tag = tag;
+	m_pendingTextures.push_back(textureFile);
+
+	return(true);
+}
+
+/***********************************************************
+ *  StreamNextTexture()
+ *
+ *  This method is used for loading the next queued texture
+ *  and binding it to its slot.  Until then the objects
+ *  using it are drawn with their color.
+ ***********************************************************/
+bool SceneManager::StreamNextTexture()
+{
+	if (HasPendingTextures() == false)
+	{
+		return(false);
+	}
+
+	const TEXTURE_FILE& textureFile = m_pendingTextures[m_nextPendingTexture];
+	CreateGLTexture(textureFile.filename.c_str(), textureFile.tag);
+	m_nextPendingTexture++;
+
+	if (HasPendingTextures() == false)
+	{
+		m_pendingTextures.clear();
+		m_nextPendingTexture = 0;
+	}
+	BindGLTextures();
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishTextureStreaming()
+ *
+ *  This method is used for loading every queued texture,
+ *  before work that needs all of them.
+ ***********************************************************/
+void SceneManager::FinishTextureStreaming()
+{
+	while (StreamNextTexture() == true)
+	{
+	}
+}
+
 /***********************************************************
  *  BindGLTextures()
  *
@@ -142,15 +320,21 @@ void SceneManager::BindGLTextures()
 /***********************************************************
  *  DestroyGLTextures()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for letting go of the textures in
+ *  all the used texture memory slots.  They stay loaded in
+ *  the resource cache, for the next scene, until its
+ *  budget is passed.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		ResourceCache::Release(m_textureIDs[i].cacheKey);
+		m_textureIDs[i].ID = 0;
 	}
+	m_loadedTextures = 0;
+	m_pendingTextures.clear();
+	m_nextPendingTexture = 0;
 }
 
 /***********************************************************
@@ -253,6 +437,8 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
+	PERF_SCOPE("SetTransformations");
+
 	// variables for this method
 	glm::mat4 modelView;
 	glm::mat4 scale;
@@ -272,6 +458,17 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
 
+	// while capturing, the settings are kept for the next
+	// drawn object instead of being sent to the shader
+	if (m_bCapturingScene == true)
+	{
+		m_captureState.model = modelView;
+		return;
+	}
+
+	// the meshes need the model transform for culling meshlets
+	m_basicMeshes->SetModelTransform(modelView);
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setMat4Value(g_ModelName, modelView);
@@ -298,6 +495,13 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
+	if (m_bCapturingScene == true)
+	{
+		m_captureState.color = currentColor;
+		m_captureState.textureTag.clear();
+		return;
+	}
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setIntValue(g_UseTextureName, false);
@@ -314,12 +518,26 @@ void SceneManager::SetShaderColor(
 void SceneManager::SetShaderTexture(
 	std::string textureTag)
 {
-	if (NULL != m_pShaderManager)
+	if (m_bCapturingScene == true)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_captureState.textureTag = textureTag;
+		return;
+	}
 
+	if (NULL != m_pShaderManager)
+	{
 		int textureID = -1;
 		textureID = FindTextureSlot(textureTag);
+
+		// a texture not streamed in yet leaves the object
+		// with its color
+		if ((textureID < 0) && (HasPendingTextures() == true))
+		{
+			m_pShaderManager->setIntValue(g_UseTextureName, false);
+			return;
+		}
+
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
 		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
 	}
 }
@@ -332,6 +550,12 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
+	if (m_bCapturingScene == true)
+	{
+		m_captureState.uvScale = glm::vec2(u, v);
+		return;
+	}
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
@@ -350,43 +574,43 @@ void SceneManager::LoadSceneTextures()
 	bool bReturn = false;
 
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/FrontCover.jpg",
 		"Front Cover");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/Glass.jpg",
 		"Glass");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/Glass2.jpg",
 		"Glass2");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/Wood.jpg",
 		"Wood");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/Black.jpg",
 		"Black");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/Chrome.jpg",
 		"Chrome");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_Textures/Grey.jpg",
 		"Grey");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_textures/BackCover.jpg",
 		"Back Cover");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_Textures/Modern.jpg",
 		"Modern");
 
-	bReturn = CreateGLTexture(
+	bReturn = AddSceneTexture(
 		"../../Utilities/MY_Textures/Brass.jpg",
 		"Brass");
 
@@ -487,35 +711,44 @@ void SceneManager::DefineObjectMaterials()
 ************************************************************/
 void SceneManager::SetupSceneLights()
 {
+	// position, ambient, diffuse, specular, focal strength, specular intensity
+	LIGHT_SOURCE lights[] = {
+		{ glm::vec3(12.0f, 15.0f, 5.0f), glm::vec3(0.1f, 0.1f, 0.1f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 32.0f, 0.05f },
+		{ glm::vec3(6.0f, 5.0f, 5.0f), glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 32.0f, 0.5f },
+		{ glm::vec3(0.0f, 15.0f, 20.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.1f, 0.1f, 0.1f), glm::vec3(0.0f, 0.0f, 0.0f), 32.0f, 0.05f },
+		{ glm::vec3(1.0f, 4.0f, -5.0f), glm::vec3(0.3f, 0.3f, 0.3f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.2f, 0.2f, 0.2f), 6.0f, 0.8f } };
 
+	// the light table is kept for the light baker
+	m_lightSources.assign(lights, lights + sizeof(lights) / sizeof(lights[0]));
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", 12.0f, 15.0f, 5.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.05f);
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", 6.0f, 5.0f, 5.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.5f);
-
-	m_pShaderManager->setVec3Value("lightSources[2].position", 0.0f, 15.0f, 20.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.05f);
-
-	m_pShaderManager->setVec3Value("lightSources[3].position", 1.0f, 4.0f, -5.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 6.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.8f);
+	UploadSceneLights();
+}
+
+/***********************************************************
+ *  UploadSceneLights()
+ *
+ *  This method is used for passing the light table into
+ *  the shader.  The shader always loops over all of its
+ *  lights, so the entries past the end of the table are
+ *  sent as black lights.
+ ***********************************************************/
+void SceneManager::UploadSceneLights()
+{
+	LIGHT_SOURCE noLight = {
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 1.0f, 0.0f };
+
+	for (int i = 0; i < MAX_SCENE_LIGHTS; i++)
+	{
+		const LIGHT_SOURCE& light = (i < (int)m_lightSources.size()) ? m_lightSources[i] : noLight;
+		std::string lightName = "lightSources[" + std::to_string(i) + "].";
+
+		m_pShaderManager->setVec3Value(lightName + "position", light.position);
+		m_pShaderManager->setVec3Value(lightName + "ambientColor", light.ambientColor);
+		m_pShaderManager->setVec3Value(lightName + "diffuseColor", light.diffuseColor);
+		m_pShaderManager->setVec3Value(lightName + "specularColor", light.specularColor);
+		m_pShaderManager->setFloatValue(lightName + "focalStrength", light.focalStrength);
+		m_pShaderManager->setFloatValue(lightName + "specularIntensity", light.specularIntensity);
+	}
 
 	m_pShaderManager->setBoolValue("bUseLighting", true);
 }
@@ -529,6 +762,12 @@ void SceneManager::SetupSceneLights()
 void SceneManager::SetShaderMaterial(
 	std::string materialTag)
 {
+	if (m_bCapturingScene == true)
+	{
+		m_captureState.materialTag = materialTag;
+		return;
+	}
+
 	if (m_objectMaterials.size() > 0)
 	{
 		OBJECT_MATERIAL material;
@@ -546,6 +785,903 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the bounding sphere of
+ *  a mesh, around the center of its vertex bounds.  The
+ *  sphere is found once and kept.
+ ***********************************************************/
+glm::vec4 SceneManager::GetMeshBounds(ShapeMeshes::MESH_TYPE mesh)
+{
+	glm::vec4& meshBounds = m_meshBounds[mesh];
+
+	if (meshBounds.w < 0.0f)
+	{
+		const std::vector<GLfloat>& vertexData = m_basicMeshes->GetMeshVertexData(mesh);
+		glm::vec3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t v = 0; v + 2 < vertexData.size(); v += ShapeMeshes::FLOATS_PER_VERTEX)
+		{
+			glm::vec3 position(vertexData[v], vertexData[v + 1], vertexData[v + 2]);
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+
+		meshBounds = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		if (boundsMin.x <= boundsMax.x)
+		{
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			meshBounds = glm::vec4(center, glm::length(boundsMax - center));
+		}
+	}
+
+	return(meshBounds);
+}
+
+/***********************************************************
+ *  SetObjectDynamic()
+ *
+ *  This method is used for marking the objects drawn next
+ *  as animated, so they are kept in the dynamic stream
+ *  instead of the static buffer.
+ ***********************************************************/
+void SceneManager::SetObjectDynamic(bool bDynamic)
+{
+	if (m_bCapturingScene == true)
+	{
+		m_captureState.bDynamic = bDynamic;
+	}
+}
+
+/***********************************************************
+ *  SetCullingView()
+ *
+ *  This method is used for passing the current view and
+ *  projection to the meshes, so that meshlets outside the
+ *  view or facing away from the camera are not drawn.
+ ***********************************************************/
+void SceneManager::SetCullingView(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	m_basicMeshes->SetCullingView(projection * view, cameraPosition);
+
+	m_frameView = view;
+	m_frameProjection = projection;
+	m_frameCameraPosition = cameraPosition;
+
+	if (m_hlod.IsBuilt() == true)
+	{
+		m_hlod.SelectProxies(view, projection, cameraPosition);
+	}
+}
+
+/***********************************************************
+ *  RecordSceneDraws()
+ *
+ *  This method is used for running RenderScene() with the
+ *  shader settings kept instead of sent to the GPU.  Each
+ *  draw is handed to the passed in function as a scene
+ *  object holding the settings that were current when it
+ *  was issued.
+ ***********************************************************/
+void SceneManager::RecordSceneDraws(const std::function<void(const SCENE_OBJECT&)>& onDraw)
+{
+	m_captureState.model = glm::mat4(1.0f);
+	m_captureState.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	m_captureState.textureTag.clear();
+	m_captureState.materialTag.clear();
+	m_captureState.uvScale = glm::vec2(0.0f, 0.0f);
+	m_captureState.bDynamic = false;
+	m_captureState.bufferIndex = 0;
+
+	m_bCapturingScene = true;
+	m_basicMeshes->SetDrawRecorder([this, &onDraw](const ShapeMeshes::MESH_DRAW& draw)
+	{
+		m_captureState.draw = draw;
+		onDraw(m_captureState);
+	});
+
+	RenderScene();
+
+	m_basicMeshes->SetDrawRecorder(nullptr);
+	m_bCapturingScene = false;
+}
+
+/***********************************************************
+ *  CaptureSceneObjects()
+ *
+ *  This method is used for capturing the draws of
+ *  RenderScene() into the list of scene objects.
+ ***********************************************************/
+void SceneManager::CaptureSceneObjects()
+{
+	// baked lighting belongs to the previous list of objects
+	DestroyBakedLighting();
+
+	m_sceneObjects.clear();
+
+	// the object buffers belong to the previous list, and are
+	// built again when the new list is first drawn
+	m_bObjectBuffersBuilt = false;
+	m_hlod.Destroy();
+
+	RecordSceneDraws([this](const SCENE_OBJECT& object)
+	{
+		m_sceneObjects.push_back(object);
+	});
+}
+
+/***********************************************************
+ *  RenderSceneObjects()
+ *
+ *  This method is used for drawing the captured scene
+ *  objects with the same shader settings RenderScene()
+ *  used.  When baked lighting is loaded, each object's
+ *  lighting is fed to the shader as a vertex stream.
+ ***********************************************************/
+void SceneManager::RenderSceneObjects()
+{
+	PERF_SCOPE("RenderSceneObjects");
+
+	bool bBakedLighting = (m_bakedLighting.size() == m_sceneObjects.size());
+
+	if (m_bObjectBuffersBuilt == false)
+	{
+		BuildObjectBuffers();
+	}
+	m_objectBuffers.UploadChanges();
+
+	// shaders that read the object buffers are sent one index
+	// per object instead of the model transform, others get
+	// the model transform as before
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	GLint objectIndexLocation = -1;
+	if ((program != 0) && (m_objectBuffers.IsCreated() == true))
+	{
+		objectIndexLocation = glGetUniformLocation(program, g_ObjectIndexName);
+	}
+	if ((objectIndexLocation >= 0) && (NULL != m_pShaderManager))
+	{
+		m_objectBuffers.Bind(g_StaticObjectsUnit, g_DynamicObjectsUnit);
+		m_pShaderManager->setIntValue(g_StaticObjectsName, g_StaticObjectsUnit);
+		m_pShaderManager->setIntValue(g_DynamicObjectsName, g_DynamicObjectsUnit);
+	}
+
+	bool bHLOD = m_hlod.IsBuilt();
+	// the impostors are lit by the scene lights, so they are
+	// left out while the baked lighting is drawn
+	bool bImpostors = ((m_bImpostors == true) && (bBakedLighting == false) && (m_impostors.IsCreated() == true));
+
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+
+		// objects of the far clusters are drawn by their proxy
+		if ((bHLOD == true) && (m_hlod.IsObjectProxied((GLuint)i) == true))
+		{
+			continue;
+		}
+
+		// the curved primitives are ray cast after the meshes
+		if ((bImpostors == true) && (ImpostorRenderer::CanDraw(object.draw) == true))
+		{
+			m_impostorObjects.push_back(i);
+			continue;
+		}
+
+		m_basicMeshes->SetModelTransform(object.model);
+		if (objectIndexLocation >= 0)
+		{
+			glUniform1i(objectIndexLocation, object.bufferIndex);
+		}
+		else if (NULL != m_pShaderManager)
+		{
+			m_pShaderManager->setMat4Value(g_ModelName, object.model);
+		}
+
+		SetObjectSurface(object);
+
+		if (bBakedLighting == true)
+		{
+			m_basicMeshes->SetVertexColorStream(m_bakedLighting[i]);
+		}
+		m_basicMeshes->DrawMesh(object.draw);
+	}
+
+	m_basicMeshes->SetVertexColorStream(0);
+
+	if (bImpostors == true)
+	{
+		RenderImpostors();
+	}
+
+	if (bHLOD == true)
+	{
+		m_hlod.DrawProxies();
+	}
+}
+
+/***********************************************************
+ *  SetObjectSurface()
+ *
+ *  This method is used for sending the color, texture,
+ *  material and UV scale captured with an object to the
+ *  shader.
+ ***********************************************************/
+void SceneManager::SetObjectSurface(const SCENE_OBJECT& object)
+{
+	SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+	if (object.textureTag.empty() == false)
+	{
+		SetShaderTexture(object.textureTag);
+	}
+	if (object.materialTag.empty() == false)
+	{
+		SetShaderMaterial(object.materialTag);
+	}
+	if ((object.uvScale.x != 0.0f) || (object.uvScale.y != 0.0f))
+	{
+		SetTextureUVScale(object.uvScale.x, object.uvScale.y);
+	}
+}
+
+/***********************************************************
+ *  RenderImpostors()
+ *
+ *  This method is used for drawing the objects picked for
+ *  impostors by RenderSceneObjects().  The impostor program
+ *  stands in for the scene shader during the pass, so the
+ *  lights and the surface of each object are sent to it by
+ *  the usual methods.
+ ***********************************************************/
+void SceneManager::RenderImpostors()
+{
+	PERF_SCOPE("RenderImpostors");
+
+	if (m_impostorObjects.empty() == true)
+	{
+		return;
+	}
+
+	m_impostors.Begin(m_frameView, m_frameProjection, m_frameCameraPosition);
+
+	ShaderManager* pSceneShader = m_pShaderManager;
+	m_pShaderManager = m_impostors.GetShaderManager();
+	UploadSceneLights();
+
+	for (size_t i = 0; i < m_impostorObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[m_impostorObjects[i]];
+
+		SetObjectSurface(object);
+		m_impostors.Draw(object.draw, object.model);
+	}
+
+	m_pShaderManager = pSceneShader;
+	m_impostors.End();
+
+	m_impostorObjects.clear();
+}
+
+/***********************************************************
+ *  SetImpostors()
+ *
+ *  This method is used for switching the spheres, cylinders
+ *  and cones of the captured objects between their meshes
+ *  and the ray cast impostors.  The impostor shader is
+ *  loaded the first time they are switched on.
+ ***********************************************************/
+void SceneManager::SetImpostors(bool bImpostors)
+{
+	if ((bImpostors == true) && (m_impostors.IsCreated() == false))
+	{
+		if (m_impostors.Create() == false)
+		{
+			bImpostors = false;
+		}
+	}
+
+	m_bImpostors = bImpostors;
+}
+
+/***********************************************************
+ *  AnimateSceneObjects()
+ *
+ *  This method is used for moving the dynamic objects to
+ *  the passed in time.  Each one turns around its own up
+ *  axis at the speed of the platter, so the copies in a
+ *  stress scene spin in place as well.  Only the records of
+ *  the dynamic objects are changed, and only those are sent
+ *  by the next draw of the captured objects.
+ ***********************************************************/
+void SceneManager::AnimateSceneObjects(double seconds)
+{
+	if (m_bObjectBuffersBuilt == false)
+	{
+		BuildObjectBuffers();
+	}
+
+	float angle = (float)glm::radians(fmod(seconds * g_PlatterRPM * 6.0, 360.0));
+	glm::mat4 spin = glm::rotate(angle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (size_t i = 0; i < m_dynamicObjects.size(); i++)
+	{
+		SCENE_OBJECT& object = m_sceneObjects[m_dynamicObjects[i]];
+		SceneObjectBuffers::OBJECT_RECORD record;
+
+		object.model = m_dynamicRestModels[i] * spin;
+		record.model = object.model;
+		record.bounds = SceneObjectBuffers::TransformBounds(m_dynamicLocalBounds[i], object.model);
+		m_objectBuffers.SetDynamicRecord((GLuint)i, record);
+	}
+}
+
+/***********************************************************
+ *  BuildObjectBuffers()
+ *
+ *  This method is used for splitting the captured objects
+ *  into the static buffer and the dynamic stream.  Each
+ *  object is given its record index, with the dynamic ones
+ *  counted down from -1 so one index tells the shader which
+ *  buffer to read.
+ ***********************************************************/
+void SceneManager::BuildObjectBuffers()
+{
+	PERF_SCOPE("BuildObjectBuffers");
+
+	std::vector<SceneObjectBuffers::OBJECT_RECORD> staticRecords;
+	std::vector<SceneObjectBuffers::OBJECT_RECORD> dynamicRecords;
+
+	m_dynamicObjects.clear();
+	m_dynamicRestModels.clear();
+	m_dynamicLocalBounds.clear();
+
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		SCENE_OBJECT& object = m_sceneObjects[i];
+		glm::vec4 localBounds = GetMeshBounds(object.draw.mesh);
+
+		SceneObjectBuffers::OBJECT_RECORD record;
+		record.model = object.model;
+		record.bounds = SceneObjectBuffers::TransformBounds(localBounds, object.model);
+
+		if (object.bDynamic == true)
+		{
+			object.bufferIndex = -1 - (GLint)dynamicRecords.size();
+			dynamicRecords.push_back(record);
+			m_dynamicObjects.push_back(i);
+			m_dynamicRestModels.push_back(object.model);
+			m_dynamicLocalBounds.push_back(localBounds);
+		}
+		else
+		{
+			object.bufferIndex = (GLint)staticRecords.size();
+			staticRecords.push_back(record);
+		}
+	}
+
+	m_objectBuffers.Create(staticRecords, dynamicRecords);
+	m_bObjectBuffersBuilt = true;
+}
+
+/***********************************************************
+ *  GenerateStressScene()
+ *
+ *  This method is used for building a scene of the passed
+ *  in size from copies of the objects RenderScene() draws.
+ *  The copies sit on a square grid with spacing set by the
+ *  footprint of the scene, each one moved by a random
+ *  offset and turned by a random angle around its center.
+ *  Textured objects of each copy can be given other loaded
+ *  textures, so the draws switch between more textures.
+ ***********************************************************/
+void SceneManager::GenerateStressScene(const STRESS_SCENE& settings)
+{
+	PERF_SCOPE("StressSceneGeneration");
+
+	// the copies are given textures by their slots
+	FinishTextureStreaming();
+
+	// the captured scene is the assembly that gets copied
+	CaptureSceneObjects();
+
+	std::vector<SCENE_OBJECT> assembly;
+	assembly.swap(m_sceneObjects);
+	if ((assembly.empty() == true) || (settings.nObjects == 0))
+	{
+		m_stressGridSize = 0.0f;
+		return;
+	}
+
+	// the footprint of the assembly comes from its vertices,
+	// since the object positions leave out the large table
+	glm::vec3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < assembly.size(); i++)
+	{
+		const std::vector<GLfloat>& vertexData = m_basicMeshes->GetMeshVertexData(assembly[i].draw.mesh);
+		for (size_t v = 0; v + 2 < vertexData.size(); v += ShapeMeshes::FLOATS_PER_VERTEX)
+		{
+			glm::vec4 position = assembly[i].model * glm::vec4(vertexData[v], vertexData[v + 1], vertexData[v + 2], 1.0f);
+			boundsMin = glm::min(boundsMin, glm::vec3(position));
+			boundsMax = glm::max(boundsMax, glm::vec3(position));
+		}
+	}
+	if (boundsMin.x > boundsMax.x)
+	{
+		boundsMin = glm::vec3(-1.0f, -1.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+	}
+
+	// the copies turn around the center of the footprint, so
+	// the spacing has to fit the footprint at any angle
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = glm::length(glm::vec2(boundsMax.x - boundsMin.x, boundsMax.z - boundsMin.z)) * 0.5f;
+	float spacing = radius * 2.0f * (1.0f + settings.jitter);
+
+	size_t nCopies = (settings.nObjects + assembly.size() - 1) / assembly.size();
+	size_t gridSide = (size_t)ceil(sqrt((double)nCopies));
+	m_stressGridSize = spacing * gridSide;
+
+	int nTextures = std::min((int)settings.nTextures, m_loadedTextures);
+
+	std::mt19937 random(settings.seed);
+	std::uniform_real_distribution<float> unit(-0.5f, 0.5f);
+
+	m_sceneObjects.reserve(settings.nObjects);
+	for (size_t copy = 0; copy < nCopies; copy++)
+	{
+		float gridX = ((float)(copy % gridSide) - (gridSide - 1) * 0.5f) * spacing;
+		float gridZ = ((float)(copy / gridSide) - (gridSide - 1) * 0.5f) * spacing;
+		glm::vec3 offset(
+			gridX + unit(random) * settings.jitter * spacing,
+			0.0f,
+			gridZ + unit(random) * settings.jitter * spacing);
+		float angle = unit(random) * 360.0f;
+		int textureShift = (nTextures > 0) ? (int)(random() % nTextures) : 0;
+
+		glm::mat4 copyModel =
+			glm::translate(offset + center) *
+			glm::rotate(glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::translate(-center);
+
+		for (size_t i = 0; (i < assembly.size()) && (m_sceneObjects.size() < settings.nObjects); i++)
+		{
+			SCENE_OBJECT object = assembly[i];
+			object.model = copyModel * object.model;
+
+			int textureSlot = FindTextureSlot(object.textureTag);
+			if ((nTextures > 0) && (object.textureTag.empty() == false) && (textureSlot >= 0))
+			{
+				object.textureTag = m_textureIDs[(textureSlot + textureShift) % nTextures].tag;
+			}
+
+			m_sceneObjects.push_back(object);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildSceneHLOD()
+ *
+ *  This method is used for building the proxies of the
+ *  captured static objects, with the current lights baked
+ *  into them.  The objects drawing the same mesh parts
+ *  share one list of triangles.  The dynamic objects are
+ *  merged as they stand now, their motion is too small to
+ *  see from where the proxy is drawn.
+ ***********************************************************/
+bool SceneManager::BuildSceneHLOD(const SceneHLOD::HLOD_SETTINGS& settings)
+{
+	std::map<std::tuple<int, GLuint, bool>, std::vector<GLuint>> drawTriangles;
+
+	// the proxies take the average texture colors
+	FinishTextureStreaming();
+
+	for (size_t i = 0; i < m_lightSources.size(); i++)
+	{
+		SceneHLOD::HLOD_LIGHT light;
+		light.position = m_lightSources[i].position;
+		light.ambientColor = m_lightSources[i].ambientColor;
+		light.diffuseColor = m_lightSources[i].diffuseColor;
+		m_hlod.AddLight(light);
+	}
+
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+
+		std::tuple<int, GLuint, bool> drawKey(object.draw.mesh, object.draw.partMask, object.draw.bHalf);
+		auto found = drawTriangles.find(drawKey);
+		if (found == drawTriangles.end())
+		{
+			found = drawTriangles.insert(std::make_pair(drawKey, std::vector<GLuint>())).first;
+			m_basicMeshes->GetMeshTriangles(object.draw, found->second);
+		}
+
+		const std::vector<GLfloat>& vertexData = m_basicMeshes->GetMeshVertexData(object.draw.mesh);
+		SceneHLOD::HLOD_OBJECT hlodObject;
+
+		hlodObject.index = (GLuint)i;
+		hlodObject.vertexData = vertexData.data();
+		hlodObject.floatsPerVertex = ShapeMeshes::FLOATS_PER_VERTEX;
+		hlodObject.nVertices = (GLuint)vertexData.size() / ShapeMeshes::FLOATS_PER_VERTEX;
+		hlodObject.pTriangles = &found->second;
+		hlodObject.model = object.model;
+		hlodObject.bounds = SceneObjectBuffers::TransformBounds(GetMeshBounds(object.draw.mesh), object.model);
+		hlodObject.albedo = glm::vec3(object.color.r, object.color.g, object.color.b);
+
+		int textureSlot = FindTextureSlot(object.textureTag);
+		if ((object.textureTag.empty() == false) && (textureSlot >= 0))
+		{
+			hlodObject.albedo = m_textureIDs[textureSlot].averageColor;
+		}
+
+		m_hlod.AddObject(hlodObject);
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	bool bBuilt = m_hlod.Build(settings);
+	std::chrono::duration<double> buildTime = std::chrono::steady_clock::now() - startTime;
+	if (bBuilt == true)
+	{
+		std::cout << "Built " << m_hlod.GetClusterCount() << " HLOD clusters with "
+			<< m_hlod.GetProxyTriangleCount() << " proxy triangles in "
+			<< buildTime.count() << " seconds" << std::endl;
+	}
+
+	return(bBuilt);
+}
+
+#ifdef USE_VULKAN_BACKEND
+/***********************************************************
+ *  BuildVulkanScene()
+ *
+ *  This method is used for handing the scene to the Vulkan
+ *  renderer.  The loaded textures are read back from GL
+ *  and added in slot order, the materials and lights are
+ *  added as defined, and RenderScene() is run with its
+ *  draws recorded, so each draw becomes an object with the
+ *  texture, material and UV scale it was drawn with.  Each
+ *  distinct draw of a mesh is added once as a triangle
+ *  list.
+ ***********************************************************/
+bool SceneManager::BuildVulkanScene(VulkanRenderer& renderer)
+{
+	std::map<std::tuple<int, GLuint, bool>, uint32_t> drawMeshes;
+	std::map<std::string, uint32_t> materials;
+	// every texture slot is sent to the renderer
+	FinishTextureStreaming();
+	std::vector<uint32_t> textures(m_loadedTextures, VulkanRenderer::NO_TEXTURE);
+
+	renderer.ClearScene();
+
+	for (size_t i = 0; i < m_lightSources.size(); i++)
+	{
+		VulkanRenderer::RENDER_LIGHT light;
+		light.position = m_lightSources[i].position;
+		light.ambientColor = m_lightSources[i].ambientColor;
+		light.diffuseColor = m_lightSources[i].diffuseColor;
+		light.specularColor = m_lightSources[i].specularColor;
+		light.focalStrength = m_lightSources[i].focalStrength;
+		light.specularIntensity = m_lightSources[i].specularIntensity;
+		renderer.AddLight(light);
+	}
+
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		VulkanRenderer::RENDER_MATERIAL material;
+		material.ambientColor = m_objectMaterials[i].ambientColor;
+		material.ambientStrength = m_objectMaterials[i].ambientStrength;
+		material.diffuseColor = m_objectMaterials[i].diffuseColor;
+		material.specularColor = m_objectMaterials[i].specularColor;
+		material.shininess = m_objectMaterials[i].shininess;
+		materials[m_objectMaterials[i].tag] = renderer.AddMaterial(material);
+	}
+
+	// each texture is bound to the unit of its slot already,
+	// so reading it back leaves the bindings as they were
+	std::vector<unsigned char> pixels;
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		if ((width <= 0) || (height <= 0))
+		{
+			continue;
+		}
+
+		pixels.resize((size_t)width * height * 4);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		textures[i] = renderer.AddTexture(pixels.data(), (uint32_t)width, (uint32_t)height);
+	}
+
+	// the UV scale carries over from the object before, the
+	// same as the shader uniform it sets
+	glm::vec2 uvScale(1.0f, 1.0f);
+	RecordSceneDraws([&](const SCENE_OBJECT& object)
+	{
+		std::tuple<int, GLuint, bool> drawKey(object.draw.mesh, object.draw.partMask, object.draw.bHalf);
+		auto found = drawMeshes.find(drawKey);
+		if (found == drawMeshes.end())
+		{
+			std::vector<GLuint> triangles;
+			m_basicMeshes->GetMeshTriangles(object.draw, triangles);
+
+			const std::vector<GLfloat>& vertexData = m_basicMeshes->GetMeshVertexData(object.draw.mesh);
+			uint32_t mesh = renderer.AddMesh(
+				vertexData.data(),
+				ShapeMeshes::FLOATS_PER_VERTEX,
+				(uint32_t)(vertexData.size() / ShapeMeshes::FLOATS_PER_VERTEX),
+				triangles);
+			found = drawMeshes.insert(std::make_pair(drawKey, mesh)).first;
+		}
+
+		if ((object.uvScale.x != 0.0f) || (object.uvScale.y != 0.0f))
+		{
+			uvScale = object.uvScale;
+		}
+
+		uint32_t texture = VulkanRenderer::NO_TEXTURE;
+		int textureSlot = FindTextureSlot(object.textureTag);
+		if ((object.textureTag.empty() == false) && (textureSlot >= 0))
+		{
+			texture = textures[textureSlot];
+		}
+
+		uint32_t material = VulkanRenderer::NO_MATERIAL;
+		auto foundMaterial = materials.find(object.materialTag);
+		if (foundMaterial != materials.end())
+		{
+			material = foundMaterial->second;
+		}
+
+		renderer.AddObject(found->second, object.model, object.color, texture, material, uvScale);
+	});
+
+	return(renderer.UploadScene());
+}
+#endif
+
+/***********************************************************
+ *  BuildThumbnailScene()
+ *
+ *  This method is used for handing the captured objects to
+ *  the thumbnail renderer.  Each distinct draw of a mesh is
+ *  added once, over the vertices the shapes were loaded
+ *  into, and the textured objects keep their texture and
+ *  the UV scale they were drawn with, which carries over
+ *  from the object before when it was never set.
+ ***********************************************************/
+bool SceneManager::BuildThumbnailScene(ThumbnailRenderer& renderer)
+{
+	std::map<std::tuple<int, GLuint, bool>, GLuint> drawMeshes;
+
+	// the workers share the loaded textures
+	FinishTextureStreaming();
+	renderer.ClearScene();
+
+	glm::vec3 ambientColor(0.0f);
+	for (size_t i = 0; i < m_lightSources.size(); i++)
+	{
+		ThumbnailRenderer::RENDER_LIGHT light;
+		light.position = m_lightSources[i].position;
+		light.diffuseColor = m_lightSources[i].diffuseColor;
+		renderer.AddLight(light);
+		ambientColor += m_lightSources[i].ambientColor;
+	}
+	renderer.SetAmbientColor(glm::min(ambientColor, glm::vec3(1.0f)));
+
+	glm::vec2 uvScale(1.0f, 1.0f);
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+
+		std::tuple<int, GLuint, bool> drawKey(object.draw.mesh, object.draw.partMask, object.draw.bHalf);
+		auto found = drawMeshes.find(drawKey);
+		if (found == drawMeshes.end())
+		{
+			std::vector<GLuint> triangles;
+			m_basicMeshes->GetMeshTriangles(object.draw, triangles);
+
+			GLuint mesh = renderer.AddMesh(m_basicMeshes->GetMeshVertexRange(object.draw.mesh), triangles);
+			found = drawMeshes.insert(std::make_pair(drawKey, mesh)).first;
+		}
+
+		if ((object.uvScale.x != 0.0f) || (object.uvScale.y != 0.0f))
+		{
+			uvScale = object.uvScale;
+		}
+
+		GLuint texture = 0;
+		int textureSlot = FindTextureSlot(object.textureTag);
+		if ((object.textureTag.empty() == false) && (textureSlot >= 0))
+		{
+			texture = m_textureIDs[textureSlot].ID;
+		}
+
+		renderer.AddObject(found->second, object.model, object.color, texture, uvScale);
+	}
+
+	return(renderer.UploadScene());
+}
+
+/***********************************************************
+ *  SetupStressLights()
+ *
+ *  This method is used for spreading the passed in number
+ *  of lights on a circle over the stress scene grid.  The
+ *  light array of the shader has MAX_SCENE_LIGHTS entries,
+ *  so larger counts are limited to that.
+ ***********************************************************/
+void SceneManager::SetupStressLights(int nLights)
+{
+	nLights = std::max(0, std::min(nLights, (int)MAX_SCENE_LIGHTS));
+
+	// the lights share the light the scene would get from one
+	float share = (nLights > 0) ? 1.0f / nLights : 0.0f;
+	float circle = std::max(m_stressGridSize * 0.25f, 5.0f);
+
+	m_lightSources.clear();
+	for (int i = 0; i < nLights; i++)
+	{
+		float angle = glm::radians(360.0f * i / nLights);
+		LIGHT_SOURCE light;
+
+		light.position = glm::vec3(cos(angle) * circle, 15.0f, sin(angle) * circle);
+		light.ambientColor = glm::vec3(0.3f, 0.3f, 0.3f) * share;
+		light.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f) * share;
+		light.specularColor = glm::vec3(0.2f, 0.2f, 0.2f) * share;
+		light.focalStrength = 32.0f;
+		light.specularIntensity = 0.2f;
+		m_lightSources.push_back(light);
+	}
+
+	UploadSceneLights();
+}
+
+/***********************************************************
+ *  BakeSceneLighting()
+ *
+ *  This method is used for baking the lighting of the
+ *  captured scene on the CPU, saving it to the passed in
+ *  file and sending it to the GPU.  The meshes, textures
+ *  and lights must already be prepared.
+ ***********************************************************/
+bool SceneManager::BakeSceneLighting(const char* filename)
+{
+	LightBaker baker;
+
+	CaptureSceneObjects();
+	AddBakeObjects(baker);
+
+	auto startTime = std::chrono::steady_clock::now();
+	if (baker.Bake() == false)
+	{
+		return(false);
+	}
+	std::chrono::duration<double> bakeTime = std::chrono::steady_clock::now() - startTime;
+	std::cout << "Baked lighting for " << m_sceneObjects.size() << " objects in "
+		<< bakeTime.count() << " seconds" << std::endl;
+
+	UploadBakedLighting(baker);
+
+	return(baker.SaveBakedLighting(filename));
+}
+
+/***********************************************************
+ *  LoadBakedLighting()
+ *
+ *  This method is used for loading lighting baked earlier
+ *  and sending it to the GPU.  Fails when the scene has
+ *  changed since the lighting was baked.
+ ***********************************************************/
+bool SceneManager::LoadBakedLighting(const char* filename)
+{
+	LightBaker baker;
+
+	CaptureSceneObjects();
+	AddBakeObjects(baker);
+
+	if (baker.LoadBakedLighting(filename) == false)
+	{
+		return(false);
+	}
+
+	UploadBakedLighting(baker);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddBakeObjects()
+ *
+ *  This method is used for passing the lights and the
+ *  captured objects to the light baker.  Textured objects
+ *  bounce the average color of their texture.
+ ***********************************************************/
+void SceneManager::AddBakeObjects(LightBaker& baker)
+{
+	// the bounced light takes the average texture colors
+	FinishTextureStreaming();
+
+	for (size_t i = 0; i < m_lightSources.size(); i++)
+	{
+		LightBaker::BAKE_LIGHT light;
+		light.position = m_lightSources[i].position;
+		light.diffuseColor = m_lightSources[i].diffuseColor;
+		baker.AddLight(light);
+	}
+
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		const std::vector<GLfloat>& vertexData = m_basicMeshes->GetMeshVertexData(object.draw.mesh);
+		LightBaker::BAKE_OBJECT bakeObject;
+
+		bakeObject.vertexData = vertexData.data();
+		bakeObject.floatsPerVertex = ShapeMeshes::FLOATS_PER_VERTEX;
+		bakeObject.nVertices = (GLuint)vertexData.size() / ShapeMeshes::FLOATS_PER_VERTEX;
+		m_basicMeshes->GetMeshTriangles(object.draw, bakeObject.triangles);
+		bakeObject.model = object.model;
+		bakeObject.albedo = glm::vec3(object.color.r, object.color.g, object.color.b);
+
+		int textureSlot = FindTextureSlot(object.textureTag);
+		if ((object.textureTag.empty() == false) && (textureSlot >= 0))
+		{
+			bakeObject.albedo = m_textureIDs[textureSlot].averageColor;
+		}
+
+		baker.AddObject(bakeObject);
+	}
+}
+
+/***********************************************************
+ *  UploadBakedLighting()
+ *
+ *  This method is used for creating one vertex buffer of
+ *  baked lighting for each scene object.
+ ***********************************************************/
+void SceneManager::UploadBakedLighting(const LightBaker& baker)
+{
+	DestroyBakedLighting();
+
+	m_bakedLighting.resize(baker.GetObjectCount());
+	glGenBuffers((GLsizei)m_bakedLighting.size(), m_bakedLighting.data());
+
+	for (size_t i = 0; i < m_bakedLighting.size(); i++)
+	{
+		const std::vector<glm::vec4>& lighting = baker.GetObjectLighting(i);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_bakedLighting[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * lighting.size(), lighting.data(), GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyBakedLighting()
+ *
+ *  This method is used for freeing the baked lighting
+ *  buffers.
+ ***********************************************************/
+void SceneManager::DestroyBakedLighting()
+{
+	if (m_bakedLighting.empty() == false)
+	{
+		glDeleteBuffers((GLsizei)m_bakedLighting.size(), m_bakedLighting.data());
+		m_bakedLighting.clear();
+	}
+}
+
 /**************************************************************/
 /*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
 /*** preparing and rendering their own 3D replicated scenes.***/
@@ -572,16 +1708,42 @@ void SceneManager::PrepareScene()
 	
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadPyramid4Mesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadTorusMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadPrismMesh();
+	// in the rendered 3D scene - the meshes are built in
+	// parallel and then uploaded together
+	PERF_SCOPE("MeshGeneration");
+
+	const ShapeMeshes::MESH_TYPE sceneMeshes[] = {
+		ShapeMeshes::MESH_PLANE,
+		ShapeMeshes::MESH_BOX,
+		ShapeMeshes::MESH_CYLINDER,
+		ShapeMeshes::MESH_PYRAMID4,
+		ShapeMeshes::MESH_SPHERE,
+		ShapeMeshes::MESH_TORUS,
+		ShapeMeshes::MESH_CONE,
+		ShapeMeshes::MESH_PRISM };
+
+	// the generated meshes only depend on their types, so
+	// the list is the content the mesh set is known by in
+	// the resource cache - a scene opened again skips the
+	// building and upload
+	const char meshSetName[] = "ShapeMeshes";
+	uint64_t meshesKey = ResourceCache::HashBytes(meshSetName, sizeof(meshSetName));
+	meshesKey = ResourceCache::HashBytes(sceneMeshes, sizeof(sceneMeshes), meshesKey);
+
+	ShapeMeshes* pCachedMeshes = ResourceCache::AcquireMeshes(meshesKey);
+	if (NULL != pCachedMeshes)
+	{
+		delete m_basicMeshes;
+		m_basicMeshes = pCachedMeshes;
+	}
+	else
+	{
+		m_basicMeshes->LoadMeshes(sceneMeshes, sizeof(sceneMeshes) / sizeof(sceneMeshes[0]));
+
+		m_basicMeshes = ResourceCache::AddMeshes(
+			meshesKey, m_basicMeshes, (size_t)m_basicMeshes->GetMeshBufferBytes());
+	}
+	m_meshesKey = meshesKey;
 }
 
 /***********************************************************
@@ -592,6 +1754,8 @@ void SceneManager::PrepareScene()
  ***********************************************************/
 void SceneManager::RenderScene()
 {
+	PERF_SCOPE("RenderScene");
+
 	// declare the variables for the transformations
 	glm::vec3 scaleXYZ;
 	float XrotationDegrees = 0.0f;
@@ -760,6 +1924,9 @@ void SceneManager::RenderScene()
 	m_basicMeshes->DrawCylinderMesh();
 	/****************************************************************/
 	/**********                 Platter                    **********/
+	// the platter and the spindle spin with the turntable
+	SetObjectDynamic(true);
+
 	// set the XYZ scale for the mesh
 	scaleXYZ = glm::vec3(4.7f, 0.2f, 4.7f);
 
@@ -785,6 +1952,7 @@ void SceneManager::RenderScene()
 	// draw the mesh with transformation values
 	m_basicMeshes->DrawCylinderMesh();
 
+	SetObjectDynamic(false);
 	/****************************************************************/
 	/**********             Motor under platter            **********/
 	// set the XYZ scale for the mesh
@@ -812,6 +1980,8 @@ void SceneManager::RenderScene()
 	m_basicMeshes->DrawCylinderMesh();
 	/****************************************************************/
 	/**********                Spindle base                **********/
+	SetObjectDynamic(true);
+
 	// set the XYZ scale for the mesh
 	scaleXYZ = glm::vec3(0.3f, 0.1f, 0.3f);
 
@@ -860,6 +2030,7 @@ void SceneManager::RenderScene()
 
 	// draw the mesh with transformation values
 	m_basicMeshes->DrawCylinderMesh();
+	SetObjectDynamic(false);
 	/****************************************************************/
 	/**********            Motor speed button [base]       **********/
 	// set the XYZ scale for the mesh
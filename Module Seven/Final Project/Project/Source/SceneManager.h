@@ -11,7 +11,15 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "LightBaker.h"
+#include "SceneObjectBuffers.h"
+#include "SceneHLOD.h"
+#include "ImpostorRenderer.h"
+#include "VulkanRenderer.h"
+#include "ThumbnailRenderer.h"
+#include "ResourceCache.h"
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -33,6 +41,8 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		glm::vec3 averageColor;
+		uint64_t cacheKey;        // entry in the resource cache
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,23 +55,113 @@ public:
 		std::string tag;
 	};
 
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// one drawn object of the scene, captured from the
+	// shader settings and draws issued by RenderScene()
+	struct SCENE_OBJECT
+	{
+		ShapeMeshes::MESH_DRAW draw;
+		glm::mat4 model;
+		glm::vec4 color;
+		std::string textureTag;   // empty when drawn with the color
+		std::string materialTag;  // empty when no material was set
+		glm::vec2 uvScale;        // zero when the scale was never set
+		bool bDynamic;            // moved by AnimateSceneObjects()
+		GLint bufferIndex;        // record in the object buffers, negative in the dynamic stream
+	};
+
+	// settings of a generated stress scene
+	struct STRESS_SCENE
+	{
+		GLuint nObjects;          // Objects in the generated scene
+		GLuint nTextures;         // Loaded textures the copies pick from, zero keeps the scene's own
+		float jitter;             // Random offset of each copy, as a fraction of the grid spacing
+		unsigned int seed;        // The same seed generates the same scene
+	};
+
+	// size of the light array in the shaders
+	static const int MAX_SCENE_LIGHTS = 4;
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// entry of the meshes in the resource cache, zero until
+	// the meshes are loaded
+	uint64_t m_meshesKey;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
+	// texture files still to be loaded when the textures are
+	// streamed in, in load order, and the next one to load
+	struct TEXTURE_FILE
+	{
+		std::string filename;
+		std::string tag;
+	};
+	bool m_bStreamTextures;
+	std::vector<TEXTURE_FILE> m_pendingTextures;
+	size_t m_nextPendingTexture;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined light sources
+	std::vector<LIGHT_SOURCE> m_lightSources;
+
+	// objects captured from RenderScene(), and the shader
+	// settings being captured for the next drawn object
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	bool m_bCapturingScene;
+	SCENE_OBJECT m_captureState;
+	// buffers of baked lighting, one per scene object
+	std::vector<GLuint> m_bakedLighting;
+	// width and depth of the generated stress scene grid
+	float m_stressGridSize;
+
+	// transforms and bounds of the captured objects, built
+	// on first use after each capture
+	SceneObjectBuffers m_objectBuffers;
+	bool m_bObjectBuffersBuilt;
+	// the dynamic objects, with their transform and local
+	// bounds before animating
+	std::vector<size_t> m_dynamicObjects;
+	std::vector<glm::mat4> m_dynamicRestModels;
+	std::vector<glm::vec4> m_dynamicLocalBounds;
+	// proxies of the far clusters of objects
+	SceneHLOD m_hlod;
+	// bounding sphere of each mesh, negative radius until
+	// first needed
+	glm::vec4 m_meshBounds[ShapeMeshes::MAX_MESH_TYPES];
+	// spheres, cylinders and cones ray cast in their
+	// bounding boxes, and the objects picked for them in
+	// the current frame
+	ImpostorRenderer m_impostors;
+	bool m_bImpostors;
+	std::vector<size_t> m_impostorObjects;
+	// the view of the current frame
+	glm::mat4 m_frameView;
+	glm::mat4 m_frameProjection;
+	glm::vec3 m_frameCameraPosition;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// load a texture of the scene, or queue it when the
+	// textures are streamed in
+	bool AddSceneTexture(const char* filename, std::string tag);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
-	// free the loaded OpenGL textures
+	// let go of the loaded OpenGL textures, which stay in
+	// the resource cache
 	void DestroyGLTextures();
 	// find a loaded texture by tag
 	int FindTextureID(std::string tag);
@@ -97,6 +197,32 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// add the captured scene objects and the lights to the
+	// passed in light baker
+	void AddBakeObjects(LightBaker& baker);
+	// send the baked lighting of each object to the GPU
+	void UploadBakedLighting(const LightBaker& baker);
+	// free the baked lighting buffers
+	void DestroyBakedLighting();
+
+	// mark the objects drawn next as animated, only used
+	// while capturing
+	void SetObjectDynamic(bool bDynamic);
+	// split the captured objects into the static buffer
+	// and the dynamic stream
+	void BuildObjectBuffers();
+	// get the bounding sphere of a mesh around the center
+	// of its vertex bounds
+	glm::vec4 GetMeshBounds(ShapeMeshes::MESH_TYPE mesh);
+	// send the color, texture, material and UV scale of a
+	// captured object to the shader
+	void SetObjectSurface(const SCENE_OBJECT& object);
+	// run RenderScene() with each draw handed to the passed
+	// in function instead of sent to the GPU
+	void RecordSceneDraws(const std::function<void(const SCENE_OBJECT&)>& onDraw);
+	// draw the objects picked for impostors this frame
+	void RenderImpostors();
+
 public:
 
 	// The following methods are for the students to 
@@ -108,6 +234,83 @@ public:
 	// Render the objects in the 3D scene
 	void RenderScene();
 
+	// Capture the objects drawn by RenderScene() into a
+	// list that can be processed and replayed
+	void CaptureSceneObjects();
+
+	// Render the captured scene objects, with the baked
+	// lighting when it has been loaded
+	void RenderSceneObjects();
+
+	// Move the dynamic captured objects to the passed in
+	// time, the turntable platter spins
+	void AnimateSceneObjects(double seconds);
+
+	// Bake the static lighting of the scene and save it, or
+	// load lighting baked earlier for the same scene
+	bool BakeSceneLighting(const char* filename);
+	bool LoadBakedLighting(const char* filename);
+
+	// Send the light table to the shader, again after the
+	// shader program has been switched
+	void UploadSceneLights();
+
+	// Replace the captured objects with copies of the
+	// scene laid out on a jittered grid
+	void GenerateStressScene(const STRESS_SCENE& settings);
+	// Spread the passed in number of lights over the grid
+	void SetupStressLights(int nLights);
+
+	// Get the size and the draw calls of the captured scene
+	size_t GetSceneObjectCount() { return(m_sceneObjects.size()); }
+	size_t GetSceneObjectBytes() { return(m_sceneObjects.capacity() * sizeof(SCENE_OBJECT)); }
+	GLuint GetDrawCallCount() { return(m_basicMeshes->GetDrawCallCount() + m_hlod.GetDrawCallCount() + m_impostors.GetDrawCallCount()); }
+	void ResetDrawCallCount() { m_basicMeshes->ResetDrawCallCount(); m_hlod.ResetDrawCallCount(); m_impostors.ResetDrawCallCount(); }
+
+	// Merge the far clusters of the captured objects into
+	// proxies drawn in their place, until the next capture
+	bool BuildSceneHLOD(const SceneHLOD::HLOD_SETTINGS& settings);
+	GLuint GetHLODClusterCount() const { return(m_hlod.GetClusterCount()); }
+	GLuint GetHLODProxyCount() const { return(m_hlod.GetSelectedCount()); }
+
+#ifdef USE_VULKAN_BACKEND
+	// Add the objects drawn by RenderScene(), with their
+	// textures and materials, and the lights to the Vulkan
+	// renderer and upload them
+	bool BuildVulkanScene(VulkanRenderer& renderer);
+#endif
+
+	// Add the captured objects and the lights to the thumbnail
+	// renderer and upload them, sharing the loaded textures
+	bool BuildThumbnailScene(ThumbnailRenderer& renderer);
+
+	// Draw the spheres, cylinders and cones of the captured
+	// objects as ray cast impostors instead of meshes
+	void SetImpostors(bool bImpostors);
+
+	// Stream the scene textures in over the first frames
+	// instead of loading them all in PrepareScene(), set
+	// before it is called
+	void SetTextureStreaming(bool bStreaming) { m_bStreamTextures = bStreaming; }
+	// Load the next queued texture, false when none is left
+	bool StreamNextTexture();
+	bool HasPendingTextures() const { return(m_nextPendingTexture < m_pendingTextures.size()); }
+	// Load every queued texture now
+	void FinishTextureStreaming();
+
+	// Keep the shared mesh buffers packed and report how
+	// full they are, the HLOD proxies share them
+	GLsizeiptr CompactMeshBuffers(GLsizeiptr maxBytes) { return(ShapeMeshes::CompactMeshBuffers(maxBytes)); }
+	void GetMeshBufferStats(
+		GPUBufferAllocator::ALLOCATOR_STATS& vertexStats,
+		GPUBufferAllocator::ALLOCATOR_STATS& indexStats) { ShapeMeshes::GetMeshBufferStats(vertexStats, indexStats); }
+
+	// Set the view used for culling the large meshes
+	void SetCullingView(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+
 	// Load all of the needed textures before rendering
 	void LoadSceneTextures();
 
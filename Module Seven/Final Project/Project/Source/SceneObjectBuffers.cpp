@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneObjectBuffers.cpp
+// ============
+// per-object transforms and bounds of the captured scene, split into a
+// static buffer written once and a dynamic stream for the animated objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneObjectBuffers.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/***********************************************************
+ *  SceneObjectBuffers()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneObjectBuffers::SceneObjectBuffers()
+{
+	m_staticBuffer = 0;
+	m_staticTexture = 0;
+	m_nStatic = 0;
+	m_dynamicBuffer = 0;
+	m_dynamicTexture = 0;
+	m_bAnyChanged = false;
+	m_uploadStats.nRecords = 0;
+	m_uploadStats.nRanges = 0;
+	m_uploadStats.bytes = 0;
+}
+
+/***********************************************************
+ *  ~SceneObjectBuffers()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneObjectBuffers::~SceneObjectBuffers()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the static buffer and
+ *  the dynamic stream.  The static records are written
+ *  once into immutable storage where the GL supports it.
+ ***********************************************************/
+bool SceneObjectBuffers::Create(
+	const std::vector<OBJECT_RECORD>& staticRecords,
+	const std::vector<OBJECT_RECORD>& dynamicRecords)
+{
+	Destroy();
+
+	if ((CreateTextureBuffer(staticRecords, false, m_staticBuffer, m_staticTexture) == false) ||
+		(CreateTextureBuffer(dynamicRecords, true, m_dynamicBuffer, m_dynamicTexture) == false))
+	{
+		std::cout << "SceneObjectBuffers: could not create the object buffers" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_nStatic = (GLuint)staticRecords.size();
+	m_dynamicRecords = dynamicRecords;
+	m_bChanged.assign(dynamicRecords.size(), false);
+	m_bAnyChanged = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the GL objects.
+ ***********************************************************/
+void SceneObjectBuffers::Destroy()
+{
+	if (m_staticTexture != 0)
+	{
+		glDeleteTextures(1, &m_staticTexture);
+		m_staticTexture = 0;
+	}
+	if (m_dynamicTexture != 0)
+	{
+		glDeleteTextures(1, &m_dynamicTexture);
+		m_dynamicTexture = 0;
+	}
+	if (m_staticBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_staticBuffer);
+		m_staticBuffer = 0;
+	}
+	if (m_dynamicBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_dynamicBuffer);
+		m_dynamicBuffer = 0;
+	}
+
+	m_nStatic = 0;
+	m_dynamicRecords.clear();
+	m_bChanged.clear();
+	m_bAnyChanged = false;
+}
+
+/***********************************************************
+ *  SetDynamicRecord()
+ *
+ *  This method is used for changing a record of the
+ *  dynamic stream.  The record is only flagged here, the
+ *  upload waits for UploadChanges().
+ ***********************************************************/
+void SceneObjectBuffers::SetDynamicRecord(GLuint index, const OBJECT_RECORD& record)
+{
+	if (index >= m_dynamicRecords.size())
+	{
+		return;
+	}
+
+	m_dynamicRecords[index] = record;
+	m_bChanged[index] = true;
+	m_bAnyChanged = true;
+}
+
+/***********************************************************
+ *  UploadChanges()
+ *
+ *  This method is used for sending the changed dynamic
+ *  records.  Each run of neighbouring changed records is
+ *  sent with one glBufferSubData(), so a frame where a few
+ *  objects moved sends only those few records.
+ ***********************************************************/
+void SceneObjectBuffers::UploadChanges()
+{
+	m_uploadStats.nRecords = 0;
+	m_uploadStats.nRanges = 0;
+	m_uploadStats.bytes = 0;
+
+	if ((m_bAnyChanged == false) || (m_dynamicBuffer == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_dynamicBuffer);
+
+	size_t nRecords = m_dynamicRecords.size();
+	size_t first = 0;
+	while (first < nRecords)
+	{
+		if (m_bChanged[first] == false)
+		{
+			first++;
+			continue;
+		}
+
+		size_t last = first;
+		while ((last < nRecords) && (m_bChanged[last] == true))
+		{
+			m_bChanged[last] = false;
+			last++;
+		}
+
+		GLsizeiptr size = (GLsizeiptr)((last - first) * sizeof(OBJECT_RECORD));
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(first * sizeof(OBJECT_RECORD)), size, &m_dynamicRecords[first]);
+
+		m_uploadStats.nRecords += (GLuint)(last - first);
+		m_uploadStats.nRanges++;
+		m_uploadStats.bytes += size;
+		first = last;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_bAnyChanged = false;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the static and dynamic
+ *  texture buffers to the passed in texture units.  The
+ *  active texture unit is set back to the first one.
+ ***********************************************************/
+void SceneObjectBuffers::Bind(GLuint staticUnit, GLuint dynamicUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + staticUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_staticTexture);
+	glActiveTexture(GL_TEXTURE0 + dynamicUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_dynamicTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for moving a bounding sphere by a
+ *  model transform.  The radius grows by the largest scale
+ *  of the transform, so the sphere still holds the object
+ *  under uneven scales.
+ ***********************************************************/
+glm::vec4 SceneObjectBuffers::TransformBounds(const glm::vec4& localBounds, const glm::mat4& model)
+{
+	glm::vec4 center = model * glm::vec4(localBounds.x, localBounds.y, localBounds.z, 1.0f);
+	float scale = std::max(glm::length(glm::vec3(model[0])),
+		std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	return(glm::vec4(center.x, center.y, center.z, localBounds.w * scale));
+}
+
+/***********************************************************
+ *  CreateTextureBuffer()
+ *
+ *  This method is used for creating a buffer holding the
+ *  passed in records and the texture buffer that reads it.
+ *  Static buffers can never be written again, dynamic
+ *  ones allow glBufferSubData().  An empty list still gets
+ *  one record, so the shader always has a buffer to read.
+ ***********************************************************/
+bool SceneObjectBuffers::CreateTextureBuffer(
+	const std::vector<OBJECT_RECORD>& records,
+	bool bDynamic,
+	GLuint& buffer,
+	GLuint& texture)
+{
+	OBJECT_RECORD emptyRecord;
+	emptyRecord.model = glm::mat4(1.0f);
+	emptyRecord.bounds = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	const OBJECT_RECORD* pRecords = (records.empty() == true) ? &emptyRecord : records.data();
+	GLsizeiptr size = (GLsizeiptr)(std::max(records.size(), (size_t)1) * sizeof(OBJECT_RECORD));
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if ((GLEW_VERSION_4_4 == GL_TRUE) || (GLEW_ARB_buffer_storage == GL_TRUE))
+	{
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, pRecords, (bDynamic == true) ? GL_DYNAMIC_STORAGE_BIT : 0);
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, size, pRecords, (bDynamic == true) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (glGetError() == GL_OUT_OF_MEMORY)
+	{
+		return(false);
+	}
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	return(true);
+}
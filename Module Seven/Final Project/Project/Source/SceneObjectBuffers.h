@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneobjectbuffers.h
+// ============
+// per-object transforms and bounds of the captured scene, split into a
+// static buffer written once and a dynamic stream for the animated objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneObjectBuffers
+ *
+ *  This class contains the GPU copies of the scene object
+ *  transforms and bounds.  The objects that never move go
+ *  into an immutable buffer filled once when it is created.
+ *  The objects that animate go into a separate compact
+ *  stream, where only the records changed since the last
+ *  upload are sent, one glBufferSubData() per run of
+ *  neighbouring changed records.
+ *
+ *  Both buffers are read by the vertex shader through
+ *  texture buffers, five RGBA32F texels per object.
+ ***********************************************************/
+class SceneObjectBuffers
+{
+public:
+	// one object as the shader reads it, the model
+	// transform followed by the world space bounding
+	// sphere as center and radius
+	struct OBJECT_RECORD
+	{
+		glm::mat4 model;
+		glm::vec4 bounds;
+	};
+
+	// upload counts of the last UploadChanges()
+	struct UPLOAD_STATS
+	{
+		GLuint nRecords;          // Changed records sent
+		GLuint nRanges;           // glBufferSubData() calls
+		GLsizeiptr bytes;
+	};
+
+	// constructor
+	SceneObjectBuffers();
+	// destructor
+	~SceneObjectBuffers();
+
+	// create the static buffer and the dynamic stream from
+	// the passed in records
+	bool Create(
+		const std::vector<OBJECT_RECORD>& staticRecords,
+		const std::vector<OBJECT_RECORD>& dynamicRecords);
+	// free the GL objects
+	void Destroy();
+
+	// change a dynamic record, it is sent by the next upload
+	void SetDynamicRecord(GLuint index, const OBJECT_RECORD& record);
+	// send the changed dynamic records
+	void UploadChanges();
+
+	// bind the static and dynamic texture buffers to the
+	// passed in texture units
+	void Bind(GLuint staticUnit, GLuint dynamicUnit) const;
+
+	bool IsCreated() const { return(m_staticTexture != 0); }
+	GLuint GetStaticCount() const { return(m_nStatic); }
+	GLuint GetDynamicCount() const { return((GLuint)m_dynamicRecords.size()); }
+	const UPLOAD_STATS& GetUploadStats() const { return(m_uploadStats); }
+
+	// the bounding sphere of the passed in local sphere
+	// after the model transform
+	static glm::vec4 TransformBounds(const glm::vec4& localBounds, const glm::mat4& model);
+
+private:
+	GLuint m_staticBuffer;
+	GLuint m_staticTexture;
+	GLuint m_nStatic;
+
+	GLuint m_dynamicBuffer;
+	GLuint m_dynamicTexture;
+	// CPU copy of the dynamic stream, with a flag for each
+	// record changed since the last upload
+	std::vector<OBJECT_RECORD> m_dynamicRecords;
+	std::vector<bool> m_bChanged;
+	bool m_bAnyChanged;
+
+	UPLOAD_STATS m_uploadStats;
+
+	// called to create a buffer and the texture buffer that
+	// reads it
+	bool CreateTextureBuffer(
+		const std::vector<OBJECT_RECORD>& records,
+		bool bDynamic,
+		GLuint& buffer,
+		GLuint& texture);
+};
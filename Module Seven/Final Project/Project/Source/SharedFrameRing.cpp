@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+// SharedFrameRing.cpp
+// ============
+// writes the rendered frames into a shared memory ring, so local consumers
+// can read them in place without copies or sockets
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SharedFrameRing.h"
+#include "GLCapture.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// bytes per pixel of the shared frames
+	const GLsizei g_PixelBytes = 4;
+	// the images start on pages of their own, so a consumer
+	// can map or hand on a single image
+	const size_t g_PageBytes = 4096;
+	// pack buffers the frames are read back through, the
+	// oldest is waited for when all of them are in flight
+	const GLuint g_PackBufferCount = 3;
+	// longest wait for a read back, in nanoseconds
+	const GLuint64 g_FenceTimeout = 1000000000;
+
+	size_t AlignBytes(size_t bytes, size_t alignment)
+	{
+		return(((bytes + alignment - 1) / alignment) * alignment);
+	}
+}
+
+/***********************************************************
+ *  SharedFrameRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SharedFrameRing::SharedFrameRing()
+{
+	m_file = -1;
+	m_pMemory = NULL;
+	m_bytes = 0;
+	m_pHeader = NULL;
+	m_firstPending = 0;
+	m_nPending = 0;
+	m_skippedWidth = 0;
+	m_skippedHeight = 0;
+	m_nWritten = 0;
+	m_nSkipped = 0;
+	m_writeMs = 0.0;
+}
+
+/***********************************************************
+ *  ~SharedFrameRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SharedFrameRing::~SharedFrameRing()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the shared memory of
+ *  the ring and filling in its header, and the pack
+ *  buffers the frames are read back through.  The header
+ *  is written last, so a consumer that finds the magic
+ *  finds the rest of the header too.
+ ***********************************************************/
+bool SharedFrameRing::Create(const char* name, GLsizei maxWidth, GLsizei maxHeight, GLuint nSlots)
+{
+	Destroy();
+
+#ifdef __linux__
+	if ((NULL == name) || (name[0] != '/') || (maxWidth <= 0) || (maxHeight <= 0))
+	{
+		std::cout << "SharedFrameRing: the ring needs a name starting with / and a size" << std::endl;
+		return(false);
+	}
+	nSlots = (nSlots < 2) ? 2 : ((nSlots > FRAME_RING_MAX_SLOTS) ? FRAME_RING_MAX_SLOTS : nSlots);
+
+	size_t imageBytes = AlignBytes((size_t)maxWidth * maxHeight * g_PixelBytes, g_PageBytes);
+	size_t slotsOffset = AlignBytes(sizeof(FRAME_RING_HEADER), alignof(FRAME_RING_SLOT));
+	size_t imagesOffset = AlignBytes(slotsOffset + nSlots * sizeof(FRAME_RING_SLOT), g_PageBytes);
+	size_t totalBytes = imagesOffset + nSlots * imageBytes;
+
+	// a ring left by a run that did not exit cleanly has
+	// no producer, so it is replaced
+	shm_unlink(name);
+	m_file = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (m_file < 0)
+	{
+		std::cout << "SharedFrameRing: could not create " << name << ", " << strerror(errno) << std::endl;
+		return(false);
+	}
+	m_name = name;
+
+	if (ftruncate(m_file, (off_t)totalBytes) != 0)
+	{
+		std::cout << "SharedFrameRing: could not size " << name << ", " << strerror(errno) << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	void* pMemory = mmap(NULL, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+	if (pMemory == MAP_FAILED)
+	{
+		std::cout << "SharedFrameRing: could not map " << name << ", " << strerror(errno) << std::endl;
+		Destroy();
+		return(false);
+	}
+	m_pMemory = (unsigned char*)pMemory;
+	m_bytes = totalBytes;
+
+	m_pending.resize(g_PackBufferCount);
+	for (PENDING_FRAME& pending : m_pending)
+	{
+		pending.packBuffer = 0;
+		pending.fence = NULL;
+		glGenBuffers(1, &pending.packBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.packBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)maxWidth * maxHeight * g_PixelBytes, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_firstPending = 0;
+	m_nPending = 0;
+	m_skippedWidth = 0;
+	m_skippedHeight = 0;
+
+	// the new memory is zero, which is an empty ring with
+	// no consumers
+	FRAME_RING_HEADER* pHeader = (FRAME_RING_HEADER*)m_pMemory;
+	pHeader->version = FRAME_RING_VERSION;
+	pHeader->nSlots = nSlots;
+	pHeader->maxWidth = (uint32_t)maxWidth;
+	pHeader->maxHeight = (uint32_t)maxHeight;
+	pHeader->imageBytes = (uint32_t)imageBytes;
+	pHeader->slotsOffset = slotsOffset;
+	pHeader->imagesOffset = imagesOffset;
+	pHeader->totalBytes = totalBytes;
+	pHeader->producerPid = (uint32_t)getpid();
+	__atomic_store_n(&pHeader->magic, FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+	m_pHeader = pHeader;
+
+	ResetStats();
+
+	return(true);
+#else
+	std::cout << "SharedFrameRing: the frame ring needs Linux" << std::endl;
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for closing the ring.  The frames
+ *  still being read back are published first.  The
+ *  consumers are woken to see it closed, and keep their
+ *  mappings until they let go, the name is removed right
+ *  away.
+ ***********************************************************/
+void SharedFrameRing::Destroy()
+{
+	FlushFrames();
+	for (PENDING_FRAME& pending : m_pending)
+	{
+		if (NULL != pending.fence)
+		{
+			glDeleteSync(pending.fence);
+		}
+		glDeleteBuffers(1, &pending.packBuffer);
+	}
+	m_pending.clear();
+	m_nPending = 0;
+
+#ifdef __linux__
+	if (NULL != m_pHeader)
+	{
+		__atomic_store_n(&m_pHeader->bClosed, 1u, __ATOMIC_SEQ_CST);
+		syscall(SYS_futex, &m_pHeader->writeIndex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+		m_pHeader = NULL;
+	}
+	if (NULL != m_pMemory)
+	{
+		munmap(m_pMemory, m_bytes);
+		m_pMemory = NULL;
+		m_bytes = 0;
+	}
+	if (m_file >= 0)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+	if (m_name.empty() == false)
+	{
+		shm_unlink(m_name.c_str());
+		m_name.clear();
+	}
+#endif
+}
+
+/***********************************************************
+ *  WriteFrame()
+ *
+ *  This method is used for queueing the read back of the
+ *  frame into the next pack buffer, behind a fence.  The
+ *  frames queued earlier whose fences have passed are
+ *  published first, and when every pack buffer is still
+ *  in flight the oldest one is waited for.
+ *
+ *  A frame larger than the slots, after the window grew,
+ *  is left out.  The consumers have mapped the ring at its
+ *  size, so it is not made again, the size is reported
+ *  the first time it is left out instead.
+ ***********************************************************/
+bool SharedFrameRing::WriteFrame(const FRAME_INFO& info, GLsizei width, GLsizei height)
+{
+	if (NULL == m_pHeader)
+	{
+		return(false);
+	}
+
+#ifdef __linux__
+	double startMs = GetTimeMs();
+
+	while (m_nPending > 0)
+	{
+		if (PublishFrame(m_nPending == (GLuint)m_pending.size()) == false)
+		{
+			break;
+		}
+	}
+
+	if ((width <= 0) || (height <= 0) ||
+		((uint32_t)width > m_pHeader->maxWidth) || ((uint32_t)height > m_pHeader->maxHeight))
+	{
+		if ((width != m_skippedWidth) || (height != m_skippedHeight))
+		{
+			std::cout << "SharedFrameRing: " << width << "x" << height << " frames are larger than the "
+				<< m_pHeader->maxWidth << "x" << m_pHeader->maxHeight << " slots of " << m_name
+				<< ", they are left out until the window fits the slots again" << std::endl;
+			m_skippedWidth = width;
+			m_skippedHeight = height;
+		}
+		m_nSkipped++;
+		m_writeMs += GetTimeMs() - startMs;
+		return(false);
+	}
+
+	PENDING_FRAME& pending = m_pending[(m_firstPending + m_nPending) % m_pending.size()];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.packBuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	pending.info = info;
+	pending.width = width;
+	pending.height = height;
+	pending.timestampNs = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+	m_nPending++;
+	// a size left out again after the window fit is
+	// reported again
+	m_skippedWidth = 0;
+	m_skippedHeight = 0;
+
+	m_writeMs += GetTimeMs() - startMs;
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  FlushFrames()
+ *
+ *  This method is used for waiting for the read backs still
+ *  in flight and publishing their frames.
+ ***********************************************************/
+void SharedFrameRing::FlushFrames()
+{
+	double startMs = GetTimeMs();
+
+	while (m_nPending > 0)
+	{
+		PublishFrame(true);
+	}
+
+	m_writeMs += GetTimeMs() - startMs;
+}
+
+/***********************************************************
+ *  PublishFrame()
+ *
+ *  This method is used for copying the oldest pending frame
+ *  out of its pack buffer into the next slot and publishing
+ *  it.  The slot's sequence is made odd first, so a
+ *  consumer still reading the frame that was there sees it
+ *  change, and even again once the new frame is whole.
+ *  Only then does the write index move on to it.  False is
+ *  returned, and nothing is done, when the read back has
+ *  not finished and waiting was not asked for.
+ ***********************************************************/
+bool SharedFrameRing::PublishFrame(bool bWait)
+{
+	PENDING_FRAME& pending = m_pending[m_firstPending];
+
+	GLenum result = glClientWaitSync(pending.fence, GL_SYNC_FLUSH_COMMANDS_BIT, (bWait == true) ? g_FenceTimeout : 0);
+	if ((result == GL_TIMEOUT_EXPIRED) && (bWait == false))
+	{
+		return(false);
+	}
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		std::cout << "SharedFrameRing: timed out waiting for the GPU" << std::endl;
+	}
+	glDeleteSync(pending.fence);
+	pending.fence = NULL;
+	m_firstPending = (m_firstPending + 1) % (GLuint)m_pending.size();
+	m_nPending--;
+
+#ifdef __linux__
+	size_t imageBytes = (size_t)pending.width * pending.height * g_PixelBytes;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.packBuffer);
+	const void* pPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)imageBytes, GL_MAP_READ_BIT);
+	if (NULL == pPixels)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return(true);
+	}
+
+	// only the producer writes the write index
+	uint32_t frameIndex = m_pHeader->writeIndex;
+	uint32_t slotIndex = frameIndex % m_pHeader->nSlots;
+	FRAME_RING_SLOT* pSlot = (FRAME_RING_SLOT*)(m_pMemory + m_pHeader->slotsOffset) + slotIndex;
+	unsigned char* pImage = m_pMemory + m_pHeader->imagesOffset + (size_t)slotIndex * m_pHeader->imageBytes;
+
+	uint32_t sequence = pSlot->sequence;
+	__atomic_store_n(&pSlot->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(pImage, pPixels, imageBytes);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	pSlot->frameIndex = frameIndex;
+	pSlot->frameID = pending.info.frameID;
+	pSlot->timestampNs = pending.timestampNs;
+	pSlot->width = (uint32_t)pending.width;
+	pSlot->height = (uint32_t)pending.height;
+	pSlot->stride = (uint32_t)(pending.width * g_PixelBytes);
+	pSlot->format = FRAME_RING_RGBA8;
+	memcpy(pSlot->view, glm::value_ptr(pending.info.view), sizeof(pSlot->view));
+	memcpy(pSlot->projection, glm::value_ptr(pending.info.projection), sizeof(pSlot->projection));
+	memcpy(pSlot->cameraPosition, glm::value_ptr(pending.info.cameraPosition), sizeof(pSlot->cameraPosition));
+	pSlot->frameMs = pending.info.frameMs;
+
+	__atomic_store_n(&pSlot->sequence, sequence + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&m_pHeader->writeIndex, frameIndex + 1, __ATOMIC_SEQ_CST);
+	WakeConsumers();
+
+	m_nWritten++;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  WakeConsumers()
+ *
+ *  This method is used for waking the consumers asleep on
+ *  the write index.  A consumer counts itself in nWaiters
+ *  before it checks the index and sleeps, and the index is
+ *  stored before nWaiters is read, so either the consumer
+ *  sees the new frame or the producer sees the consumer.
+ ***********************************************************/
+void SharedFrameRing::WakeConsumers()
+{
+#ifdef __linux__
+	if (__atomic_load_n(&m_pHeader->nWaiters, __ATOMIC_SEQ_CST) != 0)
+	{
+		syscall(SYS_futex, &m_pHeader->writeIndex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	}
+#endif
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the stats since the last
+ *  reset, and how far behind the attached consumers are.
+ ***********************************************************/
+void SharedFrameRing::GetStats(RING_STATS& stats)
+{
+	stats.nWritten = m_nWritten;
+	stats.nSkipped = m_nSkipped;
+	stats.nConsumers = 0;
+	stats.maxLag = 0;
+	stats.averageWriteMs = (m_nWritten > 0) ? m_writeMs / m_nWritten : 0.0;
+
+#ifdef __linux__
+	if (NULL == m_pHeader)
+	{
+		return;
+	}
+
+	uint32_t writeIndex = m_pHeader->writeIndex;
+	for (uint32_t i = 0; i < FRAME_RING_MAX_CONSUMERS; i++)
+	{
+		FRAME_RING_CONSUMER& consumer = m_pHeader->consumers[i];
+		uint32_t pid = __atomic_load_n(&consumer.pid, __ATOMIC_ACQUIRE);
+		if (pid == 0)
+		{
+			continue;
+		}
+
+		// the entry of a consumer that exited without
+		// letting go is freed for the next one
+		if ((kill((pid_t)pid, 0) != 0) && (errno == ESRCH))
+		{
+			__atomic_compare_exchange_n(&consumer.pid, &pid, 0u, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		uint32_t lag = writeIndex - __atomic_load_n(&consumer.readIndex, __ATOMIC_ACQUIRE);
+		stats.nConsumers++;
+		stats.maxLag = (lag > stats.maxLag) ? lag : stats.maxLag;
+	}
+#endif
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for starting the stats over.
+ ***********************************************************/
+void SharedFrameRing::ResetStats()
+{
+	m_nWritten = 0;
+	m_nSkipped = 0;
+	m_writeMs = 0.0;
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This method is used for reading the wall clock.
+ ***********************************************************/
+double SharedFrameRing::GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedframering.h
+// ============
+// writes the rendered frames into a shared memory ring, so local consumers
+// can read them in place without copies or sockets
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SharedFrameRingFormat.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SharedFrameRing
+ *
+ *  This class contains the producer side of the frame
+ *  ring laid out in SharedFrameRingFormat.h.  Each frame is
+ *  read back from the current read framebuffer into the
+ *  next of a few pixel pack buffers with a fence behind
+ *  it, so the GPU copies it while the next frames draw.
+ *  Once its fence has passed, usually a frame or two
+ *  later, the frame is copied into its slot of the shared
+ *  memory with the camera it was drawn with, and published
+ *  by a seqlock and the write index.  The consumers map the
+ *  same memory, so a frame is never copied again after it.
+ *
+ *  Writing never waits for the consumers, the futex is only
+ *  woken when one of them is asleep on it, and only waits
+ *  for the GPU when every pack buffer is still in flight,
+ *  so the ring costs the frame a copy and little else.
+ ***********************************************************/
+class SharedFrameRing
+{
+public:
+	// what the consumers get to know about a frame
+	struct FRAME_INFO
+	{
+		uint64_t frameID;
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 cameraPosition;
+		float frameMs;
+	};
+
+	struct RING_STATS
+	{
+		GLuint nWritten;          // Frames published
+		GLuint nSkipped;          // Frames larger than the slots, left out
+		GLuint nConsumers;        // Consumers attached now
+		GLuint maxLag;            // Frames the furthest behind consumer has yet to read
+		double averageWriteMs;    // Time a frame costs the renderer to queue, copy and publish
+	};
+
+	// constructor
+	SharedFrameRing();
+	// destructor
+	~SharedFrameRing();
+
+	// create the shared memory with the passed in name, which
+	// starts with a slash, and room for frames up to the
+	// passed in size - an old ring of the same name is
+	// replaced
+	bool Create(const char* name, GLsizei maxWidth, GLsizei maxHeight, GLuint nSlots);
+	// tell the consumers the ring is closed and remove it
+	void Destroy();
+	bool IsCreated() const { return(NULL != m_pHeader); }
+
+	// queue the read back of the passed in size of the
+	// current read framebuffer, and publish the frames
+	// whose read backs have finished - frames larger than
+	// the slots are left out and reported
+	bool WriteFrame(const FRAME_INFO& info, GLsizei width, GLsizei height);
+	// wait for the queued read backs and publish them
+	void FlushFrames();
+
+	// get the stats since the last reset, freeing the
+	// entries of consumers that are gone
+	void GetStats(RING_STATS& stats);
+	void ResetStats();
+
+private:
+	// a frame whose read back is in flight
+	struct PENDING_FRAME
+	{
+		GLuint packBuffer;
+		GLsync fence;
+		FRAME_INFO info;
+		GLsizei width;
+		GLsizei height;
+		uint64_t timestampNs;
+	};
+
+	std::string m_name;
+	int m_file;
+	unsigned char* m_pMemory;
+	size_t m_bytes;
+	FRAME_RING_HEADER* m_pHeader;
+
+	// the pack buffers in the order the frames were read
+	// back, m_nPending of them from m_firstPending on
+	// hold frames not yet published
+	std::vector<PENDING_FRAME> m_pending;
+	GLuint m_firstPending;
+	GLuint m_nPending;
+	// the last size left out, so it is only reported once
+	GLsizei m_skippedWidth;
+	GLsizei m_skippedHeight;
+
+	GLuint m_nWritten;
+	GLuint m_nSkipped;
+	double m_writeMs;
+
+	// copy the oldest pending frame into its slot and
+	// publish it, waiting for its read back if asked to
+	bool PublishFrame(bool bWait);
+	// called to wake the consumers waiting for a frame
+	void WakeConsumers();
+
+	static double GetTimeMs();
+};
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedframeringformat.h
+// ============
+// layout of the shared memory frame ring the renderer writes its frames into
+// for local consumers such as the encoder and the streaming processes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+// "FRNG" at the start of the shared memory
+const uint32_t FRAME_RING_MAGIC = 0x474E5246;
+const uint32_t FRAME_RING_VERSION = 1;
+// most slots and attached consumers of one ring
+const uint32_t FRAME_RING_MAX_SLOTS = 16;
+const uint32_t FRAME_RING_MAX_CONSUMERS = 8;
+
+enum FRAME_RING_FORMAT
+{
+	// 4 bytes a pixel, the bottom row first
+	FRAME_RING_RGBA8 = 0
+};
+
+/***********************************************************
+ *  FRAME_RING_CONSUMER
+ *
+ *  The entry of an attached consumer.  A consumer claims a
+ *  free entry by swapping its pid in for zero, and stores
+ *  the index of the next frame it reads after each frame,
+ *  so the producer can report how far behind it is.  The
+ *  producer frees the entries of processes that are gone.
+ ***********************************************************/
+struct alignas(64) FRAME_RING_CONSUMER
+{
+	uint32_t pid;           // Zero when the entry is free
+	uint32_t readIndex;     // Index of the next frame the consumer reads
+};
+
+/***********************************************************
+ *  FRAME_RING_SLOT
+ *
+ *  The metadata of the frame in a slot, followed at the
+ *  slot's image offset by its pixels.  The sequence is a
+ *  seqlock: it is odd while the producer writes the slot,
+ *  and a reader that sees the same even value before and
+ *  after using the slot has seen one whole frame.
+ ***********************************************************/
+struct alignas(64) FRAME_RING_SLOT
+{
+	uint32_t sequence;
+	uint32_t frameIndex;    // Index of the frame in the ring, see writeIndex
+	uint64_t frameID;       // Frame number of the renderer
+	uint64_t timestampNs;   // CLOCK_MONOTONIC when the read back of the frame was queued
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;        // Bytes of one row of the image
+	uint32_t format;        // FRAME_RING_FORMAT
+	float view[16];         // Camera matrices the frame was drawn with, column major
+	float projection[16];
+	float cameraPosition[3];
+	float frameMs;          // Time the renderer spent on the frame
+};
+
+/***********************************************************
+ *  FRAME_RING_HEADER
+ *
+ *  The start of the shared memory, a POSIX shared memory
+ *  object named by the renderer's --frame-ring option.
+ *
+ *  The producer writes frame n into slot n % nSlots and
+ *  then stores n + 1 in writeIndex, which is also the
+ *  futex word - a consumer with nothing to read adds
+ *  itself to nWaiters and waits on it, and the producer
+ *  only wakes the futex while nWaiters is not zero.  The
+ *  producer never waits for the consumers, a consumer that
+ *  falls nSlots frames behind loses the oldest ones.
+ ***********************************************************/
+struct FRAME_RING_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nSlots;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	uint32_t imageBytes;    // Room for the image of each slot, a multiple of the page size
+	uint64_t slotsOffset;   // Offset of the FRAME_RING_SLOT array
+	uint64_t imagesOffset;  // Offset of the image of slot 0, page aligned
+	uint64_t totalBytes;
+	uint32_t producerPid;
+	uint32_t bClosed;       // Set when the producer has stopped writing
+
+	alignas(64) uint32_t writeIndex;
+	uint32_t nWaiters;
+
+	FRAME_RING_CONSUMER consumers[FRAME_RING_MAX_CONSUMERS];
+};
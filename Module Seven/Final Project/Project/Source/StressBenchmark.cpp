@@ -0,0 +1,314 @@
+///////////////////////////////////////////////////////////////////////////////
+// StressBenchmark.cpp
+// ============
+// sweeps generated stress scenes over object counts, light counts and
+// resolutions, printing the frame time, memory and draw calls of each
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StressBenchmark.h"
+#include "GLCapture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// the swept values
+	const GLuint g_ObjectCounts[] = { 1000, 10000, 100000, 1000000 };
+	const int g_LightCounts[] = { 1, 2, 4 };
+	const StressBenchmark::RESOLUTION g_Resolutions[] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+
+	// textures the copies pick from, and their random offset
+	const GLuint g_StressTextures = 16;
+	const float g_StressJitter = 0.25f;
+	const unsigned int g_StressSeed = 1234;
+
+	// each combination is measured for at least this many
+	// frames and this long, after the warm up frames
+	const int g_WarmupFrames = 2;
+	const int g_MinFrames = 5;
+	const int g_MaxFrames = 60;
+	const double g_MinSeconds = 1.0;
+}
+
+/***********************************************************
+ *  StressBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StressBenchmark::StressBenchmark(SceneManager* pSceneManager, ViewManager* pViewManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_objectCounts.assign(g_ObjectCounts, g_ObjectCounts + sizeof(g_ObjectCounts) / sizeof(g_ObjectCounts[0]));
+	m_lightCounts.assign(g_LightCounts, g_LightCounts + sizeof(g_LightCounts) / sizeof(g_LightCounts[0]));
+	m_resolutions.assign(g_Resolutions, g_Resolutions + sizeof(g_Resolutions) / sizeof(g_Resolutions[0]));
+	m_bHLOD = false;
+	m_width = 0;
+	m_height = 0;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+}
+
+/***********************************************************
+ *  ~StressBenchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StressBenchmark::~StressBenchmark()
+{
+	DestroyTarget();
+	m_pSceneManager = NULL;
+	m_pViewManager = NULL;
+}
+
+/***********************************************************
+ *  SetMaxObjects()
+ *
+ *  This method is used for leaving out the object counts
+ *  that are larger than the passed in limit.
+ ***********************************************************/
+void StressBenchmark::SetMaxObjects(GLuint maxObjects)
+{
+	m_objectCounts.erase(
+		std::remove_if(m_objectCounts.begin(), m_objectCounts.end(),
+			[maxObjects](GLuint count) { return(count > maxObjects); }),
+		m_objectCounts.end());
+}
+
+/***********************************************************
+ *  SetHLOD()
+ *
+ *  This method is used for building HLOD proxies for each
+ *  generated scene, drawn for the clusters far from the
+ *  camera.
+ ***********************************************************/
+void StressBenchmark::SetHLOD(bool bHLOD)
+{
+	m_bHLOD = bHLOD;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for measuring every combination of
+ *  object count, light count and resolution.  Each line
+ *  holds the median and the fastest frame time, the draw
+ *  calls of one frame, the memory of the scene objects and
+ *  the resident memory of the process.  With HLOD, the
+ *  clusters drawn as proxies and the time to build the
+ *  proxies are added.
+ ***********************************************************/
+bool StressBenchmark::Run(std::ostream& stream)
+{
+	char line[256];
+
+	snprintf(line, sizeof(line), "%10s %6s %11s %10s %10s %8s %8s %10s %10s %12s %8s %10s",
+		"objects", "lights", "resolution", "median ms", "min ms", "frames",
+		"draws", "scene MB", "RSS MB", "generate ms", "proxies", "hlod ms");
+	stream << "STRESS BENCHMARK\n" << line << std::endl;
+
+	// every line is measured from the same camera
+	m_pViewManager->SetCameraPose(0);
+
+	for (size_t o = 0; o < m_objectCounts.size(); o++)
+	{
+		SceneManager::STRESS_SCENE settings;
+		settings.nObjects = m_objectCounts[o];
+		settings.nTextures = g_StressTextures;
+		settings.jitter = g_StressJitter;
+		settings.seed = g_StressSeed;
+
+		auto generateStart = std::chrono::steady_clock::now();
+		m_pSceneManager->GenerateStressScene(settings);
+		std::chrono::duration<double, std::milli> generateTime = std::chrono::steady_clock::now() - generateStart;
+
+		std::chrono::duration<double, std::milli> hlodTime(0.0);
+		if (m_bHLOD == true)
+		{
+			auto hlodStart = std::chrono::steady_clock::now();
+			m_pSceneManager->BuildSceneHLOD(SceneHLOD::GetDefaultSettings());
+			hlodTime = std::chrono::steady_clock::now() - hlodStart;
+		}
+
+		for (size_t r = 0; r < m_resolutions.size(); r++)
+		{
+			if (CreateTarget(m_resolutions[r].width, m_resolutions[r].height) == false)
+			{
+				return(false);
+			}
+
+			for (size_t l = 0; l < m_lightCounts.size(); l++)
+			{
+				m_pSceneManager->SetupStressLights(m_lightCounts[l]);
+
+				for (int i = 0; i < g_WarmupFrames; i++)
+				{
+					RenderFrame();
+				}
+
+				std::vector<double> frameTimes;
+				GLuint nDrawCalls = 0;
+				double totalSeconds = 0.0;
+				while ((frameTimes.size() < (size_t)g_MaxFrames) &&
+					((frameTimes.size() < (size_t)g_MinFrames) || (totalSeconds < g_MinSeconds)))
+				{
+					auto frameStart = std::chrono::steady_clock::now();
+					nDrawCalls = RenderFrame();
+					std::chrono::duration<double> frameTime = std::chrono::steady_clock::now() - frameStart;
+
+					frameTimes.push_back(frameTime.count() * 1000.0);
+					totalSeconds += frameTime.count();
+				}
+				std::sort(frameTimes.begin(), frameTimes.end());
+
+				char resolution[32];
+				snprintf(resolution, sizeof(resolution), "%dx%d", m_width, m_height);
+				snprintf(line, sizeof(line), "%10zu %6d %11s %10.3f %10.3f %8zu %8u %10.1f %10.1f %12.1f %8u %10.1f",
+					m_pSceneManager->GetSceneObjectCount(),
+					m_lightCounts[l],
+					resolution,
+					frameTimes[frameTimes.size() / 2],
+					frameTimes[0],
+					frameTimes.size(),
+					nDrawCalls,
+					m_pSceneManager->GetSceneObjectBytes() / (1024.0 * 1024.0),
+					GetResidentBytes() / (1024.0 * 1024.0),
+					generateTime.count(),
+					m_pSceneManager->GetHLODProxyCount(),
+					hlodTime.count());
+				stream << line << std::endl;
+			}
+		}
+	}
+
+	DestroyTarget();
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used for drawing the stress scene into
+ *  the offscreen target and waiting for the GPU to finish
+ *  it.  Returns the GL draw calls of the frame.
+ ***********************************************************/
+GLuint StressBenchmark::RenderFrame()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_pViewManager->PrepareSceneView();
+	m_pSceneManager->SetCullingView(
+		m_pViewManager->GetViewMatrix(),
+		m_pViewManager->GetProjectionMatrix(),
+		m_pViewManager->GetCameraPosition());
+
+	m_pSceneManager->ResetDrawCallCount();
+	m_pSceneManager->RenderSceneObjects();
+
+	glFinish();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return(m_pSceneManager->GetDrawCallCount());
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating the offscreen color
+ *  and depth target of the passed in size.
+ ***********************************************************/
+bool StressBenchmark::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+
+	m_width = width;
+	m_height = height;
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "StressBenchmark: " << width << "x" << height << " target is not complete, status " << status << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void StressBenchmark::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  GetResidentBytes()
+ *
+ *  This method is used for reading the resident memory of
+ *  the process, which includes the driver's copies of the
+ *  GL objects on integrated and software renderers.
+ ***********************************************************/
+size_t StressBenchmark::GetResidentBytes()
+{
+#ifdef __linux__
+	FILE* pFile = fopen("/proc/self/statm", "r");
+	if (NULL == pFile)
+	{
+		return(0);
+	}
+
+	unsigned long totalPages = 0;
+	unsigned long residentPages = 0;
+	int nRead = fscanf(pFile, "%lu %lu", &totalPages, &residentPages);
+	fclose(pFile);
+
+	return((nRead == 2) ? (size_t)residentPages * (size_t)sysconf(_SC_PAGESIZE) : 0);
+#else
+	return(0);
+#endif
+}
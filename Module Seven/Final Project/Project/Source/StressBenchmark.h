@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// stressbenchmark.h
+// ============
+// sweeps generated stress scenes over object counts, light counts and
+// resolutions, printing the frame time, memory and draw calls of each
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <GL/glew.h>
+
+#include <ostream>
+#include <vector>
+
+/***********************************************************
+ *  StressBenchmark
+ *
+ *  This class contains the scaling benchmark.  For each
+ *  object count a stress scene is generated from copies
+ *  of the scene, then it is drawn with each light count
+ *  into an offscreen target of each resolution.  Every
+ *  frame ends with glFinish(), so the frame times include
+ *  the GPU work.  With HLOD the far clusters of each scene
+ *  are drawn as proxies, which keeps the draw calls about
+ *  the same as the scene grows.
+ ***********************************************************/
+class StressBenchmark
+{
+public:
+	struct RESOLUTION
+	{
+		int width;
+		int height;
+	};
+
+	// constructor
+	StressBenchmark(SceneManager* pSceneManager, ViewManager* pViewManager);
+	// destructor
+	~StressBenchmark();
+
+	// leave out the object counts above the passed in limit
+	void SetMaxObjects(GLuint maxObjects);
+	// draw the far clusters of each scene as HLOD proxies
+	void SetHLOD(bool bHLOD);
+
+	// run every combination, printing one line for each
+	bool Run(std::ostream& stream);
+
+private:
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+
+	// the swept values
+	std::vector<GLuint> m_objectCounts;
+	std::vector<int> m_lightCounts;
+	std::vector<RESOLUTION> m_resolutions;
+	// build HLOD proxies for each generated scene
+	bool m_bHLOD;
+
+	// offscreen target with the size being measured
+	int m_width;
+	int m_height;
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// create the offscreen target, replacing the last one
+	bool CreateTarget(int width, int height);
+	// free the offscreen target
+	void DestroyTarget();
+	// draw one frame into the target, returning its draw calls
+	GLuint RenderFrame();
+	// bytes of memory the process has resident, zero when
+	// the platform does not report it
+	static size_t GetResidentBytes();
+};
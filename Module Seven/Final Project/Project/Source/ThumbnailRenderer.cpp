@@ -0,0 +1,605 @@
+///////////////////////////////////////////////////////////////////////////////
+// ThumbnailRenderer.cpp
+// ============
+// draws thumbnails of scene variants on worker threads, each with a hidden
+// context of its own sharing the meshes and textures
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThumbnailRenderer.h"
+#include "ShapeMeshes.h"
+#include "GLCapture.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+	// floats of each vertex in the shared buffers - position,
+	// normal and texture coordinates
+	const GLuint g_VertexFloats = ShapeMeshes::FLOATS_PER_VERTEX;
+
+	const float g_NearPlane = 0.1f;
+	const float g_FarPlane = 100.0f;
+
+	const char* const g_ModelName = "model";
+	const char* const g_ViewProjectionName = "viewProjection";
+	const char* const g_UVScaleName = "UVscale";
+	const char* const g_ColorName = "objectColor";
+	const char* const g_UseTextureName = "bUseTexture";
+	const char* const g_TextureName = "objectTexture";
+}
+
+/***********************************************************
+ *  ThumbnailRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThumbnailRenderer::ThumbnailRenderer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_ambientColor = glm::vec3(0.0f);
+	m_indexRange = 0;
+	m_indexBuffer = 0;
+	m_indexOffset = 0;
+	m_stats.nThumbnails = 0;
+	m_stats.nWorkers = 0;
+	m_stats.seconds = 0.0;
+	m_stats.thumbnailsPerSecond = 0.0;
+}
+
+/***********************************************************
+ *  ~ThumbnailRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating a hidden window for
+ *  each worker.  Its context shares the objects of the
+ *  passed in window, which stays current on this thread.
+ ***********************************************************/
+bool ThumbnailRenderer::Create(GLFWwindow* pShareWindow, const THUMBNAIL_SETTINGS& settings)
+{
+	Destroy();
+
+	m_width = std::max(1, (int)settings.width);
+	m_height = std::max(1, (int)settings.height);
+
+	GLuint nWorkers = settings.nWorkers;
+	if (nWorkers == 0)
+	{
+		nWorkers = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// the worker contexts draw into framebuffers of their
+	// own, the windows are never shown
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	for (GLuint i = 0; i < nWorkers; i++)
+	{
+		GLFWwindow* pWindow = glfwCreateWindow(1, 1, "Thumbnail worker", NULL, pShareWindow);
+		if (NULL == pWindow)
+		{
+			std::cout << "ThumbnailRenderer: could not create the context of worker " << i << std::endl;
+			break;
+		}
+		m_windows.push_back(pWindow);
+	}
+	glfwMakeContextCurrent(pShareWindow);
+
+	return(m_windows.empty() == false);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the scene indices and
+ *  the windows of the workers.
+ ***********************************************************/
+void ThumbnailRenderer::Destroy()
+{
+	ClearScene();
+
+	for (size_t i = 0; i < m_windows.size(); i++)
+	{
+		glfwDestroyWindow(m_windows[i]);
+	}
+	m_windows.clear();
+}
+
+/***********************************************************
+ *  SetAmbientColor()
+ *
+ *  This method is used for setting the light that reaches
+ *  every surface.
+ ***********************************************************/
+void ThumbnailRenderer::SetAmbientColor(const glm::vec3& ambientColor)
+{
+	m_ambientColor = ambientColor;
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light, the lights past
+ *  MAX_LIGHTS are left out.
+ ***********************************************************/
+void ThumbnailRenderer::AddLight(const RENDER_LIGHT& light)
+{
+	if (m_lights.size() < MAX_LIGHTS)
+	{
+		m_lights.push_back(light);
+	}
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for adding a triangle list over the
+ *  vertices of a loaded mesh, returning its handle for
+ *  AddObject().  The vertices stay in the range of the
+ *  shared vertex buffers the mesh was loaded into, the
+ *  triangles index them from the start of the range.
+ ***********************************************************/
+GLuint ThumbnailRenderer::AddMesh(
+	GLuint vertexRange,
+	const std::vector<GLuint>& triangles)
+{
+	MESH mesh;
+	mesh.vertexRange = vertexRange;
+	mesh.firstIndex = (GLuint)m_indices.size();
+	mesh.nIndices = (GLuint)triangles.size();
+	mesh.vertexBuffer = 0;
+	mesh.vertexOffset = 0;
+	m_indices.insert(m_indices.end(), triangles.begin(), triangles.end());
+
+	m_meshes.push_back(mesh);
+	return((GLuint)(m_meshes.size() - 1));
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding a drawn object.  With a
+ *  texture the object shows the texture, scaled by the
+ *  passed in UV scale, otherwise its color.  Either is
+ *  tinted by the variant.
+ ***********************************************************/
+void ThumbnailRenderer::AddObject(
+	GLuint mesh,
+	const glm::mat4& model,
+	const glm::vec4& color,
+	GLuint texture,
+	const glm::vec2& uvScale)
+{
+	if (mesh >= m_meshes.size())
+	{
+		return;
+	}
+
+	OBJECT object;
+	object.mesh = mesh;
+	object.model = model;
+	object.color = color;
+	object.texture = texture;
+	object.uvScale = uvScale;
+	m_objects.push_back(object);
+}
+
+/***********************************************************
+ *  UploadScene()
+ *
+ *  This method is used for sending the triangles of the
+ *  meshes to a range of the shared index buffers, in the
+ *  current context.  The vertices are already there.
+ ***********************************************************/
+bool ThumbnailRenderer::UploadScene()
+{
+	if ((m_meshes.empty() == true) || (m_indices.empty() == true))
+	{
+		std::cout << "ThumbnailRenderer: the scene has no meshes" << std::endl;
+		return(false);
+	}
+
+	GPUBufferAllocator& indexBuffers = ShapeMeshes::GetIndexBuffers();
+	if (m_indexRange != 0)
+	{
+		indexBuffers.Free(m_indexRange);
+	}
+	m_indexRange = indexBuffers.Allocate((GLsizeiptr)(m_indices.size() * sizeof(GLuint)), m_indices.data());
+	if ((m_indexRange == 0) || (glGetError() == GL_OUT_OF_MEMORY))
+	{
+		std::cout << "ThumbnailRenderer: out of memory for the scene indices" << std::endl;
+		return(false);
+	}
+
+	// the CPU copy is only needed until the upload
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+
+	return(true);
+}
+
+/***********************************************************
+ *  ClearScene()
+ *
+ *  This method is used for dropping the scene and giving
+ *  its range of the shared index buffers back.
+ ***********************************************************/
+void ThumbnailRenderer::ClearScene()
+{
+	if (m_indexRange != 0)
+	{
+		ShapeMeshes::GetIndexBuffers().Free(m_indexRange);
+		m_indexRange = 0;
+	}
+	m_indexBuffer = 0;
+	m_indexOffset = 0;
+
+	m_indices.clear();
+	m_meshes.clear();
+	m_objects.clear();
+	m_lights.clear();
+	m_ambientColor = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  LocateMeshes()
+ *
+ *  This method is used for reading the place of the scene
+ *  indices and of each mesh's vertices in the shared
+ *  buffers.  Compaction may have moved them since the last
+ *  batch, and does not run during one, so the workers use
+ *  what is read here.  False when a mesh is gone.
+ ***********************************************************/
+bool ThumbnailRenderer::LocateMeshes()
+{
+	GPUBufferAllocator& vertexBuffers = ShapeMeshes::GetVertexBuffers();
+	GPUBufferAllocator& indexBuffers = ShapeMeshes::GetIndexBuffers();
+
+	m_indexBuffer = indexBuffers.GetBuffer(m_indexRange);
+	m_indexOffset = indexBuffers.GetOffset(m_indexRange);
+	if (m_indexBuffer == 0)
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		MESH& mesh = m_meshes[i];
+		mesh.vertexBuffer = vertexBuffers.GetBuffer(mesh.vertexRange);
+		mesh.vertexOffset = vertexBuffers.GetOffset(mesh.vertexRange);
+		if (mesh.vertexBuffer == 0)
+		{
+			std::cout << "ThumbnailRenderer: mesh " << i << " is no longer loaded" << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for drawing a thumbnail of each
+ *  variant.  The meshes are located and the shared buffers
+ *  finished before the workers start, since the other
+ *  contexts only see commands of this one that have
+ *  completed.  Each worker then takes the next variant
+ *  until none are left.
+ ***********************************************************/
+bool ThumbnailRenderer::Render(
+	const std::vector<THUMBNAIL_VARIANT>& variants,
+	THUMBNAIL_FUNCTION onThumbnail,
+	GLuint nWorkers)
+{
+	if ((m_windows.empty() == true) || (m_indexRange == 0) || (LocateMeshes() == false))
+	{
+		return(false);
+	}
+
+	glFinish();
+
+	if ((nWorkers == 0) || (nWorkers > m_windows.size()))
+	{
+		nWorkers = (GLuint)m_windows.size();
+	}
+	nWorkers = (GLuint)std::min((size_t)nWorkers, std::max((size_t)1, variants.size()));
+
+	double startMs = GetTimeMs();
+
+	std::atomic<size_t> nextVariant(0);
+	std::atomic<bool> bFailed(false);
+	std::vector<std::thread> workers;
+	for (GLuint t = 0; t < nWorkers; t++)
+	{
+		GLFWwindow* pWindow = m_windows[t];
+		workers.push_back(std::thread([&, pWindow]()
+		{
+			if (RunWorker(pWindow, variants, nextVariant, onThumbnail) == false)
+			{
+				bFailed = true;
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	m_stats.nThumbnails = (GLuint)variants.size();
+	m_stats.nWorkers = nWorkers;
+	m_stats.seconds = (GetTimeMs() - startMs) / 1000.0;
+	m_stats.thumbnailsPerSecond = (m_stats.seconds > 0.0) ? variants.size() / m_stats.seconds : 0.0;
+
+	// a worker whose context failed left its variants to the
+	// others, so the batch only fails when no worker ran
+	return((bFailed == false) || (nextVariant >= variants.size()));
+}
+
+/***********************************************************
+ *  RunWorker()
+ *
+ *  This method is used for drawing variants on a worker
+ *  thread, in the context of its window, until none are
+ *  left.  The context is released again at the end, so
+ *  the next batch can make it current on another thread.
+ ***********************************************************/
+bool ThumbnailRenderer::RunWorker(
+	GLFWwindow* pWindow,
+	const std::vector<THUMBNAIL_VARIANT>& variants,
+	std::atomic<size_t>& nextVariant,
+	THUMBNAIL_FUNCTION& onThumbnail)
+{
+	glfwMakeContextCurrent(pWindow);
+
+	WORKER_CONTEXT context;
+	if (CreateContext(context) == false)
+	{
+		DestroyContext(context);
+		glfwMakeContextCurrent(NULL);
+		return(false);
+	}
+
+	std::vector<unsigned char> pixels((size_t)m_width * m_height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	size_t variant = nextVariant.fetch_add(1);
+	while (variant < variants.size())
+	{
+		DrawVariant(context, variants[variant]);
+		glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+		onThumbnail(variant, pixels.data());
+
+		variant = nextVariant.fetch_add(1);
+	}
+
+	DestroyContext(context);
+	glfwMakeContextCurrent(NULL);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateContext()
+ *
+ *  This method is used for creating the objects a context
+ *  cannot share - the program, a vertex array over each
+ *  mesh's range of the shared buffers and the framebuffer
+ *  - in the current worker context.  The lights are the
+ *  same for every thumbnail, so they are set here once.
+ ***********************************************************/
+bool ThumbnailRenderer::CreateContext(WORKER_CONTEXT& context)
+{
+	context.framebuffer = 0;
+	context.colorBuffer = 0;
+	context.depthBuffer = 0;
+
+	context.pShader = new ShaderManager();
+	context.pShader->LoadShaders(
+		"../../Utilities/shaders/thumbnailVertexShader.glsl",
+		"../../Utilities/shaders/thumbnailFragmentShader.glsl");
+	context.pShader->use();
+
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	if (program == 0)
+	{
+		std::cout << "ThumbnailRenderer: the thumbnail shaders could not be loaded" << std::endl;
+		return(false);
+	}
+	context.modelLocation = glGetUniformLocation(program, g_ModelName);
+	context.viewProjectionLocation = glGetUniformLocation(program, g_ViewProjectionName);
+	context.uvScaleLocation = glGetUniformLocation(program, g_UVScaleName);
+	context.colorLocation = glGetUniformLocation(program, g_ColorName);
+	context.useTextureLocation = glGetUniformLocation(program, g_UseTextureName);
+
+	context.pShader->setIntValue(g_TextureName, 0);
+	context.pShader->setVec3Value("ambientColor", m_ambientColor);
+	context.pShader->setIntValue("lightCount", (int)m_lights.size());
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		std::string index = "[" + std::to_string(i) + "]";
+		context.pShader->setVec3Value("lightPositions" + index, m_lights[i].position);
+		context.pShader->setVec3Value("lightColors" + index, m_lights[i].diffuseColor);
+	}
+
+	// the ranges only keep the 16 byte alignment of the
+	// allocator, so the attributes start at each mesh's
+	// offset rather than at a base vertex
+	GLsizei stride = g_VertexFloats * sizeof(float);
+	context.vaos.resize(m_meshes.size(), 0);
+	glGenVertexArrays((GLsizei)context.vaos.size(), context.vaos.data());
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		const MESH& mesh = m_meshes[i];
+		glBindVertexArray(context.vaos[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)mesh.vertexOffset);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(mesh.vertexOffset + 3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(mesh.vertexOffset + 6 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenRenderbuffers(1, &context.colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, context.colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+	glGenRenderbuffers(1, &context.depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, context.depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &context.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, context.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, context.colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, context.depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ThumbnailRenderer: " << m_width << "x" << m_height << " target is not complete, status " << status << std::endl;
+		return(false);
+	}
+
+	// the drawing state of the main window, set again since
+	// each context has its own
+	glViewport(0, 0, m_width, m_height);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyContext()
+ *
+ *  This method is used for freeing the objects of the
+ *  current worker context.
+ ***********************************************************/
+void ThumbnailRenderer::DestroyContext(WORKER_CONTEXT& context)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	if (context.framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &context.framebuffer);
+		context.framebuffer = 0;
+	}
+	if (context.colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &context.colorBuffer);
+		context.colorBuffer = 0;
+	}
+	if (context.depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &context.depthBuffer);
+		context.depthBuffer = 0;
+	}
+	if (context.vaos.empty() == false)
+	{
+		glDeleteVertexArrays((GLsizei)context.vaos.size(), context.vaos.data());
+		context.vaos.clear();
+	}
+	if (NULL != context.pShader)
+	{
+		delete context.pShader;
+		context.pShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  DrawVariant()
+ *
+ *  This method is used for drawing one variant of the
+ *  scene, turned on the turntable and seen from its camera.
+ *  The vertex array and texture are only bound again when
+ *  they change.
+ ***********************************************************/
+void ThumbnailRenderer::DrawVariant(const WORKER_CONTEXT& context, const THUMBNAIL_VARIANT& variant)
+{
+	glClearColor(variant.backgroundColor.r, variant.backgroundColor.g, variant.backgroundColor.b, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glm::mat4 view = glm::lookAt(variant.cameraPosition, variant.cameraTarget, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(
+		glm::radians(variant.fieldOfView), (float)m_width / (float)m_height, g_NearPlane, g_FarPlane);
+	glm::mat4 viewProjection = projection * view;
+	glUniformMatrix4fv(context.viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+	glm::mat4 turntable = glm::rotate(glm::radians(variant.turntableDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::vec4 tint(variant.tint, 1.0f);
+
+	GLuint boundTexture = 0;
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GLuint boundMesh = (GLuint)m_meshes.size();
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		const OBJECT& object = m_objects[i];
+		const MESH& mesh = m_meshes[object.mesh];
+
+		glm::mat4 model = turntable * object.model;
+		glUniformMatrix4fv(context.modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+		glUniform2f(context.uvScaleLocation, object.uvScale.x, object.uvScale.y);
+
+		// the color multiplies the texture, so a textured
+		// object gets the tint alone
+		if (object.texture != 0)
+		{
+			glUniform1i(context.useTextureLocation, 1);
+			glUniform4fv(context.colorLocation, 1, glm::value_ptr(tint));
+			if (object.texture != boundTexture)
+			{
+				glBindTexture(GL_TEXTURE_2D, object.texture);
+				boundTexture = object.texture;
+			}
+		}
+		else
+		{
+			glm::vec4 color = object.color * tint;
+			glUniform1i(context.useTextureLocation, 0);
+			glUniform4fv(context.colorLocation, 1, glm::value_ptr(color));
+		}
+
+		if (object.mesh != boundMesh)
+		{
+			glBindVertexArray(context.vaos[object.mesh]);
+			boundMesh = object.mesh;
+		}
+		glDrawElements(
+			GL_TRIANGLES,
+			mesh.nIndices,
+			GL_UNSIGNED_INT,
+			(void*)(m_indexOffset + (GLintptr)mesh.firstIndex * sizeof(GLuint)));
+	}
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This method is used for reading the wall clock.
+ ***********************************************************/
+double ThumbnailRenderer::GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+// thumbnailrenderer.h
+// ============
+// draws thumbnails of scene variants on worker threads, each with a hidden
+// context of its own sharing the meshes and textures
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  ThumbnailRenderer
+ *
+ *  This class contains the batch thumbnail renderer.  A
+ *  hidden window is created for each worker, with a
+ *  context sharing the objects of the main window, so the
+ *  scene textures and the shared mesh buffers of
+ *  ShapeMeshes are seen by every worker.  The vertices are
+ *  drawn where the shapes were loaded, only the triangle
+ *  lists of the drawn parts are added to the shared index
+ *  buffers.  Nothing is changed while the workers run, so
+ *  they need no locking.
+ *
+ *  What a context cannot share is created by each worker
+ *  in its own context: the program, whose uniforms would
+ *  otherwise be set by every worker at once, a vertex
+ *  array over each mesh and the framebuffer.  The workers
+ *  then take the next variant until none are left, so the
+ *  thumbnails are spread over the threads without any
+ *  other sync.
+ ***********************************************************/
+class ThumbnailRenderer
+{
+public:
+	// size of the light arrays in the shader
+	static const GLuint MAX_LIGHTS = 4;
+
+	struct THUMBNAIL_SETTINGS
+	{
+		GLsizei width;
+		GLsizei height;
+		GLuint nWorkers;          // Threads with a context each, zero uses every core
+	};
+
+	struct RENDER_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 diffuseColor;
+	};
+
+	// one variant of the scene, a thumbnail is drawn of each
+	struct THUMBNAIL_VARIANT
+	{
+		glm::vec3 cameraPosition;
+		glm::vec3 cameraTarget;
+		float fieldOfView;        // Vertical, in degrees
+		float turntableDegrees;   // Turn of the scene around the up axis
+		glm::vec3 tint;           // Multiplies the colors and textures of the objects
+		glm::vec3 backgroundColor;
+	};
+
+	// figures of the last batch
+	struct BATCH_STATS
+	{
+		GLuint nThumbnails;
+		GLuint nWorkers;
+		double seconds;           // Including the setup of the worker contexts
+		double thumbnailsPerSecond;
+	};
+
+	// called on a worker thread with each finished thumbnail,
+	// RGB with the bottom row first, only valid during the call
+	typedef std::function<void(size_t variant, const unsigned char* pPixels)> THUMBNAIL_FUNCTION;
+
+	// constructor
+	ThumbnailRenderer();
+	// destructor
+	~ThumbnailRenderer();
+
+	// create the hidden window of each worker, sharing the
+	// objects of the passed in window - on the main thread,
+	// where GLFW creates its windows
+	bool Create(GLFWwindow* pShareWindow, const THUMBNAIL_SETTINGS& settings);
+	// free the scene indices and the worker windows
+	void Destroy();
+	GLuint GetWorkerCount() const { return((GLuint)m_windows.size()); }
+	GLsizei GetWidth() const { return(m_width); }
+	GLsizei GetHeight() const { return(m_height); }
+
+	// methods for adding the scene, which is uploaded at once
+	// by UploadScene() - the meshes are ranges of loaded
+	// vertices in ShapeMeshes::GetVertexBuffers(), and the
+	// textures the GL names of textures already loaded,
+	// zero for none
+	void SetAmbientColor(const glm::vec3& ambientColor);
+	void AddLight(const RENDER_LIGHT& light);
+	GLuint AddMesh(
+		GLuint vertexRange,
+		const std::vector<GLuint>& triangles);
+	void AddObject(
+		GLuint mesh,
+		const glm::mat4& model,
+		const glm::vec4& color,
+		GLuint texture,
+		const glm::vec2& uvScale);
+	bool UploadScene();
+	void ClearScene();
+
+	// draw a thumbnail of each variant on up to the passed
+	// in number of workers, zero uses them all, returning
+	// once every thumbnail has been handed to the function
+	bool Render(
+		const std::vector<THUMBNAIL_VARIANT>& variants,
+		THUMBNAIL_FUNCTION onThumbnail,
+		GLuint nWorkers = 0);
+
+	const BATCH_STATS& GetStats() const { return(m_stats); }
+
+private:
+	struct MESH
+	{
+		GLuint vertexRange;       // Owned by the ShapeMeshes that loaded the mesh
+		GLuint firstIndex;
+		GLuint nIndices;
+		// place of the vertices during a batch, read again
+		// before each one since compaction moves them
+		GLuint vertexBuffer;
+		GLintptr vertexOffset;
+	};
+
+	struct OBJECT
+	{
+		GLuint mesh;
+		glm::mat4 model;
+		glm::vec4 color;
+		GLuint texture;
+		glm::vec2 uvScale;
+	};
+
+	// the objects a worker creates in its own context
+	struct WORKER_CONTEXT
+	{
+		ShaderManager* pShader;
+		std::vector<GLuint> vaos; // One over the vertices of each mesh
+		GLuint framebuffer;
+		GLuint colorBuffer;
+		GLuint depthBuffer;
+		GLint modelLocation;
+		GLint viewProjectionLocation;
+		GLint uvScaleLocation;
+		GLint colorLocation;
+		GLint useTextureLocation;
+	};
+
+	// called on a worker thread to draw variants until none
+	// are left, false when its context cannot be set up
+	bool RunWorker(
+		GLFWwindow* pWindow,
+		const std::vector<THUMBNAIL_VARIANT>& variants,
+		std::atomic<size_t>& nextVariant,
+		THUMBNAIL_FUNCTION& onThumbnail);
+	// called on the main thread to read the place of the
+	// meshes in the shared buffers before a batch
+	bool LocateMeshes();
+	// called to create and free the objects of the current
+	// worker context
+	bool CreateContext(WORKER_CONTEXT& context);
+	void DestroyContext(WORKER_CONTEXT& context);
+	// called to draw one variant into the worker framebuffer
+	void DrawVariant(const WORKER_CONTEXT& context, const THUMBNAIL_VARIANT& variant);
+
+	static double GetTimeMs();
+
+	GLsizei m_width;
+	GLsizei m_height;
+	// hidden window of each worker, the owner of its context
+	std::vector<GLFWwindow*> m_windows;
+
+	// triangles on the CPU until uploaded
+	std::vector<GLuint> m_indices;
+	std::vector<MESH> m_meshes;
+	std::vector<OBJECT> m_objects;
+	std::vector<RENDER_LIGHT> m_lights;
+	glm::vec3 m_ambientColor;
+
+	// range of the triangles in the shared index buffers,
+	// and its place during a batch
+	GLuint m_indexRange;
+	GLuint m_indexBuffer;
+	GLintptr m_indexOffset;
+
+	BATCH_STATS m_stats;
+};
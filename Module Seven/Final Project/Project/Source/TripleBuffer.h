@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// lock-free hand off of the latest value from one writer thread to one
+// reader thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class contains three copies of a value.  The writer
+ *  owns one, the reader owns another, and the third sits in
+ *  the middle holding the latest published value.  Both
+ *  sides swap their copy with the middle one through a
+ *  single atomic exchange, so neither ever waits for the
+ *  other and the reader always gets the newest value.
+ *  Values published faster than they are read replace each
+ *  other unread.
+ *
+ *  Exactly one thread may write and one thread may read.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middle.store(1, std::memory_order_relaxed);
+		m_readIndex = 2;
+	}
+
+	// the writer's copy, filled before Publish()
+	T& GetWriteValue() { return(m_values[m_writeIndex]); }
+
+	// make the writer's copy the latest value and take the
+	// old middle copy to write next
+	void Publish()
+	{
+		unsigned int previous = m_middle.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// true when the value published last has been taken by
+	// the reader, or nothing has been published yet
+	bool IsPublishedRead() const
+	{
+		return((m_middle.load(std::memory_order_acquire) & FRESH_BIT) == 0);
+	}
+
+	// take the latest value when one was published since the
+	// last call, returns false when the reader's copy is
+	// already the newest
+	bool Update()
+	{
+		if ((m_middle.load(std::memory_order_acquire) & FRESH_BIT) == 0)
+		{
+			return(false);
+		}
+
+		unsigned int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+		return(true);
+	}
+
+	// the reader's copy, the latest value after Update()
+	const T& GetReadValue() const { return(m_values[m_readIndex]); }
+
+private:
+	// the middle index keeps a bit set while its value has
+	// not been read
+	static const unsigned int INDEX_MASK = 3;
+	static const unsigned int FRESH_BIT = 4;
+
+	T m_values[3];
+	// each side's index is only touched by its own thread,
+	// the middle one is on a cache line of its own
+	unsigned int m_writeIndex;
+	alignas(64) std::atomic<unsigned int> m_middle;
+	alignas(64) unsigned int m_readIndex;
+};
@@ -8,6 +8,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "GLCapture.h"
+
+#include <cstdint>
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
@@ -40,6 +43,40 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// time of the first mouse event not yet drawn, negative
+	// when every event has been drawn
+	double gPendingEventTime = -1.0;
+
+	// while the input goes through snapshots the callbacks
+	// only record the mouse here, on the event thread
+	bool gbSnapshotInput = false;
+	double gCursorX = 0.0;
+	double gCursorY = 0.0;
+	bool gbCursorMoved = false;
+	double gScrollY = 0.0;
+	uint64_t gMouseEvents = 0;
+
+	// keys copied into the input snapshots
+	const int g_SnapshotKeys[] = {
+		GLFW_KEY_ESCAPE, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D,
+		GLFW_KEY_Q, GLFW_KEY_E, GLFW_KEY_O, GLFW_KEY_P, GLFW_KEY_F12 };
+	const int g_SnapshotKeyCount = sizeof(g_SnapshotKeys) / sizeof(g_SnapshotKeys[0]);
+
+	// standard camera poses for repeatable captures
+	struct CAMERA_POSE
+	{
+		const char* name;
+		glm::vec3 position;
+		glm::vec3 front;
+		float zoom;
+		bool bOrthographic;
+	};
+	const CAMERA_POSE g_CameraPoses[] = {
+		{ "default", glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, -0.5f, -2.0f), 80.0f, false },
+		{ "front_ortho", glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), 80.0f, true },
+		{ "overhead", glm::vec3(0.0f, 14.0f, -1.0f), glm::vec3(0.0f, -1.0f, -0.3f), 80.0f, false },
+		{ "low_side", glm::vec3(-11.0f, 2.0f, 4.0f), glm::vec3(1.0f, -0.15f, -0.8f), 60.0f, false } };
 }
 
 /***********************************************************
@@ -53,6 +90,17 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewWidth = 0;
+	m_viewHeight = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bCameraBlock = false;
+	m_drawnEventTime = -1.0;
+	ResetInputLatency();
+	m_bSnapshotInput = false;
+	m_snapshotKeys = 0;
+	m_appliedScrollY = 0.0;
+	m_appliedMouseEvents = 0;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -69,6 +117,7 @@ ViewManager::ViewManager(
 ViewManager::~ViewManager()
 {
 	// free up allocated memory
+	m_cameraBuffer.Destroy();
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
 	if (NULL != g_pCamera)
@@ -126,6 +175,32 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  *  the mouse is moved within the active GLFW display window.
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
+{
+	if (gPendingEventTime < 0.0)
+	{
+		gPendingEventTime = glfwGetTime();
+	}
+
+	// the render thread moves the camera from the snapshots
+	if (gbSnapshotInput == true)
+	{
+		gCursorX = xMousePos;
+		gCursorY = yMousePos;
+		gbCursorMoved = true;
+		gMouseEvents++;
+		return;
+	}
+
+	MoveCameraByCursor(xMousePos, yMousePos);
+}
+
+/***********************************************************
+ *  MoveCameraByCursor()
+ *
+ *  This method is used for turning the camera by the move
+ *  of the mouse cursor to the passed in position.
+ ***********************************************************/
+void ViewManager::MoveCameraByCursor(double xMousePos, double yMousePos)
 {
 	/* when the first mouse move event is received, this needs to be recorded so that
 	 * all subsequent mouse moves can correctly calculate the X position offset and Y
@@ -152,6 +227,18 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 // When mouse scroll is moved, the speed of movement is adjusted
 void ViewManager::MouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
+	if (gPendingEventTime < 0.0)
+	{
+		gPendingEventTime = glfwGetTime();
+	}
+
+	if (gbSnapshotInput == true)
+	{
+		gScrollY += yoffset;
+		gMouseEvents++;
+		return;
+	}
+
 	g_pCamera->ProcessMouseScroll(-yoffset);
 }
 
@@ -164,7 +251,7 @@ void ViewManager::MouseScrollCallback(GLFWwindow* window, double xoffset, double
 void ViewManager::ProcessKeyboardEvents()
 {
 	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_ESCAPE) == true)
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
@@ -176,37 +263,37 @@ void ViewManager::ProcessKeyboardEvents()
 	}
 
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_W) == true)
 	{
 		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_S) == true)
 	{
 		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_A) == true)
 	{
 		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_D) == true)
 	{
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
 	}
 
 	// process camera panning up and down
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_Q) == true)
 	{
 		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_E) == true)
 	{
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
 	}
 	
 	// change the view to orthographic
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_O) == true)
 	{
 		// change projection bool value
 		bOrthographicProjection = true;
@@ -218,7 +305,7 @@ void ViewManager::ProcessKeyboardEvents()
 	}
 
 	// change the view back to perspective
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_P) == true)
 	{
 		// change projection bool value
 		bOrthographicProjection = false;
@@ -241,6 +328,77 @@ void ViewManager::ProcessKeyboardEvents()
  *  rendering
  ***********************************************************/
 void ViewManager::PrepareSceneView()
+{
+	// the camera buffer is created with the first frame,
+	// once the GL entry points have been loaded
+	if (m_cameraBuffer.IsCreated() == false)
+	{
+		m_cameraBuffer.Create();
+	}
+	m_cameraBuffer.BeginFrame();
+
+	UpdateCameraMatrices();
+	CameraUniformBuffer::CAMERA_BLOCK block;
+	FillCameraBlock(block);
+	m_cameraBuffer.Write(block);
+	// the copy into the camera block is queued before any
+	// draw of the frame
+	m_cameraBuffer.UploadFrame();
+
+	// if the shader manager object is valid
+	if (NULL != m_pShaderManager)
+	{
+		// set the view matrix into the shader for proper rendering
+		m_pShaderManager->setMat4Value(g_ViewName, m_viewMatrix);
+		// set the view matrix into the shader for proper rendering
+		m_pShaderManager->setMat4Value(g_ProjectionName, m_projectionMatrix);
+		// set the view position of the camera into the shader for proper rendering
+		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+	}
+
+	// shaders with the camera block read the buffer instead
+	// of the uniforms
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	m_bCameraBlock = CameraUniformBuffer::BindProgram((GLuint)program);
+}
+
+/***********************************************************
+ *  LatchSceneView()
+ *
+ *  This method is used for moving the camera by the input
+ *  that arrived while the frame's CPU work was done, right
+ *  before its draws are recorded.  The new camera is
+ *  copied over the camera block of the frame after the
+ *  copy queued by PrepareSceneView(), so every draw of the
+ *  frame sees the latched camera.  The culling and the
+ *  uniforms of the frame keep the camera of
+ *  PrepareSceneView().
+ ***********************************************************/
+bool ViewManager::LatchSceneView()
+{
+	if (IsLateLatchAvailable() == false)
+	{
+		return(false);
+	}
+
+	UpdateCameraMatrices();
+	CameraUniformBuffer::CAMERA_BLOCK block;
+	FillCameraBlock(block);
+
+	return(m_cameraBuffer.Latch(block));
+}
+
+/***********************************************************
+ *  UpdateCameraMatrices()
+ *
+ *  This method is used for moving the camera by the waiting
+ *  keyboard input and calculating the view and projection
+ *  matrices.  The mouse moves the camera from its callbacks,
+ *  the first mouse event not yet drawn is taken by the
+ *  frame.
+ ***********************************************************/
+void ViewManager::UpdateCameraMatrices()
 {
 	glm::mat4 view;
 	glm::mat4 projection;
@@ -254,21 +412,36 @@ void ViewManager::PrepareSceneView()
 	// event queue
 	ProcessKeyboardEvents();
 
+	// the snapshots carry their own event times
+	if (m_bSnapshotInput == false)
+	{
+		if ((gPendingEventTime >= 0.0) && (m_drawnEventTime < 0.0))
+		{
+			m_drawnEventTime = gPendingEventTime;
+		}
+		gPendingEventTime = -1.0;
+	}
+
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix(); 
 
+	// the projection is made for the window unless another
+	// size has been set
+	int viewWidth = (m_viewWidth > 0) ? m_viewWidth : WINDOW_WIDTH;
+	int viewHeight = (m_viewHeight > 0) ? m_viewHeight : WINDOW_HEIGHT;
+
 	// define the current projection matrix
 	if (bOrthographicProjection == true) {
 		// front-view orthographic projection with correct aspect ratio
 		double scale = 0.0;
-		if (WINDOW_WIDTH > WINDOW_HEIGHT)
+		if (viewWidth > viewHeight)
 		{
-			scale = (double)WINDOW_HEIGHT / (double)WINDOW_WIDTH;
+			scale = (double)viewHeight / (double)viewWidth;
 			projection = glm::ortho(-5.0f, 5.0f, -5.0f * (float)scale, 5.0f * (float)scale, 0.1f, 100.0f);
 		}
-		else if (WINDOW_WIDTH < WINDOW_HEIGHT)
+		else if (viewWidth < viewHeight)
 		{
-			scale = (double)WINDOW_WIDTH / (double)WINDOW_HEIGHT;
+			scale = (double)viewWidth / (double)viewHeight;
 			projection = glm::ortho(-5.0f * (float)scale, 5.0f * (float)scale, -5.0f, 5.0f, 0.1f, 100.0f);
 		}
 		else
@@ -277,16 +450,278 @@ void ViewManager::PrepareSceneView()
 		}
 	}
 	if (bOrthographicProjection == false) {
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)viewWidth / (GLfloat)viewHeight, 0.1f, 100.0f);
 	}
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	// keep the matrices for culling the scene
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
+
+/***********************************************************
+ *  FillCameraBlock()
+ *
+ *  This method is used for filling the camera block with
+ *  the calculated camera.
+ ***********************************************************/
+void ViewManager::FillCameraBlock(CameraUniformBuffer::CAMERA_BLOCK& block) const
+{
+	block.view = m_viewMatrix;
+	block.projection = m_projectionMatrix;
+	block.viewPosition = glm::vec4(g_pCamera->Position, 1.0f);
+}
+
+/***********************************************************
+ *  SubmitFrame()
+ *
+ *  This method is used for measuring the input latency,
+ *  called right before the frame is submitted.  The time
+ *  is taken from when GLFW delivered the first mouse event
+ *  the frame draws.
+ ***********************************************************/
+void ViewManager::SubmitFrame()
+{
+	if (m_drawnEventTime < 0.0)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		return;
+	}
+
+	double latencyMs = (glfwGetTime() - m_drawnEventTime) * 1000.0;
+	m_latencyFrames++;
+	m_latencyTotalMs += latencyMs;
+	if (latencyMs > m_latencyMaxMs)
+	{
+		m_latencyMaxMs = latencyMs;
+	}
+	m_drawnEventTime = -1.0;
+}
+
+/***********************************************************
+ *  SetSnapshotInput()
+ *
+ *  This method is used for routing the input through
+ *  snapshots, for when the window events and the rendering
+ *  run on separate threads.  The callbacks then only record
+ *  the mouse, and the camera is only moved by the thread
+ *  that applies the snapshots.
+ ***********************************************************/
+void ViewManager::SetSnapshotInput(bool bSnapshotInput)
+{
+	m_bSnapshotInput = bSnapshotInput;
+	gbSnapshotInput = bSnapshotInput;
+}
+
+/***********************************************************
+ *  CaptureInput()
+ *
+ *  This method is used for filling a snapshot with the key
+ *  states, the mouse and the framebuffer size, on the event
+ *  thread right after the events have been polled, as
+ *  GLFW only allows the window to be queried there.  The snapshot is the one
+ *  published before, so while it has not been read the
+ *  time of its first mouse event is kept.
+ ***********************************************************/
+void ViewManager::CaptureInput(INPUT_SNAPSHOT& snapshot, bool bPreviousRead)
+{
+	snapshot.keyMask = 0;
+	for (int i = 0; i < g_SnapshotKeyCount; i++)
+	{
+		if (glfwGetKey(m_pWindow, g_SnapshotKeys[i]) == GLFW_PRESS)
+		{
+			snapshot.keyMask |= (1u << i);
+		}
+	}
+
+	snapshot.cursorX = gCursorX;
+	snapshot.cursorY = gCursorY;
+	snapshot.bCursorMoved = gbCursorMoved;
+	snapshot.scrollY = gScrollY;
+	snapshot.nMouseEvents = gMouseEvents;
+	glfwGetFramebufferSize(m_pWindow, &snapshot.framebufferWidth, &snapshot.framebufferHeight);
+
+	if ((bPreviousRead == true) || (snapshot.firstEventTime < 0.0))
+	{
+		snapshot.firstEventTime = gPendingEventTime;
+	}
+	gPendingEventTime = -1.0;
+}
+
+/***********************************************************
+ *  ApplyInput()
+ *
+ *  This method is used for moving the camera by the mouse
+ *  input of a snapshot and keeping its key states for the
+ *  next PrepareSceneView(), on the render thread.
+ ***********************************************************/
+void ViewManager::ApplyInput(const INPUT_SNAPSHOT& snapshot)
+{
+	m_snapshotKeys = snapshot.keyMask;
+
+	if (snapshot.nMouseEvents == m_appliedMouseEvents)
+	{
+		return;
+	}
+
+	if (snapshot.bCursorMoved == true)
+	{
+		MoveCameraByCursor(snapshot.cursorX, snapshot.cursorY);
+	}
+	if (snapshot.scrollY != m_appliedScrollY)
+	{
+		g_pCamera->ProcessMouseScroll(-(snapshot.scrollY - m_appliedScrollY));
+		m_appliedScrollY = snapshot.scrollY;
+	}
+	m_appliedMouseEvents = snapshot.nMouseEvents;
+
+	if ((snapshot.firstEventTime >= 0.0) && (m_drawnEventTime < 0.0))
+	{
+		m_drawnEventTime = snapshot.firstEventTime;
+	}
+}
+
+/***********************************************************
+ *  IsKeyDown()
+ *
+ *  This method is used for checking whether a key is held,
+ *  from the last applied snapshot while the input goes
+ *  through snapshots.
+ ***********************************************************/
+bool ViewManager::IsKeyDown(int key)
+{
+	if (m_bSnapshotInput == false)
+	{
+		return(glfwGetKey(m_pWindow, key) == GLFW_PRESS);
+	}
+
+	for (int i = 0; i < g_SnapshotKeyCount; i++)
+	{
+		if (g_SnapshotKeys[i] == key)
+		{
+			return((m_snapshotKeys & (1u << i)) != 0);
+		}
 	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetInputLatency()
+ *
+ *  This method is used for getting the input latency
+ *  measured since the last reset.
+ ***********************************************************/
+void ViewManager::GetInputLatency(INPUT_LATENCY& latency) const
+{
+	latency.nFrames = m_latencyFrames;
+	latency.averageMs = (m_latencyFrames > 0) ? (m_latencyTotalMs / m_latencyFrames) : 0.0;
+	latency.maxMs = m_latencyMaxMs;
+}
+
+/***********************************************************
+ *  ResetInputLatency()
+ *
+ *  This method is used for clearing the measured input
+ *  latency.
+ ***********************************************************/
+void ViewManager::ResetInputLatency()
+{
+	m_latencyFrames = 0;
+	m_latencyTotalMs = 0.0;
+	m_latencyMaxMs = 0.0;
+}
+
+/***********************************************************
+ *  GetCameraPosition()
+ *
+ *  This method is used for getting the current position of
+ *  the camera in world space.
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraPosition()
+{
+	if (NULL == g_pCamera)
+	{
+		return(glm::vec3(0.0f, 0.0f, 0.0f));
+	}
+
+	return(g_pCamera->Position);
+}
+
+/***********************************************************
+ *  GetCameraPoseCount()
+ *
+ *  This method is used for getting the number of standard
+ *  camera poses.
+ ***********************************************************/
+int ViewManager::GetCameraPoseCount()
+{
+	return(sizeof(g_CameraPoses) / sizeof(g_CameraPoses[0]));
+}
+
+/***********************************************************
+ *  GetCameraPoseName()
+ *
+ *  This method is used for getting the name of a standard
+ *  camera pose, used to label the captures.
+ ***********************************************************/
+const char* ViewManager::GetCameraPoseName(int pose)
+{
+	if ((pose < 0) || (pose >= GetCameraPoseCount()))
+	{
+		return("");
+	}
+
+	return(g_CameraPoses[pose].name);
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used for moving the camera to one of the
+ *  standard poses, including its projection.
+ ***********************************************************/
+void ViewManager::SetCameraPose(int pose)
+{
+	if ((NULL == g_pCamera) || (pose < 0) || (pose >= GetCameraPoseCount()))
+	{
+		return;
+	}
+
+	bOrthographicProjection = g_CameraPoses[pose].bOrthographic;
+	g_pCamera->Position = g_CameraPoses[pose].position;
+	g_pCamera->Front = g_CameraPoses[pose].front;
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	g_pCamera->Zoom = g_CameraPoses[pose].zoom;
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for moving the camera to a pose that
+ *  is not one of the standard ones, including its
+ *  projection.
+ ***********************************************************/
+void ViewManager::SetCamera(const glm::vec3& position, const glm::vec3& front, float zoom, bool bOrthographic)
+{
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	bOrthographicProjection = bOrthographic;
+	g_pCamera->Position = position;
+	g_pCamera->Front = front;
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	g_pCamera->Zoom = zoom;
+}
+
+/***********************************************************
+ *  SetViewSize()
+ *
+ *  This method is used for making the projection of the
+ *  next prepared frames fit an offscreen target, so its
+ *  aspect ratio is kept.  Zero goes back to the window.
+ ***********************************************************/
+void ViewManager::SetViewSize(int width, int height)
+{
+	m_viewWidth = (width > 0) ? width : 0;
+	m_viewHeight = (height > 0) ? height : 0;
 }
@@ -11,6 +11,12 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "CameraUniformBuffer.h"
+
+#include <cstdint>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -18,6 +24,31 @@
 class ViewManager
 {
 public:
+	// time from an input event to the submit of the first
+	// frame drawn with it
+	struct INPUT_LATENCY
+	{
+		GLuint nFrames;           // Submitted frames that drew new input
+		double averageMs;
+		double maxMs;
+	};
+
+	// the window input at one moment, published by the event
+	// thread for the render thread - the mouse values add up
+	// from the start, so skipped snapshots lose nothing
+	struct INPUT_SNAPSHOT
+	{
+		GLuint keyMask;           // Bits of the tracked keys held down
+		double cursorX;           // Latest cursor position
+		double cursorY;
+		bool bCursorMoved;        // False until the first cursor event
+		double scrollY;           // Scrolling since the start
+		uint64_t nMouseEvents;    // Mouse events since the start
+		double firstEventTime;    // First mouse event not yet read, negative when none
+		int framebufferWidth;     // Window framebuffer size, read on the event thread
+		int framebufferHeight;
+	};
+
 	// constructor
 	ViewManager(
 		ShaderManager* pShaderManager);
@@ -35,9 +66,37 @@ private:
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// size the projection is made for, zero for the window
+	int m_viewWidth;
+	int m_viewHeight;
+	// view and projection matrices from the last prepared frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// camera block of the shaders, and whether the current
+	// program reads it
+	CameraUniformBuffer m_cameraBuffer;
+	bool m_bCameraBlock;
+	// first input event drawn by the frame being prepared,
+	// negative when there is none, and the measured latency
+	double m_drawnEventTime;
+	GLuint m_latencyFrames;
+	double m_latencyTotalMs;
+	double m_latencyMaxMs;
+	// input state last applied from the snapshots
+	bool m_bSnapshotInput;
+	GLuint m_snapshotKeys;
+	double m_appliedScrollY;
+	uint64_t m_appliedMouseEvents;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// move the camera by the waiting input and calculate the
+	// view and projection matrices
+	void UpdateCameraMatrices();
+	// fill the camera block with the calculated camera
+	void FillCameraBlock(CameraUniformBuffer::CAMERA_BLOCK& block) const;
+	// turn the camera by a move of the mouse cursor
+	static void MoveCameraByCursor(double xMousePos, double yMousePos);
 
 
 public:
@@ -46,4 +105,43 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+	// sample the camera again from the freshest input, after
+	// the frame's CPU work and just before its draws - only
+	// the shaders that read the camera block see it, false
+	// when none does
+	bool LatchSceneView();
+	bool IsLateLatchAvailable() { return(m_bCameraBlock == true); }
+	// record the latency of the input drawn by the frame
+	// about to be submitted
+	void SubmitFrame();
+	void GetInputLatency(INPUT_LATENCY& latency) const;
+	void ResetInputLatency();
+
+	// route the input through snapshots, so the window events
+	// and the rendering can run on separate threads
+	void SetSnapshotInput(bool bSnapshotInput);
+	// fill the previously published snapshot, on the event
+	// thread after polling the events
+	void CaptureInput(INPUT_SNAPSHOT& snapshot, bool bPreviousRead);
+	// move the camera by a snapshot, on the render thread
+	void ApplyInput(const INPUT_SNAPSHOT& snapshot);
+	// check whether a key is held, from the snapshot when the
+	// input goes through snapshots
+	bool IsKeyDown(int key);
+
+	// get the view settings used for the last prepared frame
+	glm::mat4 GetViewMatrix() { return(m_viewMatrix); }
+	glm::mat4 GetProjectionMatrix() { return(m_projectionMatrix); }
+	glm::vec3 GetCameraPosition();
+
+	// move the camera to one of the standard poses, used for
+	// repeatable captures of the scene
+	static int GetCameraPoseCount();
+	static const char* GetCameraPoseName(int pose);
+	void SetCameraPose(int pose);
+	// move the camera to a pose given by the caller
+	void SetCamera(const glm::vec3& position, const glm::vec3& front, float zoom, bool bOrthographic);
+	// make the projection for a target of the passed in size
+	// instead of the window, zero goes back to the window
+	void SetViewSize(int width, int height);
 };
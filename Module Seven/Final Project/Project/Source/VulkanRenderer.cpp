@@ -0,0 +1,1783 @@
+///////////////////////////////////////////////////////////////////////////////
+// VulkanRenderer.cpp
+// ============
+// draws the scene with Vulkan into an offscreen target, with the draws
+// recorded on persistent worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef USE_VULKAN_BACKEND
+
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	const char* g_ValidationLayerName = "VK_LAYER_KHRONOS_validation";
+	const char* g_VertexShaderFile = "../../Utilities/shaders/vulkanVertexShader.spv";
+	const char* g_FragmentShaderFile = "../../Utilities/shaders/vulkanFragmentShader.spv";
+	const VkFormat g_ColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	// positions, normals and texture coordinates of the
+	// uploaded vertices
+	const uint32_t g_FloatsPerVertex = 8;
+	// objects recorded into one secondary command buffer
+	// when the settings leave it at zero
+	const uint32_t g_DefaultObjectsPerBatch = 64;
+
+	// the GL projection has y up and a depth range of -1 to
+	// 1, Vulkan clip space has y down and 0 to 1
+	const glm::mat4 g_ClipCorrection(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, -1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 0.0f,
+		0.0f, 0.0f, 0.5f, 1.0f);
+}
+
+/***********************************************************
+ *  VulkanRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VulkanRenderer::VulkanRenderer()
+{
+	m_instance = VK_NULL_HANDLE;
+	m_physicalDevice = VK_NULL_HANDLE;
+	memset(&m_deviceProperties, 0, sizeof(m_deviceProperties));
+	memset(&m_memoryProperties, 0, sizeof(m_memoryProperties));
+	m_device = VK_NULL_HANDLE;
+	m_queueFamily = 0;
+	m_queue = VK_NULL_HANDLE;
+	m_width = 0;
+	m_height = 0;
+	m_depthFormat = VK_FORMAT_D32_SFLOAT;
+	m_colorImage = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+	m_depthImage = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+	m_readbackBuffer = { VK_NULL_HANDLE, VK_NULL_HANDLE, NULL };
+	m_renderPass = VK_NULL_HANDLE;
+	m_framebuffer = VK_NULL_HANDLE;
+	m_descriptorSetLayout = VK_NULL_HANDLE;
+	m_descriptorPool = VK_NULL_HANDLE;
+	m_descriptorSet = VK_NULL_HANDLE;
+	m_textureSetLayout = VK_NULL_HANDLE;
+	m_textureDescriptorPool = VK_NULL_HANDLE;
+	m_sampler = VK_NULL_HANDLE;
+	m_pipelineLayout = VK_NULL_HANDLE;
+	m_pipelineCache = VK_NULL_HANDLE;
+	m_pipeline = VK_NULL_HANDLE;
+	m_commandPool = VK_NULL_HANDLE;
+	m_commandBuffer = VK_NULL_HANDLE;
+	m_fence = VK_NULL_HANDLE;
+	m_objectsPerBatch = g_DefaultObjectsPerBatch;
+	m_nBatches = 0;
+	m_nextBatch = 0;
+	m_workFrame = 0;
+	m_nWorkersDone = 0;
+	m_bStopWorkers = false;
+	m_vertexBuffer = { VK_NULL_HANDLE, VK_NULL_HANDLE, NULL };
+	m_indexBuffer = { VK_NULL_HANDLE, VK_NULL_HANDLE, NULL };
+	m_sceneBuffer = { VK_NULL_HANDLE, VK_NULL_HANDLE, NULL };
+	m_whiteTexture = { { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE }, VK_NULL_HANDLE };
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~VulkanRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VulkanRenderer::~VulkanRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating everything the frames
+ *  need.  Anything that fails is reported, and the parts
+ *  created so far are freed again.
+ ***********************************************************/
+bool VulkanRenderer::Create(const RENDERER_SETTINGS& settings)
+{
+	Destroy();
+
+	m_width = settings.width;
+	m_height = settings.height;
+	m_objectsPerBatch = (settings.objectsPerBatch > 0) ? settings.objectsPerBatch : g_DefaultObjectsPerBatch;
+
+	uint32_t nWorkers = settings.nWorkers;
+	if (nWorkers == 0)
+	{
+		nWorkers = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	bool bCreated =
+		(CreateInstance(settings.bValidation) == true) &&
+		(CreateDevice() == true) &&
+		(CreateTargets() == true) &&
+		(CreatePipeline(settings.pipelineCacheFile) == true) &&
+		(CreateCommands(nWorkers) == true);
+	if (bCreated == false)
+	{
+		Destroy();
+		return(false);
+	}
+
+	std::cout << "VulkanRenderer: drawing on " << m_deviceName
+		<< " with " << nWorkers << " recording threads" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the Vulkan objects in
+ *  the reverse order of their creation.
+ ***********************************************************/
+void VulkanRenderer::Destroy()
+{
+	if (m_device != VK_NULL_HANDLE)
+	{
+		StopWorkers();
+		vkDeviceWaitIdle(m_device);
+		SavePipelineCache();
+
+		DestroyBuffer(m_vertexBuffer);
+		DestroyBuffer(m_indexBuffer);
+		DestroyBuffer(m_sceneBuffer);
+		DestroyBuffer(m_readbackBuffer);
+		DestroyTextures();
+
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			vkDestroyCommandPool(m_device, m_workers[i].pool, NULL);
+		}
+		m_workers.clear();
+		m_batchBuffers.clear();
+		if (m_fence != VK_NULL_HANDLE)
+		{
+			vkDestroyFence(m_device, m_fence, NULL);
+			m_fence = VK_NULL_HANDLE;
+		}
+		if (m_commandPool != VK_NULL_HANDLE)
+		{
+			vkDestroyCommandPool(m_device, m_commandPool, NULL);
+			m_commandPool = VK_NULL_HANDLE;
+			m_commandBuffer = VK_NULL_HANDLE;
+		}
+
+		if (m_pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(m_device, m_pipeline, NULL);
+			m_pipeline = VK_NULL_HANDLE;
+		}
+		if (m_pipelineCache != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineCache(m_device, m_pipelineCache, NULL);
+			m_pipelineCache = VK_NULL_HANDLE;
+		}
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(m_device, m_pipelineLayout, NULL);
+			m_pipelineLayout = VK_NULL_HANDLE;
+		}
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, NULL);
+			m_descriptorPool = VK_NULL_HANDLE;
+			m_descriptorSet = VK_NULL_HANDLE;
+		}
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, NULL);
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+		}
+		if (m_textureSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(m_device, m_textureSetLayout, NULL);
+			m_textureSetLayout = VK_NULL_HANDLE;
+		}
+		if (m_sampler != VK_NULL_HANDLE)
+		{
+			vkDestroySampler(m_device, m_sampler, NULL);
+			m_sampler = VK_NULL_HANDLE;
+		}
+
+		if (m_framebuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyFramebuffer(m_device, m_framebuffer, NULL);
+			m_framebuffer = VK_NULL_HANDLE;
+		}
+		if (m_renderPass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(m_device, m_renderPass, NULL);
+			m_renderPass = VK_NULL_HANDLE;
+		}
+		DestroyImage(m_colorImage);
+		DestroyImage(m_depthImage);
+
+		vkDestroyDevice(m_device, NULL);
+		m_device = VK_NULL_HANDLE;
+		m_queue = VK_NULL_HANDLE;
+	}
+
+	if (m_instance != VK_NULL_HANDLE)
+	{
+		vkDestroyInstance(m_instance, NULL);
+		m_instance = VK_NULL_HANDLE;
+		m_physicalDevice = VK_NULL_HANDLE;
+	}
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a point light, the ones
+ *  past the size of the shader light array are ignored.
+ ***********************************************************/
+void VulkanRenderer::AddLight(const RENDER_LIGHT& light)
+{
+	if (m_lights.size() < MAX_LIGHTS)
+	{
+		m_lights.push_back(light);
+	}
+}
+
+/***********************************************************
+ *  AddMaterial()
+ *
+ *  This method is used for adding a material to the scene
+ *  block.  Returns the handle the objects use it with, or
+ *  NO_MATERIAL when the material array is full.
+ ***********************************************************/
+uint32_t VulkanRenderer::AddMaterial(const RENDER_MATERIAL& material)
+{
+	if (m_materials.size() >= MAX_MATERIALS)
+	{
+		std::cout << "VulkanRenderer: more than " << MAX_MATERIALS << " materials" << std::endl;
+		return(NO_MATERIAL);
+	}
+
+	m_materials.push_back(material);
+	return((uint32_t)(m_materials.size() - 1));
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for adding a texture from RGBA
+ *  texels, the first row at a texture coordinate v of zero
+ *  like a GL texture.  Returns the handle the objects use
+ *  it with.
+ ***********************************************************/
+uint32_t VulkanRenderer::AddTexture(const unsigned char* pPixels, uint32_t width, uint32_t height)
+{
+	if ((NULL == pPixels) || (width == 0) || (height == 0))
+	{
+		return(NO_TEXTURE);
+	}
+
+	TEXTURE_DATA data;
+	data.width = width;
+	data.height = height;
+	data.pixels.assign(pPixels, pPixels + (size_t)width * height * 4);
+	m_textureData.push_back(data);
+
+	return((uint32_t)(m_textureData.size() - 1));
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for adding a mesh from interleaved
+ *  vertex data starting with the position, the normal and
+ *  the texture coordinates, and a triangle list indexing
+ *  it.  Returns the handle
+ *  the objects draw the mesh with.
+ ***********************************************************/
+uint32_t VulkanRenderer::AddMesh(
+	const float* vertexData,
+	uint32_t floatsPerVertex,
+	uint32_t nVertices,
+	const std::vector<uint32_t>& triangles)
+{
+	MESH mesh;
+	mesh.firstIndex = (uint32_t)m_indices.size();
+	mesh.nIndices = (uint32_t)triangles.size();
+	mesh.vertexOffset = (int32_t)(m_vertices.size() / g_FloatsPerVertex);
+
+	for (uint32_t v = 0; v < nVertices; v++)
+	{
+		const float* vertex = vertexData + (size_t)v * floatsPerVertex;
+		m_vertices.insert(m_vertices.end(), vertex, vertex + g_FloatsPerVertex);
+	}
+	m_indices.insert(m_indices.end(), triangles.begin(), triangles.end());
+	m_meshes.push_back(mesh);
+
+	return((uint32_t)(m_meshes.size() - 1));
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding one drawn object.  The
+ *  object is drawn with the texture when it has one, and
+ *  with the color otherwise.
+ ***********************************************************/
+void VulkanRenderer::AddObject(
+	uint32_t mesh,
+	const glm::mat4& model,
+	const glm::vec4& color,
+	uint32_t texture,
+	uint32_t material,
+	const glm::vec2& uvScale)
+{
+	if (mesh >= m_meshes.size())
+	{
+		std::cout << "VulkanRenderer: object with unknown mesh " << mesh << std::endl;
+		return;
+	}
+
+	bool bTexture = (texture < m_textureData.size());
+	OBJECT object;
+	object.mesh = mesh;
+	object.texture = (bTexture == true) ? texture : NO_TEXTURE;
+	object.constants.model = model;
+	object.constants.color = color;
+	object.constants.uvScale = uvScale;
+	object.constants.material = (material < m_materials.size()) ? (int32_t)material : -1;
+	object.constants.bUseTexture = (bTexture == true) ? 1 : 0;
+	m_objects.push_back(object);
+}
+
+/***********************************************************
+ *  UploadScene()
+ *
+ *  This method is used for placing the meshes in one vertex
+ *  buffer and one index buffer, and copying the textures
+ *  into sampled images with a descriptor set each.  The
+ *  mesh buffers are host visible, which on a software
+ *  device like lavapipe is the only memory there is.
+ ***********************************************************/
+bool VulkanRenderer::UploadScene()
+{
+	if ((m_device == VK_NULL_HANDLE) || (m_vertices.empty() == true) || (m_indices.empty() == true))
+	{
+		return(false);
+	}
+
+	vkDeviceWaitIdle(m_device);
+	DestroyBuffer(m_vertexBuffer);
+	DestroyBuffer(m_indexBuffer);
+
+	VkDeviceSize vertexBytes = m_vertices.size() * sizeof(float);
+	VkDeviceSize indexBytes = m_indices.size() * sizeof(uint32_t);
+	if ((CreateBuffer(vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer) == false) ||
+		(CreateBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indexBuffer) == false))
+	{
+		std::cout << "VulkanRenderer: could not create the mesh buffers" << std::endl;
+		DestroyBuffer(m_vertexBuffer);
+		DestroyBuffer(m_indexBuffer);
+		return(false);
+	}
+
+	memcpy(m_vertexBuffer.pMapped, m_vertices.data(), (size_t)vertexBytes);
+	memcpy(m_indexBuffer.pMapped, m_indices.data(), (size_t)indexBytes);
+
+	// one set for each texture and for the white one
+	DestroyTextures();
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (uint32_t)m_textureData.size() + 1 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = poolSize.descriptorCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(m_device, &poolInfo, NULL, &m_textureDescriptorPool) != VK_SUCCESS)
+	{
+		m_textureDescriptorPool = VK_NULL_HANDLE;
+	}
+
+	TEXTURE_DATA white;
+	white.width = 1;
+	white.height = 1;
+	white.pixels.assign(4, 255);
+	bool bUploaded = (m_textureDescriptorPool != VK_NULL_HANDLE) && (UploadTexture(white, m_whiteTexture) == true);
+	for (size_t i = 0; (bUploaded == true) && (i < m_textureData.size()); i++)
+	{
+		TEXTURE texture;
+		bUploaded = UploadTexture(m_textureData[i], texture);
+		if (bUploaded == true)
+		{
+			m_textures.push_back(texture);
+		}
+	}
+	if (bUploaded == false)
+	{
+		std::cout << "VulkanRenderer: could not upload the textures" << std::endl;
+		DestroyTextures();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ClearScene()
+ *
+ *  This method is used for dropping the meshes, textures,
+ *  materials, objects and lights.
+ ***********************************************************/
+void VulkanRenderer::ClearScene()
+{
+	if (m_device != VK_NULL_HANDLE)
+	{
+		vkDeviceWaitIdle(m_device);
+	}
+	DestroyBuffer(m_vertexBuffer);
+	DestroyBuffer(m_indexBuffer);
+	DestroyTextures();
+
+	m_vertices.clear();
+	m_indices.clear();
+	m_meshes.clear();
+	m_objects.clear();
+	m_lights.clear();
+	m_materials.clear();
+	m_textureData.clear();
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used for drawing one frame.  The workers
+ *  are woken to record the batches of objects in parallel,
+ *  then the primary command buffer runs the render pass
+ *  with the batches in order.  The frame is waited for, so
+ *  the scene block and the command pools are free to reuse
+ *  by the next frame.
+ ***********************************************************/
+bool VulkanRenderer::RenderFrame(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	if ((m_device == VK_NULL_HANDLE) || (m_vertexBuffer.buffer == VK_NULL_HANDLE) ||
+		(m_whiteTexture.descriptorSet == VK_NULL_HANDLE))
+	{
+		return(false);
+	}
+
+	// the missing lights are black, with a focal strength
+	// that keeps the specular term defined
+	SCENE_BLOCK block;
+	block.viewProjection = g_ClipCorrection * projection * view;
+	block.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	for (uint32_t i = 0; i < MAX_LIGHTS; i++)
+	{
+		LIGHT_BLOCK& light = block.lights[i];
+		light.position = glm::vec4(0.0f);
+		light.ambientColor = glm::vec4(0.0f);
+		light.diffuseColor = glm::vec4(0.0f);
+		light.specularColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (i < m_lights.size())
+		{
+			light.position = glm::vec4(m_lights[i].position, m_lights[i].specularIntensity);
+			light.ambientColor = glm::vec4(m_lights[i].ambientColor, 0.0f);
+			light.diffuseColor = glm::vec4(m_lights[i].diffuseColor, 0.0f);
+			light.specularColor = glm::vec4(m_lights[i].specularColor, m_lights[i].focalStrength);
+		}
+	}
+	for (uint32_t i = 0; i < MAX_MATERIALS; i++)
+	{
+		MATERIAL_BLOCK& material = block.materials[i];
+		material.ambientColor = glm::vec4(0.0f);
+		material.diffuseColor = glm::vec4(0.0f);
+		material.specularColor = glm::vec4(0.0f);
+		if (i < m_materials.size())
+		{
+			material.ambientColor = glm::vec4(m_materials[i].ambientColor, m_materials[i].ambientStrength);
+			material.diffuseColor = glm::vec4(m_materials[i].diffuseColor, 0.0f);
+			material.specularColor = glm::vec4(m_materials[i].specularColor, m_materials[i].shininess);
+		}
+	}
+	memcpy(m_sceneBuffer.pMapped, &block, sizeof(block));
+
+	// the batches are independent, so each worker takes the
+	// next batch until none are left
+	double startMs = GetTimeMs();
+	size_t nObjects = m_objects.size();
+	size_t nBatches = (nObjects + m_objectsPerBatch - 1) / m_objectsPerBatch;
+	m_batchBuffers.assign(nBatches, VK_NULL_HANDLE);
+	m_nBatches = nBatches;
+	m_nextBatch = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_workLock);
+		m_nWorkersDone = 0;
+		m_workFrame++;
+	}
+	m_workStart.notify_all();
+	{
+		std::unique_lock<std::mutex> lock(m_workLock);
+		m_workDone.wait(lock, [this]() { return(m_nWorkersDone == m_workers.size()); });
+	}
+	size_t nThreads = std::min(m_workers.size(), nBatches);
+
+	for (size_t i = 0; i < nBatches; i++)
+	{
+		if (m_batchBuffers[i] == VK_NULL_HANDLE)
+		{
+			std::cout << "VulkanRenderer: could not record the draws" << std::endl;
+			return(false);
+		}
+	}
+	m_stats.recordMs = GetTimeMs() - startMs;
+
+	startMs = GetTimeMs();
+	vkResetCommandBuffer(m_commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+
+	VkClearValue clearValues[2];
+	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	VkRenderPassBeginInfo passInfo = {};
+	passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	passInfo.renderPass = m_renderPass;
+	passInfo.framebuffer = m_framebuffer;
+	passInfo.renderArea.extent = { m_width, m_height };
+	passInfo.clearValueCount = 2;
+	passInfo.pClearValues = clearValues;
+	vkCmdBeginRenderPass(m_commandBuffer, &passInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	if (nBatches > 0)
+	{
+		vkCmdExecuteCommands(m_commandBuffer, (uint32_t)nBatches, m_batchBuffers.data());
+	}
+	vkCmdEndRenderPass(m_commandBuffer);
+
+	if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not record the frame" << std::endl;
+		return(false);
+	}
+
+	bool bFinished = SubmitAndWait(m_commandBuffer);
+	m_stats.submitMs = GetTimeMs() - startMs;
+	m_stats.nDrawCalls = (uint32_t)nObjects;
+	m_stats.nBatches = (uint32_t)nBatches;
+	m_stats.nWorkers = (uint32_t)nThreads;
+
+	return(bFinished);
+}
+
+/***********************************************************
+ *  SaveImage()
+ *
+ *  This method is used for copying the color target of the
+ *  last frame to the read back buffer and writing it to a
+ *  binary PPM image.  The rows are already top down.
+ ***********************************************************/
+bool VulkanRenderer::SaveImage(const char* filename)
+{
+	if (m_device == VK_NULL_HANDLE)
+	{
+		return(false);
+	}
+
+	vkResetCommandBuffer(m_commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+
+	// the render pass leaves the color target ready to copy
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { m_width, m_height, 1 };
+	vkCmdCopyImageToBuffer(m_commandBuffer, m_colorImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		m_readbackBuffer.buffer, 1, &region);
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, NULL, 0, NULL);
+
+	if ((vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS) || (SubmitAndWait(m_commandBuffer) == false))
+	{
+		std::cout << "VulkanRenderer: could not read back the frame" << std::endl;
+		return(false);
+	}
+
+	FILE* file = fopen(filename, "wb");
+	if (NULL == file)
+	{
+		std::cout << "VulkanRenderer: could not write " << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* pixels = (const unsigned char*)m_readbackBuffer.pMapped;
+	fprintf(file, "P6\n%u %u\n255\n", m_width, m_height);
+	for (size_t i = 0; i < (size_t)m_width * m_height; i++)
+	{
+		fwrite(&pixels[i * 4], 1, 3, file);
+	}
+	fclose(file);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateInstance()
+ *
+ *  This method is used for creating the instance, with the
+ *  validation layer when it was asked for and is installed.
+ *  Without a window no surface extensions are needed.
+ ***********************************************************/
+bool VulkanRenderer::CreateInstance(bool bValidation)
+{
+	std::vector<const char*> layers;
+	if (bValidation == true)
+	{
+		uint32_t nLayers = 0;
+		vkEnumerateInstanceLayerProperties(&nLayers, NULL);
+		std::vector<VkLayerProperties> availableLayers(nLayers);
+		vkEnumerateInstanceLayerProperties(&nLayers, availableLayers.data());
+		for (uint32_t i = 0; i < nLayers; i++)
+		{
+			if (strcmp(availableLayers[i].layerName, g_ValidationLayerName) == 0)
+			{
+				layers.push_back(g_ValidationLayerName);
+			}
+		}
+		if (layers.empty() == true)
+		{
+			std::cout << "VulkanRenderer: the validation layer is not installed" << std::endl;
+		}
+	}
+
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "FinalProject";
+	appInfo.applicationVersion = 1;
+	appInfo.pEngineName = "FinalProject";
+	appInfo.engineVersion = 1;
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+	createInfo.enabledLayerCount = (uint32_t)layers.size();
+	createInfo.ppEnabledLayerNames = layers.data();
+
+	VkResult result = vkCreateInstance(&createInfo, NULL, &m_instance);
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the instance, result " << result << std::endl;
+		m_instance = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateDevice()
+ *
+ *  This method is used for picking the device and creating
+ *  the logical device with one graphics queue.  A GPU is
+ *  preferred, a software device like lavapipe is taken
+ *  when there is no GPU.
+ ***********************************************************/
+bool VulkanRenderer::CreateDevice()
+{
+	uint32_t nDevices = 0;
+	vkEnumeratePhysicalDevices(m_instance, &nDevices, NULL);
+	std::vector<VkPhysicalDevice> devices(nDevices);
+	vkEnumeratePhysicalDevices(m_instance, &nDevices, devices.data());
+
+	for (uint32_t d = 0; d < nDevices; d++)
+	{
+		uint32_t nFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &nFamilies, NULL);
+		std::vector<VkQueueFamilyProperties> families(nFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &nFamilies, families.data());
+
+		for (uint32_t f = 0; f < nFamilies; f++)
+		{
+			if ((families[f].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+			{
+				continue;
+			}
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(devices[d], &properties);
+			bool bCPU = (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU);
+			if ((m_physicalDevice == VK_NULL_HANDLE) ||
+				((bCPU == false) && (m_deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)))
+			{
+				m_physicalDevice = devices[d];
+				m_deviceProperties = properties;
+				m_queueFamily = f;
+			}
+			break;
+		}
+	}
+
+	if (m_physicalDevice == VK_NULL_HANDLE)
+	{
+		std::cout << "VulkanRenderer: no device with a graphics queue" << std::endl;
+		return(false);
+	}
+	m_deviceName = m_deviceProperties.deviceName;
+	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo = {};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = m_queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.queueCreateInfoCount = 1;
+	createInfo.pQueueCreateInfos = &queueInfo;
+
+	VkResult result = vkCreateDevice(m_physicalDevice, &createInfo, NULL, &m_device);
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the device, result " << result << std::endl;
+		m_device = VK_NULL_HANDLE;
+		return(false);
+	}
+	vkGetDeviceQueue(m_device, m_queueFamily, 0, &m_queue);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the offscreen color
+ *  and depth targets, the render pass drawing into them,
+ *  and the buffer the color target is read back into.
+ ***********************************************************/
+bool VulkanRenderer::CreateTargets()
+{
+	// one of the two depth formats is always supported
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, VK_FORMAT_D32_SFLOAT, &formatProperties);
+	m_depthFormat = VK_FORMAT_D32_SFLOAT;
+	if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) == 0)
+	{
+		m_depthFormat = VK_FORMAT_X8_D24_UNORM_PACK32;
+	}
+
+	if ((CreateImage(m_width, m_height, g_ColorFormat,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT, m_colorImage) == false) ||
+		(CreateImage(m_width, m_height, m_depthFormat,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_DEPTH_BIT, m_depthImage) == false))
+	{
+		std::cout << "VulkanRenderer: could not create the offscreen targets" << std::endl;
+		return(false);
+	}
+
+	VkAttachmentDescription attachments[2] = {};
+	attachments[0].format = g_ColorFormat;
+	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	attachments[1].format = m_depthFormat;
+	attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+	subpass.pDepthStencilAttachment = &depthReference;
+
+	// the last frame's copy finishes before the targets are
+	// cleared, and the draws before the next copy
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo passInfo = {};
+	passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	passInfo.attachmentCount = 2;
+	passInfo.pAttachments = attachments;
+	passInfo.subpassCount = 1;
+	passInfo.pSubpasses = &subpass;
+	passInfo.dependencyCount = 2;
+	passInfo.pDependencies = dependencies;
+	if (vkCreateRenderPass(m_device, &passInfo, NULL, &m_renderPass) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the render pass" << std::endl;
+		m_renderPass = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkImageView views[2] = { m_colorImage.view, m_depthImage.view };
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = m_renderPass;
+	framebufferInfo.attachmentCount = 2;
+	framebufferInfo.pAttachments = views;
+	framebufferInfo.width = m_width;
+	framebufferInfo.height = m_height;
+	framebufferInfo.layers = 1;
+	if (vkCreateFramebuffer(m_device, &framebufferInfo, NULL, &m_framebuffer) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the framebuffer" << std::endl;
+		m_framebuffer = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	if (CreateBuffer((VkDeviceSize)m_width * m_height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_readbackBuffer) == false)
+	{
+		std::cout << "VulkanRenderer: could not create the read back buffer" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ *
+ *  This method is used for creating the scene block and
+ *  its descriptor set, which is written once, the layout
+ *  and sampler of the texture sets, and the pipeline
+ *  drawing the objects.  The pipeline is built through the
+ *  cache loaded from the last run.
+ ***********************************************************/
+bool VulkanRenderer::CreatePipeline(const char* pipelineCacheFile)
+{
+	if (CreateBuffer(sizeof(SCENE_BLOCK), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, m_sceneBuffer) == false)
+	{
+		std::cout << "VulkanRenderer: could not create the scene block" << std::endl;
+		return(false);
+	}
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	vkCreateDescriptorSetLayout(m_device, &layoutInfo, NULL, &m_descriptorSetLayout);
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(m_device, &poolInfo, NULL, &m_descriptorPool);
+
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = m_descriptorPool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &m_descriptorSetLayout;
+	if (vkAllocateDescriptorSets(m_device, &setInfo, &m_descriptorSet) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not allocate the descriptor set" << std::endl;
+		m_descriptorSet = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkDescriptorBufferInfo bufferInfo = { m_sceneBuffer.buffer, 0, sizeof(SCENE_BLOCK) };
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, NULL);
+
+	VkDescriptorSetLayoutBinding textureBinding = {};
+	textureBinding.binding = 0;
+	textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureBinding.descriptorCount = 1;
+	textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutInfo.pBindings = &textureBinding;
+	vkCreateDescriptorSetLayout(m_device, &layoutInfo, NULL, &m_textureSetLayout);
+
+	// the GL textures are linear and repeat
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = 0.0f;
+	if (vkCreateSampler(m_device, &samplerInfo, NULL, &m_sampler) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the sampler" << std::endl;
+		m_sampler = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkPushConstantRange pushRange = {};
+	pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushRange.offset = 0;
+	pushRange.size = sizeof(OBJECT_CONSTANTS);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	VkDescriptorSetLayout setLayouts[2] = { m_descriptorSetLayout, m_textureSetLayout };
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, NULL, &m_pipelineLayout) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the pipeline layout" << std::endl;
+		m_pipelineLayout = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	LoadPipelineCache(pipelineCacheFile);
+
+	VkShaderModule vertexShader = LoadShaderModule(g_VertexShaderFile);
+	VkShaderModule fragmentShader = LoadShaderModule(g_FragmentShaderFile);
+	if ((vertexShader == VK_NULL_HANDLE) || (fragmentShader == VK_NULL_HANDLE))
+	{
+		vkDestroyShaderModule(m_device, vertexShader, NULL);
+		vkDestroyShaderModule(m_device, fragmentShader, NULL);
+		return(false);
+	}
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertexShader;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragmentShader;
+	stages[1].pName = "main";
+
+	VkVertexInputBindingDescription vertexBinding = { 0, g_FloatsPerVertex * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX };
+	VkVertexInputAttributeDescription vertexAttributes[3] =
+	{
+		{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 },
+		{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float) },
+		{ 2, 0, VK_FORMAT_R32G32_SFLOAT, 6 * sizeof(float) }
+	};
+	VkPipelineVertexInputStateCreateInfo vertexInput = {};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInput.vertexBindingDescriptionCount = 1;
+	vertexInput.pVertexBindingDescriptions = &vertexBinding;
+	vertexInput.vertexAttributeDescriptionCount = 3;
+	vertexInput.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// the viewport and scissor are recorded in each batch
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// the GL renderer draws without face culling as well
+	VkPipelineRasterizationStateCreateInfo rasterization = {};
+	rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterization.cullMode = VK_CULL_MODE_NONE;
+	rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterization.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisample = {};
+	multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo colorBlend = {};
+	colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlend.attachmentCount = 1;
+	colorBlend.pAttachments = &blendAttachment;
+
+	VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = stages;
+	pipelineInfo.pVertexInputState = &vertexInput;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterization;
+	pipelineInfo.pMultisampleState = &multisample;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlend;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = m_pipelineLayout;
+	pipelineInfo.renderPass = m_renderPass;
+	pipelineInfo.subpass = 0;
+
+	double startMs = GetTimeMs();
+	VkResult result = vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1, &pipelineInfo, NULL, &m_pipeline);
+	double pipelineMs = GetTimeMs() - startMs;
+
+	vkDestroyShaderModule(m_device, vertexShader, NULL);
+	vkDestroyShaderModule(m_device, fragmentShader, NULL);
+
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the pipeline, result " << result << std::endl;
+		m_pipeline = VK_NULL_HANDLE;
+		return(false);
+	}
+	std::cout << "VulkanRenderer: built the pipeline in " << pipelineMs << " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateCommands()
+ *
+ *  This method is used for creating the primary command
+ *  buffer with its fence, and starting the workers with a
+ *  command pool each, since a pool can only be recorded
+ *  from one thread at a time.  The workers allocate their
+ *  secondary buffers on first use and keep them.
+ ***********************************************************/
+bool VulkanRenderer::CreateCommands(uint32_t nWorkers)
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+	if (vkCreateCommandPool(m_device, &poolInfo, NULL, &m_commandPool) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the command pool" << std::endl;
+		m_commandPool = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = m_commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+	vkAllocateCommandBuffers(m_device, &allocateInfo, &m_commandBuffer);
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	vkCreateFence(m_device, &fenceInfo, NULL, &m_fence);
+
+	// the worker pools are reset as a whole every frame
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	m_workers.resize(nWorkers);
+	for (uint32_t i = 0; i < nWorkers; i++)
+	{
+		m_workers[i].nUsed = 0;
+		if (vkCreateCommandPool(m_device, &poolInfo, NULL, &m_workers[i].pool) != VK_SUCCESS)
+		{
+			std::cout << "VulkanRenderer: could not create the worker command pools" << std::endl;
+			m_workers.resize(i);
+			return(false);
+		}
+	}
+
+	// the threads start once the worker list stops changing
+	for (uint32_t i = 0; i < nWorkers; i++)
+	{
+		m_workers[i].thread = std::thread(&VulkanRenderer::RunWorker, this, (size_t)i);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopWorkers()
+ *
+ *  This method is used for waking the workers to stop and
+ *  waiting for their threads to finish.
+ ***********************************************************/
+void VulkanRenderer::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workLock);
+		m_bStopWorkers = true;
+	}
+	m_workStart.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].thread.joinable() == true)
+		{
+			m_workers[i].thread.join();
+		}
+	}
+
+	// the next workers start counting frames from zero
+	m_bStopWorkers = false;
+	m_workFrame = 0;
+	m_nWorkersDone = 0;
+}
+
+/***********************************************************
+ *  LoadPipelineCache()
+ *
+ *  This method is used for creating the pipeline cache
+ *  with the data saved by the last run.  The data is only
+ *  used when its header matches this device and driver,
+ *  otherwise the pipeline is built from scratch and the
+ *  cache replaced on exit.
+ ***********************************************************/
+void VulkanRenderer::LoadPipelineCache(const char* filename)
+{
+	std::vector<char> data;
+	m_pipelineCacheFile = (NULL != filename) ? filename : "";
+	if (m_pipelineCacheFile.empty() == false)
+	{
+		std::ifstream file(m_pipelineCacheFile, std::ios::binary);
+		if (file.is_open() == true)
+		{
+			data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+	}
+
+	// header: length, version, vendor, device, cache UUID
+	const size_t headerBytes = 16 + VK_UUID_SIZE;
+	if (data.empty() == false)
+	{
+		uint32_t header[4] = {};
+		if (data.size() >= headerBytes)
+		{
+			memcpy(header, data.data(), sizeof(header));
+		}
+		bool bMatches =
+			(data.size() >= headerBytes) &&
+			(header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+			(header[2] == m_deviceProperties.vendorID) &&
+			(header[3] == m_deviceProperties.deviceID) &&
+			(memcmp(data.data() + 16, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+		if (bMatches == false)
+		{
+			std::cout << "VulkanRenderer: the pipeline cache is from another device or driver" << std::endl;
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = (data.empty() == false) ? data.data() : NULL;
+	if (vkCreatePipelineCache(m_device, &cacheInfo, NULL, &m_pipelineCache) != VK_SUCCESS)
+	{
+		m_pipelineCache = VK_NULL_HANDLE;
+	}
+}
+
+/***********************************************************
+ *  SavePipelineCache()
+ *
+ *  This method is used for writing the pipeline cache to
+ *  its file, so the next run skips the shader compiles.
+ ***********************************************************/
+void VulkanRenderer::SavePipelineCache()
+{
+	if ((m_pipelineCache == VK_NULL_HANDLE) || (m_pipelineCacheFile.empty() == true))
+	{
+		return;
+	}
+
+	size_t size = 0;
+	vkGetPipelineCacheData(m_device, m_pipelineCache, &size, NULL);
+	std::vector<char> data(size);
+	if ((size == 0) || (vkGetPipelineCacheData(m_device, m_pipelineCache, &size, data.data()) != VK_SUCCESS))
+	{
+		return;
+	}
+
+	std::ofstream file(m_pipelineCacheFile, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		std::cout << "VulkanRenderer: could not write " << m_pipelineCacheFile << std::endl;
+		return;
+	}
+	file.write(data.data(), (std::streamsize)size);
+}
+
+/***********************************************************
+ *  LoadShaderModule()
+ *
+ *  This method is used for loading a SPIR-V shader, built
+ *  from the GLSL source of the same name.
+ ***********************************************************/
+VkShaderModule VulkanRenderer::LoadShaderModule(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		std::cout << "VulkanRenderer: could not open " << filename << std::endl;
+		return(VK_NULL_HANDLE);
+	}
+
+	std::vector<char> code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if ((code.empty() == true) || ((code.size() % sizeof(uint32_t)) != 0))
+	{
+		std::cout << "VulkanRenderer: " << filename << " is not SPIR-V" << std::endl;
+		return(VK_NULL_HANDLE);
+	}
+
+	// the code is copied into words, a char buffer is not
+	// aligned for them
+	std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+	memcpy(words.data(), code.data(), code.size());
+
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = words.data();
+
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	if (vkCreateShaderModule(m_device, &moduleInfo, NULL, &shaderModule) != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: could not create the shader of " << filename << std::endl;
+		return(VK_NULL_HANDLE);
+	}
+
+	return(shaderModule);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a host visible buffer
+ *  that stays mapped for its whole life.
+ ***********************************************************/
+bool VulkanRenderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, BUFFER& buffer)
+{
+	buffer = { VK_NULL_HANDLE, VK_NULL_HANDLE, NULL };
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(m_device, &bufferInfo, NULL, &buffer.buffer) != VK_SUCCESS)
+	{
+		buffer.buffer = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_device, buffer.buffer, &requirements);
+	int memoryType = FindMemoryType(requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = (uint32_t)memoryType;
+	if ((memoryType < 0) || (vkAllocateMemory(m_device, &allocateInfo, NULL, &buffer.memory) != VK_SUCCESS))
+	{
+		buffer.memory = VK_NULL_HANDLE;
+		DestroyBuffer(buffer);
+		return(false);
+	}
+
+	vkBindBufferMemory(m_device, buffer.buffer, buffer.memory, 0);
+	if (vkMapMemory(m_device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.pMapped) != VK_SUCCESS)
+	{
+		buffer.pMapped = NULL;
+		DestroyBuffer(buffer);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyBuffer()
+ *
+ *  This method is used for freeing a buffer and its memory.
+ ***********************************************************/
+void VulkanRenderer::DestroyBuffer(BUFFER& buffer)
+{
+	if (NULL != buffer.pMapped)
+	{
+		vkUnmapMemory(m_device, buffer.memory);
+		buffer.pMapped = NULL;
+	}
+	if (buffer.buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_device, buffer.buffer, NULL);
+		buffer.buffer = VK_NULL_HANDLE;
+	}
+	if (buffer.memory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(m_device, buffer.memory, NULL);
+		buffer.memory = VK_NULL_HANDLE;
+	}
+}
+
+/***********************************************************
+ *  CreateImage()
+ *
+ *  This method is used for creating an image in device
+ *  memory, with a view of it.
+ ***********************************************************/
+bool VulkanRenderer::CreateImage(
+	uint32_t width,
+	uint32_t height,
+	VkFormat format,
+	VkImageUsageFlags usage,
+	VkImageAspectFlags aspect,
+	IMAGE& image)
+{
+	image = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(m_device, &imageInfo, NULL, &image.image) != VK_SUCCESS)
+	{
+		image.image = VK_NULL_HANDLE;
+		return(false);
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_device, image.image, &requirements);
+	int memoryType = FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (memoryType < 0)
+	{
+		memoryType = FindMemoryType(requirements.memoryTypeBits, 0);
+	}
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = (uint32_t)memoryType;
+	if ((memoryType < 0) || (vkAllocateMemory(m_device, &allocateInfo, NULL, &image.memory) != VK_SUCCESS))
+	{
+		image.memory = VK_NULL_HANDLE;
+		DestroyImage(image);
+		return(false);
+	}
+	vkBindImageMemory(m_device, image.image, image.memory, 0);
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspect;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(m_device, &viewInfo, NULL, &image.view) != VK_SUCCESS)
+	{
+		image.view = VK_NULL_HANDLE;
+		DestroyImage(image);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyImage()
+ *
+ *  This method is used for freeing an image, its view and
+ *  its memory.
+ ***********************************************************/
+void VulkanRenderer::DestroyImage(IMAGE& image)
+{
+	if (image.view != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(m_device, image.view, NULL);
+		image.view = VK_NULL_HANDLE;
+	}
+	if (image.image != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(m_device, image.image, NULL);
+		image.image = VK_NULL_HANDLE;
+	}
+	if (image.memory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(m_device, image.memory, NULL);
+		image.memory = VK_NULL_HANDLE;
+	}
+}
+
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for copying texel data through a
+ *  staging buffer into a new sampled image, and writing a
+ *  descriptor set of the texture pool for it.  Textures
+ *  are uploaded once per scene, so each copy is waited for.
+ ***********************************************************/
+bool VulkanRenderer::UploadTexture(const TEXTURE_DATA& data, TEXTURE& texture)
+{
+	texture.descriptorSet = VK_NULL_HANDLE;
+
+	BUFFER staging;
+	VkDeviceSize bytes = (VkDeviceSize)data.width * data.height * 4;
+	if (CreateBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging) == false)
+	{
+		texture.image = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+		return(false);
+	}
+	if (CreateImage(data.width, data.height, VK_FORMAT_R8G8B8A8_UNORM,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT, texture.image) == false)
+	{
+		DestroyBuffer(staging);
+		return(false);
+	}
+	memcpy(staging.pMapped, data.pixels.data(), (size_t)bytes);
+
+	vkResetCommandBuffer(m_commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.image.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, NULL, 0, NULL, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { data.width, data.height, 1 };
+	vkCmdCopyBufferToImage(m_commandBuffer, staging.buffer, texture.image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, NULL, 0, NULL, 1, &barrier);
+
+	bool bCopied = (vkEndCommandBuffer(m_commandBuffer) == VK_SUCCESS) && (SubmitAndWait(m_commandBuffer) == true);
+	DestroyBuffer(staging);
+
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = m_textureDescriptorPool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &m_textureSetLayout;
+	if ((bCopied == false) || (vkAllocateDescriptorSets(m_device, &setInfo, &texture.descriptorSet) != VK_SUCCESS))
+	{
+		texture.descriptorSet = VK_NULL_HANDLE;
+		DestroyImage(texture.image);
+		return(false);
+	}
+
+	VkDescriptorImageInfo imageInfo = { m_sampler, texture.image.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = texture.descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, NULL);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the texture images and
+ *  the pool of their descriptor sets.
+ ***********************************************************/
+void VulkanRenderer::DestroyTextures()
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		DestroyImage(m_textures[i].image);
+	}
+	m_textures.clear();
+	DestroyImage(m_whiteTexture.image);
+	m_whiteTexture.descriptorSet = VK_NULL_HANDLE;
+
+	if (m_textureDescriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(m_device, m_textureDescriptorPool, NULL);
+		m_textureDescriptorPool = VK_NULL_HANDLE;
+	}
+}
+
+/***********************************************************
+ *  FindMemoryType()
+ *
+ *  This method is used for finding the first memory type
+ *  allowed by the type bits that has the properties.
+ ***********************************************************/
+int VulkanRenderer::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+	{
+		if (((typeBits & (1u << i)) != 0) &&
+			((m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+		{
+			return((int)i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  RunWorker()
+ *
+ *  This method is used for the loop of a worker thread.
+ *  Each time a frame is started the worker resets its own
+ *  pool and records the next batch until none are left,
+ *  then reports that it is done and sleeps until the next
+ *  frame or until it is stopped.
+ ***********************************************************/
+void VulkanRenderer::RunWorker(size_t index)
+{
+	WORKER& worker = m_workers[index];
+	uint64_t lastFrame = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_workLock);
+			m_workStart.wait(lock, [&]() { return((m_bStopWorkers == true) || (m_workFrame != lastFrame)); });
+			if (m_bStopWorkers == true)
+			{
+				return;
+			}
+			lastFrame = m_workFrame;
+		}
+
+		// the last frame was waited for, so its buffers are free
+		vkResetCommandPool(m_device, worker.pool, 0);
+		worker.nUsed = 0;
+
+		size_t batch = m_nextBatch.fetch_add(1);
+		while (batch < m_nBatches)
+		{
+			size_t firstObject = batch * m_objectsPerBatch;
+			m_batchBuffers[batch] = RecordBatch(worker, firstObject,
+				std::min((size_t)m_objectsPerBatch, m_objects.size() - firstObject));
+			batch = m_nextBatch.fetch_add(1);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_workLock);
+			m_nWorkersDone++;
+		}
+		m_workDone.notify_one();
+	}
+}
+
+/***********************************************************
+ *  RecordBatch()
+ *
+ *  This method is used for recording the draws of a range
+ *  of objects into the next secondary command buffer of the
+ *  worker.  Secondary buffers inherit nothing but the
+ *  render pass, so each batch binds the pipeline, the
+ *  descriptor sets and the mesh buffers itself.  The
+ *  texture set is only bound again when it changes.
+ ***********************************************************/
+VkCommandBuffer VulkanRenderer::RecordBatch(WORKER& worker, size_t firstObject, size_t nObjects)
+{
+	if (worker.nUsed == worker.buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = worker.pool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocateInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		if (vkAllocateCommandBuffers(m_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			return(VK_NULL_HANDLE);
+		}
+		worker.buffers.push_back(commandBuffer);
+	}
+	VkCommandBuffer commandBuffer = worker.buffers[worker.nUsed++];
+
+	VkCommandBufferInheritanceInfo inheritance = {};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = m_renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = m_framebuffer;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		return(VK_NULL_HANDLE);
+	}
+
+	VkViewport viewport = { 0.0f, 0.0f, (float)m_width, (float)m_height, 0.0f, 1.0f };
+	VkRect2D scissor = { { 0, 0 }, { m_width, m_height } };
+	VkDeviceSize vertexOffset = 0;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+		0, 1, &m_descriptorSet, 0, NULL);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer.buffer, &vertexOffset);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+	VkDescriptorSet boundTexture = VK_NULL_HANDLE;
+	for (size_t i = firstObject; i < firstObject + nObjects; i++)
+	{
+		const OBJECT& object = m_objects[i];
+		const MESH& mesh = m_meshes[object.mesh];
+
+		VkDescriptorSet textureSet = (object.texture < m_textures.size()) ?
+			m_textures[object.texture].descriptorSet : m_whiteTexture.descriptorSet;
+		if (textureSet != boundTexture)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+				1, 1, &textureSet, 0, NULL);
+			boundTexture = textureSet;
+		}
+
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(OBJECT_CONSTANTS), &object.constants);
+		vkCmdDrawIndexed(commandBuffer, mesh.nIndices, 1, mesh.firstIndex, mesh.vertexOffset, 0);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		return(VK_NULL_HANDLE);
+	}
+
+	return(commandBuffer);
+}
+
+/***********************************************************
+ *  SubmitAndWait()
+ *
+ *  This method is used for submitting a primary command
+ *  buffer and waiting for the device to finish it.
+ ***********************************************************/
+bool VulkanRenderer::SubmitAndWait(VkCommandBuffer commandBuffer)
+{
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	vkResetFences(m_device, 1, &m_fence);
+	VkResult result = vkQueueSubmit(m_queue, 1, &submitInfo, m_fence);
+	if (result == VK_SUCCESS)
+	{
+		result = vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+	}
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "VulkanRenderer: the frame failed, result " << result << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This method is used for reading the wall clock.
+ ***********************************************************/
+double VulkanRenderer::GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#endif
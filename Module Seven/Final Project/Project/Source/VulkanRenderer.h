@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////////
+// vulkanrenderer.h
+// ============
+// draws the scene with Vulkan into an offscreen target, with the draws
+// recorded on persistent worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifdef USE_VULKAN_BACKEND
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  VulkanRenderer
+ *
+ *  This class contains a Vulkan backend for the scene.  The
+ *  scene manager adds the meshes, textures, materials and
+ *  lights, and an object for each draw RenderScene()
+ *  issues, and the objects are drawn headless into an
+ *  offscreen color target that can be saved, so it runs
+ *  on a software device like Mesa lavapipe on machines
+ *  without a GPU.
+ *
+ *  The worker threads are started with the renderer and
+ *  each owns a command pool.  Each frame the objects are
+ *  split into batches, the workers are woken and take the
+ *  next batch until none are left, recording it into a
+ *  secondary command buffer of their pool.  The primary
+ *  command buffer only executes the batches in order.  The
+ *  descriptor set of the scene block is written once and
+ *  stays bound to a persistently mapped buffer, each
+ *  texture has a descriptor set of its own, the per-object
+ *  data is sent as push constants, and the pipeline is
+ *  built through a pipeline cache saved between runs.
+ ***********************************************************/
+class VulkanRenderer
+{
+public:
+	// size of the light and material arrays in the shaders
+	static const uint32_t MAX_LIGHTS = 4;
+	static const uint32_t MAX_MATERIALS = 16;
+	// handle of objects drawn without a texture or material
+	static const uint32_t NO_TEXTURE = 0xFFFFFFFF;
+	static const uint32_t NO_MATERIAL = 0xFFFFFFFF;
+
+	struct RENDERER_SETTINGS
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t nWorkers;          // Threads recording the draws, zero uses every core
+		uint32_t objectsPerBatch;   // Objects recorded into one secondary command buffer
+		bool bValidation;           // Enable the Khronos validation layer when installed
+		const char* pipelineCacheFile; // NULL keeps the pipeline cache in memory only
+	};
+
+	struct RENDER_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	struct RENDER_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// timing of the last frame
+	struct FRAME_STATS
+	{
+		double recordMs;        // Recording the batches on the workers
+		double submitMs;        // Submitting the frame and waiting for it
+		uint32_t nDrawCalls;
+		uint32_t nBatches;      // Secondary command buffers executed
+		uint32_t nWorkers;      // Threads that recorded the batches
+	};
+
+	// constructor
+	VulkanRenderer();
+	// destructor
+	~VulkanRenderer();
+
+	// create the device, the offscreen target and the
+	// pipeline, false when Vulkan is not usable
+	bool Create(const RENDERER_SETTINGS& settings);
+	// wait for the device, save the pipeline cache and free
+	// every Vulkan object
+	void Destroy();
+	bool IsCreated() const { return(m_device != VK_NULL_HANDLE); }
+	const std::string& GetDeviceName() const { return(m_deviceName); }
+
+	// methods for adding the scene, which is uploaded at once
+	// by UploadScene() - the mesh and texture data is copied
+	void AddLight(const RENDER_LIGHT& light);
+	uint32_t AddMaterial(const RENDER_MATERIAL& material);
+	uint32_t AddTexture(const unsigned char* pPixels, uint32_t width, uint32_t height);
+	uint32_t AddMesh(
+		const float* vertexData,
+		uint32_t floatsPerVertex,
+		uint32_t nVertices,
+		const std::vector<uint32_t>& triangles);
+	void AddObject(
+		uint32_t mesh,
+		const glm::mat4& model,
+		const glm::vec4& color,
+		uint32_t texture,
+		uint32_t material,
+		const glm::vec2& uvScale);
+	bool UploadScene();
+	void ClearScene();
+
+	// draw one frame of the scene with the GL style view and
+	// projection, waiting until it has finished
+	bool RenderFrame(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// save the last frame as a binary PPM image
+	bool SaveImage(const char* filename);
+
+	const FRAME_STATS& GetStats() const { return(m_stats); }
+
+private:
+	struct MESH
+	{
+		uint32_t firstIndex;
+		uint32_t nIndices;
+		int32_t vertexOffset;
+	};
+
+	// push constants of one object
+	struct OBJECT_CONSTANTS
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int32_t material;           // negative without a material
+		uint32_t bUseTexture;
+	};
+
+	struct OBJECT
+	{
+		uint32_t mesh;
+		uint32_t texture;
+		OBJECT_CONSTANTS constants;
+	};
+
+	// std140 layout of the scene block in the shaders
+	struct LIGHT_BLOCK
+	{
+		glm::vec4 position;         // w holds the specular intensity
+		glm::vec4 ambientColor;
+		glm::vec4 diffuseColor;
+		glm::vec4 specularColor;    // w holds the focal strength
+	};
+
+	struct MATERIAL_BLOCK
+	{
+		glm::vec4 ambientColor;     // w holds the ambient strength
+		glm::vec4 diffuseColor;
+		glm::vec4 specularColor;    // w holds the shininess
+	};
+
+	struct SCENE_BLOCK
+	{
+		glm::mat4 viewProjection;
+		glm::vec4 cameraPosition;
+		LIGHT_BLOCK lights[MAX_LIGHTS];
+		MATERIAL_BLOCK materials[MAX_MATERIALS];
+	};
+
+	struct BUFFER
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		void* pMapped;              // Host visible buffers stay mapped
+	};
+
+	struct IMAGE
+	{
+		VkImage image;
+		VkDeviceMemory memory;
+		VkImageView view;
+	};
+
+	// texel data of a texture until uploaded
+	struct TEXTURE_DATA
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<unsigned char> pixels;   // RGBA rows, first row at v = 0
+	};
+
+	struct TEXTURE
+	{
+		IMAGE image;
+		VkDescriptorSet descriptorSet;
+	};
+
+	// thread, command pool and secondary buffers of one
+	// worker, only that worker records with them
+	struct WORKER
+	{
+		std::thread thread;
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> buffers;
+		size_t nUsed;
+	};
+
+	// called to create the parts of the renderer in order
+	bool CreateInstance(bool bValidation);
+	bool CreateDevice();
+	bool CreateTargets();
+	bool CreatePipeline(const char* pipelineCacheFile);
+	bool CreateCommands(uint32_t nWorkers);
+	// called to wake the workers and wait until they have
+	// stopped, before their pools are freed
+	void StopWorkers();
+
+	// called to load and save the pipeline cache, data from
+	// another device or driver is ignored
+	void LoadPipelineCache(const char* filename);
+	void SavePipelineCache();
+	VkShaderModule LoadShaderModule(const char* filename);
+
+	bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, BUFFER& buffer);
+	void DestroyBuffer(BUFFER& buffer);
+	bool CreateImage(
+		uint32_t width,
+		uint32_t height,
+		VkFormat format,
+		VkImageUsageFlags usage,
+		VkImageAspectFlags aspect,
+		IMAGE& image);
+	void DestroyImage(IMAGE& image);
+	// called to copy texel data into a new sampled image and
+	// write its descriptor set
+	bool UploadTexture(const TEXTURE_DATA& data, TEXTURE& texture);
+	void DestroyTextures();
+	// called to find a memory type, -1 when there is none
+	int FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+
+	// called on each worker thread to record the batches of
+	// every frame until the workers are stopped
+	void RunWorker(size_t index);
+	// called on a worker to record one batch of objects into
+	// a secondary command buffer of its pool
+	VkCommandBuffer RecordBatch(WORKER& worker, size_t firstObject, size_t nObjects);
+	// called to run a one time command buffer and wait for it
+	bool SubmitAndWait(VkCommandBuffer commandBuffer);
+
+	static double GetTimeMs();
+
+	VkInstance m_instance;
+	VkPhysicalDevice m_physicalDevice;
+	VkPhysicalDeviceProperties m_deviceProperties;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDevice m_device;
+	uint32_t m_queueFamily;
+	VkQueue m_queue;
+	std::string m_deviceName;
+
+	// offscreen target and its read back buffer
+	uint32_t m_width;
+	uint32_t m_height;
+	VkFormat m_depthFormat;
+	IMAGE m_colorImage;
+	IMAGE m_depthImage;
+	BUFFER m_readbackBuffer;
+	VkRenderPass m_renderPass;
+	VkFramebuffer m_framebuffer;
+
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+	VkDescriptorSet m_descriptorSet;
+	// the texture sets, from a pool made for the uploaded
+	// textures
+	VkDescriptorSetLayout m_textureSetLayout;
+	VkDescriptorPool m_textureDescriptorPool;
+	VkSampler m_sampler;
+	VkPipelineLayout m_pipelineLayout;
+	VkPipelineCache m_pipelineCache;
+	std::string m_pipelineCacheFile;
+	VkPipeline m_pipeline;
+
+	// primary command buffer, its pool and the frame fence
+	VkCommandPool m_commandPool;
+	VkCommandBuffer m_commandBuffer;
+	VkFence m_fence;
+	std::vector<WORKER> m_workers;
+	uint32_t m_objectsPerBatch;
+	// secondary buffer of each batch of the current frame
+	std::vector<VkCommandBuffer> m_batchBuffers;
+	size_t m_nBatches;
+	std::atomic<size_t> m_nextBatch;
+	// the frame the workers are woken for, and how many of
+	// them have finished it
+	std::mutex m_workLock;
+	std::condition_variable m_workStart;
+	std::condition_variable m_workDone;
+	uint64_t m_workFrame;
+	size_t m_nWorkersDone;
+	bool m_bStopWorkers;
+
+	// scene on the CPU until uploaded, the vertices keep the
+	// position, normal and texture coordinates
+	std::vector<float> m_vertices;
+	std::vector<uint32_t> m_indices;
+	std::vector<MESH> m_meshes;
+	std::vector<OBJECT> m_objects;
+	std::vector<RENDER_LIGHT> m_lights;
+	std::vector<RENDER_MATERIAL> m_materials;
+	std::vector<TEXTURE_DATA> m_textureData;
+
+	BUFFER m_vertexBuffer;
+	BUFFER m_indexBuffer;
+	BUFFER m_sceneBuffer;
+	// the uploaded textures, and the white one drawn by the
+	// objects without a texture
+	std::vector<TEXTURE> m_textures;
+	TEXTURE m_whiteTexture;
+
+	FRAME_STATS m_stats;
+};
+
+#endif
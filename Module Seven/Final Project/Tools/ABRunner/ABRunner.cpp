@@ -0,0 +1,478 @@
+///////////////////////////////////////////////////////////////////////////////
+// ABRunner.cpp
+// ============
+// A/B performance comparison of two builds or two runtime configurations,
+// which alternates the two commands many times on pinned CPUs and reports
+// the change of each profiled phase with a bootstrap confidence interval
+//
+// the commands are run through /bin/sh and should render the same scene and
+// camera path with the profiler on, such as "./FinalProject --benchmark-frames
+// 200", so the PROFILER table they print can be read
+//
+// usage: ABRunner --a "<command>" --b "<command>" [--runs N] [--warmup N]
+//                 [--cpus 2,3] [--threshold PERCENT] [--min-ms MS]
+//                 [--resamples N] [--seed N]
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Namespace for declaring global variables
+namespace
+{
+	const int DEFAULT_RUNS = 20;
+	const int DEFAULT_WARMUP = 2;
+	const double DEFAULT_THRESHOLD = 5.0;
+	const double DEFAULT_MIN_MS = 0.1;
+	const int DEFAULT_RESAMPLES = 2000;
+	// the two sided confidence of the reported intervals
+	const double CONFIDENCE = 0.95;
+	// phase holding the wall time of the whole process
+	const char* const PROCESS_PHASE = "(process)";
+
+	const char* const USAGE =
+		"usage: ABRunner --a \"<command>\" --b \"<command>\" [--runs N] [--warmup N]\n"
+		"                [--cpus 2,3] [--threshold PERCENT] [--min-ms MS]\n"
+		"                [--resamples N] [--seed N]";
+
+	// the measured runs of one phase, in milliseconds
+	struct PHASE_SAMPLES
+	{
+		std::vector<double> a;
+		std::vector<double> b;
+	};
+
+	// the command line settings
+	std::string g_Commands[2];
+	int g_Runs = DEFAULT_RUNS;
+	int g_Warmup = DEFAULT_WARMUP;
+	std::vector<int> g_Cpus;
+	double g_Threshold = DEFAULT_THRESHOLD;
+	double g_MinMs = DEFAULT_MIN_MS;
+	int g_Resamples = DEFAULT_RESAMPLES;
+	unsigned int g_Seed = 1;
+}
+
+// Function declarations
+bool ParseCpuList(const char* text);
+bool RunCommand(const std::string& command, std::string& output, double& wallMs);
+bool ReadProfile(const std::string& output, std::map<std::string, double>& phases);
+double GetMean(const std::vector<double>& values);
+double GetDelta(const std::vector<double>& a, const std::vector<double>& b);
+void BootstrapDelta(
+	const std::vector<double>& a,
+	const std::vector<double>& b,
+	std::mt19937& random,
+	double& low,
+	double& high);
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--a") == 0) && (i + 1 < argc))
+		{
+			g_Commands[0] = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--b") == 0) && (i + 1 < argc))
+		{
+			g_Commands[1] = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--runs") == 0) && (i + 1 < argc))
+		{
+			g_Runs = std::max(2, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--warmup") == 0) && (i + 1 < argc))
+		{
+			g_Warmup = std::max(0, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--cpus") == 0) && (i + 1 < argc))
+		{
+			if (ParseCpuList(argv[++i]) == false)
+			{
+				std::cout << "ERROR: Cannot read the CPU list " << argv[i] << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		else if ((strcmp(argv[i], "--threshold") == 0) && (i + 1 < argc))
+		{
+			g_Threshold = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--min-ms") == 0) && (i + 1 < argc))
+		{
+			g_MinMs = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--resamples") == 0) && (i + 1 < argc))
+		{
+			g_Resamples = std::max(100, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc))
+		{
+			g_Seed = (unsigned int)atoi(argv[++i]);
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown option " << argv[i] << std::endl;
+		}
+	}
+
+	if ((g_Commands[0].empty() == true) || (g_Commands[1].empty() == true))
+	{
+		std::cout << USAGE << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+#ifndef __linux__
+	std::cout << "ERROR: ABRunner needs Linux for pinning the CPUs" << std::endl;
+	return(EXIT_FAILURE);
+#endif
+
+	std::map<std::string, PHASE_SAMPLES> phases;
+	int nRuns = g_Warmup + g_Runs;
+
+	// the commands run in ABBA order, so a slow drift of the
+	// host affects both of them the same
+	for (int run = 0; run < nRuns; run++)
+	{
+		bool bWarmup = (run < g_Warmup);
+		std::cout << "run " << run + 1 << "/" << nRuns << (bWarmup ? " (warm up)" : "") << ":";
+
+		for (int step = 0; step < 2; step++)
+		{
+			int side = ((run % 2) == 0) ? step : 1 - step;
+			std::string output;
+			double wallMs = 0.0;
+
+			if (RunCommand(g_Commands[side], output, wallMs) == false)
+			{
+				std::cout << std::endl << "ERROR: Command " << (char)('A' + side) << " failed: " << g_Commands[side] << std::endl;
+				return(EXIT_FAILURE);
+			}
+
+			std::map<std::string, double> profile;
+			if (ReadProfile(output, profile) == false)
+			{
+				std::cout << std::endl << "WARNING: Command " << (char)('A' + side) << " printed no PROFILER table, only the process time is compared" << std::endl;
+			}
+			profile[PROCESS_PHASE] = wallMs;
+
+			std::cout << " " << (char)('A' + side) << " " << wallMs << " ms";
+			if (bWarmup == true)
+			{
+				continue;
+			}
+
+			for (auto it = profile.begin(); it != profile.end(); ++it)
+			{
+				PHASE_SAMPLES& samples = phases[it->first];
+				((side == 0) ? samples.a : samples.b).push_back(it->second);
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	// phases are listed by their time in A, largest first
+	std::vector<std::pair<double, std::string>> order;
+	for (auto it = phases.begin(); it != phases.end(); ++it)
+	{
+		if ((it->second.a.size() == (size_t)g_Runs) && (it->second.b.size() == (size_t)g_Runs))
+		{
+			order.push_back(std::make_pair(GetMean(it->second.a), it->first));
+		}
+	}
+	std::sort(order.rbegin(), order.rend());
+
+	std::mt19937 random(g_Seed);
+	bool bRegression = false;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%-32s %12s %12s %9s %20s  %s",
+		"phase", "A mean ms", "B mean ms", "delta", "95% interval", "verdict");
+	std::cout << std::endl << "A: " << g_Commands[0] << std::endl << "B: " << g_Commands[1] << std::endl
+		<< g_Runs << " runs each, regression threshold " << g_Threshold << "%" << std::endl << line << std::endl;
+
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const PHASE_SAMPLES& samples = phases[order[i].second];
+		double meanA = GetMean(samples.a);
+		double meanB = GetMean(samples.b);
+		double delta = GetDelta(samples.a, samples.b);
+		double low = 0.0;
+		double high = 0.0;
+		BootstrapDelta(samples.a, samples.b, random, low, high);
+
+		// a phase regressed when even the low end of the
+		// interval is slower than the threshold
+		const char* verdict = "same";
+		if (std::max(meanA, meanB) < g_MinMs)
+		{
+			verdict = "too short";
+		}
+		else if (low > g_Threshold)
+		{
+			verdict = "REGRESSION";
+			bRegression = true;
+		}
+		else if (low > 0.0)
+		{
+			verdict = "slower";
+		}
+		else if (high < 0.0)
+		{
+			verdict = "faster";
+		}
+
+		char interval[64];
+		snprintf(interval, sizeof(interval), "[%+.2f%%, %+.2f%%]", low, high);
+		snprintf(line, sizeof(line), "%-32s %12.3f %12.3f %+8.2f%% %20s  %s",
+			order[i].second.c_str(), meanA, meanB, delta, interval, verdict);
+		std::cout << line << std::endl;
+	}
+
+	std::cout << (bRegression ? "FAIL" : "PASS") << std::endl;
+
+	return((bRegression == true) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  ParseCpuList()
+ *
+ *  This function is used to read a comma separated list of
+ *  CPU numbers.
+ ***********************************************************/
+bool ParseCpuList(const char* text)
+{
+	std::stringstream stream(text);
+	std::string item;
+
+	g_Cpus.clear();
+	while (std::getline(stream, item, ','))
+	{
+		char* pEnd = NULL;
+		long cpu = strtol(item.c_str(), &pEnd, 10);
+		if ((pEnd == item.c_str()) || (*pEnd != '\0') || (cpu < 0))
+		{
+			return(false);
+		}
+		g_Cpus.push_back((int)cpu);
+	}
+
+	return(g_Cpus.empty() == false);
+}
+
+/***********************************************************
+ *  RunCommand()
+ *
+ *  This function is used to run a command through the
+ *  shell on the pinned CPUs, collecting what it prints and
+ *  its wall time.  Fails when the command does not exit
+ *  with success.
+ ***********************************************************/
+bool RunCommand(const std::string& command, std::string& output, double& wallMs)
+{
+#ifdef __linux__
+	int pipeFds[2];
+	if (pipe(pipeFds) != 0)
+	{
+		return(false);
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	pid_t child = fork();
+	if (child < 0)
+	{
+		close(pipeFds[0]);
+		close(pipeFds[1]);
+		return(false);
+	}
+
+	if (child == 0)
+	{
+		// the pinning is inherited by the command and every
+		// thread it starts
+		if (g_Cpus.empty() == false)
+		{
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			for (size_t i = 0; i < g_Cpus.size(); i++)
+			{
+				CPU_SET(g_Cpus[i], &cpus);
+			}
+			if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+			{
+				_exit(127);
+			}
+		}
+
+		dup2(pipeFds[1], STDOUT_FILENO);
+		close(pipeFds[0]);
+		close(pipeFds[1]);
+		execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+		_exit(127);
+	}
+
+	close(pipeFds[1]);
+	output.clear();
+
+	char buffer[4096];
+	ssize_t nRead = 0;
+	while ((nRead = read(pipeFds[0], buffer, sizeof(buffer))) > 0)
+	{
+		output.append(buffer, (size_t)nRead);
+	}
+	close(pipeFds[0]);
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	return((WIFEXITED(status) != 0) && (WEXITSTATUS(status) == 0));
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  ReadProfile()
+ *
+ *  This function is used to read the total milliseconds of
+ *  each region from the PROFILER table in the output.
+ ***********************************************************/
+bool ReadProfile(const std::string& output, std::map<std::string, double>& phases)
+{
+	std::stringstream stream(output);
+	std::string line;
+	bool bTable = false;
+	bool bHeader = false;
+
+	while (std::getline(stream, line))
+	{
+		if (line.compare(0, 8, "PROFILER") == 0)
+		{
+			bTable = true;
+			bHeader = true;
+			continue;
+		}
+		if (bTable == false)
+		{
+			continue;
+		}
+		// the column titles follow the PROFILER line
+		if (bHeader == true)
+		{
+			bHeader = false;
+			continue;
+		}
+
+		char name[64];
+		unsigned long long calls = 0;
+		double totalMs = 0.0;
+		if (sscanf(line.c_str(), "%63s %llu %lf", name, &calls, &totalMs) != 3)
+		{
+			break;
+		}
+		phases[name] = totalMs;
+	}
+
+	return(bTable);
+}
+
+/***********************************************************
+ *  GetMean()
+ *
+ *  This function is used to get the mean of the samples.
+ ***********************************************************/
+double GetMean(const std::vector<double>& values)
+{
+	if (values.empty() == true)
+	{
+		return(0.0);
+	}
+
+	double total = 0.0;
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		total += values[i];
+	}
+	return(total / values.size());
+}
+
+/***********************************************************
+ *  GetDelta()
+ *
+ *  This function is used to get the change from A to B in
+ *  percent of A, positive when B is slower.
+ ***********************************************************/
+double GetDelta(const std::vector<double>& a, const std::vector<double>& b)
+{
+	double meanA = GetMean(a);
+	if (meanA <= 0.0)
+	{
+		return(0.0);
+	}
+	return((GetMean(b) / meanA - 1.0) * 100.0);
+}
+
+/***********************************************************
+ *  BootstrapDelta()
+ *
+ *  This function is used to get the confidence interval of
+ *  the change from A to B.  Both sample sets are redrawn
+ *  with replacement many times, and the interval is taken
+ *  from the percentiles of the redrawn changes.
+ ***********************************************************/
+void BootstrapDelta(
+	const std::vector<double>& a,
+	const std::vector<double>& b,
+	std::mt19937& random,
+	double& low,
+	double& high)
+{
+	std::uniform_int_distribution<size_t> pickA(0, a.size() - 1);
+	std::uniform_int_distribution<size_t> pickB(0, b.size() - 1);
+	std::vector<double> deltas;
+	std::vector<double> resampleA(a.size());
+	std::vector<double> resampleB(b.size());
+
+	deltas.reserve(g_Resamples);
+	for (int r = 0; r < g_Resamples; r++)
+	{
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			resampleA[i] = a[pickA(random)];
+		}
+		for (size_t i = 0; i < b.size(); i++)
+		{
+			resampleB[i] = b[pickB(random)];
+		}
+		deltas.push_back(GetDelta(resampleA, resampleB));
+	}
+	std::sort(deltas.begin(), deltas.end());
+
+	double tail = (1.0 - CONFIDENCE) * 0.5;
+	low = deltas[(size_t)(tail * (deltas.size() - 1))];
+	high = deltas[(size_t)((1.0 - tail) * (deltas.size() - 1))];
+}
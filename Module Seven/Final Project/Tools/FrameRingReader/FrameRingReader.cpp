@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameRingReader.cpp
+// ============
+// example consumer of the renderer's shared memory frame ring, which reads
+// the frames in place as they are published and reports the delivery
+// latency and the frames it lost
+//
+// the renderer is started with "./FinalProject --frame-ring NAME", in either
+// order, as the reader waits for the ring to appear.  Sleeping is a futex
+// wait on the ring's write index, the pixels are checksummed where the
+// renderer wrote them, and written out as PPM files when a prefix is passed
+// with --save
+//
+// usage: FrameRingReader --ring NAME [--frames N] [--timeout-ms MS]
+//                        [--work-ms MS] [--save PREFIX]
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+
+#include "SharedFrameRingFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Namespace for declaring global variables
+namespace
+{
+	const int DEFAULT_TIMEOUT_MS = 10000;
+	// retry period while the ring does not exist yet
+	const int OPEN_RETRY_MS = 50;
+	// longest futex sleep, so a closed ring is noticed even
+	// when the wake up was missed
+	const int WAIT_SLICE_MS = 100;
+
+	const char* const USAGE =
+		"usage: FrameRingReader --ring NAME [--frames N] [--timeout-ms MS]\n"
+		"                       [--work-ms MS] [--save PREFIX]";
+
+	// the command line settings
+	const char* g_RingName = NULL;
+	int g_Frames = 0;
+	int g_TimeoutMs = DEFAULT_TIMEOUT_MS;
+	double g_WorkMs = 0.0;
+	const char* g_SavePrefix = NULL;
+
+	// the mapped ring and the entry of this consumer
+	unsigned char* g_pMemory = NULL;
+	size_t g_Bytes = 0;
+	FRAME_RING_HEADER* g_pHeader = NULL;
+	int g_Consumer = -1;
+}
+
+// Function declarations
+bool OpenRing(const char* name, int timeoutMs);
+void CloseRing();
+bool WaitForFrame(uint32_t readIndex, int timeoutMs);
+bool SaveFrame(const FRAME_RING_SLOT& slot, const unsigned char* pImage, const char* filename);
+double GetPercentile(const std::vector<double>& sorted, double fraction);
+double GetTimeMs();
+uint64_t GetMonotonicNs();
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--ring") == 0) && (i + 1 < argc))
+		{
+			g_RingName = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc))
+		{
+			g_Frames = std::max(0, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--timeout-ms") == 0) && (i + 1 < argc))
+		{
+			g_TimeoutMs = std::max(0, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--work-ms") == 0) && (i + 1 < argc))
+		{
+			g_WorkMs = std::max(0.0, atof(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--save") == 0) && (i + 1 < argc))
+		{
+			g_SavePrefix = argv[++i];
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown option " << argv[i] << std::endl;
+		}
+	}
+
+	if (NULL == g_RingName)
+	{
+		std::cout << USAGE << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+#ifndef __linux__
+	std::cout << "ERROR: FrameRingReader needs Linux for the shared memory and futexes" << std::endl;
+	return(EXIT_FAILURE);
+#else
+	if (OpenRing(g_RingName, g_TimeoutMs) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	FRAME_RING_SLOT* pSlots = (FRAME_RING_SLOT*)(g_pMemory + g_pHeader->slotsOffset);
+	uint32_t nSlots = g_pHeader->nSlots;
+
+	std::vector<double> latencies;
+	uint32_t nRead = 0;
+	uint32_t nDropped = 0;
+	uint32_t nTorn = 0;
+	uint64_t checksum = 0;
+	uint64_t lastFrameID = 0;
+
+	// start with the newest frame, the older ones are
+	// already stale
+	uint32_t readIndex = __atomic_load_n(&g_pHeader->writeIndex, __ATOMIC_ACQUIRE);
+	if (readIndex > 0)
+	{
+		readIndex--;
+	}
+
+	double startMs = GetTimeMs();
+	while ((g_Frames == 0) || (nRead < (uint32_t)g_Frames))
+	{
+		__atomic_store_n(&g_pHeader->consumers[g_Consumer].readIndex, readIndex, __ATOMIC_RELEASE);
+		if (WaitForFrame(readIndex, g_TimeoutMs) == false)
+		{
+			break;
+		}
+
+		// a consumer more than a ring behind has lost the
+		// frames in between, it goes on with the oldest left
+		uint32_t writeIndex = __atomic_load_n(&g_pHeader->writeIndex, __ATOMIC_ACQUIRE);
+		if (writeIndex - readIndex > nSlots)
+		{
+			nDropped += writeIndex - readIndex - nSlots;
+			readIndex = writeIndex - nSlots;
+		}
+
+		FRAME_RING_SLOT& slot = pSlots[readIndex % nSlots];
+		const unsigned char* pImage = g_pMemory + g_pHeader->imagesOffset + (size_t)(readIndex % nSlots) * g_pHeader->imageBytes;
+
+		uint32_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+		if (((sequence & 1) != 0) || (slot.frameIndex != readIndex))
+		{
+			// overwritten since the write index was read
+			nDropped++;
+			readIndex++;
+			continue;
+		}
+
+		// the frame is used where it lies, the seqlock below
+		// tells whether the producer came round meanwhile
+		uint64_t frameChecksum = 0;
+		size_t rowBytes = (size_t)slot.width * 4;
+		for (uint32_t y = 0; y < slot.height; y++)
+		{
+			const unsigned char* pRow = pImage + (size_t)y * slot.stride;
+			for (size_t b = 0; b < rowBytes; b += 64)
+			{
+				frameChecksum += pRow[b];
+			}
+		}
+		double latencyMs = (GetMonotonicNs() - slot.timestampNs) / 1.0e6;
+		uint64_t frameID = slot.frameID;
+
+		if (NULL != g_SavePrefix)
+		{
+			std::string filename = std::string(g_SavePrefix) + "_" + std::to_string(frameID) + ".ppm";
+			SaveFrame(slot, pImage, filename.c_str());
+		}
+		if (g_WorkMs > 0.0)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(g_WorkMs));
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) != sequence)
+		{
+			nTorn++;
+			readIndex++;
+			continue;
+		}
+
+		if ((nRead > 0) && (frameID <= lastFrameID))
+		{
+			std::cout << "WARNING: Frame " << frameID << " arrived after frame " << lastFrameID << std::endl;
+		}
+		lastFrameID = frameID;
+		checksum += frameChecksum;
+		latencies.push_back(latencyMs);
+		nRead++;
+		readIndex++;
+	}
+	double seconds = (GetTimeMs() - startMs) / 1000.0;
+
+	CloseRing();
+
+	std::sort(latencies.begin(), latencies.end());
+	double totalMs = 0.0;
+	for (size_t i = 0; i < latencies.size(); i++)
+	{
+		totalMs += latencies[i];
+	}
+
+	std::cout << "FRAME_RING_READER frames=" << nRead
+		<< " dropped=" << nDropped
+		<< " torn=" << nTorn
+		<< " seconds=" << seconds
+		<< " frames_per_second=" << ((seconds > 0.0) ? nRead / seconds : 0.0)
+		<< " average_latency_ms=" << ((latencies.empty() == false) ? totalMs / latencies.size() : 0.0)
+		<< " p95_latency_ms=" << GetPercentile(latencies, 0.95)
+		<< " checksum=" << checksum << std::endl;
+
+	return(((nRead > 0) && ((g_Frames == 0) || (nRead >= (uint32_t)g_Frames))) ? EXIT_SUCCESS : EXIT_FAILURE);
+#endif
+}
+
+/***********************************************************
+ *  OpenRing()
+ *
+ *  This function is used to map the ring, waiting up to
+ *  the passed in time for the renderer to create it, and
+ *  claim a consumer entry in it.
+ ***********************************************************/
+bool OpenRing(const char* name, int timeoutMs)
+{
+#ifdef __linux__
+	double deadlineMs = GetTimeMs() + timeoutMs;
+	int file = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+	while ((file < 0) && (errno == ENOENT) && (GetTimeMs() < deadlineMs))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(OPEN_RETRY_MS));
+		file = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+	}
+	if (file < 0)
+	{
+		std::cout << "ERROR: Cannot open the ring " << name << ", " << strerror(errno) << std::endl;
+		return(false);
+	}
+
+	// the renderer sizes the memory before it writes the
+	// magic, so both are waited for
+	struct stat status;
+	FRAME_RING_HEADER* pHeader = NULL;
+	while (pHeader == NULL)
+	{
+		if ((fstat(file, &status) == 0) && ((size_t)status.st_size >= sizeof(FRAME_RING_HEADER)))
+		{
+			void* pMemory = mmap(NULL, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			if (pMemory != MAP_FAILED)
+			{
+				pHeader = (FRAME_RING_HEADER*)pMemory;
+				if (__atomic_load_n(&pHeader->magic, __ATOMIC_ACQUIRE) != FRAME_RING_MAGIC)
+				{
+					munmap(pMemory, (size_t)status.st_size);
+					pHeader = NULL;
+				}
+			}
+		}
+		if ((pHeader == NULL) && (GetTimeMs() >= deadlineMs))
+		{
+			std::cout << "ERROR: The ring " << name << " was never set up" << std::endl;
+			close(file);
+			return(false);
+		}
+		if (pHeader == NULL)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(OPEN_RETRY_MS));
+		}
+	}
+	close(file);
+
+	g_pMemory = (unsigned char*)pHeader;
+	g_Bytes = (size_t)status.st_size;
+	g_pHeader = pHeader;
+	if ((pHeader->version != FRAME_RING_VERSION) || (pHeader->totalBytes > g_Bytes) ||
+		(pHeader->nSlots == 0) || (pHeader->nSlots > FRAME_RING_MAX_SLOTS))
+	{
+		std::cout << "ERROR: The ring " << name << " has a layout this reader does not know" << std::endl;
+		CloseRing();
+		return(false);
+	}
+
+	uint32_t pid = (uint32_t)getpid();
+	for (uint32_t i = 0; (i < FRAME_RING_MAX_CONSUMERS) && (g_Consumer < 0); i++)
+	{
+		uint32_t expected = 0;
+		if (__atomic_compare_exchange_n(&pHeader->consumers[i].pid, &expected, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == true)
+		{
+			__atomic_store_n(&pHeader->consumers[i].readIndex, __atomic_load_n(&pHeader->writeIndex, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+			g_Consumer = (int)i;
+		}
+	}
+	if (g_Consumer < 0)
+	{
+		std::cout << "ERROR: The ring " << name << " already has " << FRAME_RING_MAX_CONSUMERS << " consumers" << std::endl;
+		CloseRing();
+		return(false);
+	}
+
+	std::cout << "INFO: Reading " << pHeader->maxWidth << "x" << pHeader->maxHeight
+		<< " frames from " << name << ", " << pHeader->nSlots << " slots" << std::endl;
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  CloseRing()
+ *
+ *  This function is used to give back the consumer entry
+ *  and unmap the ring.
+ ***********************************************************/
+void CloseRing()
+{
+#ifdef __linux__
+	if ((NULL != g_pHeader) && (g_Consumer >= 0))
+	{
+		__atomic_store_n(&g_pHeader->consumers[g_Consumer].pid, 0u, __ATOMIC_RELEASE);
+		g_Consumer = -1;
+	}
+	if (NULL != g_pMemory)
+	{
+		munmap(g_pMemory, g_Bytes);
+		g_pMemory = NULL;
+		g_pHeader = NULL;
+		g_Bytes = 0;
+	}
+#endif
+}
+
+/***********************************************************
+ *  WaitForFrame()
+ *
+ *  This function is used to sleep on the write index until
+ *  the frame with the passed in index is published,
+ *  returning false when the ring is closed or nothing
+ *  arrives in the passed in time.  The reader counts
+ *  itself in nWaiters before it checks the index again, so
+ *  the renderer, which only wakes the futex when someone
+ *  waits, cannot publish in between unnoticed.
+ ***********************************************************/
+bool WaitForFrame(uint32_t readIndex, int timeoutMs)
+{
+#ifdef __linux__
+	double deadlineMs = GetTimeMs() + timeoutMs;
+	while (true)
+	{
+		uint32_t writeIndex = __atomic_load_n(&g_pHeader->writeIndex, __ATOMIC_ACQUIRE);
+		if (writeIndex != readIndex)
+		{
+			return(true);
+		}
+		if (__atomic_load_n(&g_pHeader->bClosed, __ATOMIC_ACQUIRE) != 0)
+		{
+			return(false);
+		}
+		if (GetTimeMs() >= deadlineMs)
+		{
+			std::cout << "WARNING: No frame arrived in " << timeoutMs << " ms" << std::endl;
+			return(false);
+		}
+
+		struct timespec slice;
+		slice.tv_sec = 0;
+		slice.tv_nsec = (long)WAIT_SLICE_MS * 1000000L;
+
+		__atomic_add_fetch(&g_pHeader->nWaiters, 1u, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&g_pHeader->writeIndex, __ATOMIC_SEQ_CST) == readIndex)
+		{
+			syscall(SYS_futex, &g_pHeader->writeIndex, FUTEX_WAIT, readIndex, &slice, NULL, 0);
+		}
+		__atomic_sub_fetch(&g_pHeader->nWaiters, 1u, __ATOMIC_SEQ_CST);
+	}
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  SaveFrame()
+ *
+ *  This function is used to write a frame as a PPM file.
+ *  The rows are in the ring bottom up, PPM stores them top
+ *  down.
+ ***********************************************************/
+bool SaveFrame(const FRAME_RING_SLOT& slot, const unsigned char* pImage, const char* filename)
+{
+	FILE* file = fopen(filename, "wb");
+	if (NULL == file)
+	{
+		std::cout << "ERROR: Cannot write " << filename << std::endl;
+		return(false);
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", slot.width, slot.height);
+	std::vector<unsigned char> row((size_t)slot.width * 3);
+	for (int y = (int)slot.height - 1; y >= 0; y--)
+	{
+		const unsigned char* pRow = pImage + (size_t)y * slot.stride;
+		for (uint32_t x = 0; x < slot.width; x++)
+		{
+			row[x * 3 + 0] = pRow[x * 4 + 0];
+			row[x * 3 + 1] = pRow[x * 4 + 1];
+			row[x * 3 + 2] = pRow[x * 4 + 2];
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPercentile()
+ *
+ *  This function is used to get a percentile of sorted
+ *  values, the nearest rank.
+ ***********************************************************/
+double GetPercentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty() == true)
+	{
+		return(0.0);
+	}
+
+	size_t rank = (size_t)ceil(fraction * sorted.size());
+	return(sorted[std::min(sorted.size(), std::max((size_t)1, rank)) - 1]);
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This function is used to read the wall clock.
+ ***********************************************************/
+double GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/***********************************************************
+ *  GetMonotonicNs()
+ *
+ *  This function is used to read the clock the renderer
+ *  stamps the frames with.
+ ***********************************************************/
+uint64_t GetMonotonicNs()
+{
+#ifdef __linux__
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec);
+#else
+	return(0);
+#endif
+}
@@ -0,0 +1,1501 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLReplay.cpp
+// ============
+// offline replay of a frame saved with the GL capture (--gl-capture), which
+// re-issues every call in a hidden window and times each one on the GPU
+//
+// build with the 3DShapes folder on the include path and link GLFW and GLEW
+//
+// usage: GLReplay <capture.glcap> [--repeat N] [--top N] [--csv <file>]
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+#include "GLCaptureFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Namespace for declaring global variables
+namespace
+{
+	const int DEFAULT_REPEAT = 5;
+	const int DEFAULT_TOP = 20;
+
+	// one frame call and where its payload is
+	struct REPLAY_CALL
+	{
+		uint32_t command;
+		size_t offset;
+		uint32_t size;
+		GLuint program;         // Captured program bound at the call
+		GLuint vertexArray;     // Captured vertex array bound at the call
+		std::string details;
+		std::vector<double> gpuMs;
+		std::vector<double> cpuMs;
+	};
+
+	// the whole capture file
+	GLCAPTURE_HEADER g_Header;
+	std::vector<unsigned char> g_Data;
+
+	// offsets of the snapshot records that are re-applied
+	// before every repetition
+	std::vector<size_t> g_ProgramRecords;
+	size_t g_StateRecord = 0;
+
+	// captured names to replay names, per object type
+	std::unordered_map<GLuint, GLuint> g_Names[MAX_GLC_OBJECTS];
+	// captured program and uniform location to replay location
+	std::map<std::pair<GLuint, GLint>, GLint> g_UniformLocations;
+	std::map<std::pair<GLuint, GLint>, std::string> g_UniformNames;
+	// the captured program the replayed calls are using
+	GLuint g_CurrentProgram = 0;
+	GLuint g_CurrentVertexArray = 0;
+
+	// scratch memory for replayed read backs
+	std::vector<unsigned char> g_ReadPixels;
+}
+
+// Function declarations
+bool LoadCapture(const char* filename);
+bool CreateSnapshotObjects(std::vector<REPLAY_CALL>& calls);
+void ApplyProgramUniforms(GLCaptureReader& reader, bool bCreate);
+void ApplyDrawState();
+void ReplayCall(const REPLAY_CALL& call, bool bFinalPass);
+std::string DescribeCall(const REPLAY_CALL& call);
+const char* GetCommandName(uint32_t command);
+GLuint MapName(GLCAPTURE_OBJECT type, GLuint name);
+void ReadNames(GLCaptureReader& reader, std::vector<GLuint>& names);
+double GetMedian(std::vector<double> values);
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	const char* captureFile = NULL;
+	const char* csvFile = NULL;
+	int repeat = DEFAULT_REPEAT;
+	int top = DEFAULT_TOP;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--repeat") == 0) && (i + 1 < argc))
+		{
+			repeat = std::max(1, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--top") == 0) && (i + 1 < argc))
+		{
+			top = std::max(1, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--csv") == 0) && (i + 1 < argc))
+		{
+			csvFile = argv[++i];
+		}
+		else if (NULL == captureFile)
+		{
+			captureFile = argv[i];
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown option " << argv[i] << std::endl;
+		}
+	}
+
+	if (NULL == captureFile)
+	{
+		std::cout << "usage: GLReplay <capture.glcap> [--repeat N] [--top N] [--csv <file>]" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if (LoadCapture(captureFile) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// replay in a hidden window the size of the captured one
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(
+		std::max<uint32_t>(1, g_Header.width),
+		std::max<uint32_t>(1, g_Header.height),
+		"GLReplay", NULL, NULL);
+	if (NULL == window)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	GLenum GLEWInitResult = glewInit();
+	if (GLEW_OK != GLEWInitResult)
+	{
+		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
+	std::vector<REPLAY_CALL> calls;
+	if (CreateSnapshotObjects(calls) == false)
+	{
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
+	// two timestamps around every call
+	std::vector<GLuint> queries(calls.size() * 2);
+	glGenQueries((GLsizei)queries.size(), queries.data());
+
+	std::vector<double> frameGpuMs;
+	std::vector<double> frameCpuMs;
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		ApplyDrawState();
+		glFinish();
+
+		auto frameStart = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls.size(); i++)
+		{
+			glQueryCounter(queries[i * 2], GL_TIMESTAMP);
+			auto callStart = std::chrono::steady_clock::now();
+			ReplayCall(calls[i], pass == repeat - 1);
+			std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - callStart;
+			glQueryCounter(queries[i * 2 + 1], GL_TIMESTAMP);
+			calls[i].cpuMs.push_back(cpuTime.count());
+		}
+		std::chrono::duration<double, std::milli> frameCpuTime = std::chrono::steady_clock::now() - frameStart;
+		glFinish();
+
+		GLuint64 firstTimestamp = 0;
+		GLuint64 lastTimestamp = 0;
+		for (size_t i = 0; i < calls.size(); i++)
+		{
+			GLuint64 start = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(queries[i * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+			calls[i].gpuMs.push_back((end > start) ? (end - start) / 1.0e6 : 0.0);
+			if (i == 0)
+			{
+				firstTimestamp = start;
+			}
+			lastTimestamp = end;
+		}
+		frameGpuMs.push_back((lastTimestamp > firstTimestamp) ? (lastTimestamp - firstTimestamp) / 1.0e6 : 0.0);
+		frameCpuMs.push_back(frameCpuTime.count());
+	}
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+
+	// print the frame totals and the hottest calls
+	size_t nDraws = 0;
+	for (size_t i = 0; i < calls.size(); i++)
+	{
+		uint32_t command = calls[i].command;
+		if ((command == GLC_DRAW_ARRAYS) || (command == GLC_DRAW_ELEMENTS) || (command == GLC_DRAW_ELEMENTS_BASE_VERTEX) ||
+			(command == GLC_MULTI_DRAW_ARRAYS) || (command == GLC_MULTI_DRAW_ELEMENTS))
+		{
+			nDraws++;
+		}
+	}
+	std::cout << "GLReplay: " << captureFile << ", " << g_Header.width << "x" << g_Header.height
+		<< ", " << calls.size() << " calls, " << nDraws << " draws, " << repeat << " repetitions" << std::endl;
+	std::cout << "frame: gpu " << GetMedian(frameGpuMs) << " ms, cpu " << GetMedian(frameCpuMs) << " ms (medians)" << std::endl;
+
+	std::vector<size_t> order(calls.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::vector<double> medians(calls.size());
+	for (size_t i = 0; i < calls.size(); i++)
+	{
+		medians[i] = GetMedian(calls[i].gpuMs);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		return(medians[a] > medians[b]);
+	});
+
+	char line[512];
+	snprintf(line, sizeof(line), "%8s  %-26s %10s %10s %8s %8s  %s",
+		"call", "command", "gpu ms", "cpu ms", "program", "vao", "details");
+	std::cout << "hottest calls by median GPU time:\n" << line << std::endl;
+	for (size_t i = 0; (i < order.size()) && (i < (size_t)top); i++)
+	{
+		const REPLAY_CALL& call = calls[order[i]];
+		snprintf(line, sizeof(line), "%8zu  %-26s %10.4f %10.4f %8u %8u  %s",
+			order[i], GetCommandName(call.command), medians[order[i]], GetMedian(call.cpuMs),
+			call.program, call.vertexArray, call.details.c_str());
+		std::cout << line << std::endl;
+	}
+
+	if (NULL != csvFile)
+	{
+		std::ofstream csv(csvFile);
+		csv << "call,command,gpu_ms,cpu_ms,program,vao,details\n";
+		for (size_t i = 0; i < calls.size(); i++)
+		{
+			csv << i << "," << GetCommandName(calls[i].command) << "," << medians[i] << ","
+				<< GetMedian(calls[i].cpuMs) << "," << calls[i].program << "," << calls[i].vertexArray
+				<< ",\"" << calls[i].details << "\"\n";
+		}
+	}
+
+	glfwTerminate();
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  LoadCapture()
+ *
+ *  This function is used to read the capture file and
+ *  check its header.
+ ***********************************************************/
+bool LoadCapture(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "GLReplay: could not open " << filename << std::endl;
+		return(false);
+	}
+
+	file.read((char*)&g_Header, sizeof(g_Header));
+	if ((!file) || (g_Header.magic != GLCAPTURE_MAGIC) || (g_Header.version != GLCAPTURE_VERSION))
+	{
+		std::cout << "GLReplay: " << filename << " is not a version " << GLCAPTURE_VERSION << " capture" << std::endl;
+		return(false);
+	}
+
+	g_Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return(true);
+}
+
+/***********************************************************
+ *  CreateSnapshotObjects()
+ *
+ *  This function is used to create the objects saved in
+ *  the snapshot records and to collect the frame calls.
+ ***********************************************************/
+bool CreateSnapshotObjects(std::vector<REPLAY_CALL>& calls)
+{
+	size_t offset = 0;
+	uint32_t nRecords = g_Header.nSnapshotRecords + g_Header.nFrameRecords;
+	bool bHasState = false;
+
+	// the frame calls are annotated with the bindings they
+	// were made with while walking them
+	GLuint program = 0;
+	GLuint vertexArray = 0;
+
+	for (uint32_t i = 0; i < nRecords; i++)
+	{
+		GLCAPTURE_RECORD record;
+		if (offset + sizeof(record) > g_Data.size())
+		{
+			std::cout << "GLReplay: the capture is truncated" << std::endl;
+			return(false);
+		}
+		memcpy(&record, &g_Data[offset], sizeof(record));
+		offset += sizeof(record);
+		if (record.size > g_Data.size() - offset)
+		{
+			std::cout << "GLReplay: the capture is truncated" << std::endl;
+			return(false);
+		}
+
+		GLCaptureReader reader(&g_Data[offset], record.size);
+		switch (record.command)
+		{
+		case GLC_SNAPSHOT_BUFFER:
+		{
+			GLuint name = reader.Get32();
+			GLenum usage = reader.Get32();
+			GLint immutable = reader.Get32();
+			GLbitfield flags = reader.Get32();
+			uint32_t size = 0;
+			const unsigned char* pData = reader.GetBlock(size);
+
+			GLuint buffer = 0;
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			if ((immutable != GL_FALSE) && (size > 0))
+			{
+				// writes made through mappings are replayed with
+				// glNamedBufferSubData(), which needs dynamic storage
+				glBufferStorage(GL_COPY_WRITE_BUFFER, size, pData, flags | GL_DYNAMIC_STORAGE_BIT);
+			}
+			else
+			{
+				glBufferData(GL_COPY_WRITE_BUFFER, size, pData, usage);
+			}
+			g_Names[GLC_OBJECT_BUFFER][name] = buffer;
+			break;
+		}
+		case GLC_SNAPSHOT_TEXTURE:
+		{
+			GLuint name = reader.Get32();
+			GLsizei width = reader.Get32();
+			GLsizei height = reader.Get32();
+			GLint internalFormat = reader.Get32();
+			GLenum readFormat = reader.Get32();
+			GLenum readType = reader.Get32();
+			GLint minFilter = reader.Get32();
+			GLint magFilter = reader.Get32();
+			GLint wrapS = reader.Get32();
+			GLint wrapT = reader.Get32();
+			uint32_t size = 0;
+			const unsigned char* pData = reader.GetBlock(size);
+
+			GLuint texture = 0;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, readFormat, readType, (size > 0) ? pData : NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+			// only the top level is saved, the rest is rebuilt
+			if ((minFilter != GL_NEAREST) && (minFilter != GL_LINEAR) && (width > 0))
+			{
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+			g_Names[GLC_OBJECT_TEXTURE][name] = texture;
+			break;
+		}
+		case GLC_SNAPSHOT_TEXTURE_BUFFER:
+		{
+			GLuint name = reader.Get32();
+			GLenum internalFormat = reader.Get32();
+			GLuint buffer = reader.Get32();
+
+			GLuint texture = 0;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, MapName(GLC_OBJECT_BUFFER, buffer));
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			g_Names[GLC_OBJECT_TEXTURE][name] = texture;
+			break;
+		}
+		case GLC_SNAPSHOT_RENDERBUFFER:
+		{
+			GLuint name = reader.Get32();
+			GLenum internalFormat = reader.Get32();
+			GLsizei width = reader.Get32();
+			GLsizei height = reader.Get32();
+
+			GLuint renderbuffer = 0;
+			glGenRenderbuffers(1, &renderbuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+			if ((width > 0) && (height > 0))
+			{
+				glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+			}
+			g_Names[GLC_OBJECT_RENDERBUFFER][name] = renderbuffer;
+			break;
+		}
+		case GLC_SNAPSHOT_FRAMEBUFFER:
+		{
+			GLuint name = reader.Get32();
+			uint32_t nAttachments = reader.Get32();
+
+			GLuint framebuffer = 0;
+			glGenFramebuffers(1, &framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			for (uint32_t a = 0; a < nAttachments; a++)
+			{
+				GLenum attachment = reader.Get32();
+				GLenum type = reader.Get32();
+				GLuint object = reader.Get32();
+				if (type == GL_TEXTURE)
+				{
+					glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, MapName(GLC_OBJECT_TEXTURE, object), 0);
+				}
+				else if (type == GL_RENDERBUFFER)
+				{
+					glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, MapName(GLC_OBJECT_RENDERBUFFER, object));
+				}
+			}
+
+			uint32_t nDrawBuffers = reader.Get32();
+			std::vector<GLenum> drawBuffers;
+			for (uint32_t d = 0; (d < nDrawBuffers) && (reader.IsFailed() == false); d++)
+			{
+				drawBuffers.push_back(reader.Get32());
+			}
+			glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+			glReadBuffer(reader.Get32());
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			g_Names[GLC_OBJECT_FRAMEBUFFER][name] = framebuffer;
+			break;
+		}
+		case GLC_SNAPSHOT_VERTEX_ARRAY:
+		{
+			GLuint name = reader.Get32();
+			GLuint elementBuffer = reader.Get32();
+			uint32_t nAttributes = reader.Get32();
+
+			GLuint vertexArray = 0;
+			glGenVertexArrays(1, &vertexArray);
+			glBindVertexArray(vertexArray);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, MapName(GLC_OBJECT_BUFFER, elementBuffer));
+			for (uint32_t a = 0; a < nAttributes; a++)
+			{
+				GLuint index = reader.Get32();
+				GLint enabled = reader.Get32();
+				GLint size = reader.Get32();
+				GLenum type = reader.Get32();
+				GLboolean normalized = (GLboolean)reader.Get32();
+				GLint integer = reader.Get32();
+				GLsizei stride = reader.Get32();
+				GLuint divisor = reader.Get32();
+				GLuint buffer = reader.Get32();
+				uint64_t pointer = reader.Get64();
+
+				glBindBuffer(GL_ARRAY_BUFFER, MapName(GLC_OBJECT_BUFFER, buffer));
+				if (buffer != 0)
+				{
+					if (integer != 0)
+					{
+						glVertexAttribIPointer(index, size, type, stride, (const void*)(size_t)pointer);
+					}
+					else
+					{
+						glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(size_t)pointer);
+					}
+				}
+				glVertexAttribDivisor(index, divisor);
+				if (enabled != 0)
+				{
+					glEnableVertexAttribArray(index);
+				}
+			}
+			glBindVertexArray(0);
+			g_Names[GLC_OBJECT_VERTEX_ARRAY][name] = vertexArray;
+			break;
+		}
+		case GLC_SNAPSHOT_PROGRAM:
+		{
+			g_ProgramRecords.push_back(offset);
+			ApplyProgramUniforms(reader, true);
+			break;
+		}
+		case GLC_SNAPSHOT_STATE:
+		{
+			g_StateRecord = offset;
+			bHasState = true;
+			program = reader.Get32();
+			vertexArray = reader.Get32();
+			break;
+		}
+		default:
+		{
+			REPLAY_CALL call;
+			call.command = record.command;
+			call.offset = offset;
+			call.size = record.size;
+
+			if (record.command == GLC_USE_PROGRAM)
+			{
+				program = reader.Get32();
+			}
+			else if (record.command == GLC_BIND_VERTEX_ARRAY)
+			{
+				vertexArray = reader.Get32();
+			}
+			call.program = program;
+			call.vertexArray = vertexArray;
+			call.details = DescribeCall(call);
+
+			if (record.command != GLC_FRAME_END)
+			{
+				calls.push_back(call);
+			}
+			break;
+		}
+		}
+
+		if (reader.IsFailed() == true)
+		{
+			std::cout << "GLReplay: bad " << GetCommandName(record.command) << " record" << std::endl;
+			return(false);
+		}
+		offset += record.size;
+	}
+
+	if (bHasState == false)
+	{
+		std::cout << "GLReplay: the capture has no drawing state" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ApplyProgramUniforms()
+ *
+ *  This function is used to set a program's uniforms to
+ *  their captured values, and on the first pass to build
+ *  the program from its shader sources.
+ ***********************************************************/
+void ApplyProgramUniforms(GLCaptureReader& reader, bool bCreate)
+{
+	GLuint name = reader.Get32();
+	uint32_t nShaders = reader.Get32();
+
+	GLuint program = 0;
+	if (bCreate == true)
+	{
+		program = glCreateProgram();
+	}
+	else
+	{
+		program = MapName(GLC_OBJECT_PROGRAM, name);
+	}
+
+	for (uint32_t s = 0; s < nShaders; s++)
+	{
+		GLenum type = reader.Get32();
+		std::string source = reader.GetString();
+		if (bCreate == false)
+		{
+			continue;
+		}
+
+		const GLchar* pSource = source.c_str();
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &pSource, NULL);
+		glCompileShader(shader);
+
+		GLint bCompiled = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &bCompiled);
+		if (bCompiled == GL_FALSE)
+		{
+			GLchar log[1024];
+			glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+			std::cout << "GLReplay: shader of program " << name << " failed to compile\n" << log << std::endl;
+		}
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+	}
+
+	if (bCreate == true)
+	{
+		glLinkProgram(program);
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked == GL_FALSE)
+		{
+			GLchar log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "GLReplay: program " << name << " failed to link\n" << log << std::endl;
+		}
+		g_Names[GLC_OBJECT_PROGRAM][name] = program;
+	}
+
+	glUseProgram(program);
+
+	uint32_t nUniforms = reader.Get32();
+	for (uint32_t u = 0; u < nUniforms; u++)
+	{
+		GLint capturedLocation = (GLint)reader.Get32();
+		GLenum type = reader.Get32();
+		std::string uniformName = reader.GetString();
+		uint32_t size = 0;
+		const unsigned char* pValues = reader.GetBlock(size);
+
+		GLint location = -1;
+		if (bCreate == true)
+		{
+			location = glGetUniformLocation(program, uniformName.c_str());
+			g_UniformLocations[std::make_pair(name, capturedLocation)] = location;
+			g_UniformNames[std::make_pair(name, capturedLocation)] = uniformName;
+		}
+		else
+		{
+			location = g_UniformLocations[std::make_pair(name, capturedLocation)];
+		}
+		if ((location < 0) || (NULL == pValues))
+		{
+			continue;
+		}
+
+		GLfloat floats[16];
+		GLint ints[16];
+		memcpy(floats, pValues, std::min<size_t>(size, sizeof(floats)));
+		memcpy(ints, pValues, std::min<size_t>(size, sizeof(ints)));
+		switch (type)
+		{
+		case GL_FLOAT: glUniform1fv(location, 1, floats); break;
+		case GL_FLOAT_VEC2: glUniform2fv(location, 1, floats); break;
+		case GL_FLOAT_VEC3: glUniform3fv(location, 1, floats); break;
+		case GL_FLOAT_VEC4: glUniform4fv(location, 1, floats); break;
+		case GL_FLOAT_MAT2: glUniformMatrix2fv(location, 1, GL_FALSE, floats); break;
+		case GL_FLOAT_MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, floats); break;
+		case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, floats); break;
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2: glUniform2iv(location, 1, ints); break;
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3: glUniform3iv(location, 1, ints); break;
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4: glUniform4iv(location, 1, ints); break;
+		default:
+			// ints, bools and samplers
+			glUniform1iv(location, 1, ints);
+			break;
+		}
+	}
+
+	uint32_t nBlocks = reader.Get32();
+	for (uint32_t b = 0; (b < nBlocks) && (reader.IsFailed() == false); b++)
+	{
+		std::string blockName = reader.GetString();
+		GLuint binding = reader.Get32();
+		GLuint blockIndex = glGetUniformBlockIndex(program, blockName.c_str());
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(program, blockIndex, binding);
+		}
+	}
+}
+
+/***********************************************************
+ *  ApplyDrawState()
+ *
+ *  This function is used to put the context back into the
+ *  state the captured frame started in.
+ ***********************************************************/
+void ApplyDrawState()
+{
+	for (size_t i = 0; i < g_ProgramRecords.size(); i++)
+	{
+		GLCAPTURE_RECORD record;
+		memcpy(&record, &g_Data[g_ProgramRecords[i] - sizeof(record)], sizeof(record));
+		GLCaptureReader programReader(&g_Data[g_ProgramRecords[i]], record.size);
+		ApplyProgramUniforms(programReader, false);
+	}
+
+	GLCAPTURE_RECORD record;
+	memcpy(&record, &g_Data[g_StateRecord - sizeof(record)], sizeof(record));
+	GLCaptureReader reader(&g_Data[g_StateRecord], record.size);
+
+	g_CurrentProgram = reader.Get32();
+	g_CurrentVertexArray = reader.Get32();
+	GLuint arrayBuffer = reader.Get32();
+	GLenum activeTexture = reader.Get32();
+	uint32_t nUnits = reader.Get32();
+	for (uint32_t i = 0; i < nUnits; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, MapName(GLC_OBJECT_TEXTURE, reader.Get32()));
+		glBindTexture(GL_TEXTURE_BUFFER, MapName(GLC_OBJECT_TEXTURE, reader.Get32()));
+	}
+	glActiveTexture(activeTexture);
+	GLuint framebuffer = reader.Get32();
+	GLuint renderbuffer = reader.Get32();
+
+	glUseProgram(MapName(GLC_OBJECT_PROGRAM, g_CurrentProgram));
+	glBindVertexArray(MapName(GLC_OBJECT_VERTEX_ARRAY, g_CurrentVertexArray));
+	glBindBuffer(GL_ARRAY_BUFFER, MapName(GLC_OBJECT_BUFFER, arrayBuffer));
+	glBindFramebuffer(GL_FRAMEBUFFER, MapName(GLC_OBJECT_FRAMEBUFFER, framebuffer));
+	glBindRenderbuffer(GL_RENDERBUFFER, MapName(GLC_OBJECT_RENDERBUFFER, renderbuffer));
+
+	const GLenum caps[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_PRIMITIVE_RESTART };
+	for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); i++)
+	{
+		if (reader.Get32() != 0)
+		{
+			glEnable(caps[i]);
+		}
+		else
+		{
+			glDisable(caps[i]);
+		}
+	}
+
+	GLenum blendSrcRGB = reader.Get32();
+	GLenum blendDstRGB = reader.Get32();
+	GLenum blendSrcAlpha = reader.Get32();
+	GLenum blendDstAlpha = reader.Get32();
+	glBlendFuncSeparate(blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha);
+	glDepthFunc(reader.Get32());
+	glCullFace(reader.Get32());
+	glPolygonMode(GL_FRONT_AND_BACK, reader.Get32());
+
+	GLint viewport[4];
+	for (int i = 0; i < 4; i++)
+	{
+		viewport[i] = (GLint)reader.Get32();
+	}
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	GLfloat clearColor[4];
+	for (int i = 0; i < 4; i++)
+	{
+		clearColor[i] = reader.GetFloat();
+	}
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+	glPrimitiveRestartIndex(reader.Get32());
+	glPixelStorei(GL_PACK_ALIGNMENT, reader.Get32());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, reader.Get32());
+
+	uint32_t nAttributes = reader.Get32();
+	for (uint32_t i = 0; i < nAttributes; i++)
+	{
+		GLfloat value[4];
+		for (int c = 0; c < 4; c++)
+		{
+			value[c] = reader.GetFloat();
+		}
+		glVertexAttrib4fv(i, value);
+	}
+
+	if (reader.Get32() != 0)
+	{
+		glEnable(GL_SCISSOR_TEST);
+	}
+	else
+	{
+		glDisable(GL_SCISSOR_TEST);
+	}
+	GLint scissor[4];
+	for (int i = 0; i < 4; i++)
+	{
+		scissor[i] = (GLint)reader.Get32();
+	}
+	glScissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+
+	// a binding with no size was made with glBindBufferBase()
+	uint32_t nUniformBindings = reader.Get32();
+	for (uint32_t i = 0; i < nUniformBindings; i++)
+	{
+		GLuint buffer = MapName(GLC_OBJECT_BUFFER, reader.Get32());
+		uint64_t start = reader.Get64();
+		uint64_t size = reader.Get64();
+		if ((buffer != 0) && (size > 0))
+		{
+			glBindBufferRange(GL_UNIFORM_BUFFER, i, buffer, (GLintptr)start, (GLsizeiptr)size);
+		}
+		else
+		{
+			glBindBufferBase(GL_UNIFORM_BUFFER, i, buffer);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReplayCall()
+ *
+ *  This function is used to re-issue one captured call
+ *  with the replay's object names.  Deletes only run on the
+ *  final pass, so every repetition sees the same objects.
+ ***********************************************************/
+void ReplayCall(const REPLAY_CALL& call, bool bFinalPass)
+{
+	GLCaptureReader reader(&g_Data[call.offset], call.size);
+	std::vector<GLuint> names;
+
+	switch (call.command)
+	{
+	case GLC_ENABLE:
+		glEnable(reader.Get32());
+		break;
+	case GLC_DISABLE:
+		glDisable(reader.Get32());
+		break;
+	case GLC_BLEND_FUNC:
+	{
+		GLenum sfactor = reader.Get32();
+		GLenum dfactor = reader.Get32();
+		glBlendFunc(sfactor, dfactor);
+		break;
+	}
+	case GLC_DEPTH_FUNC:
+		glDepthFunc(reader.Get32());
+		break;
+	case GLC_CULL_FACE:
+		glCullFace(reader.Get32());
+		break;
+	case GLC_POLYGON_MODE:
+	{
+		GLenum face = reader.Get32();
+		GLenum mode = reader.Get32();
+		glPolygonMode(face, mode);
+		break;
+	}
+	case GLC_CLEAR:
+		glClear(reader.Get32());
+		break;
+	case GLC_CLEAR_COLOR:
+	{
+		GLfloat red = reader.GetFloat();
+		GLfloat green = reader.GetFloat();
+		GLfloat blue = reader.GetFloat();
+		GLfloat alpha = reader.GetFloat();
+		glClearColor(red, green, blue, alpha);
+		break;
+	}
+	case GLC_VIEWPORT:
+	{
+		GLint x = reader.Get32();
+		GLint y = reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		glViewport(x, y, width, height);
+		break;
+	}
+	case GLC_DRAW_ARRAYS:
+	{
+		GLenum mode = reader.Get32();
+		GLint first = reader.Get32();
+		GLsizei count = reader.Get32();
+		glDrawArrays(mode, first, count);
+		break;
+	}
+	case GLC_DRAW_ELEMENTS:
+	{
+		GLenum mode = reader.Get32();
+		GLsizei count = reader.Get32();
+		GLenum type = reader.Get32();
+		uint64_t offset = reader.Get64();
+		uint32_t size = 0;
+		const unsigned char* pIndices = reader.GetBlock(size);
+		glDrawElements(mode, count, type, (size > 0) ? (const void*)pIndices : (const void*)(size_t)offset);
+		break;
+	}
+	case GLC_DRAW_ELEMENTS_BASE_VERTEX:
+	{
+		GLenum mode = reader.Get32();
+		GLsizei count = reader.Get32();
+		GLenum type = reader.Get32();
+		uint64_t offset = reader.Get64();
+		uint32_t size = 0;
+		const unsigned char* pIndices = reader.GetBlock(size);
+		GLint basevertex = reader.Get32();
+		glDrawElementsBaseVertex(mode, count, type, (size > 0) ? (const void*)pIndices : (const void*)(size_t)offset, basevertex);
+		break;
+	}
+	case GLC_MULTI_DRAW_ARRAYS:
+	{
+		GLenum mode = reader.Get32();
+		GLsizei drawcount = reader.Get32();
+		std::vector<GLint> firsts(drawcount);
+		std::vector<GLsizei> counts(drawcount);
+		reader.GetBytes(firsts.data(), sizeof(GLint) * drawcount);
+		reader.GetBytes(counts.data(), sizeof(GLsizei) * drawcount);
+		glMultiDrawArrays(mode, firsts.data(), counts.data(), drawcount);
+		break;
+	}
+	case GLC_MULTI_DRAW_ELEMENTS:
+	{
+		GLenum mode = reader.Get32();
+		GLenum type = reader.Get32();
+		GLsizei drawcount = reader.Get32();
+		std::vector<GLsizei> counts(drawcount);
+		std::vector<const void*> offsets(drawcount);
+		reader.GetBytes(counts.data(), sizeof(GLsizei) * drawcount);
+		for (GLsizei i = 0; i < drawcount; i++)
+		{
+			offsets[i] = (const void*)(size_t)reader.Get64();
+		}
+		glMultiDrawElements(mode, counts.data(), type, offsets.data(), drawcount);
+		break;
+	}
+	case GLC_GEN_TEXTURES:
+	case GLC_GEN_BUFFERS:
+	case GLC_GEN_VERTEX_ARRAYS:
+	case GLC_GEN_FRAMEBUFFERS:
+	case GLC_GEN_RENDERBUFFERS:
+	{
+		ReadNames(reader, names);
+		std::vector<GLuint> created(names.size());
+		GLCAPTURE_OBJECT type = GLC_OBJECT_TEXTURE;
+		switch (call.command)
+		{
+		case GLC_GEN_TEXTURES: glGenTextures((GLsizei)created.size(), created.data()); type = GLC_OBJECT_TEXTURE; break;
+		case GLC_GEN_BUFFERS: glGenBuffers((GLsizei)created.size(), created.data()); type = GLC_OBJECT_BUFFER; break;
+		case GLC_GEN_VERTEX_ARRAYS: glGenVertexArrays((GLsizei)created.size(), created.data()); type = GLC_OBJECT_VERTEX_ARRAY; break;
+		case GLC_GEN_FRAMEBUFFERS: glGenFramebuffers((GLsizei)created.size(), created.data()); type = GLC_OBJECT_FRAMEBUFFER; break;
+		case GLC_GEN_RENDERBUFFERS: glGenRenderbuffers((GLsizei)created.size(), created.data()); type = GLC_OBJECT_RENDERBUFFER; break;
+		}
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			g_Names[type][names[i]] = created[i];
+		}
+		break;
+	}
+	case GLC_DELETE_TEXTURES:
+	case GLC_DELETE_BUFFERS:
+	case GLC_DELETE_VERTEX_ARRAYS:
+	case GLC_DELETE_FRAMEBUFFERS:
+	case GLC_DELETE_RENDERBUFFERS:
+	{
+		if (bFinalPass == false)
+		{
+			break;
+		}
+		ReadNames(reader, names);
+		GLCAPTURE_OBJECT type =
+			(call.command == GLC_DELETE_TEXTURES) ? GLC_OBJECT_TEXTURE :
+			(call.command == GLC_DELETE_BUFFERS) ? GLC_OBJECT_BUFFER :
+			(call.command == GLC_DELETE_VERTEX_ARRAYS) ? GLC_OBJECT_VERTEX_ARRAY :
+			(call.command == GLC_DELETE_FRAMEBUFFERS) ? GLC_OBJECT_FRAMEBUFFER : GLC_OBJECT_RENDERBUFFER;
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			names[i] = MapName(type, names[i]);
+		}
+		switch (call.command)
+		{
+		case GLC_DELETE_TEXTURES: glDeleteTextures((GLsizei)names.size(), names.data()); break;
+		case GLC_DELETE_BUFFERS: glDeleteBuffers((GLsizei)names.size(), names.data()); break;
+		case GLC_DELETE_VERTEX_ARRAYS: glDeleteVertexArrays((GLsizei)names.size(), names.data()); break;
+		case GLC_DELETE_FRAMEBUFFERS: glDeleteFramebuffers((GLsizei)names.size(), names.data()); break;
+		case GLC_DELETE_RENDERBUFFERS: glDeleteRenderbuffers((GLsizei)names.size(), names.data()); break;
+		}
+		break;
+	}
+	case GLC_BIND_TEXTURE:
+	{
+		GLenum target = reader.Get32();
+		GLuint texture = reader.Get32();
+		glBindTexture(target, MapName(GLC_OBJECT_TEXTURE, texture));
+		break;
+	}
+	case GLC_ACTIVE_TEXTURE:
+		glActiveTexture(reader.Get32());
+		break;
+	case GLC_TEX_PARAMETER_I:
+	{
+		GLenum target = reader.Get32();
+		GLenum pname = reader.Get32();
+		GLint param = reader.Get32();
+		glTexParameteri(target, pname, param);
+		break;
+	}
+	case GLC_TEX_IMAGE_2D:
+	{
+		GLenum target = reader.Get32();
+		GLint level = reader.Get32();
+		GLint internalFormat = reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		GLint border = reader.Get32();
+		GLenum format = reader.Get32();
+		GLenum type = reader.Get32();
+		uint32_t size = 0;
+		const unsigned char* pPixels = reader.GetBlock(size);
+		glTexImage2D(target, level, internalFormat, width, height, border, format, type, (size > 0) ? pPixels : NULL);
+		break;
+	}
+	case GLC_GENERATE_MIPMAP:
+		glGenerateMipmap(reader.Get32());
+		break;
+	case GLC_TEX_BUFFER:
+	{
+		GLenum target = reader.Get32();
+		GLenum internalFormat = reader.Get32();
+		GLuint buffer = reader.Get32();
+		glTexBuffer(target, internalFormat, MapName(GLC_OBJECT_BUFFER, buffer));
+		break;
+	}
+	case GLC_PIXEL_STORE_I:
+	{
+		GLenum pname = reader.Get32();
+		GLint param = reader.Get32();
+		glPixelStorei(pname, param);
+		break;
+	}
+	case GLC_READ_BUFFER:
+		glReadBuffer(reader.Get32());
+		break;
+	case GLC_READ_PIXELS:
+	{
+		GLint x = reader.Get32();
+		GLint y = reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		GLenum format = reader.Get32();
+		GLenum type = reader.Get32();
+		// large enough for four floats per pixel and any row
+		// padding
+		g_ReadPixels.resize((size_t)width * height * 16 + 4 * height);
+		glReadPixels(x, y, width, height, format, type, g_ReadPixels.data());
+		break;
+	}
+	case GLC_BIND_BUFFER:
+	{
+		GLenum target = reader.Get32();
+		GLuint buffer = reader.Get32();
+		glBindBuffer(target, MapName(GLC_OBJECT_BUFFER, buffer));
+		break;
+	}
+	case GLC_BUFFER_DATA:
+	{
+		GLenum target = reader.Get32();
+		uint64_t size = reader.Get64();
+		GLenum usage = reader.Get32();
+		uint32_t dataSize = 0;
+		const unsigned char* pData = reader.GetBlock(dataSize);
+		glBufferData(target, (GLsizeiptr)size, (dataSize > 0) ? pData : NULL, usage);
+		break;
+	}
+	case GLC_BUFFER_SUB_DATA:
+	{
+		GLenum target = reader.Get32();
+		uint64_t offset = reader.Get64();
+		uint32_t size = 0;
+		const unsigned char* pData = reader.GetBlock(size);
+		glBufferSubData(target, (GLintptr)offset, size, pData);
+		break;
+	}
+	case GLC_BUFFER_STORAGE:
+	{
+		GLenum target = reader.Get32();
+		uint64_t size = reader.Get64();
+		GLbitfield flags = reader.Get32();
+		uint32_t dataSize = 0;
+		const unsigned char* pData = reader.GetBlock(dataSize);
+		glBufferStorage(target, (GLsizeiptr)size, (dataSize > 0) ? pData : NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+		break;
+	}
+	case GLC_BUFFER_WRITE:
+	{
+		GLuint buffer = reader.Get32();
+		uint64_t offset = reader.Get64();
+		uint32_t size = 0;
+		const unsigned char* pData = reader.GetBlock(size);
+		glNamedBufferSubData(MapName(GLC_OBJECT_BUFFER, buffer), (GLintptr)offset, size, pData);
+		break;
+	}
+	case GLC_BIND_BUFFER_RANGE:
+	{
+		GLenum target = reader.Get32();
+		GLuint index = reader.Get32();
+		GLuint buffer = reader.Get32();
+		uint64_t offset = reader.Get64();
+		uint64_t size = reader.Get64();
+		glBindBufferRange(target, index, MapName(GLC_OBJECT_BUFFER, buffer), (GLintptr)offset, (GLsizeiptr)size);
+		break;
+	}
+	case GLC_COPY_BUFFER_SUB_DATA:
+	{
+		GLenum readTarget = reader.Get32();
+		GLenum writeTarget = reader.Get32();
+		uint64_t readOffset = reader.Get64();
+		uint64_t writeOffset = reader.Get64();
+		uint64_t size = reader.Get64();
+		glCopyBufferSubData(readTarget, writeTarget, (GLintptr)readOffset, (GLintptr)writeOffset, (GLsizeiptr)size);
+		break;
+	}
+	case GLC_BIND_VERTEX_ARRAY:
+		g_CurrentVertexArray = reader.Get32();
+		glBindVertexArray(MapName(GLC_OBJECT_VERTEX_ARRAY, g_CurrentVertexArray));
+		break;
+	case GLC_VERTEX_ATTRIB_POINTER:
+	{
+		GLuint index = reader.Get32();
+		GLint size = reader.Get32();
+		GLenum type = reader.Get32();
+		GLboolean normalized = (GLboolean)reader.Get32();
+		GLsizei stride = reader.Get32();
+		uint64_t offset = reader.Get64();
+		glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(size_t)offset);
+		break;
+	}
+	case GLC_ENABLE_VERTEX_ATTRIB_ARRAY:
+		glEnableVertexAttribArray(reader.Get32());
+		break;
+	case GLC_DISABLE_VERTEX_ATTRIB_ARRAY:
+		glDisableVertexAttribArray(reader.Get32());
+		break;
+	case GLC_VERTEX_ATTRIB_4F:
+	{
+		GLuint index = reader.Get32();
+		GLfloat x = reader.GetFloat();
+		GLfloat y = reader.GetFloat();
+		GLfloat z = reader.GetFloat();
+		GLfloat w = reader.GetFloat();
+		glVertexAttrib4f(index, x, y, z, w);
+		break;
+	}
+	case GLC_BIND_FRAMEBUFFER:
+	{
+		GLenum target = reader.Get32();
+		GLuint framebuffer = reader.Get32();
+		glBindFramebuffer(target, MapName(GLC_OBJECT_FRAMEBUFFER, framebuffer));
+		break;
+	}
+	case GLC_FRAMEBUFFER_TEXTURE_2D:
+	{
+		GLenum target = reader.Get32();
+		GLenum attachment = reader.Get32();
+		GLenum textarget = reader.Get32();
+		GLuint texture = reader.Get32();
+		GLint level = reader.Get32();
+		glFramebufferTexture2D(target, attachment, textarget, MapName(GLC_OBJECT_TEXTURE, texture), level);
+		break;
+	}
+	case GLC_FRAMEBUFFER_RENDERBUFFER:
+	{
+		GLenum target = reader.Get32();
+		GLenum attachment = reader.Get32();
+		GLenum renderbuffertarget = reader.Get32();
+		GLuint renderbuffer = reader.Get32();
+		glFramebufferRenderbuffer(target, attachment, renderbuffertarget, MapName(GLC_OBJECT_RENDERBUFFER, renderbuffer));
+		break;
+	}
+	case GLC_BIND_RENDERBUFFER:
+	{
+		GLenum target = reader.Get32();
+		GLuint renderbuffer = reader.Get32();
+		glBindRenderbuffer(target, MapName(GLC_OBJECT_RENDERBUFFER, renderbuffer));
+		break;
+	}
+	case GLC_RENDERBUFFER_STORAGE:
+	{
+		GLenum target = reader.Get32();
+		GLenum internalFormat = reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		glRenderbufferStorage(target, internalFormat, width, height);
+		break;
+	}
+	case GLC_PRIMITIVE_RESTART_INDEX:
+		glPrimitiveRestartIndex(reader.Get32());
+		break;
+	case GLC_DRAW_BUFFER:
+		glDrawBuffer(reader.Get32());
+		break;
+	case GLC_DRAW_BUFFERS:
+	{
+		GLsizei n = reader.Get32();
+		std::vector<GLenum> buffers(n);
+		reader.GetBytes(buffers.data(), sizeof(GLenum) * n);
+		glDrawBuffers(n, buffers.data());
+		break;
+	}
+	case GLC_SCISSOR:
+	{
+		GLint x = reader.Get32();
+		GLint y = reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		glScissor(x, y, width, height);
+		break;
+	}
+	case GLC_MEMORY_BARRIER:
+		glMemoryBarrier(reader.Get32());
+		break;
+	case GLC_UNIFORM_BLOCK_BINDING:
+	{
+		GLuint program = MapName(GLC_OBJECT_PROGRAM, reader.Get32());
+		std::string blockName = reader.GetString();
+		GLuint binding = reader.Get32();
+		GLuint blockIndex = glGetUniformBlockIndex(program, blockName.c_str());
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(program, blockIndex, binding);
+		}
+		break;
+	}
+	case GLC_USE_PROGRAM:
+		g_CurrentProgram = reader.Get32();
+		glUseProgram(MapName(GLC_OBJECT_PROGRAM, g_CurrentProgram));
+		break;
+	case GLC_UNIFORM:
+	{
+		GLCAPTURE_UNIFORM kind = (GLCAPTURE_UNIFORM)reader.Get32();
+		GLint capturedLocation = (GLint)reader.Get32();
+		GLsizei count = reader.Get32();
+		GLboolean transpose = (GLboolean)reader.Get32();
+		uint32_t size = 0;
+		const unsigned char* pValues = reader.GetBlock(size);
+
+		std::map<std::pair<GLuint, GLint>, GLint>::const_iterator found =
+			g_UniformLocations.find(std::make_pair(g_CurrentProgram, capturedLocation));
+		if ((found == g_UniformLocations.end()) || (found->second < 0) || (NULL == pValues))
+		{
+			break;
+		}
+
+		GLint location = found->second;
+		const GLfloat* pFloats = (const GLfloat*)pValues;
+		const GLint* pInts = (const GLint*)pValues;
+		switch (kind)
+		{
+		case GLC_UNIFORM_1I: glUniform1i(location, pInts[0]); break;
+		case GLC_UNIFORM_1IV: glUniform1iv(location, count, pInts); break;
+		case GLC_UNIFORM_1F: glUniform1f(location, pFloats[0]); break;
+		case GLC_UNIFORM_1FV: glUniform1fv(location, count, pFloats); break;
+		case GLC_UNIFORM_2FV: glUniform2fv(location, count, pFloats); break;
+		case GLC_UNIFORM_3FV: glUniform3fv(location, count, pFloats); break;
+		case GLC_UNIFORM_4FV: glUniform4fv(location, count, pFloats); break;
+		case GLC_UNIFORM_MATRIX3FV: glUniformMatrix3fv(location, count, transpose, pFloats); break;
+		case GLC_UNIFORM_MATRIX4FV: glUniformMatrix4fv(location, count, transpose, pFloats); break;
+		}
+		break;
+	}
+	}
+}
+
+/***********************************************************
+ *  DescribeCall()
+ *
+ *  This function is used to summarize the arguments that
+ *  tell calls of the same kind apart in the report.
+ ***********************************************************/
+std::string DescribeCall(const REPLAY_CALL& call)
+{
+	GLCaptureReader reader(&g_Data[call.offset], call.size);
+	char text[128];
+	text[0] = '\0';
+
+	switch (call.command)
+	{
+	case GLC_DRAW_ARRAYS:
+	{
+		GLenum mode = reader.Get32();
+		GLint first = reader.Get32();
+		GLsizei count = reader.Get32();
+		snprintf(text, sizeof(text), "mode=0x%x first=%d count=%d", mode, first, count);
+		break;
+	}
+	case GLC_DRAW_ELEMENTS:
+	case GLC_DRAW_ELEMENTS_BASE_VERTEX:
+	{
+		GLenum mode = reader.Get32();
+		GLsizei count = reader.Get32();
+		snprintf(text, sizeof(text), "mode=0x%x count=%d", mode, count);
+		break;
+	}
+	case GLC_MULTI_DRAW_ARRAYS:
+	case GLC_MULTI_DRAW_ELEMENTS:
+	{
+		GLenum mode = reader.Get32();
+		if (call.command == GLC_MULTI_DRAW_ELEMENTS)
+		{
+			reader.Get32();
+		}
+		GLsizei drawcount = reader.Get32();
+		if (call.command == GLC_MULTI_DRAW_ARRAYS)
+		{
+			std::vector<GLint> firsts(drawcount);
+			reader.GetBytes(firsts.data(), sizeof(GLint) * drawcount);
+		}
+		long long total = 0;
+		for (GLsizei i = 0; i < drawcount; i++)
+		{
+			total += (GLsizei)reader.Get32();
+		}
+		snprintf(text, sizeof(text), "mode=0x%x draws=%d count=%lld", mode, drawcount, total);
+		break;
+	}
+	case GLC_BUFFER_DATA:
+	case GLC_BUFFER_STORAGE:
+	{
+		reader.Get32();
+		snprintf(text, sizeof(text), "bytes=%llu", (unsigned long long)reader.Get64());
+		break;
+	}
+	case GLC_BUFFER_SUB_DATA:
+	case GLC_BUFFER_WRITE:
+	{
+		reader.Get32();
+		reader.Get64();
+		snprintf(text, sizeof(text), "bytes=%u", reader.Get32());
+		break;
+	}
+	case GLC_COPY_BUFFER_SUB_DATA:
+	{
+		reader.Get32();
+		reader.Get32();
+		reader.Get64();
+		reader.Get64();
+		snprintf(text, sizeof(text), "bytes=%llu", (unsigned long long)reader.Get64());
+		break;
+	}
+	case GLC_TEX_IMAGE_2D:
+	{
+		reader.Get32();
+		GLint level = reader.Get32();
+		reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		snprintf(text, sizeof(text), "level=%d %dx%d", level, width, height);
+		break;
+	}
+	case GLC_READ_PIXELS:
+	{
+		reader.Get32();
+		reader.Get32();
+		GLsizei width = reader.Get32();
+		GLsizei height = reader.Get32();
+		snprintf(text, sizeof(text), "%dx%d", width, height);
+		break;
+	}
+	case GLC_UNIFORM:
+	{
+		reader.Get32();
+		GLint location = (GLint)reader.Get32();
+		std::map<std::pair<GLuint, GLint>, std::string>::const_iterator found =
+			g_UniformNames.find(std::make_pair(call.program, location));
+		snprintf(text, sizeof(text), "%s", (found != g_UniformNames.end()) ? found->second.c_str() : "(unknown)");
+		break;
+	}
+	}
+
+	return(text);
+}
+
+/***********************************************************
+ *  GetCommandName()
+ *
+ *  This function is used to get the GL function a record
+ *  was made for.
+ ***********************************************************/
+const char* GetCommandName(uint32_t command)
+{
+	switch (command)
+	{
+	case GLC_SNAPSHOT_BUFFER: return("SnapshotBuffer");
+	case GLC_SNAPSHOT_TEXTURE: return("SnapshotTexture");
+	case GLC_SNAPSHOT_RENDERBUFFER: return("SnapshotRenderbuffer");
+	case GLC_SNAPSHOT_FRAMEBUFFER: return("SnapshotFramebuffer");
+	case GLC_SNAPSHOT_VERTEX_ARRAY: return("SnapshotVertexArray");
+	case GLC_SNAPSHOT_PROGRAM: return("SnapshotProgram");
+	case GLC_SNAPSHOT_STATE: return("SnapshotState");
+	case GLC_SNAPSHOT_TEXTURE_BUFFER: return("SnapshotTextureBuffer");
+	case GLC_ENABLE: return("glEnable");
+	case GLC_DISABLE: return("glDisable");
+	case GLC_BLEND_FUNC: return("glBlendFunc");
+	case GLC_DEPTH_FUNC: return("glDepthFunc");
+	case GLC_CULL_FACE: return("glCullFace");
+	case GLC_POLYGON_MODE: return("glPolygonMode");
+	case GLC_CLEAR: return("glClear");
+	case GLC_CLEAR_COLOR: return("glClearColor");
+	case GLC_VIEWPORT: return("glViewport");
+	case GLC_DRAW_ARRAYS: return("glDrawArrays");
+	case GLC_DRAW_ELEMENTS: return("glDrawElements");
+	case GLC_MULTI_DRAW_ARRAYS: return("glMultiDrawArrays");
+	case GLC_MULTI_DRAW_ELEMENTS: return("glMultiDrawElements");
+	case GLC_GEN_TEXTURES: return("glGenTextures");
+	case GLC_DELETE_TEXTURES: return("glDeleteTextures");
+	case GLC_BIND_TEXTURE: return("glBindTexture");
+	case GLC_ACTIVE_TEXTURE: return("glActiveTexture");
+	case GLC_TEX_PARAMETER_I: return("glTexParameteri");
+	case GLC_TEX_IMAGE_2D: return("glTexImage2D");
+	case GLC_GENERATE_MIPMAP: return("glGenerateMipmap");
+	case GLC_PIXEL_STORE_I: return("glPixelStorei");
+	case GLC_READ_BUFFER: return("glReadBuffer");
+	case GLC_READ_PIXELS: return("glReadPixels");
+	case GLC_GEN_BUFFERS: return("glGenBuffers");
+	case GLC_DELETE_BUFFERS: return("glDeleteBuffers");
+	case GLC_BIND_BUFFER: return("glBindBuffer");
+	case GLC_BUFFER_DATA: return("glBufferData");
+	case GLC_BUFFER_SUB_DATA: return("glBufferSubData");
+	case GLC_COPY_BUFFER_SUB_DATA: return("glCopyBufferSubData");
+	case GLC_GEN_VERTEX_ARRAYS: return("glGenVertexArrays");
+	case GLC_DELETE_VERTEX_ARRAYS: return("glDeleteVertexArrays");
+	case GLC_BIND_VERTEX_ARRAY: return("glBindVertexArray");
+	case GLC_VERTEX_ATTRIB_POINTER: return("glVertexAttribPointer");
+	case GLC_ENABLE_VERTEX_ATTRIB_ARRAY: return("glEnableVertexAttribArray");
+	case GLC_DISABLE_VERTEX_ATTRIB_ARRAY: return("glDisableVertexAttribArray");
+	case GLC_VERTEX_ATTRIB_4F: return("glVertexAttrib4f");
+	case GLC_GEN_FRAMEBUFFERS: return("glGenFramebuffers");
+	case GLC_DELETE_FRAMEBUFFERS: return("glDeleteFramebuffers");
+	case GLC_BIND_FRAMEBUFFER: return("glBindFramebuffer");
+	case GLC_FRAMEBUFFER_TEXTURE_2D: return("glFramebufferTexture2D");
+	case GLC_FRAMEBUFFER_RENDERBUFFER: return("glFramebufferRenderbuffer");
+	case GLC_GEN_RENDERBUFFERS: return("glGenRenderbuffers");
+	case GLC_DELETE_RENDERBUFFERS: return("glDeleteRenderbuffers");
+	case GLC_BIND_RENDERBUFFER: return("glBindRenderbuffer");
+	case GLC_RENDERBUFFER_STORAGE: return("glRenderbufferStorage");
+	case GLC_PRIMITIVE_RESTART_INDEX: return("glPrimitiveRestartIndex");
+	case GLC_USE_PROGRAM: return("glUseProgram");
+	case GLC_UNIFORM: return("glUniform");
+	case GLC_BUFFER_STORAGE: return("glBufferStorage");
+	case GLC_BUFFER_WRITE: return("MappedBufferWrite");
+	case GLC_BIND_BUFFER_RANGE: return("glBindBufferRange");
+	case GLC_UNIFORM_BLOCK_BINDING: return("glUniformBlockBinding");
+	case GLC_DRAW_BUFFER: return("glDrawBuffer");
+	case GLC_DRAW_BUFFERS: return("glDrawBuffers");
+	case GLC_SCISSOR: return("glScissor");
+	case GLC_DRAW_ELEMENTS_BASE_VERTEX: return("glDrawElementsBaseVertex");
+	case GLC_MEMORY_BARRIER: return("glMemoryBarrier");
+	case GLC_TEX_BUFFER: return("glTexBuffer");
+	case GLC_FRAME_END: return("FrameEnd");
+	}
+	return("unknown");
+}
+
+/***********************************************************
+ *  MapName()
+ *
+ *  This function is used to get the replay's name for a
+ *  captured object.  Objects the capture did not know,
+ *  such as ones made before the hooks were installed, map
+ *  to zero.
+ ***********************************************************/
+GLuint MapName(GLCAPTURE_OBJECT type, GLuint name)
+{
+	if (name == 0)
+	{
+		return(0);
+	}
+	std::unordered_map<GLuint, GLuint>::const_iterator found = g_Names[type].find(name);
+	return((found != g_Names[type].end()) ? found->second : 0);
+}
+
+/***********************************************************
+ *  ReadNames()
+ *
+ *  This function is used to read the names of a glGen* or
+ *  glDelete* record.
+ ***********************************************************/
+void ReadNames(GLCaptureReader& reader, std::vector<GLuint>& names)
+{
+	uint32_t n = reader.Get32();
+	names.clear();
+	for (uint32_t i = 0; (i < n) && (reader.IsFailed() == false); i++)
+	{
+		names.push_back(reader.Get32());
+	}
+}
+
+/***********************************************************
+ *  GetMedian()
+ *
+ *  This function is used to get the median of the timings
+ *  over the repetitions, which ignores the odd slow pass.
+ ***********************************************************/
+double GetMedian(std::vector<double> values)
+{
+	if (values.empty() == true)
+	{
+		return(0.0);
+	}
+	std::sort(values.begin(), values.end());
+	return(values[values.size() / 2]);
+}
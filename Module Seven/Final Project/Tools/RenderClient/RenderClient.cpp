@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+// RenderClient.cpp
+// ============
+// load generator for the render service, which keeps a number of requests in
+// flight on one connection and reports the round trip latency and throughput
+//
+// the service is started with "./FinalProject --render-service PATH".  The
+// camera orbits the platter, one step per request, unless a standard pose is
+// asked for.  The images arrive as sealed memfds and are only mapped, they
+// are written out as PPM files when a prefix is passed with --save
+//
+// usage: RenderClient --socket PATH [--requests N] [--in-flight N]
+//                     [--size WIDTHxHEIGHT] [--pose N] [--impostors]
+//                     [--platter SECONDS] [--save PREFIX]
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+
+#include "RenderServiceFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Namespace for declaring global variables
+namespace
+{
+	const int DEFAULT_REQUESTS = 200;
+	const int DEFAULT_IN_FLIGHT = 8;
+	const int DEFAULT_WIDTH = 640;
+	const int DEFAULT_HEIGHT = 480;
+	// the orbit around the platter, seen from the height and
+	// distance of the default camera
+	const float ORBIT_RADIUS = 12.0f;
+	const float ORBIT_HEIGHT = 5.0f;
+	const float ORBIT_TARGET_HEIGHT = 2.0f;
+	const float ORBIT_ZOOM = 80.0f;
+
+	const char* const USAGE =
+		"usage: RenderClient --socket PATH [--requests N] [--in-flight N]\n"
+		"                    [--size WIDTHxHEIGHT] [--pose N] [--impostors]\n"
+		"                    [--platter SECONDS] [--save PREFIX]";
+
+	// the command line settings
+	const char* g_SocketPath = NULL;
+	int g_Requests = DEFAULT_REQUESTS;
+	int g_InFlight = DEFAULT_IN_FLIGHT;
+	int g_Width = DEFAULT_WIDTH;
+	int g_Height = DEFAULT_HEIGHT;
+	int g_Pose = -1;
+	bool g_bImpostors = false;
+	float g_PlatterSeconds = 0.0f;
+	const char* g_SavePrefix = NULL;
+}
+
+// Function declarations
+int Connect(const char* socketPath);
+bool SendRequest(int connection, uint32_t id);
+bool ReceiveReply(int connection, RENDER_REPLY& reply, int& imageFile);
+bool CheckImage(int imageFile, const RENDER_REPLY& reply, const char* filename);
+double GetPercentile(const std::vector<double>& sorted, double fraction);
+double GetTimeMs();
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--socket") == 0) && (i + 1 < argc))
+		{
+			g_SocketPath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--requests") == 0) && (i + 1 < argc))
+		{
+			g_Requests = std::max(1, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--in-flight") == 0) && (i + 1 < argc))
+		{
+			g_InFlight = std::max(1, atoi(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 1 < argc))
+		{
+			if ((sscanf(argv[++i], "%dx%d", &g_Width, &g_Height) != 2) || (g_Width <= 0) || (g_Height <= 0))
+			{
+				std::cout << "ERROR: Cannot read the size " << argv[i] << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		else if ((strcmp(argv[i], "--pose") == 0) && (i + 1 < argc))
+		{
+			g_Pose = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--impostors") == 0)
+		{
+			g_bImpostors = true;
+		}
+		else if ((strcmp(argv[i], "--platter") == 0) && (i + 1 < argc))
+		{
+			g_PlatterSeconds = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--save") == 0) && (i + 1 < argc))
+		{
+			g_SavePrefix = argv[++i];
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown option " << argv[i] << std::endl;
+		}
+	}
+
+	if (NULL == g_SocketPath)
+	{
+		std::cout << USAGE << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+#ifndef __linux__
+	std::cout << "ERROR: RenderClient needs Linux for the memfd images" << std::endl;
+	return(EXIT_FAILURE);
+#endif
+
+	int connection = Connect(g_SocketPath);
+	if (connection < 0)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	std::vector<double> sentMs(g_Requests, 0.0);
+	std::vector<double> latencies;
+	double totalBatch = 0.0;
+	double totalQueueMs = 0.0;
+	double totalRenderMs = 0.0;
+	int nSent = 0;
+	int nReceived = 0;
+	int nFailed = 0;
+
+	// the requests are sent ahead of the replies, so the
+	// service has compatible ones to batch
+	double startMs = GetTimeMs();
+	while (nReceived < g_Requests)
+	{
+		while ((nSent < g_Requests) && (nSent - nReceived < g_InFlight))
+		{
+			sentMs[nSent] = GetTimeMs();
+			if (SendRequest(connection, (uint32_t)nSent) == false)
+			{
+				std::cout << "ERROR: The request could not be sent" << std::endl;
+				return(EXIT_FAILURE);
+			}
+			nSent++;
+		}
+
+		RENDER_REPLY reply;
+		int imageFile = -1;
+		if (ReceiveReply(connection, reply, imageFile) == false)
+		{
+			std::cout << "ERROR: The service closed the connection" << std::endl;
+			return(EXIT_FAILURE);
+		}
+		nReceived++;
+
+		if ((reply.magic != RENDER_SERVICE_MAGIC) || (reply.id >= (uint32_t)g_Requests))
+		{
+			std::cout << "ERROR: The reply is not for this client" << std::endl;
+			return(EXIT_FAILURE);
+		}
+		latencies.push_back(GetTimeMs() - sentMs[reply.id]);
+		totalBatch += reply.batchSize;
+		totalQueueMs += reply.queueMs;
+		totalRenderMs += reply.renderMs;
+
+		std::string filename;
+		if (NULL != g_SavePrefix)
+		{
+			filename = std::string(g_SavePrefix) + "_" + std::to_string(reply.id) + ".ppm";
+		}
+		if ((reply.status != RENDER_OK) ||
+			(CheckImage(imageFile, reply, (NULL != g_SavePrefix) ? filename.c_str() : NULL) == false))
+		{
+			std::cout << "WARNING: Request " << reply.id << " failed with status " << reply.status << std::endl;
+			nFailed++;
+		}
+#ifdef __linux__
+		if (imageFile >= 0)
+		{
+			close(imageFile);
+		}
+#endif
+	}
+	double seconds = (GetTimeMs() - startMs) / 1000.0;
+#ifdef __linux__
+	close(connection);
+#endif
+
+	std::sort(latencies.begin(), latencies.end());
+	double totalMs = 0.0;
+	for (size_t i = 0; i < latencies.size(); i++)
+	{
+		totalMs += latencies[i];
+	}
+
+	std::cout << "RENDER_CLIENT requests=" << g_Requests
+		<< " failed=" << nFailed
+		<< " in_flight=" << g_InFlight
+		<< " seconds=" << seconds
+		<< " requests_per_second=" << g_Requests / seconds
+		<< " average_ms=" << totalMs / latencies.size()
+		<< " p50_ms=" << GetPercentile(latencies, 0.5)
+		<< " p95_ms=" << GetPercentile(latencies, 0.95)
+		<< " max_ms=" << latencies.back()
+		<< " average_batch=" << totalBatch / g_Requests
+		<< " service_queue_ms=" << totalQueueMs / g_Requests
+		<< " service_render_ms=" << totalRenderMs / g_Requests << std::endl;
+
+	return((nFailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *  Connect()
+ *
+ *  This function is used to connect to the service socket,
+ *  returning -1 when it is not there.
+ ***********************************************************/
+int Connect(const char* socketPath)
+{
+#ifdef __linux__
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		std::cout << "ERROR: The socket path " << socketPath << " is too long" << std::endl;
+		return(-1);
+	}
+	strcpy(address.sun_path, socketPath);
+
+	int connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if ((connection < 0) || (connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0))
+	{
+		std::cout << "ERROR: Cannot connect to " << socketPath << ", " << strerror(errno) << std::endl;
+		if (connection >= 0)
+		{
+			close(connection);
+		}
+		return(-1);
+	}
+
+	return(connection);
+#else
+	return(-1);
+#endif
+}
+
+/***********************************************************
+ *  SendRequest()
+ *
+ *  This function is used to send one request, with the
+ *  camera at the step of the orbit given by its id, or at
+ *  the standard pose when one was asked for.
+ ***********************************************************/
+bool SendRequest(int connection, uint32_t id)
+{
+#ifdef __linux__
+	RENDER_REQUEST request;
+	memset(&request, 0, sizeof(request));
+	request.magic = RENDER_SERVICE_MAGIC;
+	request.version = RENDER_SERVICE_VERSION;
+	request.id = id;
+	request.pose = g_Pose;
+	request.width = (uint32_t)g_Width;
+	request.height = (uint32_t)g_Height;
+	request.clearColor[3] = 1.0f;
+	request.platterSeconds = g_PlatterSeconds;
+	request.flags = (g_bImpostors == true) ? RENDER_IMPOSTORS : 0;
+
+	float angle = 2.0f * (float)M_PI * (float)id / (float)g_Requests;
+	request.position[0] = ORBIT_RADIUS * sinf(angle);
+	request.position[1] = ORBIT_HEIGHT;
+	request.position[2] = ORBIT_RADIUS * cosf(angle);
+	request.front[0] = -request.position[0];
+	request.front[1] = ORBIT_TARGET_HEIGHT - ORBIT_HEIGHT;
+	request.front[2] = -request.position[2];
+	request.zoom = ORBIT_ZOOM;
+
+	return(send(connection, &request, sizeof(request), MSG_NOSIGNAL) == (ssize_t)sizeof(request));
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  ReceiveReply()
+ *
+ *  This function is used to wait for the next reply and
+ *  take the image memfd from its control data, -1 when it
+ *  carries none.
+ ***********************************************************/
+bool ReceiveReply(int connection, RENDER_REPLY& reply, int& imageFile)
+{
+#ifdef __linux__
+	struct iovec data;
+	data.iov_base = &reply;
+	data.iov_len = sizeof(reply);
+
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &data;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	ssize_t nReceived = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+	while ((nReceived < 0) && (errno == EINTR))
+	{
+		nReceived = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+	}
+	if (nReceived != (ssize_t)sizeof(reply))
+	{
+		return(false);
+	}
+
+	imageFile = -1;
+	struct cmsghdr* pHeader = CMSG_FIRSTHDR(&message);
+	if ((NULL != pHeader) && (pHeader->cmsg_level == SOL_SOCKET) && (pHeader->cmsg_type == SCM_RIGHTS))
+	{
+		memcpy(&imageFile, CMSG_DATA(pHeader), sizeof(int));
+	}
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  CheckImage()
+ *
+ *  This function is used to check that the image memfd is
+ *  sealed and holds the whole image, then map it and save
+ *  it when a filename is passed in.  The rows arrive
+ *  bottom up, PPM stores them top down.
+ ***********************************************************/
+bool CheckImage(int imageFile, const RENDER_REPLY& reply, const char* filename)
+{
+#ifdef __linux__
+	size_t bytes = (size_t)reply.stride * reply.height;
+	struct stat status;
+	if ((imageFile < 0) || (fstat(imageFile, &status) != 0) || ((size_t)status.st_size < bytes))
+	{
+		return(false);
+	}
+	int seals = fcntl(imageFile, F_GET_SEALS);
+	if ((seals < 0) || ((seals & F_SEAL_WRITE) == 0))
+	{
+		std::cout << "WARNING: The image of request " << reply.id << " is not sealed" << std::endl;
+	}
+
+	if (NULL == filename)
+	{
+		return(true);
+	}
+
+	const unsigned char* pImage = (const unsigned char*)mmap(NULL, bytes, PROT_READ, MAP_SHARED, imageFile, 0);
+	if ((const void*)pImage == MAP_FAILED)
+	{
+		return(false);
+	}
+
+	FILE* file = fopen(filename, "wb");
+	if (NULL == file)
+	{
+		std::cout << "ERROR: Cannot write " << filename << std::endl;
+		munmap((void*)pImage, bytes);
+		return(false);
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", reply.width, reply.height);
+	std::vector<unsigned char> row((size_t)reply.width * 3);
+	for (int y = (int)reply.height - 1; y >= 0; y--)
+	{
+		const unsigned char* pRow = pImage + (size_t)y * reply.stride;
+		for (uint32_t x = 0; x < reply.width; x++)
+		{
+			row[x * 3 + 0] = pRow[x * 4 + 0];
+			row[x * 3 + 1] = pRow[x * 4 + 1];
+			row[x * 3 + 2] = pRow[x * 4 + 2];
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	munmap((void*)pImage, bytes);
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  GetPercentile()
+ *
+ *  This function is used to get a percentile of sorted
+ *  values, the nearest rank.
+ ***********************************************************/
+double GetPercentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty() == true)
+	{
+		return(0.0);
+	}
+
+	size_t rank = (size_t)ceil(fraction * sorted.size());
+	return(sorted[std::min(sorted.size(), std::max((size_t)1, rank)) - 1]);
+}
+
+/***********************************************************
+ *  GetTimeMs()
+ *
+ *  This function is used to read the wall clock.
+ ***********************************************************/
+double GetTimeMs()
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// bakedFragmentShader.glsl
+// ============
+// fragment shader for drawing the scene with its diffuse lighting baked into
+// a per-vertex color stream - the shadowed diffuse light is a multiply, only
+// the unshadowed ambient and specular terms are lit here
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define MAX_LIGHTS 4
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec4 fragmentBakedLighting;
+
+out vec4 outFragmentColor;
+
+// camera of the frame, shared with the vertex shader
+layout (std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform sampler2D objectTexture;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform Material material;
+uniform LightSource lightSources[MAX_LIGHTS];
+
+void main()
+{
+	vec4 surfaceColor = objectColor;
+	if (bUseTexture == true)
+	{
+		surfaceColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+	}
+
+	if (bUseLighting == false)
+	{
+		outFragmentColor = surfaceColor;
+		return;
+	}
+
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+
+	// the ambient and specular light of the scene shader,
+	// which do not depend on the shadows
+	vec3 ambientLight = vec3(0.0f);
+	vec3 specular = vec3(0.0f);
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		ambientLight += lightSources[i].ambientColor;
+
+		vec3 lightDirection = normalize(lightSources[i].position - fragmentPosition);
+		vec3 reflectDirection = reflect(-lightDirection, normal);
+		float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), lightSources[i].focalStrength);
+		specular += lightSources[i].specularIntensity * specularComponent * lightSources[i].specularColor;
+	}
+
+	// rgb holds the baked diffuse light, alpha is the open
+	// part of the hemisphere, which only darkens the ambient
+	// light in occluded corners
+	vec3 ambient = ambientLight * material.ambientColor * material.ambientStrength * fragmentBakedLighting.a;
+	vec3 diffuse = fragmentBakedLighting.rgb * material.diffuseColor;
+	specular *= material.specularColor;
+
+	outFragmentColor = vec4((ambient + diffuse + specular) * surfaceColor.rgb, surfaceColor.a);
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// bakedVertexShader.glsl
+// ============
+// vertex shader for drawing the scene with its lighting baked into a
+// per-vertex color stream
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+layout (location = 3) in vec4 inBakedLighting;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec4 fragmentBakedLighting;
+
+// camera of the frame, replaced just before the draws are
+// recorded when the camera is late latched
+layout (std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+// transforms and bounds of the scene objects, five texels
+// per object - the model columns and the bounding sphere
+uniform samplerBuffer staticObjects;
+uniform samplerBuffer dynamicObjects;
+// record of the drawn object, negative indices count down
+// from -1 in the dynamic objects
+uniform int objectIndex;
+
+mat4 GetObjectModel()
+{
+	int first = ((objectIndex >= 0) ? objectIndex : -1 - objectIndex) * 5;
+	if (objectIndex >= 0)
+	{
+		return mat4(
+			texelFetch(staticObjects, first),
+			texelFetch(staticObjects, first + 1),
+			texelFetch(staticObjects, first + 2),
+			texelFetch(staticObjects, first + 3));
+	}
+	return mat4(
+		texelFetch(dynamicObjects, first),
+		texelFetch(dynamicObjects, first + 1),
+		texelFetch(dynamicObjects, first + 2),
+		texelFetch(dynamicObjects, first + 3));
+}
+
+void main()
+{
+	mat4 model = GetObjectModel();
+	gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+
+	// the specular light is still lit per fragment
+	fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0f));
+	fragmentVertexNormal = mat3(transpose(inverse(model))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+	fragmentBakedLighting = inBakedLighting;
+}
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// heatmapFragmentShader.glsl
+// ============
+// fragment shader mapping the per-pixel fragment counts to a heatmap - black
+// where nothing was drawn, then blue, cyan, green, yellow and red as the
+// overdraw rises to the heatmap scale, and white above it
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D overdrawCounts;
+uniform float heatmapScale = 8.0f;
+
+const vec3 heatColors[5] = vec3[5](
+	vec3(0.0f, 0.0f, 1.0f),
+	vec3(0.0f, 1.0f, 1.0f),
+	vec3(0.0f, 1.0f, 0.0f),
+	vec3(1.0f, 1.0f, 0.0f),
+	vec3(1.0f, 0.0f, 0.0f));
+
+void main()
+{
+	float count = texture(overdrawCounts, fragmentTextureCoordinate).r;
+
+	if (count < 0.5f)
+	{
+		outFragmentColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		return;
+	}
+	if (count > heatmapScale + 0.5f)
+	{
+		outFragmentColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		return;
+	}
+
+	// one fragment maps to the first color, the scale to the last
+	float t = clamp((count - 1.0f) / max(heatmapScale - 1.0f, 1.0f), 0.0f, 1.0f) * 4.0f;
+	int index = min(int(t), 3);
+
+	outFragmentColor = vec4(mix(heatColors[index], heatColors[index + 1], t - float(index)), 1.0f);
+}
@@ -0,0 +1,17 @@
+///////////////////////////////////////////////////////////////////////////////
+// heatmapVertexShader.glsl
+// ============
+// vertex shader for a full screen triangle, generated from the vertex index
+// so no vertex buffer is needed
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+	fragmentTextureCoordinate = position;
+	gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,16 @@
+///////////////////////////////////////////////////////////////////////////////
+// hlodFragmentShader.glsl
+// ============
+// fragment shader for drawing the proxies of far clusters - the baked color
+// is the whole surface, no textures and no lights
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec4 fragmentColor;
+
+out vec4 outFragmentColor;
+
+void main()
+{
+	outFragmentColor = fragmentColor;
+}
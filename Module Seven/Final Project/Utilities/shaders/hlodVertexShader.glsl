@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+// hlodVertexShader.glsl
+// ============
+// vertex shader for drawing the proxies of far clusters, already in world
+// space with their lighting baked into the vertex colors
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec4 inVertexColor;
+
+out vec4 fragmentColor;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+	gl_Position = viewProjection * vec4(inVertexPosition, 1.0f);
+
+	fragmentColor = inVertexColor;
+}
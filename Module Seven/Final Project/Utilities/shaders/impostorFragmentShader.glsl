@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorFragmentShader.glsl
+// ============
+// fragment shader that ray casts the exact surface of a sphere, cylinder or
+// cone inside its bounding box, writing the depth of the hit and lighting it
+// like the scene shader does
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+#extension GL_ARB_conservative_depth : enable
+
+const int SHAPE_SPHERE = 0;
+const int SHAPE_CYLINDER = 1;
+const int SHAPE_CONE = 2;
+
+// bits of the drawn parts, as in ShapeMeshes::MESH_PART
+const int PART_BOTTOM = 1;
+const int PART_TOP = 2;
+const int PART_SIDES = 4;
+
+const float PI = 3.14159265f;
+const float NO_HIT = 1.0e30f;
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define MAX_LIGHTS 4
+
+in vec3 rayOrigin;
+in vec3 rayDirection;
+flat in mat3 normalMatrix;
+
+out vec4 outFragmentColor;
+
+#ifdef GL_ARB_conservative_depth
+// the surface is always in front of the back face of the
+// box, so the depth test can still reject early
+layout (depth_less) out float gl_FragDepth;
+#endif
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPosition;
+
+uniform int primitiveShape;
+uniform int primitiveParts;
+uniform bool bHalfSphere;
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform sampler2D objectTexture;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform Material material;
+uniform LightSource lightSources[MAX_LIGHTS];
+
+// the nearest hit so far, in object space - the texture
+// coordinates match the ones of the triangle meshes
+float hitDistance = NO_HIT;
+vec3 hitNormal;
+vec2 hitTextureCoordinate;
+
+void SetHit(float t, vec3 normal, vec2 textureCoordinate)
+{
+	hitDistance = t;
+	hitNormal = normal;
+	hitTextureCoordinate = textureCoordinate;
+}
+
+// the caps of the cylinder and the bottom of the cone are
+// unit disks at the passed in height
+void IntersectDisk(float height, float normalY)
+{
+	if (rayDirection.y == 0.0f)
+	{
+		return;
+	}
+
+	float t = (height - rayOrigin.y) / rayDirection.y;
+	vec3 p = rayOrigin + t * rayDirection;
+	if ((t > 0.0f) && (t < hitDistance) && (dot(p.xz, p.xz) <= 1.0f))
+	{
+		SetHit(t, vec3(0.0f, normalY, 0.0f), vec2(0.5f + 0.5f * p.z, 0.5f + 0.5f * p.x));
+	}
+}
+
+void IntersectSphere()
+{
+	float a = dot(rayDirection, rayDirection);
+	float b = dot(rayOrigin, rayDirection);
+	float c = dot(rayOrigin, rayOrigin) - 1.0f;
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f)
+	{
+		return;
+	}
+
+	// the far side is seen through the open half sphere
+	float root = sqrt(discriminant);
+	for (int i = 0; i < 2; i++)
+	{
+		float t = (-b + ((i == 0) ? -root : root)) / a;
+		vec3 p = rayOrigin + t * rayDirection;
+		if ((t <= 0.0f) || (t >= hitDistance) || ((bHalfSphere == true) && (p.y < 0.0f)))
+		{
+			continue;
+		}
+
+		// the sphere mesh spreads u over each ring by its
+		// radius, and v follows the angle from the top
+		vec2 textureCoordinate = vec2(
+			0.5f + atan(p.x, p.z) / (2.0f * PI) * length(p.xz),
+			1.0f - acos(clamp(p.y, -1.0f, 1.0f)) / PI);
+		SetHit(t, p, textureCoordinate);
+		return;
+	}
+}
+
+void IntersectCylinderSides()
+{
+	float a = dot(rayDirection.xz, rayDirection.xz);
+	float b = dot(rayOrigin.xz, rayDirection.xz);
+	float c = dot(rayOrigin.xz, rayOrigin.xz) - 1.0f;
+	float discriminant = b * b - a * c;
+	if ((a == 0.0f) || (discriminant < 0.0f))
+	{
+		return;
+	}
+
+	float root = sqrt(discriminant);
+	for (int i = 0; i < 2; i++)
+	{
+		float t = (-b + ((i == 0) ? -root : root)) / a;
+		vec3 p = rayOrigin + t * rayDirection;
+		if ((t <= 0.0f) || (t >= hitDistance) || (p.y < 0.0f) || (p.y > 1.0f))
+		{
+			continue;
+		}
+
+		float u = atan(-p.z, p.x) / (2.0f * PI);
+		SetHit(t, vec3(p.x, 0.0f, p.z), vec2((u < 0.0f) ? u + 1.0f : u, p.y));
+		return;
+	}
+}
+
+void IntersectConeSides()
+{
+	// x^2 + z^2 = (1 - y)^2 with the apex at the top
+	float height = 1.0f - rayOrigin.y;
+	float a = dot(rayDirection.xz, rayDirection.xz) - rayDirection.y * rayDirection.y;
+	float b = dot(rayOrigin.xz, rayDirection.xz) + height * rayDirection.y;
+	float c = dot(rayOrigin.xz, rayOrigin.xz) - height * height;
+	float discriminant = b * b - a * c;
+	if ((a == 0.0f) || (discriminant < 0.0f))
+	{
+		return;
+	}
+
+	float root = sqrt(discriminant);
+	float t0 = (-b - root) / a;
+	float t1 = (-b + root) / a;
+	for (int i = 0; i < 2; i++)
+	{
+		float t = (i == 0) ? min(t0, t1) : max(t0, t1);
+		vec3 p = rayOrigin + t * rayDirection;
+		if ((t <= 0.0f) || (t >= hitDistance) || (p.y < 0.0f) || (p.y > 1.0f))
+		{
+			continue;
+		}
+
+		SetHit(t, vec3(p.x, 1.0f - p.y, p.z), vec2(0.5f + 0.5f * p.x, 0.5f - 0.5f * p.z));
+		return;
+	}
+}
+
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+
+	vec3 lightDirection = normalize(light.position - vertexPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	vec3 diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	vec3 specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+	return(ambient + diffuse + specular);
+}
+
+void main()
+{
+	if (primitiveShape == SHAPE_SPHERE)
+	{
+		IntersectSphere();
+	}
+	else
+	{
+		if ((primitiveParts & PART_SIDES) != 0)
+		{
+			if (primitiveShape == SHAPE_CYLINDER)
+			{
+				IntersectCylinderSides();
+			}
+			else
+			{
+				IntersectConeSides();
+			}
+		}
+		if ((primitiveParts & PART_BOTTOM) != 0)
+		{
+			IntersectDisk(0.0f, -1.0f);
+		}
+		if (((primitiveParts & PART_TOP) != 0) && (primitiveShape == SHAPE_CYLINDER))
+		{
+			IntersectDisk(1.0f, 1.0f);
+		}
+	}
+
+	if (hitDistance == NO_HIT)
+	{
+		discard;
+	}
+
+	// the depth of the hit replaces the depth of the box
+	vec3 fragmentPosition = vec3(model * vec4(rayOrigin + hitDistance * rayDirection, 1.0f));
+	vec4 clipPosition = projection * view * vec4(fragmentPosition, 1.0f);
+	float depth = clipPosition.z / clipPosition.w;
+	gl_FragDepth = (gl_DepthRange.diff * depth + gl_DepthRange.near + gl_DepthRange.far) * 0.5f;
+
+	vec4 surfaceColor = objectColor;
+	if (bUseTexture == true)
+	{
+		surfaceColor = texture(objectTexture, hitTextureCoordinate * UVscale);
+	}
+
+	if (bUseLighting == false)
+	{
+		outFragmentColor = surfaceColor;
+		return;
+	}
+
+	vec3 normal = normalize(normalMatrix * hitNormal);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+
+	vec3 phongResult = vec3(0.0f);
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		phongResult += CalcLightSource(lightSources[i], normal, fragmentPosition, viewDirection);
+	}
+
+	outFragmentColor = vec4(phongResult * surfaceColor.rgb, surfaceColor.a);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorVertexShader.glsl
+// ============
+// vertex shader for drawing a sphere, cylinder or cone as its bounding box,
+// sending the fragment shader the view ray in object space
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+const int SHAPE_SPHERE = 0;
+
+layout (location = 0) in vec3 inVertexPosition;
+
+// view ray through the box, in the object space of the
+// primitive - both are linear over the box, so they are
+// interpolated exactly
+out vec3 rayOrigin;
+out vec3 rayDirection;
+// turns object space normals into world space
+flat out mat3 normalMatrix;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPosition;
+
+uniform int primitiveShape;
+uniform bool bHalfSphere;
+
+void main()
+{
+	// the box corners are at -1 and 1, only full spheres
+	// reach below zero in height
+	vec3 position = inVertexPosition;
+	if ((primitiveShape != SHAPE_SPHERE) || (bHalfSphere == true))
+	{
+		position.y = position.y * 0.5f + 0.5f;
+	}
+
+	gl_Position = projection * view * model * vec4(position, 1.0f);
+
+	mat4 inverseModel = inverse(model);
+	normalMatrix = transpose(mat3(inverseModel));
+
+	if (projection[2][3] == 0.0f)
+	{
+		// orthographic rays run along the view direction,
+		// starting well in front of the box
+		vec3 forward = -vec3(view[0][2], view[1][2], view[2][2]);
+		rayDirection = mat3(inverseModel) * forward;
+		rayOrigin = position - rayDirection * (4.0f / length(rayDirection));
+	}
+	else
+	{
+		rayOrigin = vec3(inverseModel * vec4(viewPosition, 1.0f));
+		rayDirection = position - rayOrigin;
+	}
+}
@@ -0,0 +1,14 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawFragmentShader.glsl
+// ============
+// fragment shader for counting the fragments drawn to each pixel - with
+// additive blending every fragment adds one to the counting target
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec4 outFragmentCount;
+
+void main()
+{
+	outFragmentCount = vec4(1.0f, 0.0f, 0.0f, 0.0f);
+}
@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// thumbnailFragmentShader.glsl
+// ============
+// fragment shader of the thumbnail workers - the object color, or texture
+// times the tint in the color, lit by the ambient light and the diffuse term
+// of each scene light
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform vec4 objectColor;
+uniform bool bUseTexture;
+uniform sampler2D objectTexture;
+uniform vec3 lightPositions[4];
+uniform vec3 lightColors[4];
+uniform vec3 ambientColor;
+uniform int lightCount;
+
+void main()
+{
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 lighting = ambientColor;
+
+	for (int i = 0; i < lightCount; i++)
+	{
+		vec3 lightDirection = normalize(lightPositions[i] - fragmentPosition);
+		lighting += max(dot(normal, lightDirection), 0.0f) * lightColors[i];
+	}
+
+	vec4 surfaceColor = objectColor;
+	if (bUseTexture == true)
+	{
+		surfaceColor = texture(objectTexture, fragmentTextureCoordinate) * objectColor;
+	}
+
+	outFragmentColor = vec4(min(lighting, vec3(1.0f)) * surfaceColor.rgb, surfaceColor.a);
+}
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// thumbnailVertexShader.glsl
+// ============
+// vertex shader of the thumbnail workers - the captured objects drawn from the
+// shared mesh buffers with their model transform and texture scale
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+uniform mat4 model;
+uniform mat4 viewProjection;
+uniform vec2 UVscale;
+
+void main()
+{
+	vec4 worldPosition = model * vec4(inVertexPosition, 1.0f);
+	gl_Position = viewProjection * worldPosition;
+
+	fragmentPosition = worldPosition.xyz;
+	fragmentVertexNormal = mat3(transpose(inverse(model))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate * UVscale;
+}
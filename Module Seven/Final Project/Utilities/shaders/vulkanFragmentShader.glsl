@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// vulkanFragmentShader.glsl
+// ============
+// fragment shader of the Vulkan backend - the object texture or color lit
+// by the ambient, diffuse and specular light of the scene lights and the
+// object material, the same as the scene shader.  Compile to SPIR-V next to
+// this file with
+//     glslangValidator -V -S frag vulkanFragmentShader.glsl -o vulkanFragmentShader.spv
+///////////////////////////////////////////////////////////////////////////////
+#version 450
+
+#define MAX_LIGHTS 4
+#define MAX_MATERIALS 16
+
+struct Material
+{
+	vec4 ambientColor;      // w holds the ambient strength
+	vec4 diffuseColor;
+	vec4 specularColor;     // w holds the shininess
+};
+
+struct LightSource
+{
+	vec4 position;          // w holds the specular intensity
+	vec4 ambientColor;
+	vec4 diffuseColor;
+	vec4 specularColor;     // w holds the focal strength
+};
+
+layout (location = 0) in vec3 fragmentPosition;
+layout (location = 1) in vec3 fragmentVertexNormal;
+layout (location = 2) in vec2 fragmentTextureCoordinate;
+
+layout (location = 0) out vec4 outFragmentColor;
+
+layout (set = 0, binding = 0) uniform SceneBlock
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+	LightSource lightSources[MAX_LIGHTS];
+	Material materials[MAX_MATERIALS];
+} scene;
+
+// a white texel is bound for the objects without a texture
+layout (set = 1, binding = 0) uniform sampler2D objectTexture;
+
+layout (push_constant) uniform ObjectBlock
+{
+	mat4 model;
+	vec4 color;
+	vec2 UVscale;
+	int material;           // negative without a material
+	uint bUseTexture;
+} object;
+
+void main()
+{
+	vec4 surfaceColor = object.color;
+	if (object.bUseTexture != 0)
+	{
+		surfaceColor = texture(objectTexture, fragmentTextureCoordinate * object.UVscale);
+	}
+
+	// objects without a material get no light, like a
+	// material left unset in the scene shader
+	Material material = Material(vec4(0.0f), vec4(0.0f), vec4(0.0f));
+	if (object.material >= 0)
+	{
+		material = scene.materials[object.material];
+	}
+
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(scene.cameraPosition.xyz - fragmentPosition);
+
+	vec3 ambientLight = vec3(0.0f);
+	vec3 diffuseLight = vec3(0.0f);
+	vec3 specular = vec3(0.0f);
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		LightSource light = scene.lightSources[i];
+		ambientLight += light.ambientColor.rgb;
+
+		vec3 lightDirection = normalize(light.position.xyz - fragmentPosition);
+		diffuseLight += max(dot(normal, lightDirection), 0.0f) * light.diffuseColor.rgb;
+
+		vec3 reflectDirection = reflect(-lightDirection, normal);
+		float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.specularColor.w);
+		specular += light.position.w * specularComponent * light.specularColor.rgb;
+	}
+
+	vec3 ambient = ambientLight * material.ambientColor.rgb * material.ambientColor.w;
+	vec3 diffuse = diffuseLight * material.diffuseColor.rgb;
+	specular *= material.specularColor.rgb;
+
+	outFragmentColor = vec4((ambient + diffuse + specular) * surfaceColor.rgb, surfaceColor.a);
+}
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// vulkanVertexShader.glsl
+// ============
+// vertex shader of the Vulkan backend - the camera comes from the scene
+// block, the model transform of each object is a push constant.  Compile to
+// SPIR-V next to this file with
+//     glslangValidator -V -S vert vulkanVertexShader.glsl -o vulkanVertexShader.spv
+///////////////////////////////////////////////////////////////////////////////
+#version 450
+
+#define MAX_LIGHTS 4
+#define MAX_MATERIALS 16
+
+struct Material
+{
+	vec4 ambientColor;      // w holds the ambient strength
+	vec4 diffuseColor;
+	vec4 specularColor;     // w holds the shininess
+};
+
+struct LightSource
+{
+	vec4 position;          // w holds the specular intensity
+	vec4 ambientColor;
+	vec4 diffuseColor;
+	vec4 specularColor;     // w holds the focal strength
+};
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+layout (location = 0) out vec3 fragmentPosition;
+layout (location = 1) out vec3 fragmentVertexNormal;
+layout (location = 2) out vec2 fragmentTextureCoordinate;
+
+layout (set = 0, binding = 0) uniform SceneBlock
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+	LightSource lightSources[MAX_LIGHTS];
+	Material materials[MAX_MATERIALS];
+} scene;
+
+layout (push_constant) uniform ObjectBlock
+{
+	mat4 model;
+	vec4 color;
+	vec2 UVscale;
+	int material;           // negative without a material
+	uint bUseTexture;
+} object;
+
+void main()
+{
+	vec4 worldPosition = object.model * vec4(inVertexPosition, 1.0f);
+	gl_Position = scene.viewProjection * worldPosition;
+
+	fragmentPosition = worldPosition.xyz;
+	fragmentVertexNormal = mat3(transpose(inverse(object.model))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+}